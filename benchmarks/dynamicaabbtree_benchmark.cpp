@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "dynamicaabbtree.h"
+
+// Actors are scattered with the same density at every count, so queries return about as many of them
+static constexpr size_t ACTOR_COUNTS[] = { 10000, 100000, 1000000 };
+static constexpr float  ACTOR_SPACING = 4.f;
+static constexpr float  ACTOR_SIZE    = 1.f;
+
+static constexpr size_t MOVE_FRAMES    = 10;
+static constexpr float  MOVE_STEP      = 0.05f; // Most moves stay inside the fat boxes
+static constexpr size_t QUERY_COUNT    = 1000;
+static constexpr float  QUERY_SIZE     = 20.f;
+static constexpr float  FRUSTUM_FAR    = 100.f;
+
+template <typename F>
+double measure(F &&function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    function();
+    auto end = std::chrono::high_resolution_clock::now();
+
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static BoundingBox make_box(const glm::vec3 &center, float size);
+static bool overlaps(const BoundingBox &, const BoundingBox &);
+
+void run(size_t actor_count)
+{
+    std::mt19937 random(1);
+
+    float world_size = std::cbrt(static_cast<float>(actor_count)) * ACTOR_SPACING;
+    std::uniform_real_distribution<float> position(0.f, world_size);
+    std::uniform_real_distribution<float> step(-MOVE_STEP, MOVE_STEP);
+
+    std::vector<glm::vec3> centers(actor_count);
+    for(auto &&center : centers)
+        center = glm::vec3(position(random), position(random), position(random));
+
+    DynamicAabbTree tree;
+    std::vector<DynamicAabbTree::Proxy> proxies(actor_count);
+
+    double insert_time = measure([&]
+    {
+        for(size_t i = 0; i < actor_count; ++i)
+            proxies[i] = tree.insert(make_box(centers[i], ACTOR_SIZE), static_cast<uint32_t>(i));
+    });
+
+    size_t reinserted = 0;
+    double move_time = measure([&]
+    {
+        for(size_t frame = 0; frame < MOVE_FRAMES; ++frame)
+        for(size_t i = 0; i < actor_count; ++i)
+        {
+            centers[i] += glm::vec3(step(random), step(random), step(random));
+            reinserted += tree.move(proxies[i], make_box(centers[i], ACTOR_SIZE))? 1 : 0;
+        }
+    });
+
+    std::vector<glm::vec3> query_centers(QUERY_COUNT);
+    for(auto &&center : query_centers)
+        center = glm::vec3(position(random), position(random), position(random));
+
+    std::vector<uint32_t> results;
+    size_t box_results = 0;
+    double box_query_time = measure([&]
+    {
+        for(auto &&center : query_centers)
+        {
+            results.clear();
+            tree.query(make_box(center, QUERY_SIZE), results);
+            box_results += results.size();
+        }
+    });
+
+    // Linear scan over the fat boxes, for reference and to check the tree
+    size_t scanned_results = 0;
+    double scan_time = measure([&]
+    {
+        for(auto &&center : query_centers)
+        {
+            auto query = make_box(center, QUERY_SIZE);
+            for(auto proxy : proxies)
+                scanned_results += overlaps(tree.get_fat_box(proxy), query)? 1 : 0;
+        }
+    });
+
+    size_t frustum_results = 0;
+    double frustum_query_time = measure([&]
+    {
+        auto projection = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, FRUSTUM_FAR);
+        for(auto &&center : query_centers)
+        {
+            auto view = glm::lookAt(center, center + glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f));
+
+            results.clear();
+            tree.query(Frustum(projection * view), results);
+            frustum_results += results.size();
+        }
+    });
+
+    std::printf
+    (
+        "%8zu actors, height %3d: insert %8.2f ms, move %7.2f ms/frame (%5.2f%% reinserted), "
+        "box query %7.2f us (%6.1f results, scan %8.2f us), frustum query %8.2f us (%7.1f results)%s\n",
+        actor_count,
+        tree.get_height(),
+        insert_time,
+        move_time / MOVE_FRAMES,
+        100.0 * reinserted / (actor_count * MOVE_FRAMES),
+        box_query_time * 1000.0 / QUERY_COUNT,
+        static_cast<double>(box_results) / QUERY_COUNT,
+        scan_time * 1000.0 / QUERY_COUNT,
+        frustum_query_time * 1000.0 / QUERY_COUNT,
+        static_cast<double>(frustum_results) / QUERY_COUNT,
+        box_results == scanned_results? "" : ", MISMATCH"
+    );
+}
+
+int main()
+{
+    for(auto actor_count : ACTOR_COUNTS)
+        run(actor_count);
+
+    return 0;
+}
+
+static BoundingBox make_box(const glm::vec3 &center, float size)
+{
+    return { center - glm::vec3(size * 0.5f), center + glm::vec3(size * 0.5f) };
+}
+
+static bool overlaps(const BoundingBox &a, const BoundingBox &b)
+{
+    return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+}
\ No newline at end of file
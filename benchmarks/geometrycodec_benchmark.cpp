@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "geometrycodec.h"
+
+// Same layout as StaticMesh::Vertex, without the Vulkan dependencies of its header
+struct BenchmarkVertex
+{
+    float position[3];
+    float normal[3];
+    float uv[2];
+    float color[3];
+};
+
+static constexpr size_t GRID_SIZE   = 1024;
+static constexpr int    REPETITIONS = 10;
+
+// Milliseconds of the fastest repetition
+template <typename F>
+double measure(F &&function)
+{
+    double best = INFINITY;
+    for(int i = 0; i < REPETITIONS; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        function();
+        auto end = std::chrono::high_resolution_clock::now();
+
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    return best;
+}
+
+void report(const char *name, size_t raw_size, size_t encoded_size, double encode_time, double decode_time);
+
+int main()
+{
+    // Noisy height field, neighbouring vertices are close like in a real mesh
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> noise(-0.05f, 0.05f);
+
+    std::vector<BenchmarkVertex> vertices(GRID_SIZE * GRID_SIZE);
+    for(size_t y = 0; y < GRID_SIZE; ++y)
+    for(size_t x = 0; x < GRID_SIZE; ++x)
+    {
+        auto &vertex = vertices[y * GRID_SIZE + x];
+        float height = std::sin(x * 0.05f) * std::cos(y * 0.05f) + noise(random);
+
+        vertex = { { float(x), height, float(y) }, { 0.f, 1.f, 0.f }, { x / float(GRID_SIZE), y / float(GRID_SIZE) }, { 1.f, 1.f, 1.f } };
+    }
+
+    std::vector<MeshElementIndex> indices;
+    indices.reserve((GRID_SIZE - 1) * (GRID_SIZE - 1) * 6);
+    for(MeshElementIndex y = 0; y + 1 < GRID_SIZE; ++y)
+    for(MeshElementIndex x = 0; x + 1 < GRID_SIZE; ++x)
+    {
+        MeshElementIndex corner = y * GRID_SIZE + x;
+        MeshElementIndex below  = corner + GRID_SIZE;
+        indices.insert(indices.end(), { corner, below, corner + 1, corner + 1, below, below + 1 });
+    }
+
+    std::vector<uint8_t> encoded_vertices;
+    std::vector<BenchmarkVertex> decoded_vertices(vertices.size());
+    double vertex_encode_time = measure([&]
+    {
+        encoded_vertices = GeometryCodec::encode_vertices(vertices.data(), vertices.size(), sizeof(BenchmarkVertex));
+    });
+    double vertex_decode_time = measure([&]
+    {
+        GeometryCodec::decode_vertices(encoded_vertices.data(), encoded_vertices.size(), decoded_vertices.data(), decoded_vertices.size(), sizeof(BenchmarkVertex));
+    });
+
+    std::vector<uint8_t> encoded_indices;
+    std::vector<MeshElementIndex> decoded_indices(indices.size());
+    double index_encode_time = measure([&]
+    {
+        encoded_indices = GeometryCodec::encode_indices(indices.data(), indices.size());
+    });
+    double index_decode_time = measure([&]
+    {
+        GeometryCodec::decode_indices(encoded_indices.data(), encoded_indices.size(), decoded_indices.data(), decoded_indices.size());
+    });
+
+    if
+    (
+        std::memcmp(decoded_vertices.data(), vertices.data(), vertices.size() * sizeof(BenchmarkVertex)) != 0 ||
+        decoded_indices != indices
+    )
+    {
+        std::printf("Decoded geometry doesn't match\n");
+        return 1;
+    }
+
+    report("vertices", vertices.size() * sizeof(BenchmarkVertex), encoded_vertices.size(), vertex_encode_time, vertex_decode_time);
+    report("indices", indices.size() * sizeof(MeshElementIndex), encoded_indices.size(), index_encode_time, index_decode_time);
+
+    return 0;
+}
+
+void report(const char *name, size_t raw_size, size_t encoded_size, double encode_time, double decode_time)
+{
+    double megabytes = raw_size / (1024.0 * 1024.0);
+
+    std::printf
+    (
+        "%-8s %8.1f MB -> %7.1f MB (%5.1f%%), encode %7.2f ms (%6.0f MB/s), decode %7.2f ms (%6.0f MB/s)\n",
+        name,
+        megabytes,
+        encoded_size / (1024.0 * 1024.0),
+        100.0 * encoded_size / raw_size,
+        encode_time,
+        megabytes / encode_time * 1000.0,
+        decode_time,
+        megabytes / decode_time * 1000.0
+    );
+}
\ No newline at end of file
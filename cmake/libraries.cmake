@@ -25,6 +25,7 @@ set(${CMAKE_PROJECT_NAME}_LIBRARIES
 )
 
 set(TEST_LIBRARIES
+    gtest_main${crt_type}
     gtest${crt_type}
     gmock${crt_type}
 )
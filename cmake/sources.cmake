@@ -21,6 +21,24 @@ file(GLOB ${CMAKE_PROJECT_NAME}_SOURCES
     ${${CMAKE_PROJECT_NAME}_${SYSTEM}_SOURCES}
 )
 
+# Engine sources tests and benchmarks are built with, they don't touch the device
+set(${CMAKE_PROJECT_NAME}_TESTED_SOURCES
+    ${CMAKE_SOURCE_DIR}/src/dynamicaabbtree.cpp
+    ${CMAKE_SOURCE_DIR}/src/frustum.cpp
+    ${CMAKE_SOURCE_DIR}/src/geometrycodec.cpp
+    ${CMAKE_SOURCE_DIR}/src/gltfloader.cpp
+    ${CMAKE_SOURCE_DIR}/src/json.cpp
+    ${CMAKE_SOURCE_DIR}/src/mappedfile.cpp
+)
+
+file(GLOB ${CMAKE_PROJECT_NAME}_TESTS_SOURCES
+    ${CMAKE_SOURCE_DIR}/tests/*.cpp
+)
+
+file(GLOB ${CMAKE_PROJECT_NAME}_BENCHMARKS_SOURCES
+    ${CMAKE_SOURCE_DIR}/benchmarks/*.cpp
+)
+
 file(GLOB ${CMAKE_PROJECT_NAME}_SHADERS
     ${CMAKE_SOURCE_DIR}/src/shaders/*.vert
     ${CMAKE_SOURCE_DIR}/src/shaders/*.frag
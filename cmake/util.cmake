@@ -111,4 +111,24 @@ macro(copy_target_dlls target_name)
     foreach(dll ${dlls})
         file(COPY ${dll} DESTINATION ${CMAKE_CURRENT_BINARY_DIR}/${CMAKE_BUILD_TYPE})
     endforeach(dll ${dlls})
+endmacro()
+
+macro(add_unit_tests project_name)
+    enable_testing()
+
+    add_executable(${project_name}_tests ${${project_name}_TESTS_SOURCES} ${${project_name}_TESTED_SOURCES})
+    target_include_directories(${project_name}_tests PRIVATE ${CMAKE_SOURCE_DIR}/src)
+    target_link_libraries(${project_name}_tests ${TEST_LIBRARIES} ${${project_name}_LIBRARIES})
+    add_test(NAME ${project_name}_tests COMMAND ${project_name}_tests)
+endmacro()
+
+# Executable per source file, named after it
+macro(add_benchmarks project_name)
+    foreach(source ${${project_name}_BENCHMARKS_SOURCES})
+        get_filename_component(benchmark ${source} NAME_WE)
+
+        add_executable(${benchmark} ${source} ${${project_name}_TESTED_SOURCES})
+        target_include_directories(${benchmark} PRIVATE ${CMAKE_SOURCE_DIR}/src)
+        target_link_libraries(${benchmark} ${${project_name}_LIBRARIES})
+    endforeach()
 endmacro()
\ No newline at end of file
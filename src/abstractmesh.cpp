@@ -1,11 +1,50 @@
 #include "abstractmesh.h"
 
 static size_t default_mesh_id = 0;
+static const AbstractMesh::VertexStreams empty_vertex_streams;
 
 AbstractMesh::AbstractMesh()
-: Actor("mesh" + std::to_string(default_mesh_id++))
+: AbstractMesh("mesh" + std::to_string(default_mesh_id++))
 {}
 
 AbstractMesh::AbstractMesh(std::string_view id)
-: Actor(id)
-{}
\ No newline at end of file
+: Actor(id),
+vertex_streams(&empty_vertex_streams)
+{
+    kind = SceneNodeKind::MESH;
+}
+
+size_t AbstractMesh::get_vertex_count() const
+{
+    return vertex_streams->count;
+}
+
+const AbstractMesh::VertexStreams &AbstractMesh::get_vertex_streams() const
+{
+    return *vertex_streams;
+}
+
+const StridedView<glm::vec3> &AbstractMesh::get_vertex_positions() const
+{
+    return vertex_streams->positions;
+}
+
+const StridedView<glm::vec3> &AbstractMesh::get_vertex_normals() const
+{
+    return vertex_streams->normals;
+}
+
+const StridedView<glm::vec2> &AbstractMesh::get_vertex_uvs() const
+{
+    return vertex_streams->uvs;
+}
+
+const StridedView<glm::vec3> &AbstractMesh::get_vertex_colors() const
+{
+    return vertex_streams->colors;
+}
+
+void AbstractMesh::set_vertex_streams(const VertexStreams *streams)
+{
+    vertex_streams = streams;
+}
\ No newline at end of file
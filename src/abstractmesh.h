@@ -8,6 +8,7 @@
 #include <glm/vec3.hpp>
 
 #include "actor.h"
+#include "stridedview.h"
 
 using MeshElementIndex   = uint32_t;
 using VertexIndex        = MeshElementIndex;
@@ -22,15 +23,35 @@ public:
     AbstractMesh();
     AbstractMesh(std::string_view id);
 
-    virtual size_t get_vertex_count() const = 0;
+    // Attributes of the vertices kept on the CPU, described by the derived mesh.
+    // Views are empty while the CPU copy is released, count stays
+    struct VertexStreams
+    {
+        size_t count = 0;
 
-    virtual const glm::vec3 &get_vertex_position(VertexIndex) const = 0;
-    virtual const glm::vec2 &get_vertex_texture(VertexIndex) const = 0;
-    virtual const glm::vec3 &get_vertex_normal(VertexIndex) const = 0;
-    virtual const glm::vec3 &get_vertex_color(VertexIndex) const = 0;
+        StridedView<glm::vec3> positions;
+        StridedView<glm::vec3> normals;
+        StridedView<glm::vec2> uvs;
+        StridedView<glm::vec3> colors;
+    };
+
+    size_t get_vertex_count() const;
+
+    const VertexStreams &get_vertex_streams() const;
+    const StridedView<glm::vec3> &get_vertex_positions() const;
+    const StridedView<glm::vec3> &get_vertex_normals() const;
+    const StridedView<glm::vec2> &get_vertex_uvs() const;
+    const StridedView<glm::vec3> &get_vertex_colors() const;
 
     virtual const void *get_raw_vertices_data() const = 0;
     virtual const void *get_raw_indices_data() const = 0;
+
+protected:
+    // Streams must outlive the mesh, they may be shared with other meshes
+    void set_vertex_streams(const VertexStreams *);
+
+private:
+    const VertexStreams *vertex_streams;
 };
 
 #endif // CG_SEM5_COURSEWORK_MESH_H
\ No newline at end of file
@@ -10,8 +10,10 @@ Actor::Actor()
 {}
 
 Actor::Actor(std::string_view id)
-: SceneNode(id), model(glm::mat4(1.f))
-{}
+: SceneNode(id), model(glm::mat4(1.f)), mobility(Mobility::MOVABLE)
+{
+    kind = SceneNodeKind::ACTOR;
+}
 
 const glm::mat4 &Actor::get_model_matrix() const
 {
@@ -19,11 +21,6 @@ const glm::mat4 &Actor::get_model_matrix() const
 }
 
 const glm::mat4 &Actor::model_matrix() const
-{
-    return const_cast<Actor*>(this)->model_matrix();
-}
-
-glm::mat4 &Actor::model_matrix()
 {
     return model;
 }
@@ -56,4 +53,14 @@ void Actor::scale(const glm::vec3 &scale)
 {
     model = glm::scale(model, scale);
     this->changed = true;
+}
+
+Mobility Actor::get_mobility() const
+{
+    return mobility;
+}
+
+void Actor::set_mobility(Mobility mobility)
+{
+    this->mobility = mobility;
 }
\ No newline at end of file
@@ -6,6 +6,12 @@
 
 #include "scenenode.h"
 
+enum class Mobility
+{
+    MOVABLE,
+    STATIC // Transform is fixed once the actor is in a prepared scene, renderers may bake it
+};
+
 class Actor : public SceneNode
 {
 public:
@@ -14,7 +20,6 @@ public:
 
     const glm::mat4 &get_model_matrix() const;
     const glm::mat4 &model_matrix() const;
-    glm::mat4 &model_matrix();
     void set_model_matrix(const glm::mat4 &);
     Actor &model_matrix(const glm::mat4 &);
 
@@ -22,8 +27,12 @@ public:
     void rotate(float angle, const glm::vec3 &axis);
     void scale(const glm::vec3 &);
 
+    Mobility get_mobility() const;
+    void set_mobility(Mobility);
+
 private:
     glm::mat4 model;
+    Mobility  mobility;
 };
 
 #endif // CG_SEM5_ACTOR_H
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include <algorithm>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "assetloader.h"
+#include "cookedmesh.h"
+
+AssetLoader::AssetLoader(std::shared_ptr<Device> device, VkQueue queue)
+: device(device),
+queue(queue),
+command_pool(device->create_command_pool(device->queue_family_indices.graphics, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT)),
+texture_format(StaticMesh::select_texture_format(*device)),
+registry(),
+texture_streamer(),
+texture_packer(),
+virtual_texture_cache(device),
+placeholder(),
+workers(),
+mutex(),
+imported_meshes(),
+waiting_instances(),
+importing_keys(),
+pending_count(0)
+{}
+
+AssetLoader::~AssetLoader()
+{
+    workers.wait();
+
+    // Unfinished futures get broken_promise
+    imported_meshes.clear();
+    waiting_instances.clear();
+
+    vkDestroyCommandPool(*device, command_pool, nullptr);
+}
+
+AssetLoader::StaticMeshFuture AssetLoader::load_static_mesh
+(
+    std::string_view id,
+    std::string_view path,
+    int import_flags,
+    uint32_t lod_count
+)
+{
+    auto pending = std::make_shared<PendingStaticMesh>();
+    pending->id  = id.data();
+    pending->key = AssetRegistry::make_static_mesh_key(path, texture_format.format, import_flags, lod_count);
+
+    StaticMeshFuture future = pending->promise.get_future().share();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if(auto resources = registry.find_static_mesh(pending->key))
+        {
+            pending->promise.set_value(StaticMesh::instantiate(id, resources));
+            return future;
+        }
+
+        ++pending_count;
+
+        if(!importing_keys.insert(pending->key).second)
+        {
+            waiting_instances.push_back(pending);
+            return future;
+        }
+    }
+
+    workers.run([this, pending, path = std::string(path), import_flags, lod_count]
+    {
+        try
+        {
+            pending->data = StaticMesh::import_from_file(path, texture_format, import_flags, lod_count, &registry);
+        }
+        catch(...)
+        {
+            pending->error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        imported_meshes.push_back(pending);
+    });
+
+    return future;
+}
+
+std::shared_ptr<StaticMesh> AssetLoader::create_placeholder(std::string_view id)
+{
+    if(placeholder)
+        return StaticMesh::instantiate(id, placeholder);
+
+    std::vector<std::shared_ptr<DeviceBuffer>> staging;
+
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
+
+    auto mesh = StaticMesh::create_placeholder(id, device, copy_cmd, staging);
+
+    device->end_command_buffer(copy_cmd);
+    device->flush_command_buffer(copy_cmd, queue);
+    vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+
+    placeholder = mesh->get_resources();
+    return mesh;
+}
+
+size_t AssetLoader::flush_uploads()
+{
+    std::vector<std::shared_ptr<PendingStaticMesh>> meshes;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(imported_meshes.empty())
+            return 0;
+
+        meshes.swap(imported_meshes);
+        pending_count -= meshes.size();
+    }
+
+    std::vector<std::shared_ptr<StaticMesh>> uploaded(meshes.size());
+    std::vector<std::shared_ptr<DeviceBuffer>> staging;
+
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
+
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        if(meshes[i]->error)
+            continue;
+
+        try
+        {
+            uploaded[i] = StaticMesh::create
+            (
+                meshes[i]->id,
+                std::move(meshes[i]->data),
+                device,
+                copy_cmd,
+                staging,
+                &registry,
+                &texture_streamer,
+                &texture_packer,
+                &virtual_texture_cache
+            );
+        }
+        catch(...)
+        {
+            meshes[i]->error = std::current_exception();
+        }
+    }
+
+    device->end_command_buffer(copy_cmd);
+    device->flush_command_buffer(copy_cmd, queue);
+    vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+
+    std::vector<std::shared_ptr<PendingStaticMesh>> instances;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        for(size_t i = 0; i < meshes.size(); ++i)
+        {
+            if(uploaded[i])
+                registry.add_static_mesh(meshes[i]->key, uploaded[i]->get_resources());
+
+            importing_keys.erase(meshes[i]->key);
+        }
+
+        auto importing = std::partition
+        (
+            waiting_instances.begin(), waiting_instances.end(),
+            [this](auto &&instance) { return importing_keys.count(instance->key) > 0; }
+        );
+
+        instances.assign(importing, waiting_instances.end());
+        waiting_instances.erase(importing, waiting_instances.end());
+        pending_count -= instances.size();
+    }
+
+    for(size_t i = 0; i < meshes.size(); ++i)
+    {
+        if(meshes[i]->error)
+            meshes[i]->promise.set_exception(meshes[i]->error);
+        else
+            meshes[i]->promise.set_value(uploaded[i]);
+    }
+
+    for(auto &&instance : instances)
+    {
+        auto mesh = std::find_if
+        (
+            meshes.begin(), meshes.end(),
+            [&instance](auto &&imported) { return imported->key == instance->key; }
+        );
+
+        size_t i = mesh - meshes.begin();
+        if(uploaded[i])
+            instance->promise.set_value(uploaded[i]->instantiate(instance->id));
+        else
+            instance->promise.set_exception(meshes[i]->error);
+    }
+
+    return meshes.size() + instances.size();
+}
+
+bool AssetLoader::has_pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending_count > 0;
+}
+
+void AssetLoader::restore_cpu_geometry(const std::vector<StaticMesh*> &meshes)
+{
+    std::vector<StaticMesh*> released;
+    std::unordered_set<const StaticMesh::Resources*> resources;
+    for(auto mesh : meshes)
+        if(!mesh->has_cpu_geometry() && resources.insert(mesh->get_resources().get()).second)
+            released.push_back(mesh);
+
+    std::vector<StaticMesh::Geometry> geometries(released.size());
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, released.size(), 1), [&](const tbb::blocked_range<size_t> &range)
+    {
+        for(size_t i = range.begin(); i != range.end(); ++i)
+        {
+            auto &source = released[i]->get_resources()->source;
+            if(CookedMesh::read_cpu_geometry(source.path, texture_format, source.import_flags, source.lod_count, geometries[i]))
+                continue;
+
+            auto data = StaticMesh::import_from_file(source.path, texture_format, source.import_flags, source.lod_count, &registry);
+            geometries[i] = { std::move(data.vertices), std::move(data.indices) };
+        }
+    });
+
+    // Resources are written only by the calling thread
+    for(size_t i = 0; i < released.size(); ++i)
+        released[i]->restore_cpu_geometry(std::move(geometries[i]));
+}
+
+void AssetLoader::restore_cpu_geometry(StaticMesh &mesh)
+{
+    restore_cpu_geometry(std::vector<StaticMesh*>{ &mesh });
+}
+
+AssetRegistry &AssetLoader::get_registry()
+{
+    return registry;
+}
+
+TextureStreamer &AssetLoader::get_texture_streamer()
+{
+    return texture_streamer;
+}
+
+VirtualTextureCache &AssetLoader::get_virtual_texture_cache()
+{
+    return virtual_texture_cache;
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#ifndef CG_SEM5_ASSETLOADER_H
+#define CG_SEM5_ASSETLOADER_H
+
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include <tbb/task_group.h>
+
+#include "assetregistry.h"
+#include "device.h"
+#include "staticmesh.h"
+#include "texturepacker.h"
+#include "texturestreamer.h"
+#include "virtualtexturecache.h"
+
+// Imports assets on TBB workers and uploads them in batches on the thread owning the queue.
+// Futures become ready in flush_uploads, after the upload fence has signaled.
+// Assets are imported once per source: resident ones are instantiated immediately,
+// requests for one being imported wait for it
+class AssetLoader
+{
+public:
+    using StaticMeshFuture = std::shared_future<std::shared_ptr<StaticMesh>>;
+
+    AssetLoader(std::shared_ptr<Device>, VkQueue);
+    ~AssetLoader();
+
+    AssetLoader(const AssetLoader &) = delete;
+    AssetLoader &operator=(const AssetLoader &) = delete;
+
+    StaticMeshFuture load_static_mesh
+    (
+        std::string_view id,
+        std::string_view path,
+        int import_flags = StaticMesh::DEFAULT_IMPORT_FLAGS,
+        uint32_t lod_count = StaticMesh::DEFAULT_LOD_COUNT
+    );
+
+    // Synchronous, for meshes drawn while others are loading
+    std::shared_ptr<StaticMesh> create_placeholder(std::string_view id);
+
+    // Records every imported asset into one command buffer and waits for one fence.
+    // Must be called from the thread that submits to the queue. Returns uploaded asset count
+    size_t flush_uploads();
+
+    bool has_pending() const;
+
+    // Synchronous, decodes the geometry released after upload from the cooked file on TBB workers,
+    // sources without one are imported again. Meshes sharing resources are restored once
+    void restore_cpu_geometry(const std::vector<StaticMesh*> &);
+    void restore_cpu_geometry(StaticMesh &);
+
+    AssetRegistry &get_registry();
+
+    // Finer mip levels of uploaded textures, driven by the renderer
+    TextureStreamer &get_texture_streamer();
+
+    // Pages of virtual textures, driven by the renderer's feedback pass
+    VirtualTextureCache &get_virtual_texture_cache();
+
+private:
+    struct PendingStaticMesh
+    {
+        std::string id;
+        std::string key;
+        std::promise<std::shared_ptr<StaticMesh>> promise;
+        StaticMesh::ImportData data;
+        std::exception_ptr     error;
+    };
+
+    std::shared_ptr<Device> device;
+    VkQueue       queue;
+    VkCommandPool command_pool;
+
+    StaticMesh::TextureFormat texture_format;
+
+    AssetRegistry registry;
+    TextureStreamer     texture_streamer;
+    TexturePacker       texture_packer;
+    VirtualTextureCache virtual_texture_cache;
+    std::shared_ptr<const StaticMesh::Resources> placeholder;
+
+    tbb::task_group workers;
+
+    mutable std::mutex mutex;
+    std::vector<std::shared_ptr<PendingStaticMesh>> imported_meshes;
+    std::vector<std::shared_ptr<PendingStaticMesh>> waiting_instances; // Of meshes being imported
+    std::unordered_set<std::string>                 importing_keys;
+    size_t pending_count;
+};
+
+#endif // CG_SEM5_ASSETLOADER_H
\ No newline at end of file
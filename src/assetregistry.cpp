@@ -0,0 +1,140 @@
+#include <filesystem>
+
+#include "assetregistry.h"
+
+std::string canonical_path(std::string_view path)
+{
+    std::error_code error;
+    auto canonical = std::filesystem::weakly_canonical(std::filesystem::path(path), error);
+
+    // Still a usable key, only aliases of the path are not recognized
+    if(error)
+        return std::string(path);
+
+    return canonical.generic_string();
+}
+
+AssetRegistry::AssetRegistry(VkDeviceSize texture_budget)
+: recent_texture_size(0),
+texture_budget(texture_budget)
+{}
+
+std::string AssetRegistry::make_static_mesh_key(std::string_view path, VkFormat texture_format, int import_flags, uint32_t lod_count)
+{
+    return canonical_path(path) 
+        + '|' + std::to_string(static_cast<int>(texture_format)) 
+        + '|' + std::to_string(import_flags) 
+        + '|' + std::to_string(lod_count);
+}
+
+std::string AssetRegistry::make_texture_key(std::string_view path, VkFormat format)
+{
+    return canonical_path(path) + '|' + std::to_string(static_cast<int>(format));
+}
+
+std::shared_ptr<const StaticMesh::Resources> AssetRegistry::find_static_mesh(const std::string &key) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = static_meshes.find(key);
+    return it == static_meshes.end()? nullptr : it->second.lock();
+}
+
+std::shared_ptr<Texture2D> AssetRegistry::find_texture(const std::string &key) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = textures.find(key);
+    auto texture = it == textures.end()? nullptr : it->second.lock();
+
+    if(texture)
+        touch_texture(key, texture);
+
+    return texture;
+}
+
+void AssetRegistry::add_static_mesh(const std::string &key, std::shared_ptr<const StaticMesh::Resources> resources)
+{
+    add(static_meshes, key, resources);
+}
+
+void AssetRegistry::add_texture(const std::string &key, std::shared_ptr<Texture2D> texture)
+{
+    add(textures, key, texture);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if(auto resident = textures[key].lock())
+        touch_texture(key, resident);
+}
+
+size_t AssetRegistry::collect_garbage()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for(auto it = static_meshes.begin(); it != static_meshes.end();)
+        it = it->second.expired()? static_meshes.erase(it) : std::next(it);
+
+    for(auto it = textures.begin(); it != textures.end();)
+        it = it->second.expired()? textures.erase(it) : std::next(it);
+
+    return static_meshes.size() + textures.size();
+}
+
+void AssetRegistry::set_texture_budget(VkDeviceSize budget)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    texture_budget = budget;
+    evict_textures();
+}
+
+VkDeviceSize AssetRegistry::get_texture_budget() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return texture_budget;
+}
+
+VkDeviceSize AssetRegistry::get_cached_texture_size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return recent_texture_size;
+}
+
+void AssetRegistry::touch_texture(const std::string &key, std::shared_ptr<Texture2D> texture) const
+{
+    auto position = recent_texture_positions.find(key);
+    if(position != recent_texture_positions.end())
+    {
+        recent_textures.splice(recent_textures.begin(), recent_textures, position->second);
+        return;
+    }
+
+    recent_textures.emplace_front(key, texture);
+    recent_texture_positions.emplace(key, recent_textures.begin());
+    recent_texture_size += texture->memory_size;
+
+    evict_textures();
+}
+
+void AssetRegistry::evict_textures() const
+{
+    while(recent_texture_size > texture_budget && !recent_textures.empty())
+    {
+        auto &[key, texture] = recent_textures.back();
+        recent_texture_size -= texture->memory_size;
+        recent_texture_positions.erase(key);
+        recent_textures.pop_back();
+    }
+}
+
+template <typename T>
+void AssetRegistry::add(Cache<T> &cache, const std::string &key, std::shared_ptr<T> asset)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto &entry = cache[key];
+    if(entry.expired())
+        entry = asset;
+}
\ No newline at end of file
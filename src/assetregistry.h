@@ -0,0 +1,69 @@
+#ifndef CG_SEM5_ASSETREGISTRY_H
+#define CG_SEM5_ASSETREGISTRY_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <vulkan/vulkan.h>
+
+#include "staticmesh.h"
+#include "texture2d.h"
+
+// Resources already resident on the device, keyed by canonical source path and import parameters.
+// Static meshes are held by weak references: an asset is released with its last user and imported again on the next request.
+// The most recently used textures are also kept alive up to a device memory budget,
+// so materials that come back soon don't read and upload their textures again
+class AssetRegistry
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_TEXTURE_BUDGET = 256ull << 20;
+
+    AssetRegistry(VkDeviceSize texture_budget = DEFAULT_TEXTURE_BUDGET);
+
+    static std::string make_static_mesh_key(std::string_view path, VkFormat texture_format, int import_flags, uint32_t lod_count);
+    static std::string make_texture_key(std::string_view path, VkFormat);
+
+    std::shared_ptr<const StaticMesh::Resources> find_static_mesh(const std::string &key) const;
+    std::shared_ptr<Texture2D> find_texture(const std::string &key) const;
+
+    // A live entry under the same key is kept
+    void add_static_mesh(const std::string &key, std::shared_ptr<const StaticMesh::Resources>);
+    void add_texture(const std::string &key, std::shared_ptr<Texture2D>);
+
+    // Drops entries of released assets, returns how many are left
+    size_t collect_garbage();
+
+    // Least recently used textures are released first, textures still used by meshes stay resident regardless
+    void set_texture_budget(VkDeviceSize);
+    VkDeviceSize get_texture_budget() const;
+    VkDeviceSize get_cached_texture_size() const;
+
+private:
+    template <typename T>
+    using Cache = std::unordered_map<std::string, std::weak_ptr<T>>;
+
+    template <typename T>
+    void add(Cache<T> &, const std::string &key, std::shared_ptr<T>);
+
+    // Called with the mutex locked
+    void touch_texture(const std::string &key, std::shared_ptr<Texture2D>) const;
+    void evict_textures() const;
+
+    mutable std::mutex mutex;
+
+    Cache<const StaticMesh::Resources> static_meshes;
+    Cache<Texture2D>                   textures;
+
+    // Most recently used first
+    using RecentTextures = std::list<std::pair<std::string, std::shared_ptr<Texture2D>>>;
+    mutable RecentTextures recent_textures;
+    mutable std::unordered_map<std::string, RecentTextures::iterator> recent_texture_positions;
+    mutable VkDeviceSize recent_texture_size;
+    VkDeviceSize         texture_budget;
+};
+
+#endif // CG_SEM5_ASSETREGISTRY_H
\ No newline at end of file
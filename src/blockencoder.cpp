@@ -0,0 +1,624 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "blockencoder.h"
+#include "simd.h"
+
+static constexpr size_t PIXEL_COUNT = BlockEncoder::BLOCK_SIZE * BlockEncoder::BLOCK_SIZE;
+
+// Position of each index between the endpoints
+static constexpr float BC1_WEIGHTS[4] = { 0.f, 1.f / 3.f, 2.f / 3.f, 1.f };
+static constexpr float BC7_WEIGHTS[16] =
+{
+    0.f / 64.f,  4.f / 64.f,  9.f / 64.f,  13.f / 64.f, 17.f / 64.f, 21.f / 64.f, 26.f / 64.f, 30.f / 64.f,
+    34.f / 64.f, 38.f / 64.f, 43.f / 64.f, 47.f / 64.f, 51.f / 64.f, 55.f / 64.f, 60.f / 64.f, 64.f / 64.f
+};
+
+static constexpr uint8_t BC7_MODE_6 = 1 << 6;
+
+// Pixels of one block by channel
+struct BlockPixels
+{
+    alignas(16) float channels[4][PIXEL_COUNT];
+};
+
+struct Endpoints
+{
+    float colors[2][4];
+};
+
+struct Bc1Fit
+{
+    uint16_t colors[2];
+    uint8_t  indices[PIXEL_COUNT]; // 0 is the first color, 3 the second
+    float    error;
+};
+
+struct Bc7Fit
+{
+    uint8_t endpoints[2][4]; // 7 bits per channel
+    uint8_t p_bits[2];
+    uint8_t indices[PIXEL_COUNT];
+    float   error;
+};
+
+// Appends bits from the least significant one
+struct BlockWriter
+{
+    uint8_t *block;
+    size_t   position = 0;
+
+    void write(uint32_t value, size_t count);
+};
+
+BlockPixels load_pixels(const uint8_t rgba[64]);
+
+void fit_principal_axis(const BlockPixels &, size_t channel_count, Endpoints &);
+
+bool fit_least_squares
+(
+    const BlockPixels &,
+    const uint8_t indices[PIXEL_COUNT],
+    const float weights[],
+    size_t channel_count,
+    Endpoints &
+);
+
+// Nearest of steps + 1 evenly spaced points from the first endpoint to the second
+void project_pixels
+(
+    const BlockPixels &,
+    const Endpoints &,
+    size_t channel_count,
+    int steps,
+    uint8_t indices[PIXEL_COUNT]
+);
+
+float get_error
+(
+    const BlockPixels &,
+    const Endpoints &,
+    const uint8_t indices[PIXEL_COUNT],
+    const float weights[],
+    size_t channel_count
+);
+
+uint16_t pack_565(const float color[4]);
+void unpack_565(uint16_t packed, float color[4]);
+
+void fit_bc1(const BlockPixels &, const Endpoints &, Bc1Fit &);
+void write_bc1(Bc1Fit &, uint8_t block[8]);
+
+void encode_bc4_alpha(const uint8_t rgba[64], uint8_t block[8]);
+
+void fit_bc7(const BlockPixels &, const Endpoints &, Bc7Fit &);
+void write_bc7(Bc7Fit &, uint8_t block[16]);
+
+bool BlockEncoder::can_encode(VkFormat format)
+{
+    return get_block_bytes(format) != 0;
+}
+
+size_t BlockEncoder::get_block_bytes(VkFormat format)
+{
+    switch(format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        return 8;
+
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return 16;
+
+    default:
+        return 0;
+    }
+}
+
+std::vector<uint8_t> BlockEncoder::encode(const uint8_t *rgba, uint32_t width, uint32_t height, VkFormat format)
+{
+    void (*encode_block)(const uint8_t *, uint8_t *) = nullptr;
+
+    switch(format)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        encode_block = encode_bc1;
+        break;
+
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        encode_block = encode_bc3;
+        break;
+
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        encode_block = encode_bc7;
+        break;
+
+    default:
+        throw std::runtime_error("Can't encode textures in format " + std::to_string(format));
+    }
+
+    uint32_t blocks_x    = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    uint32_t blocks_y    = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    size_t   block_bytes = get_block_bytes(format);
+
+    std::vector<uint8_t> blocks(static_cast<size_t>(blocks_x) * blocks_y * block_bytes);
+
+    tbb::parallel_for
+    (
+        tbb::blocked_range<uint32_t>(0, blocks_y),
+        [&](const tbb::blocked_range<uint32_t> &range)
+        {
+            uint8_t pixels[PIXEL_COUNT * 4];
+
+            for(uint32_t block_y = range.begin(); block_y != range.end(); ++block_y)
+            {
+                for(uint32_t block_x = 0; block_x < blocks_x; ++block_x)
+                {
+                    for(uint32_t y = 0; y < BLOCK_SIZE; ++y)
+                    {
+                        size_t row = std::min(block_y * BLOCK_SIZE + y, height - 1);
+
+                        for(uint32_t x = 0; x < BLOCK_SIZE; ++x)
+                        {
+                            size_t column = std::min(block_x * BLOCK_SIZE + x, width - 1);
+                            std::memcpy(&pixels[(y * BLOCK_SIZE + x) * 4], &rgba[(row * width + column) * 4], 4);
+                        }
+                    }
+
+                    encode_block(pixels, &blocks[(static_cast<size_t>(block_y) * blocks_x + block_x) * block_bytes]);
+                }
+            }
+        }
+    );
+
+    return blocks;
+}
+
+void BlockEncoder::encode_bc1(const uint8_t rgba[64], uint8_t block[8])
+{
+    auto pixels = load_pixels(rgba);
+
+    Endpoints endpoints;
+    fit_principal_axis(pixels, 3, endpoints);
+
+    Bc1Fit fit;
+    fit_bc1(pixels, endpoints, fit);
+
+    if(fit_least_squares(pixels, fit.indices, BC1_WEIGHTS, 3, endpoints))
+    {
+        Bc1Fit refined;
+        fit_bc1(pixels, endpoints, refined);
+
+        if(refined.error < fit.error)
+            fit = refined;
+    }
+
+    write_bc1(fit, block);
+}
+
+void BlockEncoder::encode_bc3(const uint8_t rgba[64], uint8_t block[16])
+{
+    encode_bc4_alpha(rgba, block);
+    encode_bc1(rgba, block + 8);
+}
+
+void BlockEncoder::encode_bc7(const uint8_t rgba[64], uint8_t block[16])
+{
+    auto pixels = load_pixels(rgba);
+
+    Endpoints endpoints;
+    fit_principal_axis(pixels, 4, endpoints);
+
+    Bc7Fit fit;
+    fit_bc7(pixels, endpoints, fit);
+
+    if(fit_least_squares(pixels, fit.indices, BC7_WEIGHTS, 4, endpoints))
+    {
+        Bc7Fit refined;
+        fit_bc7(pixels, endpoints, refined);
+
+        if(refined.error < fit.error)
+            fit = refined;
+    }
+
+    write_bc7(fit, block);
+}
+
+void BlockWriter::write(uint32_t value, size_t count)
+{
+    for(size_t i = 0; i < count; ++i, ++position)
+        block[position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (position % 8));
+}
+
+BlockPixels load_pixels(const uint8_t rgba[64])
+{
+    BlockPixels pixels;
+
+    for(size_t i = 0; i < PIXEL_COUNT; ++i)
+        for(size_t c = 0; c < 4; ++c)
+            pixels.channels[c][i] = rgba[i * 4 + c];
+
+    return pixels;
+}
+
+void fit_principal_axis(const BlockPixels &pixels, size_t channel_count, Endpoints &endpoints)
+{
+    float mean[4] = {};
+    for(size_t c = 0; c < channel_count; ++c)
+    {
+        for(size_t i = 0; i < PIXEL_COUNT; ++i)
+            mean[c] += pixels.channels[c][i];
+
+        mean[c] /= PIXEL_COUNT;
+    }
+
+    float covariance[4][4] = {};
+    for(size_t i = 0; i < PIXEL_COUNT; ++i)
+        for(size_t a = 0; a < channel_count; ++a)
+            for(size_t b = a; b < channel_count; ++b)
+                covariance[a][b] += (pixels.channels[a][i] - mean[a]) * (pixels.channels[b][i] - mean[b]);
+
+    for(size_t a = 0; a < channel_count; ++a)
+        for(size_t b = 0; b < a; ++b)
+            covariance[a][b] = covariance[b][a];
+
+    // Power iteration from the row of the channel that varies most
+    size_t widest = 0;
+    for(size_t c = 1; c < channel_count; ++c)
+        if(covariance[c][c] > covariance[widest][widest])
+            widest = c;
+
+    float axis[4] = {};
+    std::copy(covariance[widest], covariance[widest] + channel_count, axis);
+
+    for(int iteration = 0; iteration < 8; ++iteration)
+    {
+        float next[4] = {};
+        float scale   = 0.f;
+
+        for(size_t a = 0; a < channel_count; ++a)
+        {
+            for(size_t b = 0; b < channel_count; ++b)
+                next[a] += covariance[a][b] * axis[b];
+
+            scale = std::max(scale, std::abs(next[a]));
+        }
+
+        if(scale < 1e-6f)
+            break;
+
+        for(size_t c = 0; c < channel_count; ++c)
+            axis[c] = next[c] / scale;
+    }
+
+    float length = 0.f;
+    for(size_t c = 0; c < channel_count; ++c)
+        length += axis[c] * axis[c];
+
+    float low = 0.f, high = 0.f;
+    if(length > 1e-12f)
+    {
+        length = std::sqrt(length);
+        for(size_t c = 0; c < channel_count; ++c)
+            axis[c] /= length;
+
+        low  = std::numeric_limits<float>::max();
+        high = std::numeric_limits<float>::lowest();
+
+        for(size_t i = 0; i < PIXEL_COUNT; ++i)
+        {
+            float t = 0.f;
+            for(size_t c = 0; c < channel_count; ++c)
+                t += (pixels.channels[c][i] - mean[c]) * axis[c];
+
+            low  = std::min(low, t);
+            high = std::max(high, t);
+        }
+    }
+
+    for(size_t c = 0; c < 4; ++c)
+    {
+        bool is_used = c < channel_count;
+        endpoints.colors[0][c] = is_used? std::clamp(mean[c] + axis[c] * low, 0.f, 255.f) : 255.f;
+        endpoints.colors[1][c] = is_used? std::clamp(mean[c] + axis[c] * high, 0.f, 255.f) : 255.f;
+    }
+}
+
+bool fit_least_squares
+(
+    const BlockPixels &pixels,
+    const uint8_t indices[PIXEL_COUNT],
+    const float weights[],
+    size_t channel_count,
+    Endpoints &endpoints
+)
+{
+    float alpha2 = 0.f, beta2 = 0.f, alpha_beta = 0.f;
+    float alpha_x[4] = {}, beta_x[4] = {};
+
+    for(size_t i = 0; i < PIXEL_COUNT; ++i)
+    {
+        float beta  = weights[indices[i]];
+        float alpha = 1.f - beta;
+
+        alpha2     += alpha * alpha;
+        beta2      += beta * beta;
+        alpha_beta += alpha * beta;
+
+        for(size_t c = 0; c < channel_count; ++c)
+        {
+            alpha_x[c] += alpha * pixels.channels[c][i];
+            beta_x[c]  += beta * pixels.channels[c][i];
+        }
+    }
+
+    float determinant = alpha2 * beta2 - alpha_beta * alpha_beta;
+    if(std::abs(determinant) < 1e-6f)
+        return false;
+
+    for(size_t c = 0; c < channel_count; ++c)
+    {
+        endpoints.colors[0][c] = std::clamp((alpha_x[c] * beta2 - beta_x[c] * alpha_beta) / determinant, 0.f, 255.f);
+        endpoints.colors[1][c] = std::clamp((beta_x[c] * alpha2 - alpha_x[c] * alpha_beta) / determinant, 0.f, 255.f);
+    }
+
+    return true;
+}
+
+void project_pixels
+(
+    const BlockPixels &pixels,
+    const Endpoints &endpoints,
+    size_t channel_count,
+    int steps,
+    uint8_t indices[PIXEL_COUNT]
+)
+{
+    float direction[4] = {};
+    float length = 0.f;
+
+    for(size_t c = 0; c < channel_count; ++c)
+    {
+        direction[c] = endpoints.colors[1][c] - endpoints.colors[0][c];
+        length += direction[c] * direction[c];
+    }
+
+    if(length < 1e-6f)
+    {
+        std::memset(indices, 0, PIXEL_COUNT);
+        return;
+    }
+
+    for(size_t c = 0; c < channel_count; ++c)
+        direction[c] *= steps / length;
+
+#ifdef CG_SEM5_SSE
+    __m128i groups[PIXEL_COUNT / 4];
+
+    for(size_t group = 0; group < PIXEL_COUNT / 4; ++group)
+    {
+        __m128 t = _mm_setzero_ps();
+
+        for(size_t c = 0; c < channel_count; ++c)
+        {
+            __m128 offset = _mm_sub_ps(_mm_load_ps(&pixels.channels[c][group * 4]), _mm_set1_ps(endpoints.colors[0][c]));
+            t = _mm_add_ps(t, _mm_mul_ps(offset, _mm_set1_ps(direction[c])));
+        }
+
+        t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), _mm_set1_ps(static_cast<float>(steps)));
+        groups[group] = _mm_cvtps_epi32(t);
+    }
+
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(groups[0], groups[1]), _mm_packs_epi32(groups[2], groups[3]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(indices), packed);
+#else
+    for(size_t i = 0; i < PIXEL_COUNT; ++i)
+    {
+        float t = 0.f;
+        for(size_t c = 0; c < channel_count; ++c)
+            t += (pixels.channels[c][i] - endpoints.colors[0][c]) * direction[c];
+
+        indices[i] = static_cast<uint8_t>(std::lround(std::clamp(t, 0.f, static_cast<float>(steps))));
+    }
+#endif
+}
+
+float get_error
+(
+    const BlockPixels &pixels,
+    const Endpoints &endpoints,
+    const uint8_t indices[PIXEL_COUNT],
+    const float weights[],
+    size_t channel_count
+)
+{
+    float error = 0.f;
+
+    for(size_t i = 0; i < PIXEL_COUNT; ++i)
+    {
+        float weight = weights[indices[i]];
+
+        for(size_t c = 0; c < channel_count; ++c)
+        {
+            float difference = endpoints.colors[0][c] + (endpoints.colors[1][c] - endpoints.colors[0][c]) * weight - pixels.channels[c][i];
+            error += difference * difference;
+        }
+    }
+
+    return error;
+}
+
+uint16_t pack_565(const float color[4])
+{
+    auto r = static_cast<uint16_t>(std::lround(color[0] * 31.f / 255.f));
+    auto g = static_cast<uint16_t>(std::lround(color[1] * 63.f / 255.f));
+    auto b = static_cast<uint16_t>(std::lround(color[2] * 31.f / 255.f));
+
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void unpack_565(uint16_t packed, float color[4])
+{
+    uint32_t r = (packed >> 11) & 0x1f;
+    uint32_t g = (packed >> 5) & 0x3f;
+    uint32_t b = packed & 0x1f;
+
+    color[0] = static_cast<float>((r << 3) | (r >> 2));
+    color[1] = static_cast<float>((g << 2) | (g >> 4));
+    color[2] = static_cast<float>((b << 3) | (b >> 2));
+    color[3] = 255.f;
+}
+
+void fit_bc1(const BlockPixels &pixels, const Endpoints &endpoints, Bc1Fit &fit)
+{
+    // Indices are chosen against the colors the hardware will decode
+    Endpoints decoded;
+    for(size_t i = 0; i < 2; ++i)
+    {
+        fit.colors[i] = pack_565(endpoints.colors[i]);
+        unpack_565(fit.colors[i], decoded.colors[i]);
+    }
+
+    project_pixels(pixels, decoded, 3, 3, fit.indices);
+    fit.error = get_error(pixels, decoded, fit.indices, BC1_WEIGHTS, 3);
+}
+
+void write_bc1(Bc1Fit &fit, uint8_t block[8])
+{
+    // Four color blocks need the first color to be greater, equal colors decode every index 0 to the first one
+    if(fit.colors[0] < fit.colors[1])
+    {
+        std::swap(fit.colors[0], fit.colors[1]);
+        for(auto &&index : fit.indices)
+            index = 3 - index;
+    }
+
+    // The interpolated colors follow both endpoints
+    static constexpr uint8_t BC1_INDICES[4] = { 0, 2, 3, 1 };
+
+    uint32_t bits = 0;
+    if(fit.colors[0] != fit.colors[1])
+        for(size_t i = 0; i < PIXEL_COUNT; ++i)
+            bits |= static_cast<uint32_t>(BC1_INDICES[fit.indices[i]]) << (i * 2);
+
+    block[0] = static_cast<uint8_t>(fit.colors[0]);
+    block[1] = static_cast<uint8_t>(fit.colors[0] >> 8);
+    block[2] = static_cast<uint8_t>(fit.colors[1]);
+    block[3] = static_cast<uint8_t>(fit.colors[1] >> 8);
+
+    for(size_t i = 0; i < 4; ++i)
+        block[4 + i] = static_cast<uint8_t>(bits >> (i * 8));
+}
+
+void encode_bc4_alpha(const uint8_t rgba[64], uint8_t block[8])
+{
+    uint8_t low = 255, high = 0;
+    for(size_t i = 0; i < PIXEL_COUNT; ++i)
+    {
+        low  = std::min(low, rgba[i * 4 + 3]);
+        high = std::max(high, rgba[i * 4 + 3]);
+    }
+
+    // Eight alpha blocks: 0 is high, 1 is low and 2..7 step from high to low
+    block[0] = high;
+    block[1] = low;
+
+    uint64_t bits = 0;
+    if(high > low)
+    {
+        uint32_t range = high - low;
+
+        for(size_t i = 0; i < PIXEL_COUNT; ++i)
+        {
+            uint32_t step  = ((rgba[i * 4 + 3] - low) * 7 + range / 2) / range;
+            uint32_t index = step == 7? 0 : step == 0? 1 : 8 - step;
+
+            bits |= static_cast<uint64_t>(index) << (i * 3);
+        }
+    }
+
+    for(size_t i = 0; i < 6; ++i)
+        block[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+}
+
+void fit_bc7(const BlockPixels &pixels, const Endpoints &endpoints, Bc7Fit &fit)
+{
+    Endpoints decoded;
+
+    // Both parities of the shared lowest bit are tried for each endpoint
+    for(size_t i = 0; i < 2; ++i)
+    {
+        float best_error = std::numeric_limits<float>::max();
+
+        for(uint8_t p_bit = 0; p_bit < 2; ++p_bit)
+        {
+            uint8_t quantized[4];
+            float   error = 0.f;
+
+            for(size_t c = 0; c < 4; ++c)
+            {
+                long value   = std::lround((endpoints.colors[i][c] - p_bit) / 2.f);
+                quantized[c] = static_cast<uint8_t>(std::clamp(value, 0l, 127l));
+
+                float difference = static_cast<float>(quantized[c] * 2 + p_bit) - endpoints.colors[i][c];
+                error += difference * difference;
+            }
+
+            if(error < best_error)
+            {
+                best_error = error;
+                fit.p_bits[i] = p_bit;
+                std::copy(quantized, quantized + 4, fit.endpoints[i]);
+            }
+        }
+
+        for(size_t c = 0; c < 4; ++c)
+            decoded.colors[i][c] = static_cast<float>(fit.endpoints[i][c] * 2 + fit.p_bits[i]);
+    }
+
+    project_pixels(pixels, decoded, 4, 15, fit.indices);
+    fit.error = get_error(pixels, decoded, fit.indices, BC7_WEIGHTS, 4);
+}
+
+void write_bc7(Bc7Fit &fit, uint8_t block[16])
+{
+    // The first index is stored without its top bit
+    if(fit.indices[0] >= 8)
+    {
+        std::swap(fit.endpoints[0], fit.endpoints[1]);
+        std::swap(fit.p_bits[0], fit.p_bits[1]);
+        for(auto &&index : fit.indices)
+            index = 15 - index;
+    }
+
+    std::memset(block, 0, 16);
+    BlockWriter writer{ block };
+
+    writer.write(BC7_MODE_6, 7);
+
+    for(size_t c = 0; c < 4; ++c)
+    {
+        writer.write(fit.endpoints[0][c], 7);
+        writer.write(fit.endpoints[1][c], 7);
+    }
+
+    writer.write(fit.p_bits[0], 1);
+    writer.write(fit.p_bits[1], 1);
+
+    writer.write(fit.indices[0], 3);
+    for(size_t i = 1; i < PIXEL_COUNT; ++i)
+        writer.write(fit.indices[i], 4);
+}
\ No newline at end of file
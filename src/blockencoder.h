@@ -0,0 +1,31 @@
+#ifndef CG_SEM5_BLOCKENCODER_H
+#define CG_SEM5_BLOCKENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Block compression of RGBA8 images on the CPU.
+// Endpoints start at the extremes of the block along the principal axis of its colors and are
+// refined once by least squares. BC1 and the color half of BC3 use four color blocks, BC3 alpha
+// spans the block's alpha range and BC7 uses mode 6 (one RGBA subset, 4-bit indices).
+// Projecting pixels onto the endpoint axis is SSE2 accelerated
+class BlockEncoder
+{
+public:
+    static constexpr uint32_t BLOCK_SIZE = 4;
+
+    static bool can_encode(VkFormat);
+    static size_t get_block_bytes(VkFormat);
+
+    // Rows of width * 4 bytes from the top, edge blocks repeat the last row and column.
+    // Rows of blocks are encoded in parallel
+    static std::vector<uint8_t> encode(const uint8_t *rgba, uint32_t width, uint32_t height, VkFormat format);
+
+    static void encode_bc1(const uint8_t rgba[64], uint8_t block[8]);
+    static void encode_bc3(const uint8_t rgba[64], uint8_t block[16]);
+    static void encode_bc7(const uint8_t rgba[64], uint8_t block[16]);
+};
+
+#endif // CG_SEM5_BLOCKENCODER_H
\ No newline at end of file
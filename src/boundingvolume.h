@@ -0,0 +1,43 @@
+#ifndef CG_SEM5_BOUNDINGVOLUME_H
+#define CG_SEM5_BOUNDINGVOLUME_H
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+struct BoundingSphere
+{
+    glm::vec3 center = glm::vec3(0.f);
+    float     radius = 0.f;
+};
+
+// Axis aligned
+struct BoundingBox
+{
+    glm::vec3 min = glm::vec3(0.f);
+    glm::vec3 max = glm::vec3(0.f);
+};
+
+inline BoundingBox combine(const BoundingBox &a, const BoundingBox &b)
+{
+    return { glm::min(a.min, b.min), glm::max(a.max, b.max) };
+}
+
+inline float surface_area(const BoundingBox &box)
+{
+    glm::vec3 size = box.max - box.min;
+    return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// Box around the transformed box: the center is transformed, the half extent goes through |model|
+inline BoundingBox transform_bounding_box(const BoundingBox &box, const glm::mat4 &model)
+{
+    glm::vec3 center = glm::vec3(model * glm::vec4(0.5f * (box.min + box.max), 1.f));
+    glm::vec3 half   = 0.5f * (box.max - box.min);
+    glm::vec3 extent = glm::abs(glm::vec3(model[0])) * half.x
+                     + glm::abs(glm::vec3(model[1])) * half.y
+                     + glm::abs(glm::vec3(model[2])) * half.z;
+
+    return { center - extent, center + extent };
+}
+
+#endif // CG_SEM5_BOUNDINGVOLUME_H
\ No newline at end of file
@@ -16,7 +16,9 @@ aspect_ratio(aspect_ratio),
 znear(znear),
 zfar(zfar),
 perspective(glm::perspective(fov, aspect_ratio, znear, zfar))
-{}
+{
+    kind = SceneNodeKind::CAMERA;
+}
 
 const glm::mat4 &Camera::get_perspective_matrix() const
 {
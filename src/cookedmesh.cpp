@@ -0,0 +1,441 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <type_traits>
+
+#include "cookedmesh.h"
+#include "assetregistry.h"
+#include "geometrycodec.h"
+#include "mappedfile.h"
+#include "virtualtexture.h"
+
+static constexpr uint32_t COOKED_MESH_MAGIC   = 0x434d4743; // CGMC
+static constexpr uint32_t COOKED_MESH_VERSION = 3;
+
+struct CookedMeshStamp
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t source_size;
+    int64_t  source_time;
+    int32_t  import_flags;
+    uint32_t lod_count;
+    uint32_t texture_format;
+    uint32_t vertex_size;
+};
+
+class CookedMeshWriter
+{
+public:
+    template <typename T>
+    void write(const T &value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write(&value, sizeof(T));
+    }
+
+    void write(const void *value, size_t size)
+    {
+        auto bytes = static_cast<const uint8_t*>(value);
+        data.insert(data.end(), bytes, bytes + size);
+    }
+
+    void write_string(const std::string &string)
+    {
+        write(static_cast<uint32_t>(string.size()));
+        write(string.data(), string.size());
+    }
+
+    template <typename T>
+    void write_array(const std::vector<T> &array)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write(static_cast<uint32_t>(array.size()));
+        write(array.data(), array.size() * sizeof(T));
+    }
+
+    void write_stream(const std::vector<uint8_t> &stream, size_t element_count)
+    {
+        write(static_cast<uint64_t>(element_count));
+        write(static_cast<uint64_t>(stream.size()));
+        write(stream.data(), stream.size());
+    }
+
+    std::vector<uint8_t> data;
+};
+
+class CookedMeshReader
+{
+public:
+    CookedMeshReader(const char *data, size_t size)
+    : cursor(reinterpret_cast<const uint8_t*>(data)),
+    end(reinterpret_cast<const uint8_t*>(data) + size)
+    {}
+
+    template <typename T>
+    T read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        T value;
+        std::memcpy(&value, skip(sizeof(T)), sizeof(T));
+
+        return value;
+    }
+
+    std::string read_string()
+    {
+        size_t size = read<uint32_t>();
+        return std::string(reinterpret_cast<const char*>(skip(size)), size);
+    }
+
+    template <typename T>
+    std::vector<T> read_array()
+    {
+        size_t count = read<uint32_t>();
+        if(count > remaining() / sizeof(T))
+            throw std::runtime_error("Truncated cooked mesh");
+
+        std::vector<T> array(count);
+        std::memcpy(array.data(), skip(count * sizeof(T)), count * sizeof(T));
+
+        return array;
+    }
+
+    template <typename T>
+    void skip_array()
+    {
+        size_t count = read<uint32_t>();
+        if(count > remaining() / sizeof(T))
+            throw std::runtime_error("Truncated cooked mesh");
+
+        skip(count * sizeof(T));
+    }
+
+    const uint8_t *skip(size_t size)
+    {
+        if(size > remaining())
+            throw std::runtime_error("Truncated cooked mesh");
+
+        auto data = cursor;
+        cursor += size;
+
+        return data;
+    }
+
+    size_t remaining() const
+    {
+        return static_cast<size_t>(end - cursor);
+    }
+
+private:
+    const uint8_t *cursor;
+    const uint8_t *end;
+};
+
+bool make_stamp(std::string_view source_path, const StaticMesh::TextureFormat &, int import_flags, uint32_t lod_count, CookedMeshStamp &);
+bool read_geometry(CookedMeshReader &, StaticMesh::ImportData &, std::vector<Texture2D::Source> &texture_sources);
+bool read_streams(CookedMeshReader &, StaticMesh::Geometry &);
+bool is_virtual_texture(std::string_view path);
+
+std::string CookedMesh::get_path(std::string_view source_path)
+{
+    return std::string(source_path) + ".cooked";
+}
+
+bool CookedMesh::read
+(
+    std::string_view source_path,
+    const StaticMesh::TextureFormat &texture_format,
+    int import_flags,
+    uint32_t lod_count,
+    const AssetRegistry *registry,
+    StaticMesh::ImportData &data
+)
+{
+    CookedMeshStamp stamp;
+    std::error_code error;
+    auto path = get_path(source_path);
+
+    if(!make_stamp(source_path, texture_format, import_flags, lod_count, stamp) || !std::filesystem::is_regular_file(path, error))
+        return false;
+
+    StaticMesh::ImportData cooked;
+    std::vector<Texture2D::Source> texture_sources; // Path and format only
+
+    {
+        MappedFile file(path);
+        CookedMeshReader reader(file.get_data(), file.get_size());
+
+        // Stale and corrupted files are imported again
+        if
+        (
+            reader.remaining() < sizeof(stamp) ||
+            std::memcmp(reader.skip(sizeof(stamp)), &stamp, sizeof(stamp)) != 0 ||
+            !read_geometry(reader, cooked, texture_sources)
+        )
+            return false;
+    }
+
+    cooked.diffuse_sources.resize(cooked.materials.size());
+    for(size_t i = 0; i < cooked.materials.size(); ++i)
+    {
+        auto &source = cooked.diffuse_sources[i];
+        source = std::move(texture_sources[i]);
+
+        if(is_virtual_texture(source.path))
+        {
+            cooked.materials[i].virtual_diffuse = VirtualTexture::open(source.path);
+            continue;
+        }
+
+        if(registry != nullptr)
+        {
+            cooked.materials[i].diffuse = registry->find_texture(AssetRegistry::make_texture_key(source.path, source.format));
+            if(cooked.materials[i].diffuse)
+                continue;
+        }
+
+        source = Texture2D::read_source(source.path, source.format);
+    }
+
+    cooked.source.path         = source_path.data();
+    cooked.source.import_flags = import_flags;
+    cooked.source.lod_count    = lod_count;
+
+    data = std::move(cooked);
+    return true;
+}
+
+bool CookedMesh::read_cpu_geometry
+(
+    std::string_view source_path,
+    const StaticMesh::TextureFormat &texture_format,
+    int import_flags,
+    uint32_t lod_count,
+    StaticMesh::Geometry &geometry
+)
+{
+    CookedMeshStamp stamp;
+    std::error_code error;
+    auto path = get_path(source_path);
+
+    if(!make_stamp(source_path, texture_format, import_flags, lod_count, stamp) || !std::filesystem::is_regular_file(path, error))
+        return false;
+
+    MappedFile file(path);
+    CookedMeshReader reader(file.get_data(), file.get_size());
+
+    if(reader.remaining() < sizeof(stamp) || std::memcmp(reader.skip(sizeof(stamp)), &stamp, sizeof(stamp)) != 0)
+        return false;
+
+    try
+    {
+        // Materials and parts are walked over, only the streams are decoded
+        auto material_count = reader.read<uint32_t>();
+        for(uint32_t i = 0; i < material_count; ++i)
+        {
+            reader.skip(reader.read<uint32_t>());
+            reader.skip(sizeof(StaticMesh::MaterialProperties));
+            reader.skip(reader.read<uint32_t>());
+            reader.skip(sizeof(uint32_t));
+        }
+
+        auto part_count = reader.read<uint32_t>();
+        for(uint32_t i = 0; i < part_count; ++i)
+        {
+            reader.skip(2 * sizeof(MeshElementIndex) + sizeof(uint32_t));
+            reader.skip_array<StaticMesh::Lod>();
+            reader.skip_array<StaticMesh::Meshlet>();
+        }
+
+        return read_streams(reader, geometry);
+    }
+    catch(const std::runtime_error &)
+    {
+        return false;
+    }
+}
+
+void CookedMesh::write(const StaticMesh::TextureFormat &texture_format, const StaticMesh::ImportData &data)
+{
+    CookedMeshStamp stamp;
+    if(!make_stamp(data.source.path, texture_format, data.source.import_flags, data.source.lod_count, stamp))
+        return;
+
+    for(auto &&source : data.diffuse_sources)
+        if(source.path.empty() || source.path.find('#') != std::string::npos)
+            return;
+
+    CookedMeshWriter writer;
+    writer.write(stamp);
+
+    writer.write(static_cast<uint32_t>(data.materials.size()));
+    for(size_t i = 0; i < data.materials.size(); ++i)
+    {
+        writer.write_string(data.materials[i].name);
+        writer.write(data.materials[i].properties);
+        writer.write_string(data.diffuse_sources[i].path);
+        writer.write(static_cast<uint32_t>(data.diffuse_sources[i].format));
+    }
+
+    writer.write(static_cast<uint32_t>(data.parts.size()));
+    for(auto &&part : data.parts)
+    {
+        writer.write(part.index_base);
+        writer.write(part.index_count);
+        writer.write(static_cast<uint32_t>(part.material - data.materials.data()));
+        writer.write_array(part.lods);
+        writer.write_array(part.meshlets);
+    }
+
+    writer.write_stream(GeometryCodec::encode_vertices(data.vertices.data(), data.vertices.size(), sizeof(StaticMesh::Vertex)), data.vertices.size());
+    writer.write_stream(GeometryCodec::encode_indices(data.indices.data(), data.indices.size()), data.indices.size());
+
+    writer.write_array(data.bvh.get_nodes());
+    writer.write_array(data.bvh.get_triangles());
+
+    // Concurrent readers never see a partially written file, concurrent writers use their own ones
+    auto path = get_path(data.source.path);
+    auto temporary_path = path + '.' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(writer.data.data()), static_cast<std::streamsize>(writer.data.size()));
+        if(!file)
+            return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+    if(error)
+        std::filesystem::remove(temporary_path, error);
+}
+
+bool make_stamp
+(
+    std::string_view source_path,
+    const StaticMesh::TextureFormat &texture_format,
+    int import_flags,
+    uint32_t lod_count,
+    CookedMeshStamp &stamp
+)
+{
+    std::error_code error;
+    std::filesystem::path path(source_path);
+
+    auto size = std::filesystem::file_size(path, error);
+    if(error)
+        return false;
+
+    auto time = std::filesystem::last_write_time(path, error);
+    if(error)
+        return false;
+
+    // Zeroed first, the stamp is compared as raw bytes
+    std::memset(&stamp, 0, sizeof(stamp));
+    stamp.magic          = COOKED_MESH_MAGIC;
+    stamp.version        = COOKED_MESH_VERSION;
+    stamp.source_size    = size;
+    stamp.source_time    = static_cast<int64_t>(time.time_since_epoch().count());
+    stamp.import_flags   = import_flags;
+    stamp.lod_count      = lod_count;
+    stamp.texture_format = static_cast<uint32_t>(texture_format.format);
+    stamp.vertex_size    = sizeof(StaticMesh::Vertex);
+
+    return true;
+}
+
+bool read_geometry(CookedMeshReader &reader, StaticMesh::ImportData &data, std::vector<Texture2D::Source> &texture_sources)
+{
+    try
+    {
+        data.materials.resize(reader.read<uint32_t>());
+        texture_sources.resize(data.materials.size());
+        for(size_t i = 0; i < data.materials.size(); ++i)
+        {
+            data.materials[i].name       = reader.read_string();
+            data.materials[i].properties = reader.read<StaticMesh::MaterialProperties>();
+            texture_sources[i].path      = reader.read_string();
+            texture_sources[i].format    = static_cast<VkFormat>(reader.read<uint32_t>());
+        }
+
+        data.parts.resize(reader.read<uint32_t>());
+        for(auto &&part : data.parts)
+        {
+            part.index_base  = reader.read<MeshElementIndex>();
+            part.index_count = reader.read<MeshElementIndex>();
+
+            auto material = reader.read<uint32_t>();
+            if(material >= data.materials.size())
+                return false;
+
+            part.material = &data.materials[material];
+            part.lods     = reader.read_array<StaticMesh::Lod>();
+            part.meshlets = reader.read_array<StaticMesh::Meshlet>();
+        }
+
+        StaticMesh::Geometry geometry;
+        if(!read_streams(reader, geometry))
+            return false;
+
+        data.vertices = std::move(geometry.vertices);
+        data.indices  = std::move(geometry.indices);
+
+        // Checked against the geometry, throws on mismatch
+        auto bvh_nodes     = reader.read_array<TriangleBvh::Node>();
+        auto bvh_triangles = reader.read_array<MeshElementIndex>();
+        data.bvh = TriangleBvh
+        (
+            std::move(bvh_nodes),
+            std::move(bvh_triangles),
+            make_strided_view(data.vertices, &StaticMesh::Vertex::position),
+            data.indices
+        );
+    }
+    catch(const std::runtime_error &)
+    {
+        return false;
+    }
+
+    for(auto &&part : data.parts)
+        if(static_cast<size_t>(part.index_base) + part.index_count > data.indices.size())
+            return false;
+
+    for(auto index : data.indices)
+        if(index >= data.vertices.size())
+            return false;
+
+    return reader.remaining() == 0;
+}
+
+bool is_virtual_texture(std::string_view path)
+{
+    static constexpr std::string_view EXTENSION = ".vtex";
+    return path.size() >= EXTENSION.size() && path.compare(path.size() - EXTENSION.size(), EXTENSION.size(), EXTENSION) == 0;
+}
+
+bool read_streams(CookedMeshReader &reader, StaticMesh::Geometry &geometry)
+{
+    // Every block of vertices has at least its plane modes, every index at least one byte
+    auto vertex_count = reader.read<uint64_t>();
+    auto vertex_size  = reader.read<uint64_t>();
+    auto vertex_data  = reader.skip(vertex_size);
+    if(vertex_count > vertex_size * GeometryCodec::BLOCK_SIZE)
+        return false;
+
+    geometry.vertices.resize(vertex_count);
+    GeometryCodec::decode_vertices(vertex_data, vertex_size, geometry.vertices.data(), geometry.vertices.size(), sizeof(StaticMesh::Vertex));
+
+    auto index_count = reader.read<uint64_t>();
+    auto index_size  = reader.read<uint64_t>();
+    auto index_data  = reader.skip(index_size);
+    if(index_count > index_size)
+        return false;
+
+    geometry.indices.resize(index_count);
+    GeometryCodec::decode_indices(index_data, index_size, geometry.indices.data(), geometry.indices.size());
+
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef CG_SEM5_COOKEDMESH_H
+#define CG_SEM5_COOKEDMESH_H
+
+#include <string>
+#include <string_view>
+
+#include "staticmesh.h"
+
+class AssetRegistry;
+
+// Import results cached next to the source file, so later imports skip parsing, LOD, meshlet and BVH generation.
+// Vertex and index streams are compressed with GeometryCodec, textures are referenced by path.
+// A cooked file is used only while the source file, import parameters and texture format are unchanged
+class CookedMesh
+{
+public:
+    static std::string get_path(std::string_view source_path);
+
+    // False if there is no valid cooked file
+    static bool read
+    (
+        std::string_view source_path,
+        const StaticMesh::TextureFormat &,
+        int import_flags,
+        uint32_t lod_count,
+        const AssetRegistry *,
+        StaticMesh::ImportData &
+    );
+
+    // Vertex and index streams only, for restoring the CPU copy of an uploaded mesh.
+    // False if there is no valid cooked file
+    static bool read_cpu_geometry
+    (
+        std::string_view source_path,
+        const StaticMesh::TextureFormat &,
+        int import_flags,
+        uint32_t lod_count,
+        StaticMesh::Geometry &
+    );
+
+    // Write failures are ignored, the cooked file is only a cache.
+    // Meshes with textures that have no file of their own are not cooked
+    static void write(const StaticMesh::TextureFormat &, const StaticMesh::ImportData &);
+};
+
+#endif // CG_SEM5_COOKEDMESH_H
\ No newline at end of file
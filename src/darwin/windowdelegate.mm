@@ -113,7 +113,13 @@
         || position.y > view_size.height
     ) return;
 
-    mouse_moved_callback(static_cast<int32_t>(position.x), static_cast<int32_t>(position.y));
+    // Framebuffer pixels from the top left corner, like the swapchain images
+    CGFloat scale = [self backingScaleFactor];
+    mouse_moved_callback
+    (
+        static_cast<int32_t>(position.x * scale),
+        static_cast<int32_t>((view_size.height - position.y) * scale)
+    );
 }
 
 -(NSSize)windowWillResize:(NSWindow *)sender
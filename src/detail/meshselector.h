@@ -1,23 +1,23 @@
 #ifndef CG_SEM5_MESHSELECTOR_H
 #define CG_SEM5_MESHSELECTOR_H
 
-#include "../scenegraphvisitor.h"
+#include <vector>
+
 #include "../abstractmesh.h"
 
-class MeshSelector : public SceneGraphVisitor
+class MeshSelector
 {
 public:
     MeshSelector();
 
-    virtual void visit_up(std::shared_ptr<SceneNode>) override;
-    virtual void visit_down(std::shared_ptr<SceneNode>) override;
+    void visit_down(AbstractMesh &);
 
     void reset_current_mesh();
-    std::shared_ptr<AbstractMesh> get_next_mesh();
+    AbstractMesh *get_next_mesh();
 
 private:
     size_t current_mesh;
-    std::vector<std::shared_ptr<AbstractMesh>> meshes;
+    std::vector<AbstractMesh*> meshes;
 };
 
 #endif // CG_SEM5_MESHSELECTOR_H
\ No newline at end of file
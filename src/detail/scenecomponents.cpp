@@ -0,0 +1,77 @@
+#include <algorithm>
+
+#include "scenecomponents.h"
+
+void SceneComponents::visit_down(Actor &actor)
+{
+    add(actor);
+}
+
+SceneComponents::Entity SceneComponents::add(Actor &actor)
+{
+    auto entity = static_cast<Entity>(actors.size());
+
+    switch(actor.get_kind())
+    {
+    case SceneNodeKind::STATIC_MESH:
+        static_meshes.push_back({ entity, static_cast<StaticMesh*>(&actor) });
+        break;
+
+    case SceneNodeKind::CAMERA:
+        cameras.push_back({ entity, static_cast<Camera*>(&actor) });
+        break;
+
+    default:
+        break;
+    }
+
+    actors.push_back(&actor);
+
+    return entity;
+}
+
+void SceneComponents::remove(const std::unordered_set<const Actor*> &removed)
+{
+    auto kept = std::move(actors);
+    kept.erase
+    (
+        std::remove_if(kept.begin(), kept.end(), [&removed](auto &&actor) { return removed.count(actor) > 0; }),
+        kept.end()
+    );
+
+    clear();
+    for(auto &&actor : kept)
+        add(*actor);
+}
+
+void SceneComponents::clear()
+{
+    actors.clear();
+    static_meshes.clear();
+    cameras.clear();
+}
+
+size_t SceneComponents::size() const
+{
+    return actors.size();
+}
+
+bool SceneComponents::empty() const
+{
+    return actors.empty();
+}
+
+const std::vector<Actor*> &SceneComponents::get_actors() const
+{
+    return actors;
+}
+
+const std::vector<SceneComponents::Component<StaticMesh>> &SceneComponents::get_static_meshes() const
+{
+    return static_meshes;
+}
+
+const std::vector<SceneComponents::Component<Camera>> &SceneComponents::get_cameras() const
+{
+    return cameras;
+}
\ No newline at end of file
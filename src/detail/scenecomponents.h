@@ -0,0 +1,61 @@
+#ifndef CG_SEM5_SCENECOMPONENTS_H
+#define CG_SEM5_SCENECOMPONENTS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#include "../camera.h"
+#include "../staticmesh.h"
+
+// Typed storage of the actors of a prepared scene, collected in one pass. Every actor is an entity, its handle
+// indexes the dense actor array, which is in the order of the model matrices in the dynamic uniform buffer.
+// Nodes are classified by their kind when they are added, so per frame systems walk contiguous arrays of raw
+// pointers with no casts and no reference counting. Nodes are owned by the scene graph, stand-ins like static
+// batches by their creator. Handles are valid until entities are removed or the storage is cleared
+class SceneComponents
+{
+public:
+    using Entity = uint32_t;
+
+    template <typename T>
+    struct Component
+    {
+        Entity entity;
+        T     *node;
+    };
+
+    void visit_down(Actor &);
+
+    Entity add(Actor &);
+
+    // Entities that are left keep their order
+    void remove(const std::unordered_set<const Actor*> &);
+    void clear();
+
+    size_t size() const;
+    bool empty() const;
+
+    const std::vector<Actor*> &get_actors() const;
+    const std::vector<Component<StaticMesh>> &get_static_meshes() const;
+    const std::vector<Component<Camera>> &get_cameras() const;
+
+    // Shared ownership for the few users that keep nodes, e.g. the actor controller
+    template <typename T>
+    std::shared_ptr<T> get_owner(const Component<T> &) const;
+
+private:
+    std::vector<Actor*>                actors;
+    std::vector<Component<StaticMesh>> static_meshes;
+    std::vector<Component<Camera>>     cameras;
+};
+
+template <typename T>
+std::shared_ptr<T> SceneComponents::get_owner(const Component<T> &component) const
+{
+    return std::static_pointer_cast<T>(component.node->shared_from_this());
+}
+
+#endif // CG_SEM5_SCENECOMPONENTS_H
\ No newline at end of file
@@ -6,7 +6,9 @@
 #include "vkassert.h"
 
 Device::Device(VkPhysicalDevice physical_device)
-: physical_device(physical_device)
+: physical_device(physical_device),
+descriptor_indexing_features(),
+descriptor_indexing_properties()
 {
     assert(physical_device != nullptr);
 
@@ -35,7 +37,11 @@ Device::Device(VkPhysicalDevice physical_device)
 Device::~Device()
 {
     if(logical_device)
+    {
+        sampler_cache.clear(logical_device);
+        staging_pool.clear();
         vkDestroyDevice(logical_device, nullptr);
+    }
 }
 
 Device::operator VkPhysicalDevice() const
@@ -96,11 +102,42 @@ QueueFamilyIndex Device::find_queue_family_index(VkQueueFlagBits queue_flags)
 }
 
 
+void Device::query_descriptor_indexing(VkInstance instance)
+{
+    if
+    (
+        !is_extension_supported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) ||
+        !is_extension_supported(VK_KHR_MAINTENANCE3_EXTENSION_NAME)
+    )
+        return;
+
+    auto get_features = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR"));
+    auto get_properties = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2KHR>(vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR"));
+    if(get_features == nullptr || get_properties == nullptr)
+        return;
+
+    descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2KHR features2 = {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features2.pNext = &descriptor_indexing_features;
+    get_features(physical_device, &features2);
+
+    descriptor_indexing_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2KHR properties2 = {};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    properties2.pNext = &descriptor_indexing_properties;
+    get_properties(physical_device, &properties2);
+
+    descriptor_indexing_features.pNext   = nullptr;
+    descriptor_indexing_properties.pNext = nullptr;
+}
+
 VkResult Device::initialize_logical_device
 (
     VkPhysicalDeviceFeatures enabled_features, 
     const std::vector<const char*> &enabled_extensions,
-    VkQueueFlags requested_queue_types
+    VkQueueFlags requested_queue_types,
+    const void *next
 )
 {
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
@@ -165,6 +202,7 @@ VkResult Device::initialize_logical_device
 
     VkDeviceCreateInfo device_create_info   = {};
     device_create_info.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    device_create_info.pNext                = next;
     device_create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
     device_create_info.pQueueCreateInfos    = queue_create_infos.data();
     device_create_info.pEnabledFeatures     = &enabled_features;
@@ -300,7 +338,7 @@ VkResult Device::create_buffer
             "Can't map buffer memory"
         );
 
-        std::memcpy(device_buffer->mapped_memory, buffer_data, device_buffer->size);
+        std::memcpy(device_buffer->mapped_memory, buffer_data, size);
         device_buffer->unmap();
     }
 
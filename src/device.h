@@ -9,6 +9,8 @@
 #include <vulkan/vulkan.h>
 
 #include "devicebuffer.h"
+#include "samplercache.h"
+#include "stagingpool.h"
 #include "vkdef.h"
 
 #undef max
@@ -29,6 +31,10 @@ struct Device
     std::vector<VkQueueFamilyProperties> queue_family_properties;
     std::vector<std::string>             supported_extensions;
 
+    // Zeroed until query_descriptor_indexing finds VK_EXT_descriptor_indexing
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT   descriptor_indexing_features;
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptor_indexing_properties;
+
     struct 
     {
         QueueFamilyIndex graphics;
@@ -36,6 +42,9 @@ struct Device
         QueueFamilyIndex transfer;
     } queue_family_indices;
 
+    SamplerCache sampler_cache;
+    StagingPool  staging_pool;
+
     Device(VkPhysicalDevice);
     ~Device();
 
@@ -47,11 +56,16 @@ struct Device
 
     QueueFamilyIndex find_queue_family_index(VkQueueFlagBits queue_flags);
 
+    // The instance must have VK_KHR_get_physical_device_properties2 enabled
+    void query_descriptor_indexing(VkInstance);
+
+    // next is chained to VkDeviceCreateInfo, e.g. for features of extensions
     VkResult initialize_logical_device
     (
         VkPhysicalDeviceFeatures enabled_features, 
         const std::vector<const char*> &enabled_extensions,
-        VkQueueFlags requested_queue_types = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT
+        VkQueueFlags requested_queue_types = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT,
+        const void *next = nullptr
     );
 
     VkResult create_buffer
@@ -68,6 +68,9 @@ VkResult DeviceBuffer::make_host_visible(VkDeviceSize size, VkDeviceSize offset)
 
 void DeviceBuffer::destroy()
 {
+    unmap();
+    size = 0;
+
     if(memory)
     {
         vkFreeMemory(device, memory, nullptr);
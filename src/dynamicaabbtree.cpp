@@ -0,0 +1,439 @@
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "dynamicaabbtree.h"
+
+BoundingBox fatten(const BoundingBox &);
+bool contains(const BoundingBox &outer, const BoundingBox &inner);
+bool overlaps(const BoundingBox &, const BoundingBox &);
+
+bool DynamicAabbTree::Node::is_leaf() const
+{
+    return left == NULL_PROXY;
+}
+
+DynamicAabbTree::DynamicAabbTree()
+: nodes(),
+root(NULL_PROXY),
+free_list(NULL_PROXY),
+leaf_count(0)
+{}
+
+DynamicAabbTree::Proxy DynamicAabbTree::insert(const BoundingBox &box, uint32_t user_data)
+{
+    Proxy leaf = allocate_node();
+    nodes[leaf].box       = fatten(box);
+    nodes[leaf].user_data = user_data;
+    nodes[leaf].height    = 0;
+
+    insert_leaf(leaf);
+    ++leaf_count;
+
+    return leaf;
+}
+
+void DynamicAabbTree::remove(Proxy leaf)
+{
+    assert(nodes[leaf].is_leaf());
+
+    remove_leaf(leaf);
+    free_node(leaf);
+    --leaf_count;
+}
+
+bool DynamicAabbTree::move(Proxy leaf, const BoundingBox &box)
+{
+    assert(nodes[leaf].is_leaf());
+
+    if(contains(nodes[leaf].box, box))
+        return false;
+
+    remove_leaf(leaf);
+    nodes[leaf].box = fatten(box);
+    insert_leaf(leaf);
+
+    return true;
+}
+
+void DynamicAabbTree::clear()
+{
+    nodes.clear();
+    root       = NULL_PROXY;
+    free_list  = NULL_PROXY;
+    leaf_count = 0;
+}
+
+uint32_t DynamicAabbTree::get_user_data(Proxy leaf) const
+{
+    return nodes[leaf].user_data;
+}
+
+const BoundingBox &DynamicAabbTree::get_fat_box(Proxy leaf) const
+{
+    return nodes[leaf].box;
+}
+
+size_t DynamicAabbTree::size() const
+{
+    return leaf_count;
+}
+
+int32_t DynamicAabbTree::get_height() const
+{
+    return root == NULL_PROXY? 0 : nodes[root].height;
+}
+
+void DynamicAabbTree::query(const BoundingBox &box, std::vector<uint32_t> &results) const
+{
+    if(root == NULL_PROXY)
+        return;
+
+    std::vector<Proxy> stack = { root };
+    while(!stack.empty())
+    {
+        auto &node = nodes[stack.back()];
+        stack.pop_back();
+
+        if(!overlaps(node.box, box))
+            continue;
+
+        if(node.is_leaf())
+        {
+            results.push_back(node.user_data);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+void DynamicAabbTree::query(const BoundingSphere &sphere, std::vector<uint32_t> &results) const
+{
+    if(root == NULL_PROXY)
+        return;
+
+    float radius_squared = sphere.radius * sphere.radius;
+
+    std::vector<Proxy> stack = { root };
+    while(!stack.empty())
+    {
+        auto &node = nodes[stack.back()];
+        stack.pop_back();
+
+        glm::vec3 offset = sphere.center - glm::clamp(sphere.center, node.box.min, node.box.max);
+        if(glm::dot(offset, offset) > radius_squared)
+            continue;
+
+        if(node.is_leaf())
+        {
+            results.push_back(node.user_data);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+void DynamicAabbTree::query(const Frustum &frustum, std::vector<uint32_t> &results) const
+{
+    if(root == NULL_PROXY)
+        return;
+
+    auto &planes = frustum.get_planes();
+
+    std::vector<Proxy> stack = { root };
+    while(!stack.empty())
+    {
+        Proxy index = stack.back();
+        auto &node  = nodes[index];
+        stack.pop_back();
+
+        glm::vec3 center = 0.5f * (node.box.min + node.box.max);
+        glm::vec3 extent = 0.5f * (node.box.max - node.box.min);
+
+        bool is_outside = false;
+        bool is_inside  = true;
+        for(auto &&plane : planes)
+        {
+            float distance = glm::dot(glm::vec3(plane), center) + plane.w;
+            float radius   = glm::dot(glm::abs(glm::vec3(plane)), extent);
+
+            is_outside = is_outside || distance + radius < 0.f;
+            is_inside  = is_inside && distance - radius >= 0.f;
+        }
+
+        if(is_outside)
+            continue;
+
+        if(is_inside || node.is_leaf())
+        {
+            collect(index, results);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+void DynamicAabbTree::raycast
+(
+    const glm::vec3 &origin,
+    const glm::vec3 &direction,
+    float max_distance,
+    std::vector<uint32_t> &results
+) const
+{
+    if(root == NULL_PROXY)
+        return;
+
+    // Slab test, infinities of axis parallel rays compare correctly
+    glm::vec3 inverse_direction = 1.f / direction;
+
+    std::vector<Proxy> stack = { root };
+    while(!stack.empty())
+    {
+        auto &node = nodes[stack.back()];
+        stack.pop_back();
+
+        glm::vec3 t0 = (node.box.min - origin) * inverse_direction;
+        glm::vec3 t1 = (node.box.max - origin) * inverse_direction;
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far  = glm::max(t0, t1);
+
+        float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.f));
+        float leave = std::min(std::min(far.x, far.y), std::min(far.z, max_distance));
+        if(enter > leave)
+            continue;
+
+        if(node.is_leaf())
+        {
+            results.push_back(node.user_data);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+DynamicAabbTree::Proxy DynamicAabbTree::allocate_node()
+{
+    if(free_list == NULL_PROXY)
+    {
+        nodes.emplace_back();
+        free_list = static_cast<Proxy>(nodes.size() - 1);
+        nodes.back().parent = NULL_PROXY;
+    }
+
+    Proxy index = free_list;
+    free_list = nodes[index].parent;
+
+    auto &node = nodes[index];
+    node.parent    = NULL_PROXY;
+    node.left      = NULL_PROXY;
+    node.right     = NULL_PROXY;
+    node.height    = 0;
+    node.user_data = 0;
+
+    return index;
+}
+
+void DynamicAabbTree::free_node(Proxy index)
+{
+    nodes[index].parent = free_list;
+    nodes[index].height = -1;
+    free_list = index;
+}
+
+void DynamicAabbTree::insert_leaf(Proxy leaf)
+{
+    if(root == NULL_PROXY)
+    {
+        root = leaf;
+        nodes[root].parent = NULL_PROXY;
+        return;
+    }
+
+    // Descends while pushing the leaf down costs less than making it a sibling here.
+    // Every ancestor of a new node grows by the inheritance cost
+    BoundingBox leaf_box = nodes[leaf].box;
+    Proxy index = root;
+    while(!nodes[index].is_leaf())
+    {
+        auto &node = nodes[index];
+
+        float area          = surface_area(node.box);
+        float combined_area = surface_area(combine(node.box, leaf_box));
+
+        float cost             = 2.f * combined_area;
+        float inheritance_cost = 2.f * (combined_area - area);
+
+        float child_costs[2];
+        Proxy children[2] = { node.left, node.right };
+        for(size_t i = 0; i < 2; ++i)
+        {
+            auto &child = nodes[children[i]];
+            float new_area = surface_area(combine(child.box, leaf_box));
+            child_costs[i] = (child.is_leaf()? new_area : new_area - surface_area(child.box)) + inheritance_cost;
+        }
+
+        if(cost < child_costs[0] && cost < child_costs[1])
+            break;
+
+        index = child_costs[0] < child_costs[1]? children[0] : children[1];
+    }
+
+    Proxy sibling    = index;
+    Proxy old_parent = nodes[sibling].parent;
+    Proxy new_parent = allocate_node();
+
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].box    = combine(leaf_box, nodes[sibling].box);
+    nodes[new_parent].height = nodes[sibling].height + 1;
+    nodes[new_parent].left   = sibling;
+    nodes[new_parent].right  = leaf;
+    nodes[sibling].parent    = new_parent;
+    nodes[leaf].parent       = new_parent;
+
+    if(old_parent == NULL_PROXY)
+        root = new_parent;
+    else
+        replace_child(old_parent, sibling, new_parent);
+
+    refit(nodes[leaf].parent);
+}
+
+void DynamicAabbTree::remove_leaf(Proxy leaf)
+{
+    if(leaf == root)
+    {
+        root = NULL_PROXY;
+        return;
+    }
+
+    Proxy parent       = nodes[leaf].parent;
+    Proxy grand_parent = nodes[parent].parent;
+    Proxy sibling      = nodes[parent].left == leaf? nodes[parent].right : nodes[parent].left;
+
+    // The sibling takes the place of the parent
+    nodes[sibling].parent = grand_parent;
+    free_node(parent);
+
+    if(grand_parent == NULL_PROXY)
+    {
+        root = sibling;
+        return;
+    }
+
+    replace_child(grand_parent, parent, sibling);
+    refit(grand_parent);
+}
+
+void DynamicAabbTree::refit(Proxy index)
+{
+    while(index != NULL_PROXY)
+    {
+        index = balance(index);
+
+        auto &node = nodes[index];
+        node.height = 1 + std::max(nodes[node.left].height, nodes[node.right].height);
+        node.box    = combine(nodes[node.left].box, nodes[node.right].box);
+
+        index = node.parent;
+    }
+}
+
+DynamicAabbTree::Proxy DynamicAabbTree::balance(Proxy a)
+{
+    if(nodes[a].is_leaf() || nodes[a].height < 2)
+        return a;
+
+    Proxy b = nodes[a].left;
+    Proxy c = nodes[a].right;
+    int32_t difference = nodes[c].height - nodes[b].height;
+
+    if(difference >= -1 && difference <= 1)
+        return a;
+
+    // The taller child takes the place of a, a takes its shorter grandchild
+    bool is_right_taller = difference > 1;
+    Proxy up    = is_right_taller? c : b;
+    Proxy stay  = is_right_taller? b : c;
+    Proxy f     = nodes[up].left;
+    Proxy g     = nodes[up].right;
+
+    nodes[up].left   = a;
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent  = up;
+
+    if(nodes[up].parent == NULL_PROXY)
+        root = up;
+    else
+        replace_child(nodes[up].parent, a, up);
+
+    Proxy taller  = nodes[f].height > nodes[g].height? f : g;
+    Proxy shorter = taller == f? g : f;
+
+    nodes[up].right       = taller;
+    nodes[shorter].parent = a;
+
+    // a keeps its untouched child on the same side
+    if(is_right_taller)
+        nodes[a].right = shorter;
+    else
+        nodes[a].left = shorter;
+
+    nodes[a].box     = combine(nodes[stay].box, nodes[shorter].box);
+    nodes[a].height  = 1 + std::max(nodes[stay].height, nodes[shorter].height);
+    nodes[up].box    = combine(nodes[a].box, nodes[taller].box);
+    nodes[up].height = 1 + std::max(nodes[a].height, nodes[taller].height);
+
+    return up;
+}
+
+void DynamicAabbTree::replace_child(Proxy parent, Proxy old_child, Proxy new_child)
+{
+    if(nodes[parent].left == old_child)
+        nodes[parent].left = new_child;
+    else
+        nodes[parent].right = new_child;
+}
+
+void DynamicAabbTree::collect(Proxy index, std::vector<uint32_t> &results) const
+{
+    std::vector<Proxy> stack = { index };
+    while(!stack.empty())
+    {
+        auto &node = nodes[stack.back()];
+        stack.pop_back();
+
+        if(node.is_leaf())
+        {
+            results.push_back(node.user_data);
+            continue;
+        }
+
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+}
+
+BoundingBox fatten(const BoundingBox &box)
+{
+    glm::vec3 margin = glm::max(DynamicAabbTree::FAT_MARGIN * (box.max - box.min), glm::vec3(DynamicAabbTree::MIN_FAT_MARGIN));
+    return { box.min - margin, box.max + margin };
+}
+
+bool contains(const BoundingBox &outer, const BoundingBox &inner)
+{
+    return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::greaterThanEqual(outer.max, inner.max));
+}
+
+bool overlaps(const BoundingBox &a, const BoundingBox &b)
+{
+    return glm::all(glm::lessThanEqual(a.min, b.max)) && glm::all(glm::lessThanEqual(b.min, a.max));
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#ifndef CG_SEM5_DYNAMICAABBTREE_H
+#define CG_SEM5_DYNAMICAABBTREE_H
+
+#include <cstdint>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "boundingvolume.h"
+#include "frustum.h"
+
+// Incremental bounding volume hierarchy of fat boxes. Leaves are enlarged by a margin, so boxes that move a little
+// stay inside their leaf and only the ones that leave it are reinserted. Insertion picks the sibling that adds
+// the least surface area, and every node on the way up is rebalanced with a rotation when its children heights
+// differ by more than one. Queries return the user data of leaves whose fat boxes pass, in no particular order
+class DynamicAabbTree
+{
+public:
+    using Proxy = int32_t;
+
+    static constexpr Proxy NULL_PROXY = -1;
+
+    // Fat boxes grow by this part of their size on every side, and by at least MIN_FAT_MARGIN
+    static constexpr float FAT_MARGIN     = 0.1f;
+    static constexpr float MIN_FAT_MARGIN = 0.05f;
+
+    DynamicAabbTree();
+
+    Proxy insert(const BoundingBox &, uint32_t user_data);
+    void remove(Proxy);
+
+    // Returns true if the box left its fat box and the leaf was reinserted
+    bool move(Proxy, const BoundingBox &);
+
+    void clear();
+
+    uint32_t get_user_data(Proxy) const;
+    const BoundingBox &get_fat_box(Proxy) const;
+
+    size_t size() const;
+    int32_t get_height() const;
+
+    void query(const BoundingBox &, std::vector<uint32_t> &results) const;
+    void query(const BoundingSphere &, std::vector<uint32_t> &results) const;
+
+    // Subtrees inside every plane are taken whole
+    void query(const Frustum &, std::vector<uint32_t> &results) const;
+
+    // Leaves whose fat boxes the ray enters within max_distance, direction doesn't have to be normalized
+    void raycast
+    (
+        const glm::vec3 &origin,
+        const glm::vec3 &direction,
+        float max_distance,
+        std::vector<uint32_t> &results
+    ) const;
+
+private:
+    struct Node
+    {
+        BoundingBox box;
+
+        Proxy parent; // Next free node while the node is free
+        Proxy left;
+        Proxy right;
+
+        int32_t  height; // 0 for leaves, -1 for free nodes
+        uint32_t user_data;
+
+        bool is_leaf() const;
+    };
+
+    Proxy allocate_node();
+    void free_node(Proxy);
+
+    void insert_leaf(Proxy);
+    void remove_leaf(Proxy);
+
+    // Refits boxes and heights from node to the root, rotating unbalanced nodes
+    void refit(Proxy);
+    Proxy balance(Proxy);
+
+    void replace_child(Proxy parent, Proxy old_child, Proxy new_child);
+
+    // Appends the user data of every leaf under node
+    void collect(Proxy, std::vector<uint32_t> &results) const;
+
+    std::vector<Node> nodes;
+    Proxy  root;
+    Proxy  free_list;
+    size_t leaf_count;
+};
+
+#endif // CG_SEM5_DYNAMICAABBTREE_H
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "frustum.h"
+
+Frustum::Frustum()
+: planes()
+{}
+
+Frustum::Frustum(const glm::mat4 &view_projection)
+: planes()
+{
+    update(view_projection);
+}
+
+void Frustum::update(const glm::mat4 &view_projection)
+{
+    glm::mat4 matrix = glm::transpose(view_projection);
+
+    planes[0] = matrix[3] + matrix[0]; // Left
+    planes[1] = matrix[3] - matrix[0]; // Right
+    planes[2] = matrix[3] + matrix[1]; // Bottom
+    planes[3] = matrix[3] - matrix[1]; // Top
+    planes[4] = matrix[3] + matrix[2]; // Near
+    planes[5] = matrix[3] - matrix[2]; // Far
+
+    for(auto &&plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+const Frustum::Planes &Frustum::get_planes() const
+{
+    return planes;
+}
+
+Frustum::Planes Frustum::get_local_planes(const glm::mat4 &model) const
+{
+    Planes local_planes;
+    glm::mat4 transposed_model = glm::transpose(model);
+
+    for(size_t i = 0; i < PLANES_COUNT; ++i)
+        local_planes[i] = transposed_model * planes[i];
+
+    return local_planes;
+}
+
+bool Frustum::intersects(const BoundingSphere &sphere) const
+{
+    for(auto &&plane : planes)
+        if(glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius)
+            return false;
+
+    return true;
+}
\ No newline at end of file
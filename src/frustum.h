@@ -0,0 +1,36 @@
+#ifndef CG_SEM5_FRUSTUM_H
+#define CG_SEM5_FRUSTUM_H
+
+#include <array>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "boundingvolume.h"
+
+class Frustum
+{
+public:
+    static constexpr size_t PLANES_COUNT = 6;
+
+    using Planes = std::array<glm::vec4, PLANES_COUNT>;
+
+    Frustum();
+    Frustum(const glm::mat4 &view_projection);
+
+    void update(const glm::mat4 &view_projection);
+
+    // Planes point inside, (xyz, w) is (normal, distance)
+    const Planes &get_planes() const;
+
+    // Planes of the same frustum expressed in the local space of the model matrix.
+    // Signed distances stay in world units, so local radii must be multiplied by the model scale
+    Planes get_local_planes(const glm::mat4 &model) const;
+
+    bool intersects(const BoundingSphere &) const;
+
+private:
+    Planes planes;
+};
+
+#endif // CG_SEM5_FRUSTUM_H
\ No newline at end of file
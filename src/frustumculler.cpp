@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+
+#include "frustumculler.h"
+#include "simd.h"
+
+bool FrustumCuller::Draw::operator==(const Draw &other) const
+{
+    return entity == other.entity && mesh == other.mesh && part == other.part;
+}
+
+bool FrustumCuller::Draw::operator!=(const Draw &other) const
+{
+    return !(*this == other);
+}
+
+void FrustumCuller::cull
+(
+    const Frustum &frustum,
+    const std::vector<SceneComponents::Component<StaticMesh>> &meshes,
+    const std::vector<uint32_t> &lods,
+    std::vector<Draw> &draws
+)
+{
+    statistics = {};
+    draws.clear();
+    candidates.clear();
+
+    boxes.clear();
+    for(auto &&[entity, mesh] : meshes)
+        boxes.add(mesh->get_bounding_box(), mesh->get_model_matrix());
+
+    statistics.tested += boxes.size();
+    test(frustum, boxes, visible);
+
+    // A single part has about the box of its mesh, so it is drawn right away
+    boxes.clear();
+    for(size_t i = 0, meshes_count = meshes.size(); i < meshes_count; ++i)
+    {
+        if(!visible[i])
+            continue;
+
+        auto &[entity, mesh] = meshes[i];
+        auto &parts = mesh->get_parts();
+        for(uint32_t j = 0, parts_count = static_cast<uint32_t>(parts.size()); j < parts_count; ++j)
+        {
+            if(parts_count == 1)
+            {
+                draws.push_back({ entity, mesh, j });
+                continue;
+            }
+
+            boxes.add(parts[j].bounding_box, mesh->get_model_matrix());
+            candidates.push_back({ entity, mesh, j });
+        }
+    }
+
+    statistics.tested += boxes.size();
+    test(frustum, boxes, visible);
+
+    for(size_t i = 0, candidates_count = candidates.size(); i < candidates_count; ++i)
+        if(visible[i])
+            draws.push_back(candidates[i]);
+
+    // Single parts went first, draws of one mesh must stay together and in part order
+    std::stable_sort
+    (
+        draws.begin(),
+        draws.end(),
+        [](auto &&a, auto &&b) { return a.entity != b.entity? a.entity < b.entity : a.part < b.part; }
+    );
+
+    statistics.visible = draws.size();
+    for(auto &&draw : draws)
+    {
+        auto &part = draw.mesh->get_parts()[draw.part];
+        auto &lod  = part.lods[std::min(lods[draw.entity], static_cast<uint32_t>(part.lods.size() - 1))];
+        statistics.triangles += lod.index_count / 3;
+    }
+}
+
+const FrustumCuller::Statistics &FrustumCuller::get_statistics() const
+{
+    return statistics;
+}
+
+void FrustumCuller::Boxes::clear()
+{
+    for(auto component : { &center_x, &center_y, &center_z, &extent_x, &extent_y, &extent_z })
+        component->clear();
+}
+
+void FrustumCuller::Boxes::add(const BoundingBox &box, const glm::mat4 &model)
+{
+    BoundingBox world_box = transform_bounding_box(box, model);
+    glm::vec3 center = 0.5f * (world_box.min + world_box.max);
+    glm::vec3 extent = 0.5f * (world_box.max - world_box.min);
+
+    center_x.push_back(center.x);
+    center_y.push_back(center.y);
+    center_z.push_back(center.z);
+    extent_x.push_back(extent.x);
+    extent_y.push_back(extent.y);
+    extent_z.push_back(extent.z);
+}
+
+size_t FrustumCuller::Boxes::size() const
+{
+    return center_x.size();
+}
+
+void FrustumCuller::test(const Frustum &frustum, Boxes &boxes, std::vector<uint8_t> &visible) const
+{
+    auto &planes = frustum.get_planes();
+
+    // A box is outside when its corner furthest along the plane normal is behind the plane
+    size_t count = boxes.size();
+    visible.assign(count, 0);
+
+    size_t i = 0;
+
+#ifdef CG_SEM5_SSE
+    // Padding lanes are never read back
+    size_t padded_count = (count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+    for(auto component : { &boxes.center_x, &boxes.center_y, &boxes.center_z, &boxes.extent_x, &boxes.extent_y, &boxes.extent_z })
+        component->resize(padded_count, 0.f);
+
+    const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    for(; i < count; i += SIMD_WIDTH)
+    {
+        __m128 x  = _mm_loadu_ps(&boxes.center_x[i]);
+        __m128 y  = _mm_loadu_ps(&boxes.center_y[i]);
+        __m128 z  = _mm_loadu_ps(&boxes.center_z[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extent_x[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.extent_y[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.extent_z[i]);
+        __m128 is_visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for(auto &&plane : planes)
+        {
+            __m128 distance = _mm_add_ps
+            (
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w))
+            );
+
+            __m128 radius = _mm_add_ps
+            (
+                _mm_add_ps
+                (
+                    _mm_mul_ps(ex, _mm_and_ps(_mm_set1_ps(plane.x), sign_mask)),
+                    _mm_mul_ps(ey, _mm_and_ps(_mm_set1_ps(plane.y), sign_mask))
+                ),
+                _mm_mul_ps(ez, _mm_and_ps(_mm_set1_ps(plane.z), sign_mask))
+            );
+
+            is_visible = _mm_and_ps(is_visible, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(is_visible);
+        for(size_t j = 0, lanes = std::min(SIMD_WIDTH, count - i); j < lanes; ++j)
+            visible[i + j] = (mask >> j) & 1;
+    }
+
+    for(auto component : { &boxes.center_x, &boxes.center_y, &boxes.center_z, &boxes.extent_x, &boxes.extent_y, &boxes.extent_z })
+        component->resize(count);
+#endif // CG_SEM5_SSE
+
+    for(; i < count; ++i)
+    {
+        glm::vec3 center(boxes.center_x[i], boxes.center_y[i], boxes.center_z[i]);
+        glm::vec3 extent(boxes.extent_x[i], boxes.extent_y[i], boxes.extent_z[i]);
+        bool is_visible = true;
+
+        for(auto &&plane : planes)
+            is_visible = is_visible && glm::dot(glm::vec3(plane), center) + plane.w + glm::dot(glm::abs(glm::vec3(plane)), extent) >= 0.f;
+
+        visible[i] = is_visible? 1 : 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef CG_SEM5_FRUSTUMCULLER_H
+#define CG_SEM5_FRUSTUMCULLER_H
+
+#include <cstdint>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "staticmesh.h"
+#include "frustum.h"
+#include "detail/scenecomponents.h"
+
+// Frustum test of world space bounding boxes, four at a time: meshes first, then the parts of visible meshes
+// that have more than one. Visible parts make the draw list the renderer records
+class FrustumCuller
+{
+public:
+    struct Draw
+    {
+        SceneComponents::Entity entity;
+        const StaticMesh       *mesh;
+        uint32_t                part;
+
+        bool operator==(const Draw &) const;
+        bool operator!=(const Draw &) const;
+    };
+
+    struct Statistics
+    {
+        size_t tested    = 0; // Boxes of meshes and parts
+        size_t visible   = 0; // Drawn parts
+        size_t triangles = 0; // Of the selected LODs, before meshlet culling
+    };
+
+    // Replaces draws with the visible parts, in the order of meshes and of their parts.
+    // lods holds the LOD of every entity
+    void cull
+    (
+        const Frustum &,
+        const std::vector<SceneComponents::Component<StaticMesh>> &meshes,
+        const std::vector<uint32_t> &lods,
+        std::vector<Draw> &draws
+    );
+
+    // Of the last cull
+    const Statistics &get_statistics() const;
+
+private:
+    static constexpr size_t SIMD_WIDTH = 4;
+
+    // Center and half extent of every box, padded to SIMD_WIDTH by test
+    struct Boxes
+    {
+        std::vector<float> center_x, center_y, center_z;
+        std::vector<float> extent_x, extent_y, extent_z;
+
+        void clear();
+        void add(const BoundingBox &, const glm::mat4 &model);
+        size_t size() const;
+    };
+
+    // visible gets one flag per box
+    void test(const Frustum &, Boxes &, std::vector<uint8_t> &visible) const;
+
+    Boxes boxes;
+    std::vector<uint8_t> visible;
+    std::vector<Draw> candidates;
+    Statistics statistics;
+};
+
+#endif // CG_SEM5_FRUSTUMCULLER_H
\ No newline at end of file
@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "geometrycodec.h"
+#include "simd.h"
+
+// Planes are stored with 0, 2, 4 or 8 bits per delta, selected by a 2-bit mode
+static constexpr size_t PLANE_MODE_COUNT = 4;
+static constexpr size_t PLANE_SIZES[PLANE_MODE_COUNT] = { 0, 4, 8, 16 };
+
+static uint8_t select_plane_mode(const uint8_t *deltas);
+static void encode_plane(const uint8_t *deltas, uint8_t mode, std::vector<uint8_t> &data);
+static void decode_plane(const uint8_t *data, uint8_t mode, uint8_t last, uint8_t *plane);
+static void transpose_block(const uint8_t *planes, size_t vertex_count, size_t stride, uint8_t *vertices);
+
+std::vector<uint8_t> GeometryCodec::encode_indices(const MeshElementIndex *indices, size_t count)
+{
+    std::vector<uint8_t> data;
+    data.reserve(count * 2);
+
+    MeshElementIndex previous = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        int32_t  delta  = static_cast<int32_t>(indices[i] - previous);
+        uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+        previous = indices[i];
+
+        while(zigzag >= 0x80)
+        {
+            data.push_back(static_cast<uint8_t>(zigzag | 0x80));
+            zigzag >>= 7;
+        }
+        data.push_back(static_cast<uint8_t>(zigzag));
+    }
+
+    return data;
+}
+
+void GeometryCodec::decode_indices(const uint8_t *data, size_t size, MeshElementIndex *indices, size_t count)
+{
+    const uint8_t *end = data + size;
+
+    MeshElementIndex previous = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        uint32_t zigzag = 0;
+        for(uint32_t shift = 0;; shift += 7)
+        {
+            if(data == end || shift > 28)
+                throw std::runtime_error("Corrupted index stream");
+
+            uint8_t byte = *data++;
+            zigzag |= static_cast<uint32_t>(byte & 0x7f) << shift;
+
+            if((byte & 0x80) == 0)
+                break;
+        }
+
+        previous  += (zigzag >> 1) ^ (0u - (zigzag & 1));
+        indices[i] = previous;
+    }
+
+    if(data != end)
+        throw std::runtime_error("Corrupted index stream");
+}
+
+std::vector<uint8_t> GeometryCodec::encode_vertices(const void *vertices, size_t count, size_t stride)
+{
+    const auto *bytes = static_cast<const uint8_t*>(vertices);
+
+    std::vector<uint8_t> data;
+    data.reserve(count * stride / 2);
+
+    std::vector<uint8_t> last(stride, 0);
+    std::vector<uint8_t> deltas(stride * BLOCK_SIZE);
+
+    for(size_t base = 0; base < count; base += BLOCK_SIZE)
+    {
+        // Vertices past the end repeat the previous one, so their deltas are free
+        for(size_t k = 0; k < stride; ++k)
+        {
+            for(size_t i = 0; i < BLOCK_SIZE; ++i)
+            {
+                uint8_t byte = base + i < count? bytes[(base + i) * stride + k] : last[k];
+                deltas[k * BLOCK_SIZE + i] = static_cast<uint8_t>(byte - last[k]);
+                last[k] = byte;
+            }
+        }
+
+        // Modes of four planes per byte, then the planes
+        size_t header = data.size();
+        data.resize(header + (stride + 3) / 4, 0);
+
+        for(size_t k = 0; k < stride; ++k)
+        {
+            uint8_t mode = select_plane_mode(&deltas[k * BLOCK_SIZE]);
+            data[header + k / 4] |= static_cast<uint8_t>(mode << (k % 4 * 2));
+            encode_plane(&deltas[k * BLOCK_SIZE], mode, data);
+        }
+    }
+
+    return data;
+}
+
+void GeometryCodec::decode_vertices(const uint8_t *data, size_t size, void *vertices, size_t count, size_t stride)
+{
+    const uint8_t *end = data + size;
+    auto *bytes = static_cast<uint8_t*>(vertices);
+
+    size_t header_size = (stride + 3) / 4;
+
+    std::vector<uint8_t> last(stride, 0);
+    std::vector<uint8_t> planes(stride * BLOCK_SIZE);
+
+    for(size_t base = 0; base < count; base += BLOCK_SIZE)
+    {
+        if(static_cast<size_t>(end - data) < header_size)
+            throw std::runtime_error("Corrupted vertex stream");
+
+        const uint8_t *header = data;
+        data += header_size;
+
+        for(size_t k = 0; k < stride; ++k)
+        {
+            uint8_t mode = (header[k / 4] >> (k % 4 * 2)) & 3;
+            if(static_cast<size_t>(end - data) < PLANE_SIZES[mode])
+                throw std::runtime_error("Corrupted vertex stream");
+
+            uint8_t *plane = planes.data() + k * BLOCK_SIZE;
+            decode_plane(data, mode, last[k], plane);
+            last[k] = plane[BLOCK_SIZE - 1];
+            data += PLANE_SIZES[mode];
+        }
+
+        transpose_block(planes.data(), std::min(BLOCK_SIZE, count - base), stride, bytes + base * stride);
+    }
+
+    if(data != end)
+        throw std::runtime_error("Corrupted vertex stream");
+}
+
+static uint8_t select_plane_mode(const uint8_t *deltas)
+{
+    int min = 0, max = 0;
+    for(size_t i = 0; i < GeometryCodec::BLOCK_SIZE; ++i)
+    {
+        int delta = static_cast<int8_t>(deltas[i]);
+        min = std::min(min, delta);
+        max = std::max(max, delta);
+    }
+
+    if(min == 0 && max == 0)
+        return 0;
+
+    if(min >= -2 && max <= 1)
+        return 1;
+
+    if(min >= -8 && max <= 7)
+        return 2;
+
+    return 3;
+}
+
+static void encode_plane(const uint8_t *deltas, uint8_t mode, std::vector<uint8_t> &data)
+{
+    size_t bits = PLANE_SIZES[mode] / 2;
+    if(bits == 0)
+        return;
+
+    size_t base = data.size();
+    data.resize(base + PLANE_SIZES[mode], 0);
+
+    // Delta i goes to bits [i % per_byte * bits, ...) of byte i / per_byte
+    size_t per_byte = 8 / bits;
+    uint8_t mask = static_cast<uint8_t>((1u << bits) - 1);
+    for(size_t i = 0; i < GeometryCodec::BLOCK_SIZE; ++i)
+        data[base + i / per_byte] |= static_cast<uint8_t>((deltas[i] & mask) << (i % per_byte * bits));
+}
+
+static void decode_plane(const uint8_t *data, uint8_t mode, uint8_t last, uint8_t *plane)
+{
+#ifdef CG_SEM5_SSE
+    __m128i deltas;
+    switch(mode)
+    {
+    case 0:
+        deltas = _mm_setzero_si128();
+        break;
+
+    case 1:
+    {
+        // Every byte repeated four times, then each copy keeps its own two bits
+        int32_t word;
+        std::memcpy(&word, data, sizeof(word));
+        __m128i bytes = _mm_cvtsi32_si128(word);
+        bytes = _mm_unpacklo_epi8(bytes, bytes);
+        bytes = _mm_unpacklo_epi16(bytes, bytes);
+
+        __m128i fields = _mm_or_si128
+        (
+            _mm_or_si128
+            (
+                _mm_and_si128(bytes, _mm_set1_epi32(0x00000003)),
+                _mm_and_si128(_mm_srli_epi16(bytes, 2), _mm_set1_epi32(0x00000300))
+            ),
+            _mm_or_si128
+            (
+                _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi32(0x00030000)),
+                _mm_and_si128(_mm_srli_epi16(bytes, 6), _mm_set1_epi32(0x03000000))
+            )
+        );
+
+        // Sign extension of the two bit fields
+        deltas = _mm_sub_epi8(_mm_xor_si128(fields, _mm_set1_epi8(2)), _mm_set1_epi8(2));
+        break;
+    }
+    case 2:
+    {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+        bytes = _mm_unpacklo_epi8(bytes, bytes);
+
+        __m128i fields = _mm_or_si128
+        (
+            _mm_and_si128(bytes, _mm_set1_epi16(0x000f)),
+            _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi16(0x0f00))
+        );
+
+        deltas = _mm_sub_epi8(_mm_xor_si128(fields, _mm_set1_epi8(8)), _mm_set1_epi8(8));
+        break;
+    }
+    default:
+        deltas = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    }
+
+    // Inclusive prefix sum of 16 bytes in four shifted adds
+    __m128i sum = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 1));
+    sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 2));
+    sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 4));
+    sum = _mm_add_epi8(sum, _mm_slli_si128(sum, 8));
+    sum = _mm_add_epi8(sum, _mm_set1_epi8(static_cast<char>(last)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(plane), sum);
+#else
+    size_t bits = PLANE_SIZES[mode] / 2;
+    size_t per_byte = bits == 0? 1 : 8 / bits;
+    uint32_t sign = bits == 0? 0 : 1u << (bits - 1);
+
+    for(size_t i = 0; i < GeometryCodec::BLOCK_SIZE; ++i)
+    {
+        uint32_t field = bits == 0? 0 : (data[i / per_byte] >> (i % per_byte * bits)) & ((1u << bits) - 1);
+        last += static_cast<uint8_t>((field ^ sign) - sign);
+        plane[i] = last;
+    }
+#endif
+}
+
+static void transpose_block(const uint8_t *planes, size_t vertex_count, size_t stride, uint8_t *vertices)
+{
+    static constexpr size_t BLOCK_SIZE = GeometryCodec::BLOCK_SIZE;
+
+    size_t k = 0;
+
+#ifdef CG_SEM5_SSE
+    if(vertex_count == BLOCK_SIZE)
+    {
+        // Four planes interleave into one 32-bit word per vertex
+        for(; k + 4 <= stride; k += 4)
+        {
+            __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 0) * BLOCK_SIZE));
+            __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 1) * BLOCK_SIZE));
+            __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 2) * BLOCK_SIZE));
+            __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(planes + (k + 3) * BLOCK_SIZE));
+
+            __m128i p01_lo = _mm_unpacklo_epi8(p0, p1);
+            __m128i p01_hi = _mm_unpackhi_epi8(p0, p1);
+            __m128i p23_lo = _mm_unpacklo_epi8(p2, p3);
+            __m128i p23_hi = _mm_unpackhi_epi8(p2, p3);
+
+            __m128i words[4] =
+            {
+                _mm_unpacklo_epi16(p01_lo, p23_lo),
+                _mm_unpackhi_epi16(p01_lo, p23_lo),
+                _mm_unpacklo_epi16(p01_hi, p23_hi),
+                _mm_unpackhi_epi16(p01_hi, p23_hi)
+            };
+
+            for(size_t w = 0; w < 4; ++w)
+            {
+                uint8_t *vertex = vertices + w * 4 * stride + k;
+                int32_t  word;
+
+                word = _mm_cvtsi128_si32(words[w]);
+                std::memcpy(vertex, &word, sizeof(word));
+                word = _mm_cvtsi128_si32(_mm_srli_si128(words[w], 4));
+                std::memcpy(vertex + stride, &word, sizeof(word));
+                word = _mm_cvtsi128_si32(_mm_srli_si128(words[w], 8));
+                std::memcpy(vertex + 2 * stride, &word, sizeof(word));
+                word = _mm_cvtsi128_si32(_mm_srli_si128(words[w], 12));
+                std::memcpy(vertex + 3 * stride, &word, sizeof(word));
+            }
+        }
+    }
+#endif
+
+    for(; k < stride; ++k)
+        for(size_t i = 0; i < vertex_count; ++i)
+            vertices[i * stride + k] = planes[k * BLOCK_SIZE + i];
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef CG_SEM5_GEOMETRYCODEC_H
+#define CG_SEM5_GEOMETRYCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "abstractmesh.h"
+
+// Lossless compression of vertex and index streams for cooked meshes.
+// Indices: delta to the previous index, zigzag and LEB128 varints.
+// Vertices: blocks of BLOCK_SIZE vertices are transposed into byte planes, every byte is replaced
+// by its difference to the same byte of the previous vertex, and each plane is bit packed
+// with the narrowest of 0, 2, 4 or 8 bits per delta. Unpacking and transposition are SSE2 accelerated.
+// Decoders throw std::runtime_error on truncated or corrupted input
+class GeometryCodec
+{
+public:
+    static constexpr size_t BLOCK_SIZE = 16;
+
+    static std::vector<uint8_t> encode_indices(const MeshElementIndex *indices, size_t count);
+    static void decode_indices(const uint8_t *data, size_t size, MeshElementIndex *indices, size_t count);
+
+    static std::vector<uint8_t> encode_vertices(const void *vertices, size_t count, size_t stride);
+    static void decode_vertices(const uint8_t *data, size_t size, void *vertices, size_t count, size_t stride);
+};
+
+#endif // CG_SEM5_GEOMETRYCODEC_H
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include <cassert>
+#include <cstddef>
+
+#include "geometryheap.h"
+#include "vkassert.h"
+
+static_assert
+(
+    offsetof(StaticMesh::Vertex, normal) == GeometryHeap::POSITION_STREAM_STRIDE,
+    "Split vertex streams expect the position to be the first vertex member"
+);
+
+void transfer_barrier(VkCommandBuffer command_buffer)
+{
+    VkMemoryBarrier barrier = {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    vkCmdPipelineBarrier
+    (
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr
+    );
+}
+
+GeometryHeap::GeometryHeap(std::shared_ptr<Device> device, VertexStreamLayout layout, size_t vertex_capacity, size_t index_capacity)
+: device(device),
+vertex_layout(layout),
+vertices
+({
+    {},
+    layout == VertexStreamLayout::INTERLEAVED? 
+        std::vector<size_t> { sizeof(StaticMesh::Vertex) } : 
+        std::vector<size_t> { POSITION_STREAM_STRIDE, ATTRIBUTE_STREAM_STRIDE },
+    RangeAllocator(vertex_capacity),
+    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+}),
+indices
+({
+    {},
+    { sizeof(MeshElementIndex) },
+    RangeAllocator(index_capacity),
+    VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+}),
+allocations(),
+is_allocated(),
+free_handles(),
+transient_buffers()
+{
+    for(size_t i = 0; i < vertices.element_sizes.size(); ++i)
+        vertices.buffers.push_back(create_arena_buffer(vertices, i, vertex_capacity));
+
+    indices.buffers.push_back(create_arena_buffer(indices, 0, index_capacity));
+}
+
+GeometryHeap::Handle GeometryHeap::upload(const StaticMesh &mesh, VkCommandBuffer command_buffer)
+{
+    if(!mesh.has_cpu_geometry())
+        throw std::runtime_error("Can't upload static mesh \"" + mesh.get_id() + "\" without its CPU geometry");
+
+    auto &mesh_vertices = mesh.get_vertices();
+    auto &mesh_indices  = mesh.get_indices();
+
+    Allocation allocation;
+    allocation.vertex_count  = static_cast<uint32_t>(mesh_vertices.size());
+    allocation.index_count   = static_cast<uint32_t>(mesh_indices.size());
+    allocation.vertex_offset = static_cast<uint32_t>(allocate(vertices, allocation.vertex_count, command_buffer));
+    allocation.first_index   = static_cast<uint32_t>(allocate(indices, allocation.index_count, command_buffer));
+
+    VkDeviceSize vertex_data_size = mesh_vertices.size() * sizeof(StaticMesh::Vertex);
+    VkDeviceSize index_data_size  = mesh_indices.size() * sizeof(MeshElementIndex);
+
+    if(vertex_data_size + index_data_size > 0)
+    {
+        // Mesh arrays go straight into one staging buffer, vertex streams first
+        auto staging = std::make_shared<DeviceBuffer>();
+        vk_assert
+        (
+            device->create_buffer
+            (
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                staging,
+                vertex_data_size + index_data_size
+            ),
+            "Can't create staging buffer for static mesh geometry"
+        );
+
+        vk_assert
+        (
+            staging->map(),
+            "Can't map staging buffer for static mesh geometry"
+        );
+
+        auto staging_data = static_cast<uint8_t*>(staging->mapped_memory);
+        if(vertex_layout == VertexStreamLayout::INTERLEAVED)
+            std::memcpy(staging_data, mesh_vertices.data(), vertex_data_size);
+        else
+        {
+            uint8_t *attributes = staging_data + mesh_vertices.size() * POSITION_STREAM_STRIDE;
+
+            // Vertex::position comes first, the rest of the vertex is the attribute stream
+            mesh.get_vertex_positions().copy_to(reinterpret_cast<glm::vec3*>(staging_data));
+            for(auto &&vertex : mesh_vertices)
+            {
+                std::memcpy(attributes, &vertex.normal, ATTRIBUTE_STREAM_STRIDE);
+                attributes += ATTRIBUTE_STREAM_STRIDE;
+            }
+        }
+
+        std::memcpy(staging_data + vertex_data_size, mesh_indices.data(), index_data_size);
+        staging->unmap();
+
+        VkBufferCopy copy_region = {};
+        for(size_t i = 0; i < vertices.buffers.size() && vertex_data_size > 0; ++i)
+        {
+            copy_region.dstOffset = allocation.vertex_offset * vertices.element_sizes[i];
+            copy_region.size      = mesh_vertices.size() * vertices.element_sizes[i];
+            vkCmdCopyBuffer(command_buffer, *staging, *vertices.buffers[i], 1, &copy_region);
+
+            copy_region.srcOffset += copy_region.size;
+        }
+
+        if(index_data_size > 0)
+        {
+            copy_region.srcOffset = vertex_data_size;
+            copy_region.dstOffset = allocation.first_index * sizeof(MeshElementIndex);
+            copy_region.size      = index_data_size;
+            vkCmdCopyBuffer(command_buffer, *staging, *indices.buffers.front(), 1, &copy_region);
+        }
+
+        transient_buffers.push_back(staging);
+    }
+
+    Handle handle;
+    if(free_handles.empty())
+    {
+        handle = static_cast<Handle>(allocations.size());
+        allocations.push_back(allocation);
+        is_allocated.push_back(true);
+    }
+    else
+    {
+        handle = free_handles.back();
+        free_handles.pop_back();
+        allocations[handle]  = allocation;
+        is_allocated[handle] = true;
+    }
+
+    return handle;
+}
+
+void GeometryHeap::free(Handle handle)
+{
+    assert(handle < allocations.size() && is_allocated[handle]);
+
+    auto &allocation = allocations[handle];
+    vertices.allocator.free(allocation.vertex_offset, allocation.vertex_count);
+    indices.allocator.free(allocation.first_index, allocation.index_count);
+
+    is_allocated[handle] = false;
+    free_handles.push_back(handle);
+}
+
+const GeometryHeap::Allocation &GeometryHeap::get_allocation(Handle handle) const
+{
+    assert(handle < allocations.size() && is_allocated[handle]);
+    return allocations[handle];
+}
+
+bool GeometryHeap::compact(VkCommandBuffer command_buffer, size_t max_moves)
+{
+    size_t moves = compact(vertices, &Allocation::vertex_offset, &Allocation::vertex_count, command_buffer, max_moves);
+    moves += compact(indices, &Allocation::first_index, &Allocation::index_count, command_buffer, max_moves - moves);
+
+    return moves > 0;
+}
+
+bool GeometryHeap::is_fragmented() const
+{
+    return vertices.allocator.is_fragmented() || indices.allocator.is_fragmented();
+}
+
+void GeometryHeap::release_transient_buffers()
+{
+    transient_buffers.clear();
+}
+
+VertexStreamLayout GeometryHeap::get_vertex_layout() const
+{
+    return vertex_layout;
+}
+
+const std::vector<std::shared_ptr<DeviceBuffer>> &GeometryHeap::get_vertex_buffers() const
+{
+    return vertices.buffers;
+}
+
+std::shared_ptr<DeviceBuffer> GeometryHeap::get_index_buffer() const
+{
+    return indices.buffers.front();
+}
+
+std::shared_ptr<DeviceBuffer> GeometryHeap::create_arena_buffer(const Arena &arena, size_t stream, size_t capacity)
+{
+    auto buffer = std::make_shared<DeviceBuffer>();
+
+    vk_assert
+    (
+        device->create_buffer
+        (
+            arena.usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            buffer,
+            std::max<size_t>(capacity, 1) * arena.element_sizes[stream]
+        ),
+        "Can't create geometry heap arena"
+    );
+
+    return buffer;
+}
+
+size_t GeometryHeap::allocate(Arena &arena, size_t count, VkCommandBuffer command_buffer)
+{
+    if(count == 0)
+        return 0;
+
+    if(auto offset = arena.allocator.allocate(count))
+        return *offset;
+
+    // Double the arena, old contents are copied to the front of the new buffer
+    size_t old_capacity = arena.allocator.get_capacity();
+    size_t new_capacity = std::max(2 * old_capacity, old_capacity + count);
+
+    transfer_barrier(command_buffer);
+
+    for(size_t i = 0; i < arena.buffers.size(); ++i)
+    {
+        auto buffer = create_arena_buffer(arena, i, new_capacity);
+
+        VkBufferCopy copy_region = {};
+        copy_region.size = old_capacity * arena.element_sizes[i];
+        if(copy_region.size > 0)
+            vkCmdCopyBuffer(command_buffer, *arena.buffers[i], *buffer, 1, &copy_region);
+
+        transient_buffers.push_back(arena.buffers[i]);
+        arena.buffers[i] = buffer;
+    }
+
+    transfer_barrier(command_buffer);
+    arena.allocator.grow(new_capacity);
+
+    return arena.allocator.allocate(count).value();
+}
+
+size_t GeometryHeap::compact
+(
+    Arena &arena,
+    uint32_t Allocation::*offset,
+    uint32_t Allocation::*count,
+    VkCommandBuffer command_buffer,
+    size_t max_moves
+)
+{
+    size_t moves = 0;
+
+    while(moves < max_moves && arena.allocator.is_fragmented())
+    {
+        // The last allocation is moved into the first hole it fits in
+        Allocation *last = nullptr;
+        for(size_t i = 0; i < allocations.size(); ++i)
+            if(is_allocated[i] && allocations[i].*count > 0 && (last == nullptr || allocations[i].*offset > last->*offset))
+                last = &allocations[i];
+
+        if(last == nullptr || last->*offset < arena.allocator.get_first_free_offset())
+            break;
+
+        size_t new_offset = arena.allocator.allocate(last->*count).value_or(last->*offset);
+        if(new_offset + last->*count > last->*offset)
+        {
+            if(new_offset != last->*offset)
+                arena.allocator.free(new_offset, last->*count);
+
+            break;
+        }
+
+        transfer_barrier(command_buffer);
+
+        for(size_t i = 0; i < arena.buffers.size(); ++i)
+        {
+            VkBufferCopy copy_region = {};
+            copy_region.srcOffset = static_cast<VkDeviceSize>(last->*offset) * arena.element_sizes[i];
+            copy_region.dstOffset = static_cast<VkDeviceSize>(new_offset) * arena.element_sizes[i];
+            copy_region.size      = static_cast<VkDeviceSize>(last->*count) * arena.element_sizes[i];
+            vkCmdCopyBuffer(command_buffer, *arena.buffers[i], *arena.buffers[i], 1, &copy_region);
+        }
+
+        arena.allocator.free(last->*offset, last->*count);
+        last->*offset = static_cast<uint32_t>(new_offset);
+        ++moves;
+    }
+
+    return moves;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#ifndef CG_SEM5_GEOMETRYHEAP_H
+#define CG_SEM5_GEOMETRYHEAP_H
+
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "devicebuffer.h"
+#include "rangeallocator.h"
+#include "staticmesh.h"
+
+enum class VertexStreamLayout
+{
+    INTERLEAVED,    // One stream of StaticMesh::Vertex
+    SPLIT_POSITIONS // Tightly packed positions, then normal, uv and color in a second stream
+};
+
+// Device local vertex and index arenas shared by every static mesh.
+// Each mesh gets its own vertexOffset/firstIndex range, freed ranges are reused.
+// All methods record into the given command buffer, buffers they replace or stage through
+// stay alive until release_transient_buffers is called after that command buffer is executed
+class GeometryHeap
+{
+public:
+    using Handle = uint32_t;
+
+    struct Allocation
+    {
+        uint32_t vertex_offset;
+        uint32_t vertex_count;
+        uint32_t first_index;
+        uint32_t index_count;
+    };
+
+    static constexpr size_t POSITION_STREAM_STRIDE  = sizeof(glm::vec3);
+    static constexpr size_t ATTRIBUTE_STREAM_STRIDE = sizeof(StaticMesh::Vertex) - POSITION_STREAM_STRIDE;
+
+    GeometryHeap(std::shared_ptr<Device>, VertexStreamLayout, size_t vertex_capacity, size_t index_capacity);
+
+    Handle upload(const StaticMesh &, VkCommandBuffer);
+    void free(Handle);
+
+    const Allocation &get_allocation(Handle) const;
+
+    // Moves at most max_moves allocations into free ranges in front of them.
+    // Returns true if anything moved: offsets changed, so draws must be rerecorded
+    bool compact(VkCommandBuffer, size_t max_moves);
+    bool is_fragmented() const;
+
+    void release_transient_buffers();
+
+    VertexStreamLayout get_vertex_layout() const;
+
+    // One buffer per vertex stream, bound to consecutive bindings
+    const std::vector<std::shared_ptr<DeviceBuffer>> &get_vertex_buffers() const;
+    std::shared_ptr<DeviceBuffer> get_index_buffer() const;
+
+private:
+    // Streams of an arena share the element offsets
+    struct Arena
+    {
+        std::vector<std::shared_ptr<DeviceBuffer>> buffers;
+        std::vector<size_t>                        element_sizes;
+        RangeAllocator     allocator;
+        VkBufferUsageFlags usage;
+    };
+
+    std::shared_ptr<DeviceBuffer> create_arena_buffer(const Arena &, size_t stream, size_t capacity);
+    size_t allocate(Arena &, size_t count, VkCommandBuffer);
+    size_t compact(Arena &, uint32_t Allocation::*offset, uint32_t Allocation::*count, VkCommandBuffer, size_t max_moves);
+
+    std::shared_ptr<Device> device;
+    VertexStreamLayout      vertex_layout;
+
+    Arena vertices;
+    Arena indices;
+
+    std::vector<Allocation> allocations;
+    std::vector<bool>       is_allocated;
+    std::vector<Handle>     free_handles;
+
+    std::vector<std::shared_ptr<DeviceBuffer>> transient_buffers;
+};
+
+#endif // CG_SEM5_GEOMETRYHEAP_H
\ No newline at end of file
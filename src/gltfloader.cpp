@@ -0,0 +1,533 @@
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_set>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtx/transform.hpp>
+
+#include "gltfloader.h"
+#include "json.h"
+
+static constexpr uint32_t GLB_MAGIC      = 0x46546c67; // glTF
+static constexpr uint32_t GLB_VERSION    = 2;
+static constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a;
+static constexpr uint32_t GLB_CHUNK_BIN  = 0x004e4942;
+
+static constexpr uint32_t GLTF_BYTE           = 5120;
+static constexpr uint32_t GLTF_UNSIGNED_BYTE  = 5121;
+static constexpr uint32_t GLTF_SHORT          = 5122;
+static constexpr uint32_t GLTF_UNSIGNED_SHORT = 5123;
+static constexpr uint32_t GLTF_UNSIGNED_INT   = 5125;
+static constexpr uint32_t GLTF_FLOAT          = 5126;
+
+static constexpr size_t GLTF_TRIANGLES = 4;
+static constexpr size_t NO_ELEMENT     = std::numeric_limits<size_t>::max();
+
+struct GltfAccessor
+{
+    const std::byte *data = nullptr; // First element
+    size_t   count  = 0;
+    size_t   stride = 0;
+    size_t   view   = NO_ELEMENT;
+
+    uint32_t component_type  = GLTF_FLOAT;
+    uint32_t component_count = 0;
+    bool     normalized      = false;
+};
+
+struct GltfDocument
+{
+    JsonValue        json;
+    const std::byte *bin      = nullptr;
+    size_t           bin_size = 0;
+};
+
+struct GltfPrimitiveInstance
+{
+    const JsonValue *primitive;
+    glm::mat4        transform;
+};
+
+static size_t component_size(uint32_t component_type)
+{
+    switch(component_type)
+    {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+
+    default:
+        throw std::runtime_error("Unsupported glTF accessor component type");
+    }
+}
+
+static uint32_t type_component_count(const std::string &type)
+{
+    if(type == "SCALAR")
+        return 1;
+
+    if(type.size() == 4 && type.compare(0, 3, "VEC") == 0 && type[3] >= '2' && type[3] <= '4')
+        return type[3] - '0';
+
+    throw std::runtime_error("Unsupported glTF accessor type \"" + type + "\"");
+}
+
+template <typename T>
+static T read_unaligned(const std::byte *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+
+    return value;
+}
+
+static float read_component(const std::byte *data, uint32_t component_type, bool normalized)
+{
+    switch(component_type)
+    {
+    case GLTF_BYTE:
+    {
+        float value = read_unaligned<int8_t>(data);
+        return normalized? std::max(value / 127.f, -1.f) : value;
+    }
+    case GLTF_UNSIGNED_BYTE:
+    {
+        float value = read_unaligned<uint8_t>(data);
+        return normalized? value / 255.f : value;
+    }
+    case GLTF_SHORT:
+    {
+        float value = read_unaligned<int16_t>(data);
+        return normalized? std::max(value / 32767.f, -1.f) : value;
+    }
+    case GLTF_UNSIGNED_SHORT:
+    {
+        float value = read_unaligned<uint16_t>(data);
+        return normalized? value / 65535.f : value;
+    }
+    case GLTF_UNSIGNED_INT:
+        return static_cast<float>(read_unaligned<uint32_t>(data));
+
+    default:
+        return read_unaligned<float>(data);
+    }
+}
+
+// Missing components are left as they are
+static void read_floats(const GltfAccessor &accessor, size_t index, float *values, uint32_t value_count)
+{
+    const std::byte *element = accessor.data + index * accessor.stride;
+    size_t size = component_size(accessor.component_type);
+
+    for(uint32_t i = 0, count = std::min(value_count, accessor.component_count); i < count; ++i)
+        values[i] = read_component(element + i * size, accessor.component_type, accessor.normalized);
+}
+
+static GltfAccessor get_accessor(const GltfDocument &document, size_t index)
+{
+    const auto &accessor = document.json["accessors"][index];
+    if(accessor.is_null() || accessor.has("sparse") || !accessor.has("bufferView"))
+        throw std::runtime_error("Unsupported glTF accessor");
+
+    GltfAccessor result;
+    result.view            = accessor["bufferView"].as_index(0);
+    result.count           = accessor["count"].as_index(0);
+    result.component_type  = static_cast<uint32_t>(accessor["componentType"].as_index(GLTF_FLOAT));
+    result.component_count = type_component_count(accessor["type"].as_string());
+    result.normalized      = accessor["normalized"].as_bool();
+
+    const auto &view = document.json["bufferViews"][result.view];
+    if(view.is_null() || view["buffer"].as_index(0) != 0 || document.bin == nullptr)
+        throw std::runtime_error("glTF accessor doesn't reference the binary chunk");
+
+    size_t element_size = component_size(result.component_type) * result.component_count;
+    size_t view_offset  = view["byteOffset"].as_index(0);
+    size_t view_length  = view["byteLength"].as_index(0);
+    size_t offset       = accessor["byteOffset"].as_index(0);
+
+    result.stride = view["byteStride"].as_index(element_size);
+    result.data   = document.bin + view_offset + offset;
+
+    if
+    (
+        view_offset + view_length > document.bin_size ||
+        (result.count > 0 && offset + (result.count - 1) * result.stride + element_size > view_length)
+    )
+        throw std::runtime_error("glTF accessor is out of buffer bounds");
+
+    return result;
+}
+
+static bool has_vertex_layout
+(
+    const GltfAccessor &positions,
+    const GltfAccessor &normals,
+    const GltfAccessor &uvs,
+    const GltfAccessor &colors
+)
+{
+    auto matches = [&positions](const GltfAccessor &accessor, uint32_t component_count, size_t offset)
+    {
+        return accessor.view == positions.view &&
+               accessor.count == positions.count &&
+               accessor.stride == sizeof(StaticMesh::Vertex) &&
+               accessor.component_type == GLTF_FLOAT &&
+               accessor.component_count == component_count &&
+               accessor.data == positions.data + offset;
+    };
+
+    return matches(positions, 3, offsetof(StaticMesh::Vertex, position)) &&
+           matches(normals, 3, offsetof(StaticMesh::Vertex, normal)) &&
+           matches(uvs, 2, offsetof(StaticMesh::Vertex, uv)) &&
+           matches(colors, 3, offsetof(StaticMesh::Vertex, color));
+}
+
+static glm::mat4 get_node_transform(const JsonValue &node)
+{
+    const auto &matrix = node["matrix"];
+    if(matrix.size() == 16)
+    {
+        glm::mat4 transform;
+        for(size_t i = 0; i < 16; ++i)
+            glm::value_ptr(transform)[i] = static_cast<float>(matrix[i].as_number());
+
+        return transform;
+    }
+
+    const auto &translation = node["translation"];
+    const auto &rotation    = node["rotation"];
+    const auto &scale       = node["scale"];
+
+    glm::vec3 t(translation[0].as_number(), translation[1].as_number(), translation[2].as_number());
+    glm::quat r(rotation[3].as_number(1.0), rotation[0].as_number(), rotation[1].as_number(), rotation[2].as_number());
+    glm::vec3 s(scale[0].as_number(1.0), scale[1].as_number(1.0), scale[2].as_number(1.0));
+
+    return glm::translate(t) * glm::mat4_cast(r) * glm::scale(s);
+}
+
+static void collect_primitives
+(
+    const GltfDocument &document,
+    size_t node_index,
+    const glm::mat4 &parent_transform,
+    size_t depth,
+    std::vector<std::vector<GltfPrimitiveInstance>> &instances
+)
+{
+    const auto &nodes = document.json["nodes"];
+    const auto &node  = nodes[node_index];
+
+    if(node.is_null() || depth > nodes.size())
+        throw std::runtime_error("Malformed glTF node hierarchy");
+
+    glm::mat4 transform = parent_transform * get_node_transform(node);
+
+    if(node.has("mesh"))
+    {
+        const auto &primitives = document.json["meshes"][node["mesh"].as_index(0)]["primitives"];
+        for(size_t i = 0; i < primitives.size(); ++i)
+        {
+            const auto &primitive = primitives[i];
+            size_t material = primitive["material"].as_index(instances.size() - 1); // Last slot is the default material
+
+            if(material < instances.size())
+                instances[material].push_back({ &primitive, transform });
+        }
+    }
+
+    const auto &children = node["children"];
+    for(size_t i = 0; i < children.size(); ++i)
+        collect_primitives(document, children[i].as_index(NO_ELEMENT), transform, depth + 1, instances);
+}
+
+static void append_primitive
+(
+    const GltfDocument &document,
+    const GltfPrimitiveInstance &instance,
+    std::vector<StaticMesh::Vertex> &vertices,
+    std::vector<MeshElementIndex> &indices
+)
+{
+    const auto &primitive  = *instance.primitive;
+    const auto &attributes = primitive["attributes"];
+
+    // Strips, fans, lines and points aren't drawn by the mesh pipeline
+    if(primitive["mode"].as_index(GLTF_TRIANGLES) != GLTF_TRIANGLES || !attributes.has("POSITION"))
+        return;
+
+    auto optional_accessor = [&document, &attributes](const char *name)
+    {
+        return attributes.has(name)? get_accessor(document, attributes[name].as_index(0)) : GltfAccessor();
+    };
+
+    auto positions = get_accessor(document, attributes["POSITION"].as_index(0));
+    auto normals   = optional_accessor("NORMAL");
+    auto uvs       = optional_accessor("TEXCOORD_0");
+    auto colors    = optional_accessor("COLOR_0");
+
+    size_t vertex_count = positions.count;
+    size_t vertex_base  = vertices.size();
+    size_t index_base   = indices.size();
+
+    vertices.resize(vertex_base + vertex_count);
+    StaticMesh::Vertex *vertex = vertices.data() + vertex_base;
+
+    bool is_identity = instance.transform == glm::mat4(1.f);
+
+    // Normals get their y flipped like in the generic importer path
+    if(is_identity && has_vertex_layout(positions, normals, uvs, colors))
+    {
+        std::memcpy(vertex, positions.data, vertex_count * sizeof(StaticMesh::Vertex));
+        for(size_t i = 0; i < vertex_count; ++i)
+            vertex[i].normal.y *= -1;
+    }
+    else
+    {
+        glm::mat3 normal_transform = glm::mat3(instance.transform);
+
+        for(size_t i = 0; i < vertex_count; ++i, ++vertex)
+        {
+            vertex->position = glm::vec3(0.f);
+            vertex->normal   = glm::vec3(0.f);
+            vertex->uv       = glm::vec2(0.f);
+            vertex->color    = glm::vec3(1.f);
+
+            read_floats(positions, i, &vertex->position.x, 3);
+            if(normals.count == vertex_count)
+                read_floats(normals, i, &vertex->normal.x, 3);
+            if(uvs.count == vertex_count)
+                read_floats(uvs, i, &vertex->uv.x, 2);
+            if(colors.count == vertex_count)
+                read_floats(colors, i, &vertex->color.x, 3);
+
+            if(!is_identity)
+            {
+                vertex->position = glm::vec3(instance.transform * glm::vec4(vertex->position, 1.f));
+                if(vertex->normal != glm::vec3(0.f))
+                    vertex->normal = glm::normalize(normal_transform * vertex->normal);
+            }
+
+            vertex->normal.y *= -1;
+        }
+    }
+
+    if(primitive.has("indices"))
+    {
+        auto accessor = get_accessor(document, primitive["indices"].as_index(0));
+        size_t index_count = accessor.count - accessor.count % 3;
+        indices.resize(index_base + index_count);
+        MeshElementIndex *index = indices.data() + index_base;
+
+        if(accessor.component_type == GLTF_UNSIGNED_INT && accessor.stride == sizeof(uint32_t))
+            std::memcpy(index, accessor.data, index_count * sizeof(uint32_t));
+        else if(accessor.component_type == GLTF_UNSIGNED_SHORT || accessor.component_type == GLTF_UNSIGNED_BYTE || accessor.component_type == GLTF_UNSIGNED_INT)
+            for(size_t i = 0; i < index_count; ++i)
+                index[i] = static_cast<MeshElementIndex>(read_component(accessor.data + i * accessor.stride, accessor.component_type, false));
+        else
+            throw std::runtime_error("Unsupported glTF index type");
+
+        MeshElementIndex max_index = 0;
+        for(size_t i = 0; i < index_count; ++i)
+            max_index = std::max(max_index, index[i]);
+
+        if(index_count > 0 && max_index >= vertex_count)
+            throw std::runtime_error("glTF index is out of vertex range");
+
+        if(vertex_base != 0)
+            for(size_t i = 0; i < index_count; ++i)
+                index[i] += static_cast<MeshElementIndex>(vertex_base);
+    }
+    else
+        for(size_t i = 0, index_count = vertex_count - vertex_count % 3; i < index_count; ++i)
+            indices.push_back(static_cast<MeshElementIndex>(vertex_base + i));
+
+    // Mirroring transforms flip the winding
+    if(glm::determinant(glm::mat3(instance.transform)) < 0.f)
+        for(size_t i = index_base; i + 2 < indices.size(); i += 3)
+            std::swap(indices[i + 1], indices[i + 2]);
+
+    // Flat normals need a vertex per corner
+    if(normals.count != vertex_count)
+    {
+        std::vector<StaticMesh::Vertex> corners;
+        corners.reserve(indices.size() - index_base);
+
+        for(size_t i = index_base; i < indices.size(); i += 3)
+        {
+            const auto &a = vertices[indices[i]];
+            const auto &b = vertices[indices[i + 1]];
+            const auto &c = vertices[indices[i + 2]];
+
+            glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+            normal = glm::length(normal) > 0.f? glm::normalize(normal) : glm::vec3(0.f);
+            normal.y *= -1;
+
+            for(auto corner : { a, b, c })
+            {
+                corner.normal = normal;
+                corners.push_back(corner);
+            }
+        }
+
+        vertices.resize(vertex_base);
+        vertices.insert(vertices.end(), corners.begin(), corners.end());
+
+        for(size_t i = index_base; i < indices.size(); ++i)
+            indices[i] = static_cast<MeshElementIndex>(vertex_base + i - index_base);
+    }
+}
+
+bool GltfLoader::can_load(std::string_view path, int import_flags)
+{
+    static constexpr std::string_view EXTENSION = ".glb";
+
+    if((import_flags & ~StaticMesh::DEFAULT_IMPORT_FLAGS) != 0 || path.size() < EXTENSION.size())
+        return false;
+
+    auto extension = path.substr(path.size() - EXTENSION.size());
+    return std::equal
+    (
+        extension.begin(), extension.end(), EXTENSION.begin(),
+        [](char lhs, char rhs) { return std::tolower(static_cast<unsigned char>(lhs)) == rhs; }
+    );
+}
+
+GltfLoader::Mesh GltfLoader::load(std::string_view path)
+{
+    using namespace std::string_literals;
+
+    Mesh mesh;
+    auto file = std::make_shared<MappedFile>(path);
+    mesh.file = file;
+
+    const auto *data = reinterpret_cast<const std::byte*>(file->get_data());
+    size_t size = file->get_size();
+
+    if
+    (
+        size < 20 ||
+        read_unaligned<uint32_t>(data) != GLB_MAGIC ||
+        read_unaligned<uint32_t>(data + 4) != GLB_VERSION ||
+        read_unaligned<uint32_t>(data + 16) != GLB_CHUNK_JSON
+    )
+        throw std::runtime_error("Can't load mesh from file \""s + path.data() + "\"");
+
+    GltfDocument document;
+    size_t json_size = read_unaligned<uint32_t>(data + 12);
+    if(20 + json_size > size)
+        throw std::runtime_error("Can't load mesh from file \""s + path.data() + "\"");
+
+    document.json = JsonValue::parse(std::string_view(reinterpret_cast<const char*>(data + 20), json_size));
+
+    size_t bin_offset = 20 + json_size;
+    if(bin_offset + 8 <= size && read_unaligned<uint32_t>(data + bin_offset + 4) == GLB_CHUNK_BIN)
+    {
+        document.bin      = data + bin_offset + 8;
+        document.bin_size = std::min<size_t>(read_unaligned<uint32_t>(data + bin_offset), size - bin_offset - 8);
+    }
+
+    const auto &json = document.json;
+
+    const auto &images = json["images"];
+    mesh.images.resize(images.size());
+    for(size_t i = 0; i < images.size(); ++i)
+    {
+        mesh.images[i].uri       = images[i]["uri"].as_string();
+        mesh.images[i].mime_type = images[i]["mimeType"].as_string();
+
+        if(images[i].has("bufferView") && document.bin != nullptr)
+        {
+            const auto &view = json["bufferViews"][images[i]["bufferView"].as_index(0)];
+            size_t offset = view["byteOffset"].as_index(0);
+            size_t length = view["byteLength"].as_index(0);
+
+            if(offset + length > document.bin_size)
+                throw std::runtime_error("Can't load mesh from file \""s + path.data() + "\"");
+
+            mesh.images[i].data = document.bin + offset;
+            mesh.images[i].size = length;
+        }
+    }
+
+    const auto &materials = json["materials"];
+    mesh.materials.resize(materials.size() + 1);
+    for(size_t i = 0; i < materials.size(); ++i)
+    {
+        const auto &pbr = materials[i]["pbrMetallicRoughness"];
+        const auto &base_color = pbr["baseColorFactor"];
+
+        auto &material = mesh.materials[i];
+        material.name = materials[i]["name"].as_string();
+        for(glm::length_t c = 0; c < 4; ++c)
+            material.base_color[c] = static_cast<float>(base_color[c].as_number(1.0));
+
+        if(pbr.has("baseColorTexture"))
+        {
+            const auto &texture = json["textures"][pbr["baseColorTexture"]["index"].as_index(NO_ELEMENT)];
+            const auto &basisu  = texture["extensions"]["KHR_texture_basisu"];
+            material.image = (basisu.has("source")? basisu : texture)["source"].as_index(NO_IMAGE);
+            if(material.image >= mesh.images.size())
+                material.image = NO_IMAGE;
+        }
+    }
+    mesh.materials.back().name = "DefaultMaterial";
+
+    // Primitives bucketed by material, so every material is one contiguous group
+    std::vector<std::vector<GltfPrimitiveInstance>> instances(mesh.materials.size());
+
+    const auto &nodes  = json["nodes"];
+    const auto &scenes = json["scenes"];
+    if(scenes.size() > 0)
+    {
+        const auto &roots = scenes[json["scene"].as_index(0)]["nodes"];
+        for(size_t i = 0; i < roots.size(); ++i)
+            collect_primitives(document, roots[i].as_index(NO_ELEMENT), glm::mat4(1.f), 0, instances);
+    }
+    else
+    {
+        std::unordered_set<size_t> children;
+        for(size_t i = 0; i < nodes.size(); ++i)
+            for(size_t j = 0; j < nodes[i]["children"].size(); ++j)
+                children.insert(nodes[i]["children"][j].as_index(NO_ELEMENT));
+
+        for(size_t i = 0; i < nodes.size(); ++i)
+            if(children.count(i) == 0)
+                collect_primitives(document, i, glm::mat4(1.f), 0, instances);
+    }
+
+    for(size_t i = 0; i < instances.size(); ++i)
+    {
+        size_t index_base = mesh.indices.size();
+        for(auto &&instance : instances[i])
+            append_primitive(document, instance, mesh.vertices, mesh.indices);
+
+        if(mesh.indices.size() > index_base)
+        {
+            mesh.groups.push_back
+            ({
+                i,
+                static_cast<MeshElementIndex>(index_base),
+                static_cast<MeshElementIndex>(mesh.indices.size() - index_base)
+            });
+        }
+    }
+
+    if(mesh.vertices.empty())
+        throw std::runtime_error("Can't load mesh from file \""s + path.data() + "\"");
+
+    return mesh;
+}
\ No newline at end of file
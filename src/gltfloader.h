@@ -0,0 +1,66 @@
+#ifndef CG_SEM5_GLTFLOADER_H
+#define CG_SEM5_GLTFLOADER_H
+
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/vec4.hpp>
+
+#include "staticmesh.h"
+#include "mappedfile.h"
+
+// Binary glTF 2.0 (.glb) reader. The file is memory mapped and accessors are read in place:
+// a primitive whose attributes are interleaved exactly like StaticMesh::Vertex is copied with one memcpy
+// and 32-bit indices are copied as a block. Embedded images keep pointing into the mapped file.
+// Output matches the importer with StaticMesh::DEFAULT_IMPORT_FLAGS: node transforms are applied,
+// missing normals are flat and triangles are grouped by material
+class GltfLoader
+{
+public:
+    static constexpr size_t NO_IMAGE = std::numeric_limits<size_t>::max();
+
+    struct Image
+    {
+        std::string uri;       // External image relative to the file, empty if embedded
+        std::string mime_type;
+        const void *data = nullptr; // Embedded image inside the mapped file
+        size_t      size = 0;
+    };
+
+    struct Material
+    {
+        std::string name;
+        glm::vec4   base_color = glm::vec4(1.f);
+        size_t      image      = NO_IMAGE;
+    };
+
+    // Triangles of one material, contiguous in indices
+    struct Group
+    {
+        size_t           material;
+        MeshElementIndex index_base;
+        MeshElementIndex index_count;
+    };
+
+    struct Mesh
+    {
+        std::shared_ptr<const MappedFile> file; // Owns embedded image data
+
+        std::vector<Material>           materials;
+        std::vector<Image>              images;
+        std::vector<Group>              groups;
+        std::vector<StaticMesh::Vertex> vertices;
+        std::vector<MeshElementIndex>   indices;
+    };
+
+    // GLB files whose import flags ask for nothing beyond the defaults
+    static bool can_load(std::string_view path, int import_flags);
+
+    static Mesh load(std::string_view path);
+};
+
+#endif // CG_SEM5_GLTFLOADER_H
\ No newline at end of file
@@ -0,0 +1,348 @@
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+#include "json.h"
+
+static const JsonValue null_json_value;
+
+class JsonParser
+{
+public:
+    JsonParser(std::string_view text)
+    : cursor(text.data()),
+    end(text.data() + text.size())
+    {}
+
+    JsonValue parse_document()
+    {
+        JsonValue value = parse_value(0);
+
+        skip_spaces();
+        if(cursor != end)
+            fail("Unexpected data after JSON value");
+
+        return value;
+    }
+
+private:
+    static constexpr size_t MAX_DEPTH = 256;
+
+    [[noreturn]] void fail(const char *message) const
+    {
+        throw std::runtime_error(message);
+    }
+
+    void skip_spaces()
+    {
+        while(cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r'))
+            ++cursor;
+    }
+
+    void expect(char c)
+    {
+        skip_spaces();
+        if(cursor == end || *cursor != c)
+            fail("Malformed JSON");
+
+        ++cursor;
+    }
+
+    bool consume(std::string_view word)
+    {
+        if(static_cast<size_t>(end - cursor) < word.size() || std::string_view(cursor, word.size()) != word)
+            return false;
+
+        cursor += word.size();
+        return true;
+    }
+
+    JsonValue parse_value(size_t depth)
+    {
+        if(depth > MAX_DEPTH)
+            fail("JSON nesting is too deep");
+
+        skip_spaces();
+        if(cursor == end)
+            fail("Unexpected end of JSON");
+
+        JsonValue value;
+        switch(*cursor)
+        {
+        case '{':
+            value.type = JsonValue::Type::OBJECT;
+            parse_object(value, depth);
+            break;
+
+        case '[':
+            value.type = JsonValue::Type::ARRAY;
+            parse_array(value, depth);
+            break;
+
+        case '"':
+            value.type   = JsonValue::Type::STRING;
+            value.string = parse_string();
+            break;
+
+        case 't':
+        case 'f':
+            value.type = JsonValue::Type::BOOLEAN;
+            value.boolean = consume("true");
+            if(!value.boolean && !consume("false"))
+                fail("Malformed JSON literal");
+            break;
+
+        case 'n':
+            if(!consume("null"))
+                fail("Malformed JSON literal");
+            break;
+
+        default:
+            value.type   = JsonValue::Type::NUMBER;
+            value.number = parse_number();
+        }
+
+        return value;
+    }
+
+    void parse_object(JsonValue &object, size_t depth)
+    {
+        expect('{');
+        skip_spaces();
+        if(cursor < end && *cursor == '}')
+        {
+            ++cursor;
+            return;
+        }
+
+        do
+        {
+            skip_spaces();
+            if(cursor == end || *cursor != '"')
+                fail("Malformed JSON object key");
+
+            object.member_names.push_back(parse_string());
+            expect(':');
+            object.elements.push_back(parse_value(depth + 1));
+            skip_spaces();
+        }
+        while(cursor < end && *cursor++ == ',');
+
+        if(cursor[-1] != '}')
+            fail("Malformed JSON object");
+    }
+
+    void parse_array(JsonValue &array, size_t depth)
+    {
+        expect('[');
+        skip_spaces();
+        if(cursor < end && *cursor == ']')
+        {
+            ++cursor;
+            return;
+        }
+
+        do
+        {
+            array.elements.push_back(parse_value(depth + 1));
+            skip_spaces();
+        }
+        while(cursor < end && *cursor++ == ',');
+
+        if(cursor[-1] != ']')
+            fail("Malformed JSON array");
+    }
+
+    double parse_number()
+    {
+        // strtod needs a terminated string, numbers are short
+        const char *begin = cursor;
+        while(cursor < end && (std::isdigit(static_cast<unsigned char>(*cursor)) || *cursor == '-' || *cursor == '+' || *cursor == '.' || *cursor == 'e' || *cursor == 'E'))
+            ++cursor;
+
+        std::string number(begin, cursor);
+        char *number_end = nullptr;
+        double value = std::strtod(number.c_str(), &number_end);
+
+        if(number.empty() || number_end != number.c_str() + number.size())
+            fail("Malformed JSON number");
+
+        return value;
+    }
+
+    uint32_t parse_hex4()
+    {
+        if(end - cursor < 4)
+            fail("Malformed JSON escape");
+
+        uint32_t code = 0;
+        for(int i = 0; i < 4; ++i, ++cursor)
+        {
+            char c = *cursor;
+            code <<= 4;
+            if(c >= '0' && c <= '9')
+                code |= c - '0';
+            else if(c >= 'a' && c <= 'f')
+                code |= c - 'a' + 10;
+            else if(c >= 'A' && c <= 'F')
+                code |= c - 'A' + 10;
+            else
+                fail("Malformed JSON escape");
+        }
+
+        return code;
+    }
+
+    void append_utf8(std::string &string, uint32_t code)
+    {
+        if(code < 0x80)
+            string += static_cast<char>(code);
+        else if(code < 0x800)
+        {
+            string += static_cast<char>(0xc0 | (code >> 6));
+            string += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else if(code < 0x10000)
+        {
+            string += static_cast<char>(0xe0 | (code >> 12));
+            string += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            string += static_cast<char>(0x80 | (code & 0x3f));
+        }
+        else
+        {
+            string += static_cast<char>(0xf0 | (code >> 18));
+            string += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+            string += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            string += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    std::string parse_string()
+    {
+        ++cursor; // "
+
+        std::string string;
+        while(cursor < end && *cursor != '"')
+        {
+            if(*cursor != '\\')
+            {
+                string += *cursor++;
+                continue;
+            }
+
+            if(++cursor == end)
+                break;
+
+            char escape = *cursor++;
+            switch(escape)
+            {
+            case '"':  string += '"';  break;
+            case '\\': string += '\\'; break;
+            case '/':  string += '/';  break;
+            case 'b':  string += '\b'; break;
+            case 'f':  string += '\f'; break;
+            case 'n':  string += '\n'; break;
+            case 'r':  string += '\r'; break;
+            case 't':  string += '\t'; break;
+            case 'u':
+            {
+                uint32_t code = parse_hex4();
+
+                // Surrogate pair
+                if(code >= 0xd800 && code < 0xdc00 && consume("\\u"))
+                    code = 0x10000 + ((code - 0xd800) << 10) + (parse_hex4() - 0xdc00);
+
+                append_utf8(string, code);
+                break;
+            }
+            default:
+                fail("Malformed JSON escape");
+            }
+        }
+
+        if(cursor == end)
+            fail("Unterminated JSON string");
+
+        ++cursor; // "
+        return string;
+    }
+
+    const char *cursor;
+    const char *end;
+};
+
+JsonValue::JsonValue()
+: type(Type::NUL),
+boolean(false),
+number(0.0),
+string(),
+elements(),
+member_names()
+{}
+
+JsonValue JsonValue::parse(std::string_view text)
+{
+    return JsonParser(text).parse_document();
+}
+
+JsonValue::Type JsonValue::get_type() const
+{
+    return type;
+}
+
+bool JsonValue::is_null() const
+{
+    return type == Type::NUL;
+}
+
+bool JsonValue::has(std::string_view key) const
+{
+    return !(*this)[key].is_null();
+}
+
+const JsonValue &JsonValue::operator[](std::string_view key) const
+{
+    if(type != Type::OBJECT)
+        return null_json_value;
+
+    for(size_t i = 0; i < member_names.size(); ++i)
+        if(member_names[i] == key)
+            return elements[i];
+
+    return null_json_value;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const
+{
+    if(type != Type::ARRAY || index >= elements.size())
+        return null_json_value;
+
+    return elements[index];
+}
+
+size_t JsonValue::size() const
+{
+    return elements.size();
+}
+
+bool JsonValue::as_bool(bool fallback) const
+{
+    return type == Type::BOOLEAN? boolean : fallback;
+}
+
+double JsonValue::as_number(double fallback) const
+{
+    return type == Type::NUMBER? number : fallback;
+}
+
+size_t JsonValue::as_index(size_t fallback) const
+{
+    return type == Type::NUMBER && number >= 0.0? static_cast<size_t>(number) : fallback;
+}
+
+const std::string &JsonValue::as_string() const
+{
+    static const std::string empty;
+    return type == Type::STRING? string : empty;
+}
\ No newline at end of file
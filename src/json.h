@@ -0,0 +1,55 @@
+#ifndef CG_SEM5_JSON_H
+#define CG_SEM5_JSON_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only JSON document, enough for asset manifests like glTF.
+// Lookups of missing members or elements give a null value instead of throwing
+class JsonValue
+{
+public:
+    enum class Type
+    {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    JsonValue();
+
+    // Throws std::runtime_error on malformed input
+    static JsonValue parse(std::string_view text);
+
+    Type get_type() const;
+    bool is_null() const;
+    bool has(std::string_view key) const;
+
+    const JsonValue &operator[](std::string_view key) const;
+    const JsonValue &operator[](size_t index) const;
+
+    // Elements of an array or members of an object
+    size_t size() const;
+
+    bool as_bool(bool fallback = false) const;
+    double as_number(double fallback = 0.0) const;
+    size_t as_index(size_t fallback) const;
+    const std::string &as_string() const; // Empty for other types
+
+private:
+    friend class JsonParser;
+
+    Type        type;
+    bool        boolean;
+    double      number;
+    std::string string;
+
+    std::vector<JsonValue>   elements;     // Array elements or object member values
+    std::vector<std::string> member_names; // Parallel to elements for objects
+};
+
+#endif // CG_SEM5_JSON_H
\ No newline at end of file
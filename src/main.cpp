@@ -54,14 +54,11 @@ catch(const std::exception &e)
 
 void setup_scene(Renderer &renderer, SceneGraph &scene)
 {
-    auto mesh = StaticMesh::load_from_file
+    auto mesh = renderer.get_asset_loader().load_static_mesh
     (
         "cat", 
-        "resources/obj/cat/cat.obj", 
-        renderer.get_device(),
-        renderer.get_command_pool(),
-        renderer.get_queue()
+        "resources/obj/cat/cat.obj"
     );
 
-    scene.add_node(mesh);
+    renderer.add_static_mesh(scene, mesh);
 }
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include <stdexcept>
+#include <string>
+
+#include "mappedfile.h"
+
+#ifdef CG_SEM5_MAPPEDFILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+MappedFile::MappedFile(std::string_view path)
+: data(nullptr),
+size(0)
+{
+    using namespace std::string_literals;
+
+#ifdef CG_SEM5_MAPPEDFILE_MMAP
+    int file = open(std::string(path).c_str(), O_RDONLY);
+    if(file < 0)
+        throw std::runtime_error("Can't open file \""s + path.data() + "\"");
+
+    struct stat file_stat;
+    if(fstat(file, &file_stat) != 0)
+    {
+        close(file);
+        throw std::runtime_error("Can't get size of file \""s + path.data() + "\"");
+    }
+
+    size = static_cast<size_t>(file_stat.st_size);
+
+    // Zero length mappings are invalid, an empty file is just empty
+    if(size > 0)
+    {
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+        if(mapping == MAP_FAILED)
+        {
+            close(file);
+            throw std::runtime_error("Can't map file \""s + path.data() + "\"");
+        }
+
+        // Parsers read front to back
+        madvise(mapping, size, MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+    }
+
+    // The mapping holds its own reference to the file
+    close(file);
+#else
+    std::ifstream file(std::string(path), std::ios::binary | std::ios::ate);
+    if(!file)
+        throw std::runtime_error("Can't open file \""s + path.data() + "\"");
+
+    size = static_cast<size_t>(file.tellg());
+    buffer.resize(size);
+
+    file.seekg(0);
+    file.read(buffer.data(), size);
+    data = buffer.data();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef CG_SEM5_MAPPEDFILE_MMAP
+    if(data != nullptr)
+        munmap(const_cast<char*>(data), size);
+#endif
+}
+
+const char *MappedFile::get_data() const
+{
+    return data;
+}
+
+size_t MappedFile::get_size() const
+{
+    return size;
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#ifndef CG_SEM5_MAPPEDFILE_H
+#define CG_SEM5_MAPPEDFILE_H
+
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CG_SEM5_MAPPEDFILE_MMAP
+#endif
+
+// Read-only contents of a whole file, memory mapped where the platform allows and read otherwise
+class MappedFile
+{
+public:
+    MappedFile(std::string_view path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *get_data() const;
+    size_t get_size() const;
+
+private:
+    const char *data;
+    size_t      size;
+
+#ifndef CG_SEM5_MAPPEDFILE_MMAP
+    std::vector<char> buffer;
+#endif
+};
+
+#endif // CG_SEM5_MAPPEDFILE_H
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <unordered_map>
+
+#include "meshletbuilder.h"
+
+MeshletBuilder::MeshletBuilder(const std::vector<StaticMesh::Vertex> &vertices)
+: vertices(vertices)
+{}
+
+std::vector<StaticMesh::Meshlet> MeshletBuilder::build
+(
+    std::vector<MeshElementIndex> &indices,
+    MeshElementIndex index_base,
+    MeshElementIndex index_count
+) const
+{
+    static constexpr MeshElementIndex FACE_ELEMENT_COUNT = 3;
+    static constexpr MeshElementIndex NO_MESHLET = ~MeshElementIndex(0);
+
+    std::vector<StaticMesh::Meshlet> meshlets;
+
+    const MeshElementIndex *source = indices.data() + index_base;
+    const MeshElementIndex triangle_count = index_count / FACE_ELEMENT_COUNT;
+
+    // Part local vertex numbering keeps the adjacency arrays proportional to the part size
+    std::unordered_map<MeshElementIndex, MeshElementIndex> local_vertices;
+    std::vector<MeshElementIndex> local_indices(index_count);
+    for(MeshElementIndex i = 0; i < index_count; ++i)
+        local_indices[i] = local_vertices.emplace(source[i], static_cast<MeshElementIndex>(local_vertices.size())).first->second;
+
+    const size_t vertex_count = local_vertices.size();
+
+    std::vector<MeshElementIndex> triangle_offsets(vertex_count + 1, 0);
+    for(MeshElementIndex index : local_indices)
+        ++triangle_offsets[index + 1];
+
+    for(size_t i = 0; i < vertex_count; ++i)
+        triangle_offsets[i + 1] += triangle_offsets[i];
+
+    std::vector<MeshElementIndex> triangle_list(index_count);
+    {
+        std::vector<MeshElementIndex> fill(triangle_offsets.begin(), triangle_offsets.end() - 1);
+        for(MeshElementIndex i = 0; i < index_count; ++i)
+            triangle_list[fill[local_indices[i]]++] = i / FACE_ELEMENT_COUNT;
+    }
+
+    std::vector<bool>             emitted(triangle_count, false);
+    std::vector<MeshElementIndex> vertex_meshlet(vertex_count, NO_MESHLET);
+    std::vector<MeshElementIndex> reordered;
+    std::vector<MeshElementIndex> meshlet_vertices;
+    reordered.reserve(index_count);
+    meshlet_vertices.reserve(MAX_VERTICES);
+
+    auto new_vertex_count = [&](MeshElementIndex triangle, MeshElementIndex meshlet)
+    {
+        size_t count = 0;
+        for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+            count += vertex_meshlet[local_indices[triangle * FACE_ELEMENT_COUNT + j]] != meshlet;
+
+        return count;
+    };
+
+    MeshElementIndex next_seed = 0;
+    MeshElementIndex meshlet   = 0;
+
+    while(true)
+    {
+        while(next_seed < triangle_count && emitted[next_seed])
+            ++next_seed;
+
+        if(next_seed == triangle_count)
+            break;
+
+        MeshElementIndex meshlet_base = static_cast<MeshElementIndex>(reordered.size());
+        MeshElementIndex triangle     = next_seed;
+        meshlet_vertices.clear();
+
+        for(size_t meshlet_triangles = 0; meshlet_triangles < MAX_TRIANGLES; ++meshlet_triangles)
+        {
+            emitted[triangle] = true;
+            for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+            {
+                MeshElementIndex local = local_indices[triangle * FACE_ELEMENT_COUNT + j];
+                reordered.push_back(source[triangle * FACE_ELEMENT_COUNT + j]);
+
+                if(vertex_meshlet[local] != meshlet)
+                {
+                    vertex_meshlet[local] = meshlet;
+                    meshlet_vertices.push_back(local);
+                }
+            }
+
+            // The best neighbour adds the fewest vertices, ties go to the earliest triangle
+            MeshElementIndex best_triangle = NO_MESHLET;
+            size_t best_cost = FACE_ELEMENT_COUNT + 1;
+
+            for(MeshElementIndex vertex : meshlet_vertices)
+                for(MeshElementIndex k = triangle_offsets[vertex]; k < triangle_offsets[vertex + 1] && best_cost > 0; ++k)
+                {
+                    MeshElementIndex candidate = triangle_list[k];
+                    if(emitted[candidate])
+                        continue;
+
+                    size_t cost = new_vertex_count(candidate, meshlet);
+                    if(meshlet_vertices.size() + cost > MAX_VERTICES)
+                        continue;
+
+                    if(cost < best_cost || (cost == best_cost && candidate < best_triangle))
+                    {
+                        best_cost     = cost;
+                        best_triangle = candidate;
+                    }
+                }
+
+            if(best_triangle == NO_MESHLET)
+                break;
+
+            triangle = best_triangle;
+        }
+
+        MeshElementIndex meshlet_count = static_cast<MeshElementIndex>(reordered.size()) - meshlet_base;
+        meshlets.push_back(make_meshlet(reordered.data() + meshlet_base, index_base + meshlet_base, meshlet_count));
+        ++meshlet;
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices.begin() + index_base);
+
+    return meshlets;
+}
+
+StaticMesh::Meshlet MeshletBuilder::make_meshlet
+(
+    const MeshElementIndex *indices,
+    MeshElementIndex index_base,
+    MeshElementIndex index_count
+) const
+{
+    static constexpr MeshElementIndex FACE_ELEMENT_COUNT = 3;
+    static constexpr float MIN_CONE_DOT = 0.1f; // Wider cones almost never cull
+
+    StaticMesh::Meshlet meshlet = {};
+    meshlet.index_base  = index_base;
+    meshlet.index_count = index_count;
+
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+    for(MeshElementIndex i = 0; i < index_count; ++i)
+    {
+        min = glm::min(min, vertices[indices[i]].position);
+        max = glm::max(max, vertices[indices[i]].position);
+    }
+
+    meshlet.bounds.center = 0.5f * (min + max);
+    for(MeshElementIndex i = 0; i < index_count; ++i)
+        meshlet.bounds.radius = std::max(meshlet.bounds.radius, glm::length(vertices[indices[i]].position - meshlet.bounds.center));
+
+    std::vector<glm::vec3> normals;
+    normals.reserve(index_count / FACE_ELEMENT_COUNT);
+
+    glm::vec3 axis(0.f);
+    for(MeshElementIndex i = 0; i < index_count; i += FACE_ELEMENT_COUNT)
+    {
+        const glm::vec3 &p0 = vertices[indices[i + 0]].position;
+        const glm::vec3 &p1 = vertices[indices[i + 1]].position;
+        const glm::vec3 &p2 = vertices[indices[i + 2]].position;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if(area <= FLT_EPSILON)
+            continue;
+
+        normals.push_back(normal / area);
+        axis += normals.back();
+    }
+
+    // cone_cutoff = 1 disables the test: the left side never exceeds |center - viewer|
+    meshlet.cone_axis   = glm::vec3(0.f, 0.f, 1.f);
+    meshlet.cone_cutoff = 1.f;
+
+    float axis_length = glm::length(axis);
+    if(normals.empty() || axis_length <= FLT_EPSILON)
+        return meshlet;
+
+    axis /= axis_length;
+
+    float min_dot = 1.f;
+    for(auto &&normal : normals)
+        min_dot = std::min(min_dot, glm::dot(axis, normal));
+
+    if(min_dot < MIN_CONE_DOT)
+        return meshlet;
+
+    meshlet.cone_axis   = axis;
+    meshlet.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+
+    return meshlet;
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef CG_SEM5_MESHLETBUILDER_H
+#define CG_SEM5_MESHLETBUILDER_H
+
+#include <vector>
+
+#include "staticmesh.h"
+
+// Greedy clustering: a meshlet grows through triangles sharing its vertices
+// until it reaches MAX_VERTICES unique vertices or MAX_TRIANGLES triangles.
+class MeshletBuilder
+{
+public:
+    static constexpr size_t MAX_VERTICES  = 64;
+    static constexpr size_t MAX_TRIANGLES = 124;
+
+    MeshletBuilder(const std::vector<StaticMesh::Vertex> &);
+
+    // Reorders the triangles of [index_base, index_base + index_count) so every meshlet is contiguous
+    std::vector<StaticMesh::Meshlet> build
+    (
+        std::vector<MeshElementIndex> &indices,
+        MeshElementIndex index_base,
+        MeshElementIndex index_count
+    ) const;
+
+private:
+    StaticMesh::Meshlet make_meshlet
+    (
+        const MeshElementIndex *indices,
+        MeshElementIndex index_base,
+        MeshElementIndex index_count
+    ) const;
+
+    const std::vector<StaticMesh::Vertex> &vertices;
+};
+
+#endif // CG_SEM5_MESHLETBUILDER_H
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cmath>
+
+#include "meshletculler.h"
+#include "simd.h"
+
+MeshletCuller::MeshletCuller(const StaticMesh &mesh)
+: meshlet_count(mesh.get_meshlet_count())
+{
+    size_t padded_count = (meshlet_count + SIMD_WIDTH - 1) / SIMD_WIDTH * SIMD_WIDTH;
+
+    for(auto component : { &center_x, &center_y, &center_z, &radius, &axis_x, &axis_y, &axis_z })
+        component->resize(padded_count, 0.f);
+
+    // Padding lanes are never written back, cutoff = 1 just keeps them out of the cone test
+    cutoff.resize(padded_count, 1.f);
+
+    size_t i = 0;
+    for(auto &&part : mesh.get_parts())
+        for(auto &&meshlet : part.meshlets)
+        {
+            center_x[i] = meshlet.bounds.center.x;
+            center_y[i] = meshlet.bounds.center.y;
+            center_z[i] = meshlet.bounds.center.z;
+            radius[i]   = meshlet.bounds.radius;
+            axis_x[i]   = meshlet.cone_axis.x;
+            axis_y[i]   = meshlet.cone_axis.y;
+            axis_z[i]   = meshlet.cone_axis.z;
+            cutoff[i]   = meshlet.cone_cutoff;
+            ++i;
+        }
+}
+
+size_t MeshletCuller::get_meshlet_count() const
+{
+    return meshlet_count;
+}
+
+uint32_t MeshletCuller::cull
+(
+    const Frustum &frustum,
+    const glm::mat4 &model,
+    const glm::vec3 &camera_position,
+    bool are_back_faces_culled,
+    VkDrawIndexedIndirectCommand *commands
+) const
+{
+    static constexpr float MAX_SCALE_DIFFERENCE = 1e-3f;
+
+    auto planes = frustum.get_local_planes(model);
+
+    float scale_x = glm::length(glm::vec3(model[0]));
+    float scale_y = glm::length(glm::vec3(model[1]));
+    float scale_z = glm::length(glm::vec3(model[2]));
+    float scale   = std::max(scale_x, std::max(scale_y, scale_z));
+
+    // Normal cones are only preserved by uniform scaling
+    bool is_cone_test_enabled = are_back_faces_culled
+                              && scale - std::min(scale_x, std::min(scale_y, scale_z)) <= MAX_SCALE_DIFFERENCE * scale;
+    glm::vec3 viewer = glm::vec3(glm::inverse(model) * glm::vec4(camera_position, 1.f));
+
+    uint32_t visible_count = 0;
+    size_t i = 0;
+
+#ifdef CG_SEM5_SSE
+    const __m128 scale_4 = _mm_set1_ps(scale);
+    const __m128 viewer_x = _mm_set1_ps(viewer.x);
+    const __m128 viewer_y = _mm_set1_ps(viewer.y);
+    const __m128 viewer_z = _mm_set1_ps(viewer.z);
+    const __m128 cone_mask = _mm_castsi128_ps(_mm_set1_epi32(is_cone_test_enabled? -1 : 0));
+
+    for(; i < meshlet_count; i += SIMD_WIDTH)
+    {
+        __m128 x = _mm_loadu_ps(&center_x[i]);
+        __m128 y = _mm_loadu_ps(&center_y[i]);
+        __m128 z = _mm_loadu_ps(&center_z[i]);
+        __m128 r = _mm_loadu_ps(&radius[i]);
+
+        __m128 negative_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(r, scale_4));
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for(auto &&plane : planes)
+        {
+            __m128 distance = _mm_add_ps
+            (
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w))
+            );
+
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negative_radius));
+        }
+
+        __m128 dx = _mm_sub_ps(x, viewer_x);
+        __m128 dy = _mm_sub_ps(y, viewer_y);
+        __m128 dz = _mm_sub_ps(z, viewer_z);
+
+        __m128 distance = _mm_sqrt_ps
+        (
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz))
+        );
+
+        __m128 projection = _mm_add_ps
+        (
+            _mm_add_ps(_mm_mul_ps(dx, _mm_loadu_ps(&axis_x[i])), _mm_mul_ps(dy, _mm_loadu_ps(&axis_y[i]))),
+            _mm_mul_ps(dz, _mm_loadu_ps(&axis_z[i]))
+        );
+
+        __m128 backfacing = _mm_cmpge_ps(projection, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff[i]), distance), r));
+        visible = _mm_andnot_ps(_mm_and_ps(backfacing, cone_mask), visible);
+
+        int mask = _mm_movemask_ps(visible);
+        for(size_t j = 0, lanes = std::min(SIMD_WIDTH, meshlet_count - i); j < lanes; ++j)
+        {
+            uint32_t is_visible = (mask >> j) & 1;
+            commands[i + j].instanceCount = is_visible;
+            visible_count += is_visible;
+        }
+    }
+#endif // CG_SEM5_SSE
+
+    for(; i < meshlet_count; ++i)
+    {
+        glm::vec3 center(center_x[i], center_y[i], center_z[i]);
+        bool is_visible = true;
+
+        for(auto &&plane : planes)
+            is_visible = is_visible && glm::dot(glm::vec3(plane), center) + plane.w >= -radius[i] * scale;
+
+        glm::vec3 direction = center - viewer;
+        glm::vec3 axis(axis_x[i], axis_y[i], axis_z[i]);
+        if(is_cone_test_enabled && glm::dot(direction, axis) >= cutoff[i] * glm::length(direction) + radius[i])
+            is_visible = false;
+
+        commands[i].instanceCount = is_visible? 1 : 0;
+        visible_count += is_visible? 1 : 0;
+    }
+
+    return visible_count;
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#ifndef CG_SEM5_MESHLETCULLER_H
+#define CG_SEM5_MESHLETCULLER_H
+
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "staticmesh.h"
+#include "frustum.h"
+
+// Frustum and normal cone test of every meshlet of a mesh, four meshlets at a time
+class MeshletCuller
+{
+public:
+    MeshletCuller(const StaticMesh &);
+
+    size_t get_meshlet_count() const;
+
+    // Sets instanceCount of one command per meshlet (in part order) to 0 or 1.
+    // Normal cones are tested only when the pipeline culls back faces, otherwise they are drawn.
+    // Returns the visible meshlet count
+    uint32_t cull
+    (
+        const Frustum &,
+        const glm::mat4 &model,
+        const glm::vec3 &camera_position,
+        bool are_back_faces_culled,
+        VkDrawIndexedIndirectCommand *commands
+    ) const;
+
+private:
+    static constexpr size_t SIMD_WIDTH = 4;
+
+    size_t meshlet_count;
+
+    // Padded to SIMD_WIDTH
+    std::vector<float> center_x, center_y, center_z, radius;
+    std::vector<float> axis_x, axis_y, axis_z, cutoff;
+};
+
+#endif // CG_SEM5_MESHLETCULLER_H
\ No newline at end of file
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#include "meshsimplifier.h"
+
+struct Quadric
+{
+    float a00 = 0.f, a11 = 0.f, a22 = 0.f;
+    float a10 = 0.f, a20 = 0.f, a21 = 0.f;
+    float b0  = 0.f, b1  = 0.f, b2  = 0.f;
+    float c   = 0.f;
+    float weight = 0.f;
+};
+
+struct VertexHash
+{
+    size_t operator()(const StaticMesh::Vertex &vertex) const
+    {
+        // FNV-1a over the raw attributes
+        auto bytes = reinterpret_cast<const uint8_t*>(&vertex);
+        size_t hash = 2166136261u;
+        for(size_t i = 0; i < sizeof(StaticMesh::Vertex); ++i)
+            hash = (hash ^ bytes[i]) * 16777619u;
+
+        return hash;
+    }
+};
+
+struct VertexEqual
+{
+    bool operator()(const StaticMesh::Vertex &lhs, const StaticMesh::Vertex &rhs) const
+    {
+        return std::memcmp(&lhs, &rhs, sizeof(StaticMesh::Vertex)) == 0;
+    }
+};
+
+struct Collapse
+{
+    MeshElementIndex source;
+    MeshElementIndex target;
+    float            error;
+};
+
+static void add_plane(Quadric &quadric, const glm::vec3 &normal, float distance, float weight)
+{
+    quadric.a00 += weight * normal.x * normal.x;
+    quadric.a11 += weight * normal.y * normal.y;
+    quadric.a22 += weight * normal.z * normal.z;
+    quadric.a10 += weight * normal.y * normal.x;
+    quadric.a20 += weight * normal.z * normal.x;
+    quadric.a21 += weight * normal.z * normal.y;
+    quadric.b0  += weight * normal.x * distance;
+    quadric.b1  += weight * normal.y * distance;
+    quadric.b2  += weight * normal.z * distance;
+    quadric.c   += weight * distance * distance;
+    quadric.weight += weight;
+}
+
+static void add_quadric(Quadric &quadric, const Quadric &other)
+{
+    quadric.a00 += other.a00;
+    quadric.a11 += other.a11;
+    quadric.a22 += other.a22;
+    quadric.a10 += other.a10;
+    quadric.a20 += other.a20;
+    quadric.a21 += other.a21;
+    quadric.b0  += other.b0;
+    quadric.b1  += other.b1;
+    quadric.b2  += other.b2;
+    quadric.c   += other.c;
+    quadric.weight += other.weight;
+}
+
+// Mean squared distance from the point to the planes accumulated in the quadric
+static float quadric_error(const Quadric &quadric, const glm::vec3 &point)
+{
+    float rx = quadric.b0 + quadric.a00 * point.x + quadric.a10 * point.y + quadric.a20 * point.z;
+    float ry = quadric.b1 + quadric.a10 * point.x + quadric.a11 * point.y + quadric.a21 * point.z;
+    float rz = quadric.b2 + quadric.a20 * point.x + quadric.a21 * point.y + quadric.a22 * point.z;
+
+    float error = point.x * rx + point.y * ry + point.z * rz
+                + quadric.b0 * point.x + quadric.b1 * point.y + quadric.b2 * point.z
+                + quadric.c;
+
+    return std::fabs(error) / std::max(quadric.weight, FLT_EPSILON);
+}
+
+MeshSimplifier::MeshSimplifier(const std::vector<StaticMesh::Vertex> &vertices)
+: vertices(vertices),
+vertex_remap(vertices.size()),
+position_remap(vertices.size()),
+seams(vertices.size(), false),
+extent(0.f)
+{
+    std::unordered_map<StaticMesh::Vertex, MeshElementIndex, VertexHash, VertexEqual> unique_vertices;
+    std::unordered_map<glm::vec3, MeshElementIndex> unique_positions;
+    unique_vertices.reserve(vertices.size());
+    unique_positions.reserve(vertices.size());
+
+    glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+
+    for(MeshElementIndex i = 0, vertex_count = static_cast<MeshElementIndex>(vertices.size()); i < vertex_count; ++i)
+    {
+        auto vertex_it = unique_vertices.emplace(vertices[i], i);
+        vertex_remap[i] = vertex_it.first->second;
+
+        if(!vertex_it.second)
+        {
+            position_remap[i] = position_remap[vertex_remap[i]];
+            continue;
+        }
+
+        auto position_it = unique_positions.emplace(vertices[i].position, i);
+        position_remap[i] = position_it.first->second;
+
+        if(!position_it.second)
+            seams[position_remap[i]] = true;
+
+        min = glm::min(min, vertices[i].position);
+        max = glm::max(max, vertices[i].position);
+    }
+
+    if(!vertices.empty())
+    {
+        glm::vec3 size = max - min;
+        extent = std::max(size.x, std::max(size.y, size.z));
+    }
+}
+
+std::vector<MeshElementIndex> MeshSimplifier::simplify
+(
+    const MeshElementIndex *source_indices,
+    size_t index_count,
+    size_t target_index_count,
+    float target_error
+) const
+{
+    static constexpr MeshElementIndex FACE_ELEMENT_COUNT = 3;
+
+    std::vector<MeshElementIndex> indices(index_count);
+    for(size_t i = 0; i < index_count; ++i)
+        indices[i] = vertex_remap[source_indices[i]];
+
+    if(index_count <= target_index_count)
+        return indices;
+
+    auto edge_key = [](MeshElementIndex from, MeshElementIndex to)
+    {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    };
+
+    const size_t vertex_count = vertices.size();
+
+    // Open edges are borders of the part: either holes or material boundaries
+    std::vector<bool> locked(vertex_count, false);
+    {
+        std::unordered_map<uint64_t, uint32_t> edges;
+        edges.reserve(index_count);
+
+        for(size_t i = 0; i < index_count; i += FACE_ELEMENT_COUNT)
+            for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+            {
+                MeshElementIndex from = position_remap[indices[i + j]];
+                MeshElementIndex to   = position_remap[indices[i + (j + 1) % FACE_ELEMENT_COUNT]];
+                ++edges[edge_key(from, to)];
+            }
+
+        for(size_t i = 0; i < index_count; i += FACE_ELEMENT_COUNT)
+            for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+            {
+                MeshElementIndex from = position_remap[indices[i + j]];
+                MeshElementIndex to   = position_remap[indices[i + (j + 1) % FACE_ELEMENT_COUNT]];
+
+                if(edges.find(edge_key(to, from)) == edges.end())
+                    locked[from] = locked[to] = true;
+
+                locked[from] = locked[from] || seams[from];
+            }
+    }
+
+    std::vector<Quadric> quadrics(vertex_count);
+    for(size_t i = 0; i < index_count; i += FACE_ELEMENT_COUNT)
+    {
+        const glm::vec3 &p0 = vertices[indices[i + 0]].position;
+        const glm::vec3 &p1 = vertices[indices[i + 1]].position;
+        const glm::vec3 &p2 = vertices[indices[i + 2]].position;
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(normal);
+        if(area <= FLT_EPSILON)
+            continue;
+
+        normal /= area;
+        float distance = -glm::dot(normal, p0);
+
+        for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+            add_plane(quadrics[position_remap[indices[i + j]]], normal, distance, area);
+    }
+
+    const float error_limit = (target_error * extent) * (target_error * extent);
+
+    std::vector<MeshElementIndex> triangle_offsets(vertex_count + 1);
+    std::vector<MeshElementIndex> triangle_list;
+    std::vector<MeshElementIndex> collapse_remap(vertex_count);
+    std::vector<bool>             touched(vertex_count);
+    std::vector<Collapse>         collapses;
+
+    auto is_flipped = [&](MeshElementIndex source, MeshElementIndex target)
+    {
+        const glm::vec3 &target_position = vertices[target].position;
+
+        for(MeshElementIndex k = triangle_offsets[source]; k < triangle_offsets[source + 1]; ++k)
+        {
+            const MeshElementIndex *face = &indices[triangle_list[k] * FACE_ELEMENT_COUNT];
+
+            glm::vec3 before[FACE_ELEMENT_COUNT];
+            glm::vec3 after[FACE_ELEMENT_COUNT];
+            bool is_degenerate = false;
+
+            for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+            {
+                MeshElementIndex position = position_remap[face[j]];
+                is_degenerate = is_degenerate || position == position_remap[target];
+
+                before[j] = vertices[face[j]].position;
+                after[j]  = position == source? target_position : before[j];
+            }
+
+            if(is_degenerate)
+                continue;
+
+            glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+            glm::vec3 normal_after  = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+            if(glm::dot(normal_before, normal_after) <= 0.f)
+                return true;
+        }
+
+        return false;
+    };
+
+    while(indices.size() > target_index_count)
+    {
+        const size_t triangle_count = indices.size() / FACE_ELEMENT_COUNT;
+
+        // Triangles adjacent to every position
+        std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+        for(MeshElementIndex index : indices)
+            ++triangle_offsets[position_remap[index] + 1];
+
+        std::partial_sum(triangle_offsets.begin(), triangle_offsets.end(), triangle_offsets.begin());
+        triangle_list.resize(indices.size());
+
+        {
+            std::vector<MeshElementIndex> fill(triangle_offsets.begin(), triangle_offsets.end() - 1);
+            for(size_t i = 0; i < indices.size(); ++i)
+                triangle_list[fill[position_remap[indices[i]]]++] = static_cast<MeshElementIndex>(i / FACE_ELEMENT_COUNT);
+        }
+
+        collapses.clear();
+        for(size_t i = 0; i < indices.size(); i += FACE_ELEMENT_COUNT)
+            for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+            {
+                MeshElementIndex v0 = indices[i + j];
+                MeshElementIndex v1 = indices[i + (j + 1) % FACE_ELEMENT_COUNT];
+
+                for(auto [source, target] : { std::make_pair(v0, v1), std::make_pair(v1, v0) })
+                {
+                    MeshElementIndex source_position = position_remap[source];
+                    MeshElementIndex target_position = position_remap[target];
+
+                    if(source_position == target_position || locked[source_position])
+                        continue;
+
+                    Quadric quadric = quadrics[source_position];
+                    add_quadric(quadric, quadrics[target_position]);
+
+                    collapses.push_back({ source, target, quadric_error(quadric, vertices[target].position) });
+                }
+            }
+
+        std::sort
+        (
+            collapses.begin(),
+            collapses.end(),
+            [](const Collapse &lhs, const Collapse &rhs) { return lhs.error < rhs.error; }
+        );
+
+        std::iota(collapse_remap.begin(), collapse_remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+
+        // Every collapse of a manifold edge removes two triangles
+        const size_t collapse_budget = (triangle_count - target_index_count / FACE_ELEMENT_COUNT + 1) / 2;
+        size_t collapse_count = 0;
+
+        for(auto &&collapse : collapses)
+        {
+            if(collapse.error > error_limit || collapse_count >= collapse_budget)
+                break;
+
+            // Unlocked vertices are never seams, so the source position has exactly one vertex
+            MeshElementIndex source_position = position_remap[collapse.source];
+            MeshElementIndex target_position = position_remap[collapse.target];
+
+            if(touched[source_position] || touched[target_position])
+                continue;
+
+            if(is_flipped(source_position, collapse.target))
+                continue;
+
+            collapse_remap[collapse.source] = collapse.target;
+            add_quadric(quadrics[target_position], quadrics[source_position]);
+
+            // Neighbours keep their positions until the next pass, so the flip test above stays valid
+            for(MeshElementIndex k = triangle_offsets[source_position]; k < triangle_offsets[source_position + 1]; ++k)
+                for(MeshElementIndex j = 0; j < FACE_ELEMENT_COUNT; ++j)
+                    touched[position_remap[indices[triangle_list[k] * FACE_ELEMENT_COUNT + j]]] = true;
+
+            ++collapse_count;
+        }
+
+        if(collapse_count == 0)
+            break;
+
+        size_t write = 0;
+        for(size_t i = 0; i < indices.size(); i += FACE_ELEMENT_COUNT)
+        {
+            MeshElementIndex a = collapse_remap[indices[i + 0]];
+            MeshElementIndex b = collapse_remap[indices[i + 1]];
+            MeshElementIndex c = collapse_remap[indices[i + 2]];
+
+            MeshElementIndex pa = position_remap[a];
+            MeshElementIndex pb = position_remap[b];
+            MeshElementIndex pc = position_remap[c];
+
+            if(pa == pb || pb == pc || pc == pa)
+                continue;
+
+            indices[write + 0] = a;
+            indices[write + 1] = b;
+            indices[write + 2] = c;
+            write += FACE_ELEMENT_COUNT;
+        }
+
+        indices.resize(write);
+    }
+
+    return indices;
+}
\ No newline at end of file
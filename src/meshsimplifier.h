@@ -0,0 +1,37 @@
+#ifndef CG_SEM5_MESHSIMPLIFIER_H
+#define CG_SEM5_MESHSIMPLIFIER_H
+
+#include <vector>
+
+#include "staticmesh.h"
+
+// Quadric error metric edge collapse (Garland & Heckbert).
+// Vertices are never moved or created: an edge collapses onto one of its endpoints,
+// so every simplified index list can be drawn from the source vertex buffer.
+// Vertices on open edges (including material boundaries, since a part is simplified on its own)
+// and vertices on UV/normal seams are locked to keep the silhouette and the texture mapping intact.
+class MeshSimplifier
+{
+public:
+    MeshSimplifier(const std::vector<StaticMesh::Vertex> &);
+
+    // target_error is relative to the largest mesh extent
+    std::vector<MeshElementIndex> simplify
+    (
+        const MeshElementIndex *indices,
+        size_t index_count,
+        size_t target_index_count,
+        float target_error
+    ) const;
+
+private:
+    const std::vector<StaticMesh::Vertex> &vertices;
+
+    std::vector<MeshElementIndex> vertex_remap;   // First vertex with identical attributes
+    std::vector<MeshElementIndex> position_remap; // First unique vertex with identical position
+    std::vector<bool>             seams;          // Per position: shared by vertices with different attributes
+
+    float extent;
+};
+
+#endif // CG_SEM5_MESHSIMPLIFIER_H
\ No newline at end of file
@@ -0,0 +1,635 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "objloader.h"
+#include "mappedfile.h"
+#include "simd.h"
+
+static constexpr size_t   MIN_CHUNK_SIZE  = 1 << 16;
+static constexpr uint32_t NO_ELEMENT      = std::numeric_limits<uint32_t>::max();
+static constexpr uint32_t FLAT_NORMAL_BIT = 1u << 31; // Normal index of a generated face normal is the triangle
+
+// Zero based indices into the whole file, NO_ELEMENT for omitted elements
+struct ObjCorner
+{
+    uint32_t position;
+    uint32_t uv;
+    uint32_t normal;
+};
+
+struct ObjMaterialSwitch
+{
+    size_t      corner; // First corner drawn with the material
+    std::string material;
+};
+
+struct ObjChunk
+{
+    const char *begin;
+    const char *end;
+
+    // Elements defined in the chunk and in all chunks before it
+    size_t position_count = 0, uv_count = 0, normal_count = 0;
+    size_t position_base  = 0, uv_base  = 0, normal_base  = 0;
+
+    std::vector<ObjCorner>         corners; // Three per triangle
+    std::vector<ObjMaterialSwitch> material_switches;
+    std::vector<std::string>       material_libraries;
+};
+
+// Lines defining elements, both passes classify them the same way
+enum class ObjElement
+{
+    NONE,
+    POSITION,
+    UV,
+    NORMAL
+};
+
+struct ObjVertexKey
+{
+    uint32_t position;
+    uint32_t uv;
+    uint32_t normal;
+
+    bool operator==(const ObjVertexKey &other) const
+    {
+        return position == other.position && uv == other.uv && normal == other.normal;
+    }
+};
+
+struct ObjVertexKeyHash
+{
+    size_t operator()(const ObjVertexKey &key) const
+    {
+        uint64_t hash = key.position;
+        hash = hash * 0x9e3779b97f4a7c15ull ^ key.uv;
+        hash = hash * 0x9e3779b97f4a7c15ull ^ key.normal;
+
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+void skip_spaces(const char *&cursor, const char *end)
+{
+    while(cursor < end && is_space(*cursor))
+        ++cursor;
+}
+
+std::string_view read_token(const char *&cursor, const char *end)
+{
+    skip_spaces(cursor, end);
+
+    const char *begin = cursor;
+    while(cursor < end && !is_space(*cursor))
+        ++cursor;
+
+    return std::string_view(begin, cursor - begin);
+}
+
+ObjElement classify_element(std::string_view keyword)
+{
+    if(keyword == "v")
+        return ObjElement::POSITION;
+
+    if(keyword == "vt")
+        return ObjElement::UV;
+
+    if(keyword == "vn")
+        return ObjElement::NORMAL;
+
+    return ObjElement::NONE;
+}
+
+std::string_view trim(const char *begin, const char *end)
+{
+    skip_spaces(begin, end);
+    while(end > begin && is_space(end[-1]))
+        --end;
+
+    return std::string_view(begin, end - begin);
+}
+
+int first_set_bit(int mask)
+{
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, static_cast<unsigned long>(mask));
+    return static_cast<int>(index);
+#else
+    return __builtin_ctz(static_cast<unsigned>(mask));
+#endif
+}
+
+// Sixteen bytes per compare, the tail goes through memchr
+const char *find_line_end(const char *cursor, const char *end)
+{
+#ifdef CG_SEM5_SSE
+    const __m128i new_line = _mm_set1_epi8('\n');
+    for(; end - cursor >= 16; cursor += 16)
+    {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, new_line));
+        if(mask != 0)
+            return cursor + first_set_bit(mask);
+    }
+#endif
+
+    auto line_end = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+    return line_end == nullptr? end : line_end;
+}
+
+// Plain decimal and exponent notation, which is all OBJ exporters write.
+// Up to 19 significant digits are accumulated exactly, the result is rounded once to float
+float parse_float(const char *&cursor, const char *end)
+{
+    static constexpr double POWERS_OF_10[] =
+    {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    static constexpr int MAX_EXACT_POWER        = 22;
+    static constexpr int MAX_MANTISSA_DIGITS    = 19;
+    static constexpr int MAX_EXPONENT_MAGNITUDE = 10000;
+
+    skip_spaces(cursor, end);
+
+    bool is_negative = false;
+    if(cursor < end && (*cursor == '-' || *cursor == '+'))
+        is_negative = *cursor++ == '-';
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits   = 0;
+
+    for(; cursor < end && is_digit(*cursor); ++cursor)
+    {
+        if(digits < MAX_MANTISSA_DIGITS)
+        {
+            mantissa = mantissa * 10 + (*cursor - '0');
+            digits  += mantissa != 0;
+        }
+        else
+            ++exponent;
+    }
+
+    if(cursor < end && *cursor == '.')
+        for(++cursor; cursor < end && is_digit(*cursor); ++cursor)
+        {
+            if(digits >= MAX_MANTISSA_DIGITS)
+                continue;
+
+            mantissa = mantissa * 10 + (*cursor - '0');
+            digits  += mantissa != 0;
+            --exponent;
+        }
+
+    if(cursor < end && (*cursor == 'e' || *cursor == 'E'))
+    {
+        ++cursor;
+
+        bool is_exponent_negative = false;
+        if(cursor < end && (*cursor == '-' || *cursor == '+'))
+            is_exponent_negative = *cursor++ == '-';
+
+        int written_exponent = 0;
+        for(; cursor < end && is_digit(*cursor); ++cursor)
+            if(written_exponent < MAX_EXPONENT_MAGNITUDE)
+                written_exponent = written_exponent * 10 + (*cursor - '0');
+
+        exponent += is_exponent_negative? -written_exponent : written_exponent;
+    }
+
+    double value = static_cast<double>(mantissa);
+    if(exponent < 0)
+        value = exponent >= -MAX_EXACT_POWER? value / POWERS_OF_10[-exponent] : value * std::pow(10.0, exponent);
+    else if(exponent > 0)
+        value = exponent <= MAX_EXACT_POWER? value * POWERS_OF_10[exponent] : value * std::pow(10.0, exponent);
+
+    return static_cast<float>(is_negative? -value : value);
+}
+
+// 0 when there is no index
+long parse_index(const char *&cursor, const char *end)
+{
+    bool is_negative = false;
+    if(cursor < end && *cursor == '-')
+    {
+        is_negative = true;
+        ++cursor;
+    }
+
+    long index = 0;
+    for(; cursor < end && is_digit(*cursor); ++cursor)
+        index = index * 10 + (*cursor - '0');
+
+    return is_negative? -index : index;
+}
+
+// Negative indices count back from the last element defined before the face
+uint32_t resolve_index(long index, size_t defined_count)
+{
+    if(index > 0)
+        return static_cast<uint32_t>(index - 1);
+
+    if(index < 0 && static_cast<size_t>(-index) <= defined_count)
+        return static_cast<uint32_t>(defined_count + index);
+
+    return NO_ELEMENT;
+}
+
+std::string directory_of(std::string_view path)
+{
+    size_t separator = path.find_last_of('/');
+    return separator == std::string_view::npos? std::string() : std::string(path.substr(0, separator + 1));
+}
+
+void split_chunks(const char *data, size_t size, std::vector<ObjChunk> &chunks)
+{
+    size_t workers = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    size_t chunk_size = std::max(MIN_CHUNK_SIZE, size / (workers * 4));
+
+    const char *end = data + size;
+    for(const char *begin = data; begin < end;)
+    {
+        const char *chunk_end = begin + std::min(chunk_size, static_cast<size_t>(end - begin));
+        if(chunk_end < end)
+            chunk_end = std::min(find_line_end(chunk_end, end) + 1, end);
+
+        chunks.emplace_back();
+        chunks.back().begin = begin;
+        chunks.back().end   = chunk_end;
+        begin = chunk_end;
+    }
+}
+
+// First pass, only looks at line starts so element bases are known before parsing
+void count_elements(ObjChunk &chunk)
+{
+    for(const char *cursor = chunk.begin; cursor < chunk.end;)
+    {
+        const char *line_end = find_line_end(cursor, chunk.end);
+
+        // Parsing writes exactly the counted elements into the ranges reserved for the chunk
+        switch(classify_element(read_token(cursor, line_end)))
+        {
+        case ObjElement::POSITION:
+            ++chunk.position_count;
+            break;
+
+        case ObjElement::UV:
+            ++chunk.uv_count;
+            break;
+
+        case ObjElement::NORMAL:
+            ++chunk.normal_count;
+            break;
+
+        case ObjElement::NONE:
+            break;
+        }
+
+        cursor = line_end + 1;
+    }
+}
+
+void parse_chunk
+(
+    ObjChunk &chunk,
+    std::vector<glm::vec3> &positions,
+    std::vector<glm::vec2> &uvs,
+    std::vector<glm::vec3> &normals
+)
+{
+    size_t position_count = chunk.position_base;
+    size_t uv_count       = chunk.uv_base;
+    size_t normal_count   = chunk.normal_base;
+
+    std::vector<ObjCorner> polygon;
+
+    for(const char *cursor = chunk.begin; cursor < chunk.end;)
+    {
+        const char *line_end = find_line_end(cursor, chunk.end);
+        std::string_view keyword = read_token(cursor, line_end);
+        ObjElement element = classify_element(keyword);
+
+        if(element == ObjElement::POSITION)
+        {
+            glm::vec3 &position = positions[position_count++];
+            position.x = parse_float(cursor, line_end);
+            position.y = parse_float(cursor, line_end);
+            position.z = parse_float(cursor, line_end);
+        }
+        else if(element == ObjElement::UV)
+        {
+            glm::vec2 &uv = uvs[uv_count++];
+            uv.x = parse_float(cursor, line_end);
+            uv.y = parse_float(cursor, line_end);
+        }
+        else if(element == ObjElement::NORMAL)
+        {
+            glm::vec3 &normal = normals[normal_count++];
+            normal.x = parse_float(cursor, line_end);
+            normal.y = parse_float(cursor, line_end);
+            normal.z = parse_float(cursor, line_end);
+        }
+        else if(keyword == "f")
+        {
+            polygon.clear();
+
+            // v, v/vt, v//vn or v/vt/vn
+            for(skip_spaces(cursor, line_end); cursor < line_end; skip_spaces(cursor, line_end))
+            {
+                ObjCorner corner = { NO_ELEMENT, NO_ELEMENT, NO_ELEMENT };
+                corner.position = resolve_index(parse_index(cursor, line_end), position_count);
+
+                if(cursor < line_end && *cursor == '/')
+                {
+                    ++cursor;
+                    if(cursor < line_end && *cursor != '/')
+                        corner.uv = resolve_index(parse_index(cursor, line_end), uv_count);
+
+                    if(cursor < line_end && *cursor == '/')
+                    {
+                        ++cursor;
+                        corner.normal = resolve_index(parse_index(cursor, line_end), normal_count);
+                    }
+                }
+
+                polygon.push_back(corner);
+
+                // Unknown syntax, the rest of the line is skipped
+                if(cursor < line_end && !is_space(*cursor))
+                    break;
+            }
+
+            // Fan triangulation, points and lines aren't drawn
+            for(size_t i = 2; i < polygon.size(); ++i)
+            {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i - 1]);
+                chunk.corners.push_back(polygon[i]);
+            }
+        }
+        else if(keyword == "usemtl")
+            chunk.material_switches.push_back({ chunk.corners.size(), std::string(trim(cursor, line_end)) });
+        else if(keyword == "mtllib")
+            chunk.material_libraries.emplace_back(trim(cursor, line_end));
+
+        cursor = line_end + 1;
+    }
+}
+
+void load_material_library(std::string_view path, std::vector<ObjLoader::Material> &materials)
+{
+    MappedFile file(path);
+
+    const char *end = file.get_data() + file.get_size();
+    ObjLoader::Material *material = nullptr;
+
+    for(const char *cursor = file.get_data(); cursor < end;)
+    {
+        const char *line_end = find_line_end(cursor, end);
+        std::string_view keyword = read_token(cursor, line_end);
+
+        if(keyword == "newmtl")
+        {
+            materials.emplace_back();
+            material = &materials.back();
+            material->name = trim(cursor, line_end);
+        }
+        else if(material == nullptr)
+        {}
+        else if(keyword == "Ka" || keyword == "Kd" || keyword == "Ks")
+        {
+            glm::vec4 &color = keyword == "Ka"? material->ambient : keyword == "Kd"? material->diffuse : material->specular;
+            color.r = parse_float(cursor, line_end);
+            color.g = parse_float(cursor, line_end);
+            color.b = parse_float(cursor, line_end);
+        }
+        else if(keyword == "d")
+            material->opacity = parse_float(cursor, line_end);
+        else if(keyword == "Tr")
+            material->opacity = 1.f - parse_float(cursor, line_end);
+        else if(keyword == "map_Kd")
+        {
+            // Options come first, the file name is the last token
+            std::string_view texture;
+            for(std::string_view token = read_token(cursor, line_end); !token.empty(); token = read_token(cursor, line_end))
+                texture = token;
+
+            material->diffuse_texture = texture;
+        }
+
+        cursor = line_end + 1;
+    }
+}
+
+bool ObjLoader::can_load(std::string_view path, int import_flags)
+{
+    static constexpr std::string_view EXTENSION = ".obj";
+
+    if((import_flags & ~StaticMesh::DEFAULT_IMPORT_FLAGS) != 0 || path.size() < EXTENSION.size())
+        return false;
+
+    auto extension = path.substr(path.size() - EXTENSION.size());
+    return std::equal
+    (
+        extension.begin(), extension.end(), EXTENSION.begin(),
+        [](char lhs, char rhs) { return std::tolower(static_cast<unsigned char>(lhs)) == rhs; }
+    );
+}
+
+ObjLoader::Mesh ObjLoader::load(std::string_view path)
+{
+    using namespace std::string_literals;
+
+    MappedFile file(path);
+
+    std::vector<ObjChunk> chunks;
+    split_chunks(file.get_data(), file.get_size(), chunks);
+
+    auto for_each_chunk = [&chunks](auto &&function)
+    {
+        tbb::parallel_for
+        (
+            tbb::blocked_range<size_t>(0, chunks.size(), 1),
+            [&chunks, &function](const tbb::blocked_range<size_t> &range)
+            {
+                for(size_t i = range.begin(); i != range.end(); ++i)
+                    function(chunks[i]);
+            }
+        );
+    };
+
+    for_each_chunk(count_elements);
+
+    size_t position_count = 0, uv_count = 0, normal_count = 0;
+    for(auto &&chunk : chunks)
+    {
+        chunk.position_base = position_count;
+        chunk.uv_base       = uv_count;
+        chunk.normal_base   = normal_count;
+
+        position_count += chunk.position_count;
+        uv_count       += chunk.uv_count;
+        normal_count   += chunk.normal_count;
+    }
+
+    // Chunks write their elements in place
+    std::vector<glm::vec3> positions(position_count);
+    std::vector<glm::vec2> uvs(uv_count);
+    std::vector<glm::vec3> normals(normal_count);
+
+    for_each_chunk([&](ObjChunk &chunk) { parse_chunk(chunk, positions, uvs, normals); });
+
+    Mesh mesh;
+    std::string directory = directory_of(path);
+
+    std::unordered_set<std::string> libraries;
+    for(auto &&chunk : chunks)
+        for(auto &&library : chunk.material_libraries)
+        {
+            if(!libraries.insert(library).second)
+                continue;
+
+            // Like the generic importer, a missing library leaves its materials undefined
+            try
+            {
+                load_material_library(directory + library, mesh.materials);
+            }
+            catch(const std::runtime_error &)
+            {}
+        }
+
+    std::unordered_map<std::string, size_t> material_indices;
+    for(size_t i = 0; i < mesh.materials.size(); ++i)
+        material_indices.emplace(mesh.materials[i].name, i);
+
+    // Faces before any usemtl and with undefined materials
+    const size_t default_material = mesh.materials.size();
+
+    struct CornerRange
+    {
+        const ObjCorner *begin;
+        const ObjCorner *end;
+    };
+
+    std::vector<std::vector<CornerRange>> material_ranges(default_material + 1);
+    size_t material = default_material;
+
+    auto add_range = [&material_ranges, &material](const ObjChunk &chunk, size_t first, size_t last)
+    {
+        if(first < last)
+            material_ranges[material].push_back({ chunk.corners.data() + first, chunk.corners.data() + last });
+    };
+
+    for(auto &&chunk : chunks)
+    {
+        size_t first = 0;
+        for(auto &&material_switch : chunk.material_switches)
+        {
+            add_range(chunk, first, material_switch.corner);
+            first = material_switch.corner;
+
+            auto index = material_indices.find(material_switch.material);
+            material = index == material_indices.end()? default_material : index->second;
+        }
+
+        add_range(chunk, first, chunk.corners.size());
+    }
+
+    if(!material_ranges[default_material].empty())
+    {
+        mesh.materials.emplace_back();
+        mesh.materials.back().name = "DefaultMaterial";
+    }
+
+    std::unordered_map<ObjVertexKey, MeshElementIndex, ObjVertexKeyHash> vertex_indices;
+    uint32_t triangle = 0;
+
+    for(size_t i = 0; i < material_ranges.size(); ++i)
+    {
+        Group group;
+        group.material   = i;
+        group.index_base = static_cast<MeshElementIndex>(mesh.indices.size());
+
+        for(auto &&range : material_ranges[i])
+            for(const ObjCorner *corners = range.begin; corners < range.end; corners += 3, ++triangle)
+            {
+                for(size_t j = 0; j < 3; ++j)
+                    if
+                    (
+                        corners[j].position >= positions.size()
+                        || (corners[j].uv != NO_ELEMENT && corners[j].uv >= uvs.size())
+                        || (corners[j].normal != NO_ELEMENT && corners[j].normal >= normals.size())
+                    )
+                        throw std::runtime_error("Face index out of range in \""s + path.data() + "\"");
+
+                glm::vec3 face_normal = glm::cross
+                (
+                    positions[corners[1].position] - positions[corners[0].position],
+                    positions[corners[2].position] - positions[corners[0].position]
+                );
+
+                float face_normal_length = glm::length(face_normal);
+                if(face_normal_length > 0.f)
+                    face_normal /= face_normal_length;
+
+                for(size_t j = 0; j < 3; ++j)
+                {
+                    const ObjCorner &corner = corners[j];
+                    bool is_flat = corner.normal == NO_ELEMENT;
+
+                    ObjVertexKey key = { corner.position, corner.uv, is_flat? (FLAT_NORMAL_BIT | triangle) : corner.normal };
+                    auto [index, is_new] = vertex_indices.emplace(key, static_cast<MeshElementIndex>(mesh.vertices.size()));
+
+                    if(is_new)
+                    {
+                        StaticMesh::Vertex vertex;
+                        vertex.position = positions[corner.position];
+                        vertex.normal   = is_flat? face_normal : normals[corner.normal];
+                        vertex.normal.y *= -1; // Same as the generic importer path
+                        vertex.uv       = corner.uv == NO_ELEMENT? glm::vec2(0.f) : uvs[corner.uv];
+                        vertex.color    = glm::vec3(1.f);
+                        mesh.vertices.push_back(vertex);
+                    }
+
+                    mesh.indices.push_back(index->second);
+                }
+            }
+
+        group.index_count = static_cast<MeshElementIndex>(mesh.indices.size()) - group.index_base;
+        if(group.index_count > 0)
+            mesh.groups.push_back(group);
+    }
+
+    return mesh;
+}
\ No newline at end of file
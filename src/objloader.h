@@ -0,0 +1,52 @@
+#ifndef CG_SEM5_OBJLOADER_H
+#define CG_SEM5_OBJLOADER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/vec4.hpp>
+
+#include "staticmesh.h"
+
+// Native Wavefront OBJ/MTL reader, faster than the generic importer for our content.
+// The file is memory mapped and split into line chunks parsed on TBB workers.
+// Output matches the importer with StaticMesh::DEFAULT_IMPORT_FLAGS: polygons are triangulated,
+// vertices are joined, missing normals are flat and triangles are grouped by material
+class ObjLoader
+{
+public:
+    struct Material
+    {
+        std::string name;
+        glm::vec4   ambient  = glm::vec4(0.f, 0.f, 0.f, 1.f);
+        glm::vec4   diffuse  = glm::vec4(0.6f, 0.6f, 0.6f, 1.f);
+        glm::vec4   specular = glm::vec4(0.f, 0.f, 0.f, 1.f);
+        float       opacity  = 1.f;
+        std::string diffuse_texture; // As written in the MTL file, empty if untextured
+    };
+
+    // Triangles of one material, contiguous in indices
+    struct Group
+    {
+        size_t           material;
+        MeshElementIndex index_base;
+        MeshElementIndex index_count;
+    };
+
+    struct Mesh
+    {
+        std::vector<Material>           materials;
+        std::vector<Group>              groups;
+        std::vector<StaticMesh::Vertex> vertices;
+        std::vector<MeshElementIndex>   indices;
+    };
+
+    // OBJ files whose import flags ask for nothing beyond the defaults
+    static bool can_load(std::string_view path, int import_flags);
+
+    static Mesh load(std::string_view path);
+};
+
+#endif // CG_SEM5_OBJLOADER_H
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include "occlusionculler.h"
+#include "simd.h"
+
+using namespace std::string_literals;
+
+void OcclusionCuller::set_occluders(const std::vector<const StaticMesh*> &meshes)
+{
+    occluders.clear();
+    occluder_positions.clear();
+
+    for(auto mesh : meshes)
+    {
+        if(!mesh->has_cpu_geometry())
+            throw std::runtime_error("Occluder \""s + mesh->get_id() + "\" has no CPU geometry");
+
+        // Instances share the triangles of their resources
+        auto [positions, is_inserted] = occluder_positions.try_emplace(mesh->get_resources().get());
+        if(is_inserted)
+        {
+            auto &vertices = mesh->get_vertices();
+            auto &indices  = mesh->get_indices();
+            for(auto &&part : mesh->get_parts())
+                for(MeshElementIndex i = part.index_base, end = part.index_base + part.index_count; i < end; ++i)
+                    positions->second.push_back(vertices[indices[i]].position);
+        }
+
+        occluders.push_back({ mesh, &positions->second });
+    }
+
+    occluder_triangles.resize(occluders.size());
+}
+
+void OcclusionCuller::cull(const glm::mat4 &view_projection, std::vector<FrustumCuller::Draw> &draws)
+{
+    auto time_start = std::chrono::high_resolution_clock::now();
+
+    statistics = {};
+    if(occluders.empty() || draws.empty())
+        return;
+
+    statistics.occluders = occluders.size();
+
+    setup_triangles(view_projection);
+    rasterize();
+
+    // Draws of one mesh are together, so its box is tested once for all of them
+    groups.clear();
+    for(size_t i = 0, draws_count = draws.size(); i < draws_count; ++i)
+        if(i == 0 || draws[i].entity != draws[i - 1].entity)
+            groups.push_back(i);
+
+    groups.push_back(draws.size());
+    occluded.assign(draws.size(), 0);
+
+    std::atomic<size_t> tested(0);
+    tbb::parallel_for
+    (
+        tbb::blocked_range<size_t>(0, groups.size() - 1),
+        [&](const tbb::blocked_range<size_t> &range)
+        {
+            size_t range_tested = 0;
+            for(size_t i = range.begin(); i != range.end(); ++i)
+            {
+                size_t first = groups[i];
+                size_t last  = groups[i + 1];
+
+                auto mesh = draws[first].mesh;
+                glm::mat4 model_view_projection = view_projection * mesh->get_model_matrix();
+
+                ++range_tested;
+                if(!is_visible(mesh->get_bounding_box(), model_view_projection))
+                {
+                    std::fill(occluded.begin() + first, occluded.begin() + last, 1);
+                    continue;
+                }
+
+                // A single part has about the box of its mesh
+                auto &parts = mesh->get_parts();
+                if(parts.size() == 1)
+                    continue;
+
+                for(size_t j = first; j < last; ++j)
+                {
+                    ++range_tested;
+                    occluded[j] = is_visible(parts[draws[j].part].bounding_box, model_view_projection)? 0 : 1;
+                }
+            }
+
+            tested += range_tested;
+        }
+    );
+
+    size_t kept = 0;
+    for(size_t i = 0, draws_count = draws.size(); i < draws_count; ++i)
+        if(!occluded[i])
+            draws[kept++] = draws[i];
+
+    statistics.tested   = tested;
+    statistics.rejected = draws.size() - kept;
+    draws.erase(draws.begin() + kept, draws.end());
+
+    auto time_end = std::chrono::high_resolution_clock::now();
+    statistics.time = std::chrono::duration<double, std::milli>(time_end - time_start).count();
+}
+
+const OcclusionCuller::Statistics &OcclusionCuller::get_statistics() const
+{
+    return statistics;
+}
+
+bool OcclusionCuller::setup_triangle(const glm::mat4 &model_view_projection, const glm::vec3 *positions, Triangle &triangle)
+{
+    glm::vec2 screen[3];
+    triangle.depth = std::numeric_limits<float>::lowest();
+
+    for(int i = 0; i < 3; ++i)
+    {
+        glm::vec4 clip = model_view_projection * glm::vec4(positions[i], 1.f);
+
+        // Triangles reaching in front of the near plane are left out, the GPU clips away what would be
+        // rasterized of them here. Fewer occluders only reject less
+        if(clip.w < MIN_W || clip.z < -clip.w)
+            return false;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        screen[i] = glm::vec2((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+        triangle.depth = std::max(triangle.depth, ndc.z);
+    }
+
+    glm::vec2 screen_min = glm::min(screen[0], glm::min(screen[1], screen[2]));
+    glm::vec2 screen_max = glm::max(screen[0], glm::max(screen[1], screen[2]));
+
+    // Pixels with centers inside the bounds
+    glm::vec2 min_pixel = glm::ceil(screen_min - 0.5f);
+    glm::vec2 max_pixel = glm::floor(screen_max - 0.5f);
+    if(min_pixel.x > max_pixel.x || min_pixel.y > max_pixel.y)
+        return false;
+
+    if(max_pixel.x < 0.f || max_pixel.y < 0.f || min_pixel.x > WIDTH - 1 || min_pixel.y > HEIGHT - 1)
+        return false;
+
+    float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y)
+               - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+
+    if(area == 0.f)
+        return false;
+
+    // Both windings occlude
+    if(area < 0.f)
+        std::swap(screen[1], screen[2]);
+
+    for(int i = 0; i < 3; ++i)
+    {
+        auto &a = screen[i];
+        auto &b = screen[(i + 1) % 3];
+
+        triangle.edge_x[i]      = a.y - b.y;
+        triangle.edge_y[i]      = b.x - a.x;
+        triangle.edge_offset[i] = -(triangle.edge_x[i] * a.x + triangle.edge_y[i] * a.y);
+    }
+
+    triangle.min_x = static_cast<int32_t>(std::max(min_pixel.x, 0.f));
+    triangle.min_y = static_cast<int32_t>(std::max(min_pixel.y, 0.f));
+    triangle.max_x = static_cast<int32_t>(std::min(max_pixel.x, static_cast<float>(WIDTH - 1)));
+    triangle.max_y = static_cast<int32_t>(std::min(max_pixel.y, static_cast<float>(HEIGHT - 1)));
+
+    return true;
+}
+
+void OcclusionCuller::setup_triangles(const glm::mat4 &view_projection)
+{
+    tbb::parallel_for
+    (
+        tbb::blocked_range<size_t>(0, occluders.size(), 1),
+        [&](const tbb::blocked_range<size_t> &range)
+        {
+            for(size_t i = range.begin(); i != range.end(); ++i)
+            {
+                auto &[mesh, positions] = occluders[i];
+                auto &mesh_triangles = occluder_triangles[i];
+                mesh_triangles.clear();
+
+                glm::mat4 model_view_projection = view_projection * mesh->get_model_matrix();
+
+                Triangle triangle;
+                for(size_t j = 0, positions_count = positions->size(); j < positions_count; j += 3)
+                    if(setup_triangle(model_view_projection, &(*positions)[j], triangle))
+                        mesh_triangles.push_back(triangle);
+            }
+        }
+    );
+
+    triangles.clear();
+    for(auto &&mesh_triangles : occluder_triangles)
+        triangles.insert(triangles.end(), mesh_triangles.begin(), mesh_triangles.end());
+
+    statistics.triangles = triangles.size();
+}
+
+void OcclusionCuller::rasterize()
+{
+    depth.resize(WIDTH * HEIGHT);
+    bins.resize(TILES_X * TILES_Y);
+    for(auto &&bin : bins)
+        bin.clear();
+
+    for(uint32_t i = 0, triangles_count = static_cast<uint32_t>(triangles.size()); i < triangles_count; ++i)
+    {
+        auto &triangle = triangles[i];
+        for(uint32_t y = triangle.min_y / TILE_HEIGHT, max_y = triangle.max_y / TILE_HEIGHT; y <= max_y; ++y)
+            for(uint32_t x = triangle.min_x / TILE_WIDTH, max_x = triangle.max_x / TILE_WIDTH; x <= max_x; ++x)
+                bins[y * TILES_X + x].push_back(i);
+    }
+
+    // Tiles don't share pixels
+    tbb::parallel_for
+    (
+        tbb::blocked_range<uint32_t>(0, TILES_X * TILES_Y, 1),
+        [this](const tbb::blocked_range<uint32_t> &range)
+        {
+            for(uint32_t tile = range.begin(); tile != range.end(); ++tile)
+                rasterize_tile(tile);
+        }
+    );
+}
+
+void OcclusionCuller::rasterize_tile(uint32_t tile)
+{
+    int32_t tile_x = static_cast<int32_t>(tile % TILES_X * TILE_WIDTH);
+    int32_t tile_y = static_cast<int32_t>(tile / TILES_X * TILE_HEIGHT);
+
+    for(int32_t y = tile_y; y < tile_y + static_cast<int32_t>(TILE_HEIGHT); ++y)
+        std::fill_n(depth.begin() + y * WIDTH + tile_x, TILE_WIDTH, std::numeric_limits<float>::max());
+
+    for(auto index : bins[tile])
+    {
+        auto &triangle = triangles[index];
+
+        // Rows start at a multiple of SIMD_WIDTH, so the last lanes never leave the tile
+        int32_t min_x = std::max(triangle.min_x, tile_x) / static_cast<int32_t>(SIMD_WIDTH) * static_cast<int32_t>(SIMD_WIDTH);
+        int32_t max_x = std::min(triangle.max_x, tile_x + static_cast<int32_t>(TILE_WIDTH) - 1);
+        int32_t min_y = std::max(triangle.min_y, tile_y);
+        int32_t max_y = std::min(triangle.max_y, tile_y + static_cast<int32_t>(TILE_HEIGHT) - 1);
+
+        for(int32_t y = min_y; y <= max_y; ++y)
+        {
+            float *row = &depth[y * WIDTH];
+            glm::vec3 row_edges = triangle.edge_y * (static_cast<float>(y) + 0.5f) + triangle.edge_offset;
+
+            int32_t x = min_x;
+
+#ifdef CG_SEM5_SSE
+            const __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            const __m128 triangle_depth = _mm_set1_ps(triangle.depth);
+
+            for(; x <= max_x; x += SIMD_WIDTH)
+            {
+                __m128 pixel_x = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane_offsets);
+                __m128 inside  = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+                for(int i = 0; i < 3; ++i)
+                {
+                    __m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edge_x[i]), pixel_x), _mm_set1_ps(row_edges[i]));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, _mm_setzero_ps()));
+                }
+
+                __m128 old_depth = _mm_loadu_ps(row + x);
+                __m128 new_depth = _mm_min_ps(old_depth, triangle_depth);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+            }
+#endif // CG_SEM5_SSE
+
+            for(; x <= max_x; ++x)
+            {
+                glm::vec3 edges = triangle.edge_x * (static_cast<float>(x) + 0.5f) + row_edges;
+                if(edges.x >= 0.f && edges.y >= 0.f && edges.z >= 0.f)
+                    row[x] = std::min(row[x], triangle.depth);
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::is_visible(const BoundingBox &box, const glm::mat4 &model_view_projection) const
+{
+    glm::vec2 screen_min(std::numeric_limits<float>::max());
+    glm::vec2 screen_max(std::numeric_limits<float>::lowest());
+    float nearest = std::numeric_limits<float>::max();
+
+    for(int i = 0; i < 8; ++i)
+    {
+        glm::vec3 corner
+        (
+            (i & 1)? box.max.x : box.min.x,
+            (i & 2)? box.max.y : box.min.y,
+            (i & 4)? box.max.z : box.min.z
+        );
+
+        glm::vec4 clip = model_view_projection * glm::vec4(corner, 1.f);
+
+        // Boxes reaching behind the viewer may cover the whole screen
+        if(clip.w < MIN_W)
+            return true;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        glm::vec2 screen((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT);
+
+        screen_min = glm::min(screen_min, screen);
+        screen_max = glm::max(screen_max, screen);
+        nearest    = std::min(nearest, ndc.z);
+    }
+
+    // Pixels next to the bounds are tested too, so boxes between pixel centers still touch some
+    glm::vec2 min_pixel = glm::max(glm::floor(screen_min - 0.5f), glm::vec2(0.f));
+    glm::vec2 max_pixel = glm::min(glm::ceil(screen_max - 0.5f), glm::vec2(WIDTH - 1, HEIGHT - 1));
+
+    // Outside of the screen, the frustum culler decides
+    if(min_pixel.x > max_pixel.x || min_pixel.y > max_pixel.y)
+        return true;
+
+    int32_t min_x = static_cast<int32_t>(min_pixel.x) / static_cast<int32_t>(SIMD_WIDTH) * static_cast<int32_t>(SIMD_WIDTH);
+    int32_t max_x = static_cast<int32_t>(max_pixel.x);
+    int32_t min_y = static_cast<int32_t>(min_pixel.y);
+    int32_t max_y = static_cast<int32_t>(max_pixel.y);
+
+    for(int32_t y = min_y; y <= max_y; ++y)
+    {
+        const float *row = &depth[y * WIDTH];
+        int32_t x = min_x;
+
+#ifdef CG_SEM5_SSE
+        // Extra lanes past max_x stay in the row and can only keep the box
+        const __m128 box_depth = _mm_set1_ps(nearest);
+        for(; x <= max_x; x += SIMD_WIDTH)
+            if(_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), box_depth)) != 0)
+                return true;
+#endif // CG_SEM5_SSE
+
+        for(; x <= max_x; ++x)
+            if(row[x] >= nearest)
+                return true;
+    }
+
+    return false;
+}
\ No newline at end of file
@@ -0,0 +1,84 @@
+#ifndef CG_SEM5_OCCLUSIONCULLER_H
+#define CG_SEM5_OCCLUSIONCULLER_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "staticmesh.h"
+#include "frustumculler.h"
+
+// Software occlusion test of draws against a coarse depth buffer. Occluder triangles are binned into tiles
+// rasterized on worker threads, four pixels at a time. A pixel keeps the farthest vertex depth of the nearest
+// covering triangle, so a box is rejected only when it is behind occluders over every pixel it touches
+class OcclusionCuller
+{
+public:
+    static constexpr uint32_t WIDTH       = 320;
+    static constexpr uint32_t HEIGHT      = 192;
+    static constexpr uint32_t TILE_WIDTH  = 32;
+    static constexpr uint32_t TILE_HEIGHT = 32;
+
+    struct Statistics
+    {
+        size_t occluders = 0;
+        size_t triangles = 0;   // Rasterized ones
+        size_t tested    = 0;   // Boxes of meshes and parts
+        size_t rejected  = 0;   // Draws
+        double time      = 0.0; // Milliseconds
+    };
+
+    // Copies the full resolution triangles of the meshes, which must have their CPU geometry.
+    // Meshes are referenced until the next call
+    void set_occluders(const std::vector<const StaticMesh*> &);
+
+    // Removes occluded draws, the rest keep their order
+    void cull(const glm::mat4 &view_projection, std::vector<FrustumCuller::Draw> &draws);
+
+    // Of the last cull
+    const Statistics &get_statistics() const;
+
+private:
+    static constexpr size_t   SIMD_WIDTH = 4;
+    static constexpr uint32_t TILES_X    = WIDTH / TILE_WIDTH;
+    static constexpr uint32_t TILES_Y    = HEIGHT / TILE_HEIGHT;
+    static constexpr float    MIN_W      = 1e-5f;
+
+    struct Occluder
+    {
+        const StaticMesh *mesh;
+        const std::vector<glm::vec3> *positions; // Mesh space, three per triangle
+    };
+
+    // Edge functions of pixel centers are non negative inside
+    struct Triangle
+    {
+        glm::vec3 edge_x, edge_y, edge_offset;
+        float     depth;
+        int32_t   min_x, min_y, max_x, max_y; // Covered pixels, inclusive
+    };
+
+    static bool setup_triangle(const glm::mat4 &model_view_projection, const glm::vec3 *positions, Triangle &);
+
+    void setup_triangles(const glm::mat4 &view_projection);
+    void rasterize();
+    void rasterize_tile(uint32_t tile);
+    bool is_visible(const BoundingBox &, const glm::mat4 &model_view_projection) const;
+
+    std::unordered_map<const StaticMesh::Resources*, std::vector<glm::vec3>> occluder_positions;
+    std::vector<Occluder> occluders;
+
+    std::vector<std::vector<Triangle>> occluder_triangles; // Set up in parallel, one list per occluder
+    std::vector<Triangle> triangles;
+    std::vector<std::vector<uint32_t>> bins; // Triangles overlapping every tile
+    std::vector<float> depth;                // Row by row
+
+    std::vector<size_t> groups; // First draw of every mesh and the draw count
+    std::vector<uint8_t> occluded;
+    Statistics statistics;
+};
+
+#endif // CG_SEM5_OCCLUSIONCULLER_H
\ No newline at end of file
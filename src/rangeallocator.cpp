@@ -0,0 +1,100 @@
+#include <cassert>
+#include <iterator>
+
+#include "rangeallocator.h"
+
+RangeAllocator::RangeAllocator(size_t capacity)
+: capacity(0), used_size(0), free_ranges()
+{
+    grow(capacity);
+}
+
+std::optional<size_t> RangeAllocator::allocate(size_t size)
+{
+    if(size == 0)
+        return std::nullopt;
+
+    for(auto it = free_ranges.begin(); it != free_ranges.end(); ++it)
+    {
+        if(it->second < size)
+            continue;
+
+        size_t offset = it->first;
+        size_t rest   = it->second - size;
+
+        free_ranges.erase(it);
+        if(rest > 0)
+            free_ranges.emplace(offset + size, rest);
+
+        used_size += size;
+        return offset;
+    }
+
+    return std::nullopt;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+    if(size == 0)
+        return;
+
+    assert(offset + size <= capacity);
+    used_size -= size;
+
+    auto next = free_ranges.lower_bound(offset);
+    if(next != free_ranges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = free_ranges.erase(next);
+    }
+
+    if(next != free_ranges.begin())
+    {
+        auto previous = std::prev(next);
+        if(previous->first + previous->second == offset)
+        {
+            previous->second += size;
+            return;
+        }
+    }
+
+    free_ranges.emplace(offset, size);
+}
+
+void RangeAllocator::grow(size_t new_capacity)
+{
+    if(new_capacity <= capacity)
+        return;
+
+    size_t old_capacity = capacity;
+    size_t added = new_capacity - capacity;
+
+    capacity   = new_capacity;
+    used_size += added; // free() subtracts it back
+    free(old_capacity, added);
+}
+
+size_t RangeAllocator::get_capacity() const
+{
+    return capacity;
+}
+
+size_t RangeAllocator::get_used_size() const
+{
+    return used_size;
+}
+
+size_t RangeAllocator::get_first_free_offset() const
+{
+    return free_ranges.empty()? capacity : free_ranges.begin()->first;
+}
+
+bool RangeAllocator::is_fragmented() const
+{
+    if(free_ranges.empty())
+        return false;
+
+    // A single free range reaching the end of the arena is just unused capacity
+    auto last = std::prev(free_ranges.end());
+    return free_ranges.size() > 1 || last->first + last->second != capacity;
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#ifndef CG_SEM5_RANGEALLOCATOR_H
+#define CG_SEM5_RANGEALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+#include <optional>
+
+// First-fit allocator of [offset, offset + size) ranges, adjacent free ranges are coalesced
+class RangeAllocator
+{
+public:
+    RangeAllocator(size_t capacity = 0);
+
+    std::optional<size_t> allocate(size_t size);
+    void free(size_t offset, size_t size);
+
+    // New space is appended as a free range
+    void grow(size_t new_capacity);
+
+    size_t get_capacity() const;
+    size_t get_used_size() const;
+
+    // Offset of the first free range or capacity if there is none
+    size_t get_first_free_offset() const;
+
+    // Free space in front of the last allocation
+    bool is_fragmented() const;
+
+private:
+    size_t capacity;
+    size_t used_size;
+
+    std::map<size_t, size_t> free_ranges; // offset -> size
+};
+
+#endif // CG_SEM5_RANGEALLOCATOR_H
\ No newline at end of file
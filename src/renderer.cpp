@@ -1,9 +1,13 @@
 #include <fstream>
+#include <iomanip>
 #include <sstream>
 #include <chrono>
 #include <cstdlib>
 #include <thread>
 #include <iostream>
+#include <cmath>
+#include <algorithm>
+#include <unordered_set>
 
 #include "renderer.h"
 #include "vkassert.h"
@@ -50,10 +54,26 @@ VKAPI_ATTR VkBool32 VKAPI_CALL message_callback
     void*                      user_data
 );
 
-Renderer::Renderer(std::string_view application_name, Window &window, VulkanValidationMode mode)
+// Projected bounding sphere radius in pixels of the viewport height
+float get_screen_radius(const StaticMesh &, const Camera &, uint32_t viewport_height);
+
+bool is_instance_extension_supported(std::string_view extension);
+
+Renderer::Renderer
+(
+    std::string_view application_name,
+    Window &window,
+    VulkanValidationMode mode,
+    VertexStreamLayout vertex_layout,
+    GeometryResidency geometry_residency,
+    MaterialBinding material_binding
+)
 : AbstractRenderer(window), 
 application_name(application_name.data()), 
 validation_mode(mode),
+vertex_layout(vertex_layout),
+geometry_residency(geometry_residency),
+material_binding(material_binding),
 debug_report(),
 instance(VK_NULL_HANDLE),
 device(),
@@ -93,8 +113,19 @@ descriptor_set_layouts
     VK_NULL_HANDLE
 }),
 scene_descriptor_set(VK_NULL_HANDLE),
-vertex_buffer(std::make_shared<DeviceBuffer>()),
-index_buffer(std::make_shared<DeviceBuffer>()),
+bindless_texture_capacity(0),
+bindless_descriptor_set(VK_NULL_HANDLE),
+bindless_materials(std::make_shared<DeviceBuffer>()),
+bindless_material_indices(),
+bindless_texture_indices(),
+geometry_heap(),
+static_mesh_geometry(),
+residency_callback(),
+pick_callback(),
+is_geometry_compaction_pending(false),
+compaction_command_buffer(VK_NULL_HANDLE),
+texture_streaming_command_buffer(VK_NULL_HANDLE),
+texture_streaming_fence(VK_NULL_HANDLE),
 uniform_buffers
 ({
     std::make_shared<DeviceBuffer>(),
@@ -103,8 +134,24 @@ uniform_buffers
 dynamic_uniform_alignment(0),
 static_uniform_data(),
 dynamic_uniform_data(),
+static_mesh_ranges(),
+actor_lods(),
+meshlet_indirect_buffer(std::make_shared<DeviceBuffer>()),
+actor_meshlet_offsets(),
+meshlet_cullers(),
+frustum(),
+spatial_index(),
+static_mesh_proxies(),
+visible_entities(),
+visible_meshes(),
+frustum_culler(),
+occlusion_culler(),
+draw_list(),
+culled_draws(),
+is_draw_list_outdated(true),
 vertex_info
 ({
+    {},
     {}
 }),
 shader_stages(),
@@ -114,8 +161,17 @@ pipeline_layouts
 }),
 pipelines
 ({
+    VK_NULL_HANDLE,
+    VK_NULL_HANDLE,
     VK_NULL_HANDLE
 }),
+virtual_texture_feedback(),
+asset_loader(),
+pending_static_meshes(),
+static_batcher(),
+static_batch_sources(),
+static_batches(),
+scenegraph(nullptr),
 controller(7.5f, 0.5f),
 last_mouse_position(0.f),
 is_rotation_active(false)
@@ -131,6 +187,10 @@ Renderer::~Renderer()
     vkDeviceWaitIdle(*device);
     free_debugging();
 
+    pending_static_meshes.clear();
+    asset_loader.reset();
+    virtual_texture_feedback.reset();
+
     swapchain.cleanup();
 
     if(descriptor_pool != VK_NULL_HANDLE)
@@ -156,9 +216,12 @@ Renderer::~Renderer()
 
 	vkDestroySemaphore(*device, semaphores.present_complete, nullptr);
 	vkDestroySemaphore(*device, semaphores.render_complete, nullptr);
+    vkDestroyFence(*device, texture_streaming_fence, nullptr);
 
-    vertex_buffer.reset();
-    index_buffer.reset();
+    static_mesh_geometry.clear();
+    geometry_heap.reset();
+    meshlet_indirect_buffer.reset();
+    bindless_materials.reset();
     uniform_buffers.static_uniform.reset();
     uniform_buffers.dynamic_uniform.reset();
     device.reset();
@@ -177,7 +240,15 @@ void Renderer::render()
         view_changed();
     }
 
+    update_pending_meshes();
+    compact_geometry();
+    update_lods();
+    update_visibility();
+    update_meshlet_visibility();
+    update_texture_streaming();
+    update_virtual_textures();
     draw();
+    release_compaction_command_buffer();
     ++frame_counter;
 
     auto time_end = high_resolution_clock::now();
@@ -189,8 +260,9 @@ void Renderer::render()
     
     update_dynamic_uniform();
     update_static_uniform();
+    update_spatial_index();
 
-    for(auto &&actor : actors_container.get_actors())
+    for(auto &&actor : scene_components.get_actors())
         actor->mark_unchanged();
 
     timer += timer_speed * frame_timer;
@@ -201,7 +273,35 @@ void Renderer::render()
     if(fps_timer > 1000.0)
     {
         last_fps = static_cast<uint32_t>(static_cast<double>(frame_counter) * (1000.0 / fps_timer));
-        window.set_title(application_name + " fps: " + std::to_string(last_fps));
+
+        auto &culling_statistics = frustum_culler.get_statistics();
+
+        std::string title = application_name + " fps: " + std::to_string(last_fps)
+                          + " draws: " + std::to_string(culling_statistics.visible) + "/" + std::to_string(culling_statistics.tested)
+                          + " tris: " + std::to_string(culling_statistics.triangles);
+
+        auto &occlusion_statistics = occlusion_culler.get_statistics();
+        if(occlusion_statistics.occluders > 0)
+        {
+            std::ostringstream occlusion_title;
+            occlusion_title << std::fixed << std::setprecision(1)
+                            << " occluded: " << occlusion_statistics.rejected
+                            << " (" << occlusion_statistics.time << " ms)";
+            title += occlusion_title.str();
+        }
+
+        if(!asset_loader->get_virtual_texture_cache().empty())
+        {
+            auto statistics = asset_loader->get_virtual_texture_cache().take_statistics();
+            std::ostringstream virtual_texture_title;
+            virtual_texture_title << std::fixed << std::setprecision(1)
+                                  << " vt hits: " << 100.f * statistics.hit_rate << "%"
+                                  << " faults: " << statistics.page_faults
+                                  << " latency: " << statistics.page_fault_latency << " ms";
+            title += virtual_texture_title.str();
+        }
+
+        window.set_title(title);
 
         fps_timer     = 0.0;
         frame_counter = 0;
@@ -279,10 +379,58 @@ void Renderer::initialize_vulkan()
 
     VkPhysicalDeviceFeatures enabled_features = {};
     enabled_features.textureCompressionBC = true;
+    enabled_features.multiDrawIndirect    = device->features.multiDrawIndirect;
+
+    std::vector<const char*> device_extensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
+    // Textures are indexed by a push constant, so dynamically uniform indexing is enough
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features = {};
+    descriptor_indexing_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+    if(material_binding == MaterialBinding::BINDLESS)
+    {
+        device->query_descriptor_indexing(instance);
+
+        auto &supported  = device->descriptor_indexing_features;
+        auto &properties = device->descriptor_indexing_properties;
+
+        bindless_texture_capacity = std::min
+        ({
+            MAX_BINDLESS_TEXTURES,
+            properties.maxPerStageDescriptorUpdateAfterBindSamplers,
+            properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            properties.maxDescriptorSetUpdateAfterBindSamplers,
+            properties.maxDescriptorSetUpdateAfterBindSampledImages
+        });
+
+        if
+        (
+            supported.runtimeDescriptorArray &&
+            supported.descriptorBindingPartiallyBound &&
+            supported.descriptorBindingSampledImageUpdateAfterBind &&
+            bindless_texture_capacity > 0
+        )
+        {
+            descriptor_indexing_features.runtimeDescriptorArray                       = VK_TRUE;
+            descriptor_indexing_features.descriptorBindingPartiallyBound              = VK_TRUE;
+            descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
+            device_extensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+            device_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        }
+        else
+            material_binding = MaterialBinding::DESCRIPTOR_SETS;
+    }
 
     vk_assert
     (
-        device->initialize_logical_device(enabled_features, { VK_KHR_SWAPCHAIN_EXTENSION_NAME }),
+        device->initialize_logical_device
+        (
+            enabled_features,
+            device_extensions,
+            VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT,
+            is_bindless_enabled()? &descriptor_indexing_features : nullptr
+        ),
         "Can't create logical device"
     );
 
@@ -307,6 +455,15 @@ void Renderer::initialize_vulkan()
         "Can't create semaphore for present"
     );
 
+    VkFenceCreateInfo fence_create_info = {};
+    fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    vk_assert
+    (
+        vkCreateFence(*device, &fence_create_info, nullptr, &texture_streaming_fence),
+        "Can't create fence for texture streaming"
+    );
+
     submit_pipeline_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
     submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -315,6 +472,9 @@ void Renderer::initialize_vulkan()
     submit_info.pWaitSemaphores      = &semaphores.present_complete;
     submit_info.signalSemaphoreCount = 1;
     submit_info.pSignalSemaphores    = &semaphores.render_complete;
+
+    asset_loader  = std::make_unique<AssetLoader>(device, queue);
+    geometry_heap = std::make_unique<GeometryHeap>(device, vertex_layout, GEOMETRY_HEAP_VERTEX_CAPACITY, GEOMETRY_HEAP_INDEX_CAPACITY);
 }
 
 void Renderer::create_instance()
@@ -341,6 +501,15 @@ void Renderer::create_instance()
     if(validation_mode == VulkanValidationMode::ENABLED)
         instance_extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 
+    // Descriptor indexing features can only be queried through it
+    if(material_binding == MaterialBinding::BINDLESS)
+    {
+        if(is_instance_extension_supported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+            instance_extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        else
+            material_binding = MaterialBinding::DESCRIPTOR_SETS;
+    }
+
     VkInstanceCreateInfo create_info = {};
     create_info.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     create_info.pApplicationInfo     = &app_info;
@@ -575,10 +744,14 @@ void Renderer::create_pipeline_cache()
 
 void Renderer::prepare(SceneGraph &scenegraph)
 {
+    this->scenegraph = &scenegraph;
+
     create_static_mesh_vertex_descriptions();
 
     {
-        scenegraph.accept_down(static_meshes);
+        scenegraph.accept_down(scene_components);
+        setup_occluders();
+        batch_static_meshes();
         setup_descriptor_pool();
     }
 
@@ -589,8 +762,7 @@ void Renderer::prepare(SceneGraph &scenegraph)
     }
 
     {
-        scenegraph.accept_down(actors_container);
-        scenegraph.accept_down(camera_selector);
+        actor_lods.assign(scene_components.size(), 0);
     
         setup_uniform_buffers();
         setup_scene_descriptors();
@@ -599,16 +771,65 @@ void Renderer::prepare(SceneGraph &scenegraph)
     {
         setup_materials_descriptors();
         setup_static_mesh_buffer();
+        setup_meshlet_indirect_buffer();
+        setup_spatial_index();
+        setup_virtual_texture_feedback();
     }
 
     create_pipelines();
-    fill_command_buffers();
 
-    controller.set_actor(camera_selector.get_current_camera());
+    is_draw_list_outdated = true;
+    update_visibility();
+
+    // The scene has a camera, uniform setup throws otherwise
+    controller.set_actor(scene_components.get_owner(scene_components.get_cameras().front()));
 
     is_prepared = true;
 }
 
+void Renderer::rebuild_scene()
+{
+    vk_assert
+    (
+        vkQueueWaitIdle(queue),
+        "Can't wait queue before scene rebuild"
+    );
+
+    vkDestroyDescriptorPool(*device, descriptor_pool, nullptr);
+    descriptor_pool = VK_NULL_HANDLE;
+
+    if(is_bindless_enabled())
+        bindless_materials->destroy();
+
+    scene_components.clear();
+    scenegraph->accept_down(scene_components);
+    setup_occluders();
+    batch_static_meshes();
+    actor_lods.assign(scene_components.size(), 0);
+
+    // New uniform buffers start zeroed, so everything has to be written again
+    for(auto &&actor : scene_components.get_actors())
+        actor->mark_changed();
+
+    aligned_free(dynamic_uniform_data.models);
+    dynamic_uniform_data.models = nullptr;
+    uniform_buffers.static_uniform->destroy();
+    uniform_buffers.dynamic_uniform->destroy();
+    meshlet_indirect_buffer->destroy();
+
+    setup_descriptor_pool();
+    setup_uniform_buffers();
+    setup_scene_descriptors();
+    setup_materials_descriptors();
+    setup_static_mesh_buffer();
+    setup_meshlet_indirect_buffer();
+    setup_spatial_index();
+
+    // Draws point to the old entities
+    is_draw_list_outdated = true;
+    update_visibility();
+}
+
 void Renderer::prepare_frame()
 {
     VkResult err = swapchain.acquire_next_image(semaphores.present_complete, &current_buffer);
@@ -723,14 +944,23 @@ void Renderer::free_debugging()
 
 void Renderer::create_static_mesh_vertex_descriptions()
 {
-
-    vertex_info.static_mesh.binding_descriptions.resize(1);
+    bool is_split = vertex_layout == VertexStreamLayout::SPLIT_POSITIONS;
+    uint32_t attributes_binding = is_split? STATIC_MESH_ATTRIBUTES_BUFFER_ID : STATIC_MESH_BUFFER_ID;
+    uint32_t attributes_offset  = is_split? 0 : static_cast<uint32_t>(GeometryHeap::POSITION_STREAM_STRIDE);
 
     VkVertexInputBindingDescription input_binding_description = {};
     input_binding_description.binding   = STATIC_MESH_BUFFER_ID;
-    input_binding_description.stride    = sizeof(StaticMesh::Vertex);
+    input_binding_description.stride    = is_split? static_cast<uint32_t>(GeometryHeap::POSITION_STREAM_STRIDE) : sizeof(StaticMesh::Vertex);
     input_binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    vertex_info.static_mesh.binding_descriptions[0] = input_binding_description;
+    vertex_info.static_mesh.binding_descriptions = { input_binding_description };
+    vertex_info.depth_only.binding_descriptions  = { input_binding_description };
+
+    if(is_split)
+    {
+        input_binding_description.binding = STATIC_MESH_ATTRIBUTES_BUFFER_ID;
+        input_binding_description.stride  = static_cast<uint32_t>(GeometryHeap::ATTRIBUTE_STREAM_STRIDE);
+        vertex_info.static_mesh.binding_descriptions.push_back(input_binding_description);
+    }
 
     VkVertexInputAttributeDescription attribute_description = {};
     vertex_info.static_mesh.attribute_descriptions.resize(4);
@@ -741,34 +971,38 @@ void Renderer::create_static_mesh_vertex_descriptions()
     attribute_description.format   = VK_FORMAT_R32G32B32_SFLOAT;
     attribute_description.offset   = 0;
     vertex_info.static_mesh.attribute_descriptions[0] = attribute_description;
+    vertex_info.depth_only.attribute_descriptions = { attribute_description };
 
     // Normal (loc = 1)
     attribute_description.location = 1;
-    attribute_description.binding  = STATIC_MESH_BUFFER_ID;
+    attribute_description.binding  = attributes_binding;
     attribute_description.format   = VK_FORMAT_R32G32B32_SFLOAT;
-    attribute_description.offset   = sizeof(float) * 3;
+    attribute_description.offset   = attributes_offset;
     vertex_info.static_mesh.attribute_descriptions[1] = attribute_description;
 
     // UV (loc = 2)
     attribute_description.location = 2;
-    attribute_description.binding  = STATIC_MESH_BUFFER_ID;
+    attribute_description.binding  = attributes_binding;
     attribute_description.format   = VK_FORMAT_R32G32_SFLOAT;
-    attribute_description.offset   = sizeof(float) * 6;
+    attribute_description.offset   = attributes_offset + sizeof(float) * 3;
     vertex_info.static_mesh.attribute_descriptions[2] = attribute_description;
 
     // Color (loc = 3)
     attribute_description.location = 3;
-    attribute_description.binding  = STATIC_MESH_BUFFER_ID;
+    attribute_description.binding  = attributes_binding;
     attribute_description.format   = VK_FORMAT_R32G32B32_SFLOAT;
-    attribute_description.offset   = sizeof(float) * 8;
+    attribute_description.offset   = attributes_offset + sizeof(float) * 5;
     vertex_info.static_mesh.attribute_descriptions[3] = attribute_description;
 
-    vertex_info.static_mesh.input_state = {};
-    vertex_info.static_mesh.input_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertex_info.static_mesh.input_state.vertexBindingDescriptionCount   = static_cast<uint32_t>(vertex_info.static_mesh.binding_descriptions.size());
-    vertex_info.static_mesh.input_state.pVertexBindingDescriptions      = vertex_info.static_mesh.binding_descriptions.data();
-    vertex_info.static_mesh.input_state.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertex_info.static_mesh.attribute_descriptions.size());
-    vertex_info.static_mesh.input_state.pVertexAttributeDescriptions    = vertex_info.static_mesh.attribute_descriptions.data();
+    for(auto input : { &vertex_info.static_mesh, &vertex_info.depth_only })
+    {
+        input->input_state = {};
+        input->input_state.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        input->input_state.vertexBindingDescriptionCount   = static_cast<uint32_t>(input->binding_descriptions.size());
+        input->input_state.pVertexBindingDescriptions      = input->binding_descriptions.data();
+        input->input_state.vertexAttributeDescriptionCount = static_cast<uint32_t>(input->attribute_descriptions.size());
+        input->input_state.pVertexAttributeDescriptions    = input->attribute_descriptions.data();
+    }
 }
 
 void Renderer::create_pipelines()
@@ -783,7 +1017,7 @@ void Renderer::create_pipelines()
     VkPipelineRasterizationStateCreateInfo rasterization_create_info = {};
     rasterization_create_info.sType            = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterization_create_info.polygonMode      = VK_POLYGON_MODE_FILL;
-    rasterization_create_info.cullMode         = VK_CULL_MODE_NONE; // !
+    rasterization_create_info.cullMode         = STATIC_MESH_CULL_MODE;
     rasterization_create_info.frontFace        = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterization_create_info.flags            = 0;
     rasterization_create_info.depthClampEnable = VK_FALSE;
@@ -801,7 +1035,7 @@ void Renderer::create_pipelines()
     VkPipelineDepthStencilStateCreateInfo depth_stencil_create_info = {};
     depth_stencil_create_info.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
     depth_stencil_create_info.depthTestEnable  = VK_TRUE;
-    depth_stencil_create_info.depthWriteEnable = VK_TRUE;
+    depth_stencil_create_info.depthWriteEnable = is_depth_prepass_enabled()? VK_FALSE : VK_TRUE; // Prepass already wrote it
     depth_stencil_create_info.depthCompareOp   = VK_COMPARE_OP_LESS_OR_EQUAL;
     depth_stencil_create_info.front            = depth_stencil_create_info.back;
     depth_stencil_create_info.back.compareOp   = VK_COMPARE_OP_ALWAYS;
@@ -830,7 +1064,11 @@ void Renderer::create_pipelines()
     dynamic_state_create_info.flags             = 0;
 
     shader_stages[0] = device->load_shader("resources/shaders/static_mesh.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
-    shader_stages[1] = device->load_shader("resources/shaders/static_mesh.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT);
+    shader_stages[1] = device->load_shader
+    (
+        is_bindless_enabled()? "resources/shaders/static_mesh_bindless.frag.spv" : "resources/shaders/static_mesh.frag.spv",
+        VK_SHADER_STAGE_FRAGMENT_BIT
+    );
 
     VkGraphicsPipelineCreateInfo pipeline_create_info = {};
     pipeline_create_info.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -861,6 +1099,65 @@ void Renderer::create_pipelines()
         vkCreateGraphicsPipelines(*device, pipeline_cache, 1, &pipeline_create_info, nullptr, &pipelines.static_mesh),
         "Can't create graphics pipeline for static meshes"
     );
+
+    // Virtual texture feedback: page table entries go into an integer target, which can't be blended
+    std::array<VkPipelineShaderStageCreateInfo, 2> feedback_stages =
+    {
+        shader_stages[0],
+        device->load_shader
+        (
+            is_bindless_enabled()? "resources/shaders/virtual_feedback_bindless.frag.spv" : "resources/shaders/virtual_feedback.frag.spv",
+            VK_SHADER_STAGE_FRAGMENT_BIT
+        )
+    };
+
+    blend_attachment_state = {};
+    blend_attachment_state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT;
+
+    depth_stencil_create_info.depthWriteEnable = VK_TRUE;
+
+    pipeline_create_info.renderPass = virtual_texture_feedback->get_render_pass();
+    pipeline_create_info.pStages    = feedback_stages.data();
+
+    vk_assert
+    (
+        vkCreateGraphicsPipelines(*device, pipeline_cache, 1, &pipeline_create_info, nullptr, &pipelines.virtual_feedback),
+        "Can't create virtual texture feedback pipeline"
+    );
+
+    pipeline_create_info.renderPass = renderpass;
+
+    if(!is_depth_prepass_enabled())
+        return;
+
+    // Depth prepass: positions only, no fragment shader and no color writes
+    VkPipelineShaderStageCreateInfo depth_only_stage = device->load_shader("resources/shaders/depth_only.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+
+    blend_attachment_state = {};
+    blend_attachment_state.colorWriteMask = 0;
+
+    depth_stencil_create_info.depthWriteEnable = VK_TRUE;
+    depth_stencil_create_info.depthCompareOp   = VK_COMPARE_OP_LESS;
+
+    pipeline_create_info.pVertexInputState = &vertex_info.depth_only.input_state;
+    pipeline_create_info.stageCount        = 1;
+    pipeline_create_info.pStages           = &depth_only_stage;
+
+    vk_assert
+    (
+        vkCreateGraphicsPipelines(*device, pipeline_cache, 1, &pipeline_create_info, nullptr, &pipelines.depth_prepass),
+        "Can't create depth prepass pipeline"
+    );
+}
+
+bool Renderer::is_depth_prepass_enabled() const
+{
+    return vertex_layout == VertexStreamLayout::SPLIT_POSITIONS;
+}
+
+bool Renderer::is_bindless_enabled() const
+{
+    return material_binding == MaterialBinding::BINDLESS;
 }
 
 void Renderer::fill_command_buffers()
@@ -892,6 +1189,23 @@ void Renderer::fill_command_buffers()
             "Can't begin draw buffer"
         );
 
+        // Buffers stay bound for every pass
+        auto &vertex_buffers = geometry_heap->get_vertex_buffers();
+        for(uint32_t j = 0; j < vertex_buffers.size(); ++j)
+        {
+            VkDeviceSize offsets[1] = { 0 };
+            vkCmdBindVertexBuffers(draw_command_buffers[i], STATIC_MESH_BUFFER_ID + j, 1, &vertex_buffers[j]->buffer, offsets);
+        }
+
+        vkCmdBindIndexBuffer(draw_command_buffers[i], *geometry_heap->get_index_buffer(), 0, VK_INDEX_TYPE_UINT32);
+
+        if(!asset_loader->get_virtual_texture_cache().empty())
+        {
+            virtual_texture_feedback->begin(draw_command_buffers[i]);
+            record_static_meshes(draw_command_buffers[i], pipelines.virtual_feedback, false);
+            virtual_texture_feedback->end(draw_command_buffers[i]);
+        }
+
         vkCmdBeginRenderPass(draw_command_buffers[i], &renderpass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
 
         VkViewport viewport = {};
@@ -910,51 +1224,125 @@ void Renderer::fill_command_buffers()
 
         // Draw static meshes
         /////////////////////
-        if(vertex_buffer->size != 0 && index_buffer->size != 0)
-        {
-            VkDeviceSize offsets[1] = { 0 };
-            vkCmdBindVertexBuffers(draw_command_buffers[i], STATIC_MESH_BUFFER_ID, 1, &vertex_buffer->buffer, offsets);
-            vkCmdBindIndexBuffer(draw_command_buffers[i], index_buffer->buffer, 0, VK_INDEX_TYPE_UINT32);
-        }
+        if(is_depth_prepass_enabled())
+            record_static_meshes(draw_command_buffers[i], pipelines.depth_prepass, true);
 
-        std::array<VkDescriptorSet, 2> descriptor_sets;
-        descriptor_sets[0] = scene_descriptor_set;
+        record_static_meshes(draw_command_buffers[i], pipelines.static_mesh, false);
+        /////////////////////
+
+        vkCmdEndRenderPass(draw_command_buffers[i]);
 
-        auto &actors = actors_container.get_actors();
-        size_t model_matrix_index = 0;
+        vk_assert
+        (
+            vkEndCommandBuffer(draw_command_buffers[i]),
+            "Can't finish draw command buffer"
+        );
+    }
+}
 
-        for(auto &&actor : actors)
+void Renderer::record_static_meshes(VkCommandBuffer command_buffer, VkPipeline pipeline, bool is_depth_only)
+{
+    std::array<VkDescriptorSet, 2> descriptor_sets;
+    descriptor_sets[0] = scene_descriptor_set;
+    descriptor_sets[1] = bindless_descriptor_set;
+
+    // Position-only pass needs neither the material set nor the push constants
+    uint32_t descriptor_sets_count = is_depth_only? 1 : static_cast<uint32_t>(descriptor_sets.size());
+    auto &virtual_texture_cache = asset_loader->get_virtual_texture_cache();
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+    // Draws of one actor are adjacent and in part order
+    const StaticMesh *mesh = nullptr;
+    const StaticMeshRange *range = nullptr;
+    uint32_t lod = 0;
+    uint32_t dynamic_offset = 0;
+    uint32_t next_part = 0;
+    size_t meshlet_offset = 0;
+    bool are_actor_sets_bound = false;
+
+    for(auto &&draw : draw_list)
+    {
+        if(draw.mesh != mesh)
         {
-            if(auto mesh = std::dynamic_pointer_cast<StaticMesh>(actor))
-            {
-                auto &materials = mesh->get_materials();
-                auto &parts = mesh->get_parts();
-                for(size_t j = 0, materials_count = materials.size(); j < materials_count; ++j)
-                {
-                    descriptor_sets[1] = materials[j].descriptor_set;
+            mesh           = draw.mesh;
+            range          = &static_mesh_ranges.at(mesh->get_resources().get());
+            lod            = actor_lods[draw.entity];
+            next_part      = 0;
+            meshlet_offset = actor_meshlet_offsets[draw.entity];
+
+            // Bindless materials don't change the sets, only the model matrix offset changes per actor
+            dynamic_offset = draw.entity * static_cast<uint32_t>(dynamic_uniform_alignment);
+            if(is_bindless_enabled())
+                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layouts.static_mesh, 0, descriptor_sets_count, descriptor_sets.data(), 1, &dynamic_offset);
+
+            are_actor_sets_bound = false;
+        }
 
-                    vkCmdBindPipeline(draw_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.static_mesh);
+        // Meshlet commands of culled parts are skipped
+        auto &parts = mesh->get_parts();
+        for(; next_part < draw.part; ++next_part)
+            meshlet_offset += parts[next_part].meshlets.size();
 
-                    uint32_t dynamic_offset = static_cast<uint32_t>(model_matrix_index) * static_cast<uint32_t>(dynamic_uniform_alignment);
-                    vkCmdBindDescriptorSets(draw_command_buffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layouts.static_mesh, 0, static_cast<uint32_t>(descriptor_sets.size()), descriptor_sets.data(), 1, &dynamic_offset);
+        ++next_part;
 
-                    vkCmdPushConstants(draw_command_buffers[i], pipeline_layouts.static_mesh, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(StaticMesh::MaterialProperties), &materials[j].properties);
+        auto &part = parts[draw.part];
+        auto &material = *part.material;
+        auto &lod_range = part.lods[std::min(lod, static_cast<uint32_t>(part.lods.size() - 1))];
 
-                    vkCmdDrawIndexed(draw_command_buffers[i], parts[j].index_count, 1, 0, parts[j].index_base, 0);
-                }
+        if(is_bindless_enabled())
+        {
+            if(!is_depth_only)
+            {
+                uint32_t material_index = bindless_material_indices.at(&material);
+                vkCmdPushConstants(command_buffer, pipeline_layouts.static_mesh, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(material_index), &material_index);
+            }
+        }
+        else
+        {
+            // Parts whose textures are packed into one array keep the bound sets
+            if(!are_actor_sets_bound || descriptor_sets[1] != material.descriptor_set)
+            {
+                are_actor_sets_bound = true;
+                descriptor_sets[1]   = material.descriptor_set;
+                vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layouts.static_mesh, 0, descriptor_sets_count, descriptor_sets.data(), 1, &dynamic_offset);
             }
 
-            ++model_matrix_index;
+            if(!is_depth_only)
+            {
+                MaterialConstants constants =
+                {
+                    material.properties,
+                    material.diffuse_region,
+                    virtual_texture_cache.get_page_table_offset(material.virtual_diffuse.get())
+                };
+                vkCmdPushConstants(command_buffer, pipeline_layouts.static_mesh, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+            }
         }
-        /////////////////////
 
-        vkCmdEndRenderPass(draw_command_buffers[i]);
+        if(lod == 0 && !part.meshlets.empty() && meshlet_indirect_buffer->size != 0)
+        {
+            VkDeviceSize command_offset = meshlet_offset * sizeof(VkDrawIndexedIndirectCommand);
+            uint32_t meshlets_count = static_cast<uint32_t>(part.meshlets.size());
+
+            if(device->enabled_features.multiDrawIndirect)
+                vkCmdDrawIndexedIndirect(command_buffer, *meshlet_indirect_buffer, command_offset, meshlets_count, sizeof(VkDrawIndexedIndirectCommand));
+            else
+                for(uint32_t k = 0; k < meshlets_count; ++k)
+                    vkCmdDrawIndexedIndirect(command_buffer, *meshlet_indirect_buffer, command_offset + k * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+        }
+        else
+            vkCmdDrawIndexed
+            (
+                command_buffer,
+                lod_range.index_count,
+                1,
+                range->first_index + lod_range.index_base,
+                range->vertex_offset,
+                0
+            );
 
-        vk_assert
-        (
-            vkEndCommandBuffer(draw_command_buffers[i]),
-            "Can't finish draw command buffer"
-        );
+        meshlet_offset += part.meshlets.size();
     }
 }
 
@@ -966,10 +1354,10 @@ void Renderer::setup_static_mesh_pipeline_layout()
         descriptor_set_layouts.static_mesh_material
     };
 
-    // Use push constants to pass material properties to the fragment shader
+    // Use push constants to pass material properties, or the index of the bindless material, to the fragment shader
     VkPushConstantRange push_constant_range = {};
     push_constant_range.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-    push_constant_range.size       = sizeof(StaticMesh::MaterialProperties);
+    push_constant_range.size       = is_bindless_enabled()? sizeof(uint32_t) : sizeof(MaterialConstants);
     push_constant_range.offset     = 0;
 
     VkPipelineLayoutCreateInfo layout_create_info = {};
@@ -1015,12 +1403,20 @@ void Renderer::setup_scene_descriptors()
     models_descriptor.dstBinding      = 1;
     models_descriptor.pBufferInfo     = &uniform_buffers.dynamic_uniform->descriptor;
     models_descriptor.descriptorCount = 1;
-    
+
+    VkWriteDescriptorSet page_table_descriptor = {};
+    page_table_descriptor.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    page_table_descriptor.dstSet          = scene_descriptor_set;
+    page_table_descriptor.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    page_table_descriptor.dstBinding      = 2;
+    page_table_descriptor.pBufferInfo     = &asset_loader->get_virtual_texture_cache().get_page_table()->descriptor;
+    page_table_descriptor.descriptorCount = 1;
 
     std::vector<VkWriteDescriptorSet> write_descriptor_sets = 
     {
         projection_view_descriptor,
-        models_descriptor
+        models_descriptor,
+        page_table_descriptor
     };
 
     vkUpdateDescriptorSets(*device, static_cast<uint32_t>(write_descriptor_sets.size()), write_descriptor_sets.data(), 0, nullptr);
@@ -1028,12 +1424,31 @@ void Renderer::setup_scene_descriptors()
 
 void Renderer::setup_materials_descriptors()
 {
-    auto &meshes = static_meshes.get_meshes();
-    for(auto &&mesh : meshes)
+    if(is_bindless_enabled())
+    {
+        setup_bindless_materials();
+        return;
+    }
+
+    // Instances share materials and materials with one texture share a set, packed textures share their array
+    std::unordered_set<const StaticMesh::Resources*> described;
+    std::unordered_map<const Texture*, VkDescriptorSet> texture_sets;
+
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
     {
+        if(!described.insert(mesh->get_resources().get()).second)
+            continue;
+
         auto &materials = mesh->get_materials();
         for(size_t i = 0, materials_count = materials.size(); i < materials_count; ++i)
         {
+            auto texture_set = texture_sets.find(materials[i].diffuse.get());
+            if(texture_set != texture_sets.end())
+            {
+                const_cast<VkDescriptorSet&>(materials[i].descriptor_set) = texture_set->second;
+                continue;
+            }
+
             VkDescriptorSetAllocateInfo allocate_info = {};
             allocate_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
             allocate_info.descriptorPool     = descriptor_pool;
@@ -1046,6 +1461,8 @@ void Renderer::setup_materials_descriptors()
                 "Can't allocate descriptor sets for materials"
             );
 
+            texture_sets.emplace(materials[i].diffuse.get(), materials[i].descriptor_set);
+
             VkWriteDescriptorSet write_descriptor = {};
             write_descriptor.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
             write_descriptor.dstSet          = const_cast<VkDescriptorSet&>(materials[i].descriptor_set);
@@ -1063,183 +1480,491 @@ void Renderer::setup_materials_descriptors()
     }
 }
 
-void Renderer::setup_static_mesh_buffer()
+void Renderer::setup_bindless_materials()
 {
-    auto &meshes = static_meshes.get_meshes();
-    std::vector<StaticMesh::Vertex> vertices;
-    std::vector<MeshElementIndex> indices;
+    std::vector<BindlessMaterial> materials;
+    std::vector<VkDescriptorImageInfo> textures;
+
+    bindless_material_indices.clear();
+    bindless_texture_indices.clear();
 
-    for(auto &&mesh : meshes)
+    // Instances share materials and materials share textures, each is stored once
+    std::unordered_set<const StaticMesh::Resources*> described;
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
     {
-        auto &mesh_vertices = mesh->get_vertices();
-        auto &mesh_indices = mesh->get_indices();
-        vertices.insert(vertices.end(), mesh_vertices.begin(), mesh_vertices.end());
-        indices.insert(indices.end(), mesh_indices.begin(), mesh_indices.end());
-    }
+        if(!described.insert(mesh->get_resources().get()).second)
+            continue;
+
+        for(auto &&material : mesh->get_materials())
+        {
+            auto texture = bindless_texture_indices.emplace(material.diffuse.get(), static_cast<uint32_t>(textures.size()));
+            if(texture.second)
+                textures.push_back(material.diffuse->descriptor);
 
-    uint32_t vertex_data_size = static_cast<uint32_t>(vertices.size()) * sizeof(StaticMesh::Vertex);
-    uint32_t index_data_size = static_cast<uint32_t>(indices.size()) * sizeof(MeshElementIndex);
+            bindless_material_indices.emplace(&material, static_cast<uint32_t>(materials.size()));
+            materials.push_back
+            (
+                BindlessMaterial
+                {
+                    material.properties,
+                    material.diffuse_region,
+                    texture.first->second,
+                    asset_loader->get_virtual_texture_cache().get_page_table_offset(material.virtual_diffuse.get())
+                }
+            );
+        }
+    }
 
-    if(vertex_data_size == 0 || index_data_size == 0)
-        return;
+    if(textures.size() > bindless_texture_capacity)
+        throw std::runtime_error("Can't fit " + std::to_string(textures.size()) + " textures into bindless materials");
 
-    auto vertex_staging = std::make_shared<DeviceBuffer>();
-    auto index_staging = std::make_shared<DeviceBuffer>();
+    // The buffer can't be empty, shaders don't read the placeholder
+    if(materials.empty())
+        materials.emplace_back();
 
     vk_assert
     (
         device->create_buffer
         (
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-            vertex_staging, 
-            vertex_data_size, 
-            vertices.data()
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            bindless_materials,
+            materials.size() * sizeof(BindlessMaterial),
+            materials.data()
         ),
-        "Can't create staging buffer for static mesh vertices"
+        "Can't create buffer for bindless materials"
     );
 
-    vk_assert
-    (
-        device->create_buffer
-        (        
-            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            vertex_buffer,
-            vertex_data_size
-        ),
-        "Can't create target buffer for static mesh vertices"
-    );
+    VkDescriptorSetAllocateInfo allocate_info = {};
+    allocate_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocate_info.descriptorPool     = descriptor_pool;
+    allocate_info.pSetLayouts        = &descriptor_set_layouts.static_mesh_material;
+    allocate_info.descriptorSetCount = 1;
 
     vk_assert
     (
-        device->create_buffer
-        (
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-            index_staging, 
-            index_data_size, 
-            indices.data()
-        ),
-        "Can't create staging buffer for static mesh indices"
+        vkAllocateDescriptorSets(*device, &allocate_info, &bindless_descriptor_set),
+        "Can't allocate descriptor set for bindless materials"
     );
 
-    vk_assert
-    (
-        device->create_buffer
-        (        
-            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            index_buffer,
-            index_data_size
-        ),
-        "Can't create target buffer for static mesh vertices"
-    );
+    VkWriteDescriptorSet textures_descriptor = {};
+    textures_descriptor.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    textures_descriptor.dstSet          = bindless_descriptor_set;
+    textures_descriptor.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    textures_descriptor.dstBinding      = 0;
+    textures_descriptor.pImageInfo      = textures.data();
+    textures_descriptor.descriptorCount = static_cast<uint32_t>(textures.size());
+
+    VkWriteDescriptorSet materials_descriptor = {};
+    materials_descriptor.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    materials_descriptor.dstSet          = bindless_descriptor_set;
+    materials_descriptor.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    materials_descriptor.dstBinding      = 1;
+    materials_descriptor.pBufferInfo     = &bindless_materials->descriptor;
+    materials_descriptor.descriptorCount = 1;
+
+    std::vector<VkWriteDescriptorSet> write_descriptor_sets = { materials_descriptor };
+    if(!textures.empty())
+        write_descriptor_sets.push_back(textures_descriptor);
 
-    // Copy from staging to target
-    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    vkUpdateDescriptorSets(*device, static_cast<uint32_t>(write_descriptor_sets.size()), write_descriptor_sets.data(), 0, nullptr);
+}
 
-    VkCommandBufferBeginInfo begin_info = {};
-    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    
-    vk_assert
-    (
-        vkBeginCommandBuffer(copy_cmd, &begin_info),
-        "Can't copy data from staging to target"
-    );
+void Renderer::batch_static_meshes()
+{
+    std::vector<std::shared_ptr<StaticMesh>> sources;
+    for(auto &&component : scene_components.get_static_meshes())
+        if(component.node->get_mobility() == Mobility::STATIC)
+            sources.push_back(scene_components.get_owner(component));
 
-    VkBufferCopy copy_region = {};
-    copy_region.size = vertex_data_size;
-    vkCmdCopyBuffer
-    (
-        copy_cmd,
-        *vertex_staging,
-        *vertex_buffer,
-        1,
-        &copy_region
-    );
+    if(sources != static_batch_sources)
+    {
+        std::vector<StaticMesh*> released;
+        for(auto &&mesh : sources)
+            released.push_back(mesh.get());
 
-    copy_region.size = index_data_size;
-    vkCmdCopyBuffer
-    (
-        copy_cmd,
-        *index_staging,
-        *index_buffer,
-        1,
-        &copy_region
-    );
+        asset_loader->restore_cpu_geometry(released);
 
-    vk_assert
-    (
-        vkEndCommandBuffer(copy_cmd),
-        "Can't finish copying from staging to target"
-    );
+        static_batches = static_batcher.build(sources);
+        static_batch_sources = sources;
 
-    VkSubmitInfo submit_info = {};
-    submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers    = &copy_cmd;
+        // Sources are never uploaded themselves
+        if(geometry_residency == GeometryResidency::RELEASE_AFTER_UPLOAD)
+            for(auto &&mesh : sources)
+                mesh->release_cpu_geometry();
+    }
 
-    vk_assert
-    (
-        vkQueueSubmit(queue, 1, &submit_info, VK_NULL_HANDLE),
-        "Can't submit copy command to queue"
-    );
+    std::unordered_set<const Actor*> batched;
+    for(auto &&mesh : sources)
+        batched.insert(mesh.get());
 
-    vk_assert
-    (
-        vkQueueWaitIdle(queue),
-        "Can't wait copy queue"
-    );
+    scene_components.remove(batched);
 
-    // TODO: fence
+    for(auto &&batch : static_batches)
+        scene_components.add(*batch);
 }
 
-void Renderer::setup_uniform_buffers()
+void Renderer::setup_static_mesh_buffer()
 {
-    size_t min_alignment = device->properties.limits.minUniformBufferOffsetAlignment;
-    dynamic_uniform_alignment = sizeof(glm::mat4);
-    if(min_alignment > 0)
-        dynamic_uniform_alignment = (dynamic_uniform_alignment + min_alignment - 1) & ~(min_alignment - 1);
+    auto &meshes = scene_components.get_static_meshes();
 
-    size_t actors_count = actors_container.get_actors().size();
-    if(actors_count == 0)
-        throw std::runtime_error("No actors in scene graph");
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
 
-    size_t buffer_size = actors_count * dynamic_uniform_alignment;
+    std::unordered_set<const StaticMesh::Resources*> scene_resources;
+    for(auto &&[entity, mesh] : meshes)
+        scene_resources.insert(mesh->get_resources().get());
 
-    dynamic_uniform_data.models = static_cast<glm::mat4*>(aligned_allocate(buffer_size, dynamic_uniform_alignment));
-    assert(dynamic_uniform_data.models != nullptr);
+    // Meshes that left the scene give their ranges back
+    for(auto it = static_mesh_geometry.begin(); it != static_mesh_geometry.end();)
+    {
+        auto resources = it->second.resources.lock();
+        bool is_in_scene = resources && scene_resources.count(resources.get()) > 0;
 
-    vk_assert
-    (
-        device->create_buffer
-        (
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-            uniform_buffers.static_uniform,
-            sizeof(static_uniform_data)
-        ),
-        "Can't create buffer for static uniform"
-    );
+        if(is_in_scene)
+        {
+            ++it;
+            continue;
+        }
 
-    vk_assert
-    (
-        device->create_buffer
-        (
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-            uniform_buffers.dynamic_uniform,
-            buffer_size
-        ),
-        "Can't create buffer for dynamic uniform"
-    );
+        geometry_heap->free(it->second.handle);
+        it = static_mesh_geometry.erase(it);
+        is_geometry_compaction_pending = true;
 
-    vk_assert
-    (
-        uniform_buffers.static_uniform->map(),
-        "Can't map memory on static uniform"
-    );
+        if(resources && residency_callback)
+            residency_callback(*resources, ResidencyEvent::EVICTED);
+    }
+
+    std::vector<StaticMesh*> released;
+    for(auto &&[entity, mesh] : meshes)
+        if(static_mesh_geometry.find(mesh->get_resources().get()) == static_mesh_geometry.end() && !mesh->has_cpu_geometry())
+            released.push_back(mesh);
+
+    asset_loader->restore_cpu_geometry(released);
+
+    if(residency_callback)
+    {
+        std::unordered_set<const StaticMesh::Resources*> restored;
+        for(auto mesh : released)
+            if(restored.insert(mesh->get_resources().get()).second)
+                residency_callback(*mesh->get_resources(), ResidencyEvent::CPU_COPY_RESTORED);
+    }
+
+    std::vector<StaticMesh*> uploaded;
+    for(auto &&[entity, mesh] : meshes)
+    {
+        auto &resources = mesh->get_resources();
+        if(static_mesh_geometry.find(resources.get()) != static_mesh_geometry.end())
+            continue;
+
+        static_mesh_geometry[resources.get()] = { resources, geometry_heap->upload(*mesh, copy_cmd) };
+        uploaded.push_back(mesh);
+    }
+
+    device->end_command_buffer(copy_cmd);
+    device->flush_command_buffer(copy_cmd, queue);
+    vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+
+    geometry_heap->release_transient_buffers();
+
+    // Upload fence has signaled, device copies are complete
+    for(auto &&mesh : uploaded)
+    {
+        auto &resources = *mesh->get_resources();
+        if(residency_callback)
+            residency_callback(resources, ResidencyEvent::UPLOADED);
+
+        bool is_released = geometry_residency == GeometryResidency::RELEASE_AFTER_UPLOAD && mesh->release_cpu_geometry();
+        if(is_released && residency_callback)
+            residency_callback(resources, ResidencyEvent::CPU_COPY_RELEASED);
+    }
+
+    update_static_mesh_ranges();
+}
+
+void Renderer::update_static_mesh_ranges()
+{
+    static_mesh_ranges.clear();
+    for(auto &&[resources, geometry] : static_mesh_geometry)
+    {
+        auto &allocation = geometry_heap->get_allocation(geometry.handle);
+        static_mesh_ranges[resources] = { static_cast<int32_t>(allocation.vertex_offset), allocation.first_index };
+    }
+}
+
+void Renderer::compact_geometry()
+{
+    // The submitted copies are waited for by the end of the frame
+    if(!is_prepared || !is_geometry_compaction_pending || !geometry_heap->is_fragmented())
+        return;
+
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
+
+    bool is_moved = geometry_heap->compact(copy_cmd, GEOMETRY_COMPACTION_MOVES_PER_FRAME);
+
+    // Nothing fits into the remaining holes until the next free
+    if(!is_moved)
+    {
+        device->end_command_buffer(copy_cmd);
+        vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+        is_geometry_compaction_pending = false;
+        return;
+    }
+
+    // Submissions on one queue are ordered by the barrier, so the frame reads the moved geometry
+    VkMemoryBarrier barrier = {};
+    barrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+    vkCmdPipelineBarrier
+    (
+        copy_cmd,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+        0,
+        1, &barrier,
+        0, nullptr,
+        0, nullptr
+    );
+
+    device->end_command_buffer(copy_cmd);
+
+    VkSubmitInfo compaction_submit_info = {};
+    compaction_submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    compaction_submit_info.commandBufferCount = 1;
+    compaction_submit_info.pCommandBuffers    = &copy_cmd;
+
+    vk_assert
+    (
+        vkQueueSubmit(queue, 1, &compaction_submit_info, VK_NULL_HANDLE),
+        "Can't submit geometry compaction"
+    );
+
+    compaction_command_buffer = copy_cmd;
+
+    // Draw buffers aren't in flight, the queue is idle after every frame
+    auto previous_ranges = std::move(static_mesh_ranges);
+    update_static_mesh_ranges();
+
+    std::unordered_set<const StaticMesh::Resources*> moved;
+    for(auto &&[resources, range] : static_mesh_ranges)
+    {
+        auto previous = previous_ranges.find(resources);
+        bool is_moved = previous == previous_ranges.end()
+                     || previous->second.vertex_offset != range.vertex_offset
+                     || previous->second.first_index != range.first_index;
+
+        if(is_moved)
+            moved.insert(resources);
+    }
+
+    patch_meshlet_commands(moved);
+
+    // Only draws recorded with the offsets themselves need rerecording, it's done once by update_visibility
+    for(auto &&draw : draw_list)
+    {
+        if(moved.count(draw.mesh->get_resources().get()) == 0)
+            continue;
+
+        auto &part = draw.mesh->get_parts()[draw.part];
+        bool is_indirect = actor_lods[draw.entity] == 0 && !part.meshlets.empty() && meshlet_indirect_buffer->size != 0;
+        if(!is_indirect)
+        {
+            is_draw_list_outdated = true;
+            break;
+        }
+    }
+}
+
+void Renderer::release_compaction_command_buffer()
+{
+    if(compaction_command_buffer == VK_NULL_HANDLE)
+        return;
+
+    // The frame waited for the queue
+    vkFreeCommandBuffers(*device, command_pool, 1, &compaction_command_buffer);
+    compaction_command_buffer = VK_NULL_HANDLE;
+}
+
+void Renderer::setup_meshlet_indirect_buffer()
+{
+    std::vector<VkDrawIndexedIndirectCommand> commands;
+    actor_meshlet_offsets.assign(scene_components.size(), 0);
+    meshlet_cullers.clear();
+
+    // Only static meshes read their offsets
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        actor_meshlet_offsets[entity] = commands.size();
+
+        auto resources = mesh->get_resources().get();
+        meshlet_cullers.emplace(resources, *mesh);
+
+        auto &range = static_mesh_ranges.at(resources);
+        for(auto &&part : mesh->get_parts())
+            for(auto &&meshlet : part.meshlets)
+            {
+                VkDrawIndexedIndirectCommand command = {};
+                command.indexCount    = meshlet.index_count;
+                command.instanceCount = 1;
+                command.firstIndex    = range.first_index + meshlet.index_base;
+                command.vertexOffset  = range.vertex_offset;
+                command.firstInstance = 0;
+                commands.push_back(command);
+            }
+    }
+
+    if(commands.empty())
+        return;
+
+    vk_assert
+    (
+        device->create_buffer
+        (
+            VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            meshlet_indirect_buffer,
+            commands.size() * sizeof(VkDrawIndexedIndirectCommand),
+            commands.data()
+        ),
+        "Can't create meshlet indirect buffer"
+    );
+
+    vk_assert
+    (
+        meshlet_indirect_buffer->map(),
+        "Can't map meshlet indirect buffer"
+    );
+}
+
+void Renderer::patch_meshlet_commands(const std::unordered_set<const StaticMesh::Resources*> &resources)
+{
+    if(resources.empty() || meshlet_indirect_buffer->mapped_memory == nullptr)
+        return;
+
+    auto commands = static_cast<VkDrawIndexedIndirectCommand*>(meshlet_indirect_buffer->mapped_memory);
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        auto mesh_resources = mesh->get_resources().get();
+        if(resources.count(mesh_resources) == 0)
+            continue;
+
+        auto &range = static_mesh_ranges.at(mesh_resources);
+        auto command = commands + actor_meshlet_offsets[entity];
+        for(auto &&part : mesh->get_parts())
+            for(auto &&meshlet : part.meshlets)
+            {
+                command->firstIndex   = range.first_index + meshlet.index_base;
+                command->vertexOffset = range.vertex_offset;
+                ++command;
+            }
+    }
+}
+
+void Renderer::setup_spatial_index()
+{
+    spatial_index.clear();
+    static_mesh_proxies.clear();
+
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        auto box = transform_bounding_box(mesh->get_bounding_box(), mesh->get_model_matrix());
+        static_mesh_proxies.push_back(spatial_index.insert(box, entity));
+    }
+}
+
+void Renderer::setup_occluders()
+{
+    // Before batching, batches mix occluders with everything else in their cells
+    std::vector<const StaticMesh*> occluders;
+    std::vector<StaticMesh*> restored;
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        if(!mesh->is_occluder())
+            continue;
+
+        if(!mesh->has_cpu_geometry())
+            restored.push_back(mesh);
+
+        occluders.push_back(mesh);
+    }
+
+    asset_loader->restore_cpu_geometry(restored);
+
+    // The culler keeps its own copy of the triangles
+    occlusion_culler.set_occluders(occluders);
+
+    for(auto mesh : restored)
+        mesh->release_cpu_geometry();
+}
+
+void Renderer::update_spatial_index()
+{
+    auto &meshes = scene_components.get_static_meshes();
+    for(size_t i = 0, meshes_count = meshes.size(); i < meshes_count; ++i)
+    {
+        auto &mesh = *meshes[i].node;
+        if(mesh.is_changed())
+            spatial_index.move(static_mesh_proxies[i], transform_bounding_box(mesh.get_bounding_box(), mesh.get_model_matrix()));
+    }
+}
+
+void Renderer::setup_virtual_texture_feedback()
+{
+    // Created up front, virtual textures can arrive with meshes loaded later
+    if(virtual_texture_feedback)
+        return;
+
+    virtual_texture_feedback = std::make_unique<VirtualTextureFeedback>(device, width, height, depth_format);
+}
+
+void Renderer::setup_uniform_buffers()
+{
+    size_t min_alignment = device->properties.limits.minUniformBufferOffsetAlignment;
+    dynamic_uniform_alignment = sizeof(glm::mat4);
+    if(min_alignment > 0)
+        dynamic_uniform_alignment = (dynamic_uniform_alignment + min_alignment - 1) & ~(min_alignment - 1);
+
+    size_t actors_count = scene_components.size();
+    if(actors_count == 0)
+        throw std::runtime_error("No actors in scene graph");
+
+    size_t buffer_size = actors_count * dynamic_uniform_alignment;
+
+    dynamic_uniform_data.models = static_cast<glm::mat4*>(aligned_allocate(buffer_size, dynamic_uniform_alignment));
+    assert(dynamic_uniform_data.models != nullptr);
+
+    vk_assert
+    (
+        device->create_buffer
+        (
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
+            uniform_buffers.static_uniform,
+            sizeof(static_uniform_data)
+        ),
+        "Can't create buffer for static uniform"
+    );
+
+    vk_assert
+    (
+        device->create_buffer
+        (
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            uniform_buffers.dynamic_uniform,
+            buffer_size
+        ),
+        "Can't create buffer for dynamic uniform"
+    );
+
+    vk_assert
+    (
+        uniform_buffers.static_uniform->map(),
+        "Can't map memory on static uniform"
+    );
 
     vk_assert
     (
@@ -1253,12 +1978,12 @@ void Renderer::setup_uniform_buffers()
 
 void Renderer::update_static_uniform()
 {
-    auto camera = camera_selector.get_current_camera();
-    if(!camera->is_changed())
+    auto &camera = get_current_camera();
+    if(!camera.is_changed())
         return;
 
-    static_uniform_data.projection = camera->get_perspective_matrix();
-    static_uniform_data.view       = camera->get_model_matrix();
+    static_uniform_data.projection = camera.get_perspective_matrix();
+    static_uniform_data.view       = camera.get_model_matrix();
 
     std::memcpy(uniform_buffers.static_uniform->mapped_memory, &static_uniform_data, sizeof(static_uniform_data));
 }
@@ -1266,7 +1991,7 @@ void Renderer::update_static_uniform()
 void Renderer::update_dynamic_uniform()
 {
     bool at_least_one_changed = false;
-    auto &actors = actors_container.get_actors();
+    auto &actors = scene_components.get_actors();
     for(size_t i = 0, actors_count = actors.size(); i < actors_count; ++i)
     {
         if(actors[i]->is_changed())
@@ -1299,18 +2024,39 @@ void Renderer::setup_descriptor_pool()
     std::vector<VkDescriptorPoolSize> pool_sizes = 
     {
         VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         1 },
-        VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 }
+        VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+        VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1 } // Virtual texture page table
     };
 
-    uint32_t samplers_count = static_cast<uint32_t>(static_meshes.get_meshes().size());
-    if(samplers_count > 0)
-        pool_sizes.push_back(VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, samplers_count });
-
     VkDescriptorPoolCreateInfo pool_create_info = {};
-    pool_create_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    pool_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+
+    if(is_bindless_enabled())
+    {
+        // One set with the whole texture array and the materials buffer
+        pool_sizes.push_back(VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, bindless_texture_capacity });
+        pool_sizes.push_back(VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1 });
+
+        pool_create_info.flags   = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+        pool_create_info.maxSets = 2;
+    }
+    else
+    {
+        // One descriptor set with one sampler per material, instances share them
+        uint32_t samplers_count = 0;
+        std::unordered_set<const StaticMesh::Resources*> counted;
+        for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+            if(counted.insert(mesh->get_resources().get()).second)
+                samplers_count += static_cast<uint32_t>(mesh->get_materials().size());
+
+        if(samplers_count > 0)
+            pool_sizes.push_back(VkDescriptorPoolSize { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, samplers_count });
+
+        pool_create_info.maxSets = samplers_count + 1; // + 1 for uniforms and the page table on one DescriptorSet
+    }
+
     pool_create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
     pool_create_info.pPoolSizes    = pool_sizes.data();
-    pool_create_info.maxSets       = samplers_count + 1; // + 1 for uniforms (static and dynamic on one DescriptorSet)
 
     vk_assert
     (
@@ -1333,10 +2079,17 @@ void Renderer::setup_scene_descriptor_set_layout()
     dynamic_uniform_layout.binding         = 1;
     dynamic_uniform_layout.descriptorCount = 1;
 
+    VkDescriptorSetLayoutBinding page_table_layout = {};
+    page_table_layout.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    page_table_layout.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT;
+    page_table_layout.binding         = 2;
+    page_table_layout.descriptorCount = 1;
+
     std::vector<VkDescriptorSetLayoutBinding> layout_bindings = 
     {
         static_uniform_layout,
-        dynamic_uniform_layout
+        dynamic_uniform_layout,
+        page_table_layout
     };
 
     VkDescriptorSetLayoutCreateInfo descriptor_layout_create_info = {};
@@ -1359,7 +2112,32 @@ void Renderer::setup_materials_descriptor_set_layout()
     };
 
     VkDescriptorSetLayoutCreateInfo descriptor_layout_create_info = {};
-    descriptor_layout_create_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptor_layout_create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+    // Textures of streamed levels are written again while the set is bound by recorded draws
+    std::vector<VkDescriptorBindingFlagsEXT> binding_flags =
+    {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT,
+        0
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_create_info = {};
+    binding_flags_create_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    binding_flags_create_info.bindingCount  = static_cast<uint32_t>(binding_flags.size());
+    binding_flags_create_info.pBindingFlags = binding_flags.data();
+
+    if(is_bindless_enabled())
+    {
+        layout_bindings =
+        {
+            VkDescriptorSetLayoutBinding { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, bindless_texture_capacity, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr },
+            VkDescriptorSetLayoutBinding { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1,                         VK_SHADER_STAGE_FRAGMENT_BIT, nullptr }
+        };
+
+        descriptor_layout_create_info.pNext = &binding_flags_create_info;
+        descriptor_layout_create_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    }
+
     descriptor_layout_create_info.bindingCount = static_cast<uint32_t>(layout_bindings.size());
     descriptor_layout_create_info.pBindings    = layout_bindings.data();
 
@@ -1375,11 +2153,271 @@ void Renderer::view_changed()
     // TODO:
 }
 
+void Renderer::update_lods()
+{
+    auto &camera = get_current_camera();
+
+    bool is_lod_changed = false;
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        if(mesh->get_lod_count() < 2)
+            continue;
+
+        float screen_radius = get_screen_radius(*mesh, camera, height);
+
+        uint32_t lod = 0;
+        if(screen_radius < LOD_FULL_DETAIL_SCREEN_RADIUS)
+        {
+            float level = std::floor(std::log2(LOD_FULL_DETAIL_SCREEN_RADIUS / std::max(screen_radius, 1e-3f)));
+            lod = std::min(static_cast<uint32_t>(level), mesh->get_lod_count() - 1);
+        }
+
+        if(actor_lods[entity] != lod)
+        {
+            actor_lods[entity] = lod;
+            is_lod_changed = true;
+        }
+    }
+
+    // Rerecorded with the new draw list
+    if(is_lod_changed)
+        is_draw_list_outdated = true;
+}
+
+void Renderer::update_visibility()
+{
+    auto &camera = get_current_camera();
+    glm::mat4 view_projection = camera.get_perspective_matrix() * camera.get_model_matrix();
+    frustum.update(view_projection);
+
+    visible_entities.clear();
+    spatial_index.query(frustum, visible_entities);
+    std::sort(visible_entities.begin(), visible_entities.end());
+
+    // Both are in entity order
+    auto &meshes = scene_components.get_static_meshes();
+    visible_meshes.clear();
+    auto mesh = meshes.begin();
+    for(auto entity : visible_entities)
+    {
+        while(mesh->entity != entity)
+            ++mesh;
+
+        visible_meshes.push_back(*mesh);
+    }
+
+    frustum_culler.cull(frustum, visible_meshes, actor_lods, culled_draws);
+    occlusion_culler.cull(view_projection, culled_draws);
+    if(!is_draw_list_outdated && culled_draws == draw_list)
+        return;
+
+    draw_list.swap(culled_draws);
+    is_draw_list_outdated = false;
+
+    // Queue is idle after every submit, so prerecorded buffers are safe to rerecord here
+    fill_command_buffers();
+}
+
+void Renderer::update_meshlet_visibility()
+{
+    if(meshlet_indirect_buffer->mapped_memory == nullptr)
+        return;
+
+    // The frustum is updated by update_visibility
+    const glm::mat4 &view = get_current_camera().get_model_matrix();
+    glm::vec3 camera_position = glm::vec3(glm::inverse(view)[3]);
+
+    auto commands = static_cast<VkDrawIndexedIndirectCommand*>(meshlet_indirect_buffer->mapped_memory);
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        if(actor_lods[entity] != 0)
+            continue;
+
+        auto culler = meshlet_cullers.find(mesh->get_resources().get());
+        if(culler == meshlet_cullers.end())
+            continue;
+
+        culler->second.cull
+        (
+            frustum,
+            mesh->get_model_matrix(),
+            camera_position,
+            (STATIC_MESH_CULL_MODE & VK_CULL_MODE_BACK_BIT) != 0,
+            commands + actor_meshlet_offsets[entity]
+        );
+    }
+}
+
+void Renderer::update_texture_streaming()
+{
+    auto &texture_streamer = asset_loader->get_texture_streamer();
+
+    // Uploads submitted by an earlier frame, the views don't change while they may be executing
+    if(texture_streaming_command_buffer != VK_NULL_HANDLE)
+    {
+        VkResult status = vkGetFenceStatus(*device, texture_streaming_fence);
+        if(status == VK_NOT_READY)
+            return;
+
+        vk_assert(status, "Can't get texture streaming fence status");
+        vk_assert
+        (
+            vkResetFences(*device, 1, &texture_streaming_fence),
+            "Can't reset texture streaming fence"
+        );
+
+        vkFreeCommandBuffers(*device, command_pool, 1, &texture_streaming_command_buffer);
+        texture_streaming_command_buffer = VK_NULL_HANDLE;
+
+        update_streamed_descriptors(texture_streamer.commit());
+    }
+
+    if(texture_streamer.empty())
+        return;
+
+    // A texture mapped once across a mesh needs about one texel per pixel of its projected diameter
+    auto &camera = get_current_camera();
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        float screen_size = 2.f * get_screen_radius(*mesh, camera, height);
+        for(auto &&material : mesh->get_materials())
+        {
+            auto texture = material.diffuse.get();
+            if(texture == nullptr || material.virtual_diffuse)
+                continue;
+
+            float texture_size = static_cast<float>(std::max(texture->width, texture->height));
+            float level = std::floor(std::log2(texture_size / std::max(screen_size, 1.f)));
+            texture_streamer.request(texture, static_cast<uint32_t>(std::max(level, 0.f)), screen_size);
+        }
+    }
+
+    texture_streamer.load();
+    if(!texture_streamer.has_loaded())
+        return;
+
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
+
+    bool is_recorded = texture_streamer.record(copy_cmd);
+
+    device->end_command_buffer(copy_cmd);
+    if(!is_recorded)
+    {
+        vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+        return;
+    }
+
+    VkSubmitInfo streaming_submit_info = {};
+    streaming_submit_info.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    streaming_submit_info.commandBufferCount = 1;
+    streaming_submit_info.pCommandBuffers    = &copy_cmd;
+
+    vk_assert
+    (
+        vkQueueSubmit(queue, 1, &streaming_submit_info, texture_streaming_fence),
+        "Can't submit texture streaming"
+    );
+
+    texture_streaming_command_buffer = copy_cmd;
+}
+
+void Renderer::update_streamed_descriptors(const std::vector<const Texture2D*> &changed)
+{
+    if(changed.empty())
+        return;
+
+    std::unordered_set<const Texture*> changed_textures(changed.begin(), changed.end());
+
+    // Views were recreated, sets using them are written again and draws rerecorded
+    if(is_bindless_enabled())
+    {
+        for(auto &&texture : changed)
+        {
+            auto index = bindless_texture_indices.find(texture);
+            if(index == bindless_texture_indices.end())
+                continue;
+
+            VkWriteDescriptorSet write_descriptor = {};
+            write_descriptor.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write_descriptor.dstSet          = bindless_descriptor_set;
+            write_descriptor.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write_descriptor.dstBinding      = 0;
+            write_descriptor.dstArrayElement = index->second;
+            write_descriptor.pImageInfo      = &texture->descriptor;
+            write_descriptor.descriptorCount = 1;
+
+            vkUpdateDescriptorSets(*device, 1, &write_descriptor, 0, nullptr);
+        }
+
+        // The set and the recorded draws stay valid, only the array elements changed
+        return;
+    }
+
+    std::unordered_set<const StaticMesh::Resources*> described;
+    for(auto &&[entity, mesh] : scene_components.get_static_meshes())
+    {
+        if(!described.insert(mesh->get_resources().get()).second)
+            continue;
+
+        for(auto &&material : mesh->get_materials())
+        {
+            if(changed_textures.count(material.diffuse.get()) == 0)
+                continue;
+
+            VkWriteDescriptorSet write_descriptor = {};
+            write_descriptor.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write_descriptor.dstSet          = material.descriptor_set;
+            write_descriptor.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write_descriptor.dstBinding      = 0;
+            write_descriptor.pImageInfo      = &material.diffuse->descriptor;
+            write_descriptor.descriptorCount = 1;
+
+            vkUpdateDescriptorSets(*device, 1, &write_descriptor, 0, nullptr);
+        }
+    }
+
+    fill_command_buffers();
+}
+
+void Renderer::update_virtual_textures()
+{
+    auto &virtual_texture_cache = asset_loader->get_virtual_texture_cache();
+    if(!is_prepared || virtual_texture_cache.empty())
+        return;
+
+    // The queue is idle after every frame, so the feedback of the last one is complete
+    virtual_texture_cache.request(virtual_texture_feedback->get_data(), virtual_texture_feedback->get_size());
+
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
+
+    bool is_recorded = virtual_texture_cache.record(copy_cmd);
+
+    device->end_command_buffer(copy_cmd);
+    if(is_recorded)
+    {
+        device->flush_command_buffer(copy_cmd, queue);
+        virtual_texture_cache.commit();
+    }
+
+    vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+}
+
 void Renderer::destroy_command_buffers()
 {
     vkFreeCommandBuffers(*device, command_pool, static_cast<uint32_t>(draw_command_buffers.size()), draw_command_buffers.data());
 }
 
+Camera &Renderer::get_current_camera() const
+{
+    auto &cameras = scene_components.get_cameras();
+    if(cameras.empty())
+        throw std::runtime_error("Camera is not found");
+
+    return *cameras.front().node;
+}
+
 std::shared_ptr<Device> Renderer::get_device() const
 {
     return device;
@@ -1395,6 +2433,182 @@ VkQueue Renderer::get_queue() const
     return queue;
 }
 
+void Renderer::set_residency_callback(ResidencyCallback callback)
+{
+    residency_callback = callback;
+}
+
+void Renderer::set_pick_callback(PickCallback callback)
+{
+    pick_callback = callback;
+}
+
+AssetLoader &Renderer::get_asset_loader()
+{
+    return *asset_loader;
+}
+
+const FrustumCuller::Statistics &Renderer::get_culling_statistics() const
+{
+    return frustum_culler.get_statistics();
+}
+
+const OcclusionCuller::Statistics &Renderer::get_occlusion_statistics() const
+{
+    return occlusion_culler.get_statistics();
+}
+
+std::optional<Renderer::PickHit> Renderer::pick(int32_t x, int32_t y) const
+{
+    if(!is_prepared)
+        return std::nullopt;
+
+    // Every point of the pixel center projects through the camera position, the far plane one is used
+    auto &camera = get_current_camera();
+    glm::vec2 ndc
+    (
+        2.f * (static_cast<float>(x) + 0.5f) / static_cast<float>(width) - 1.f,
+        2.f * (static_cast<float>(y) + 0.5f) / static_cast<float>(height) - 1.f
+    );
+
+    glm::vec4 far_point = glm::inverse(camera.get_perspective_matrix() * camera.get_model_matrix()) * glm::vec4(ndc, 1.f, 1.f);
+    glm::vec3 origin    = glm::vec3(glm::inverse(camera.get_model_matrix())[3]);
+    glm::vec3 direction = glm::normalize(glm::vec3(far_point) / far_point.w - origin);
+
+    std::vector<uint32_t> entities;
+    spatial_index.raycast(origin, direction, std::numeric_limits<float>::max(), entities);
+
+    std::optional<PickHit> nearest;
+    float max_distance = std::numeric_limits<float>::max();
+
+    auto &meshes = scene_components.get_static_meshes();
+    for(auto entity : entities)
+    {
+        auto component = std::lower_bound
+        (
+            meshes.begin(),
+            meshes.end(),
+            entity,
+            [](auto &&component, uint32_t entity) { return component.entity < entity; }
+        );
+
+        auto &mesh = *component->node;
+
+        // The mesh space direction isn't normalized, so hit distances stay in world units
+        glm::mat4 inverse_model = glm::inverse(mesh.get_model_matrix());
+        auto hit = mesh.get_bvh().intersect
+        (
+            glm::vec3(inverse_model * glm::vec4(origin, 1.f)),
+            glm::vec3(inverse_model * glm::vec4(direction, 0.f)),
+            max_distance
+        );
+
+        if(!hit.is_hit())
+            continue;
+
+        auto &parts = mesh.get_parts();
+        for(uint32_t i = 0, parts_count = static_cast<uint32_t>(parts.size()); i < parts_count; ++i)
+        {
+            if(hit.triangle < parts[i].index_base || hit.triangle >= parts[i].index_base + parts[i].index_count)
+                continue;
+
+            max_distance = hit.distance;
+            nearest = PickHit
+            {
+                scene_components.get_owner(*component),
+                i,
+                (hit.triangle - parts[i].index_base) / 3,
+                hit.distance,
+                origin + hit.distance * direction,
+                hit.barycentric
+            };
+
+            break;
+        }
+    }
+
+    return nearest;
+}
+
+void Renderer::add_static_mesh
+(
+    SceneGraph &scenegraph,
+    AssetLoader::StaticMeshFuture future,
+    const glm::mat4 &model,
+    Mobility mobility
+)
+{
+    static size_t placeholder_id = 0;
+
+    // Resident assets are ready at once and need no placeholder
+    if(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+    {
+        try
+        {
+            auto mesh = future.get();
+            mesh->set_model_matrix(model);
+            mesh->set_mobility(mobility);
+            scenegraph.add_node(mesh);
+
+            if(is_prepared && &scenegraph == this->scenegraph)
+                rebuild_scene();
+
+            return;
+        }
+        catch(const std::exception &)
+        {
+            // Reported by update_pending_meshes, the placeholder stays in the scene
+        }
+    }
+
+    auto placeholder = asset_loader->create_placeholder("placeholder" + std::to_string(placeholder_id++));
+    placeholder->set_model_matrix(model);
+
+    scenegraph.add_node(placeholder);
+    pending_static_meshes.push_back({ &scenegraph, future, placeholder, mobility });
+
+    if(is_prepared && &scenegraph == this->scenegraph)
+        rebuild_scene();
+}
+
+void Renderer::update_pending_meshes()
+{
+    if(pending_static_meshes.empty())
+        return;
+
+    asset_loader->flush_uploads();
+
+    bool is_scene_changed = false;
+    for(auto it = pending_static_meshes.begin(); it != pending_static_meshes.end();)
+    {
+        if(it->future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        try
+        {
+            auto mesh = it->future.get();
+            mesh->set_model_matrix(it->placeholder->get_model_matrix());
+            mesh->set_mobility(it->mobility);
+
+            it->scenegraph->replace_node(it->placeholder, mesh);
+            is_scene_changed = is_scene_changed || it->scenegraph == scenegraph;
+        }
+        catch(const std::exception &e)
+        {
+            // The placeholder stays in the scene
+            std::cerr << "Can't load static mesh: " << e.what() << std::endl;
+        }
+
+        it = pending_static_meshes.erase(it);
+    }
+
+    if(is_prepared && is_scene_changed)
+        rebuild_scene();
+}
+
 void Renderer::on_key(const Key &key)
 {
     if(key.modifiers == Key::Modifiers::NONE)
@@ -1442,6 +2656,12 @@ void Renderer::on_mouse_down(MouseButton button)
     {
         is_rotation_active = !is_rotation_active;
     }
+    else if(button == MouseButton::RIGHT && pick_callback)
+    {
+        auto hit = pick(static_cast<int32_t>(last_mouse_position.x), static_cast<int32_t>(last_mouse_position.y));
+        if(hit)
+            pick_callback(*hit);
+    }
 }
 
 void Renderer::on_mouse_up(MouseButton button)
@@ -1452,8 +2672,9 @@ void Renderer::on_mouse_move(int32_t x, int32_t y)
 {
     if(is_rotation_active)
     {
+        // Window y grows downwards
         float dx = last_mouse_position.x - static_cast<float>(x);
-        float dy = last_mouse_position.y - static_cast<float>(y);
+        float dy = static_cast<float>(y) - last_mouse_position.y;
 
         std::cout << "rotation: " << dx << ", " << dy << std::endl;
         controller.rotate(dx, dy);
@@ -1461,4 +2682,46 @@ void Renderer::on_mouse_move(int32_t x, int32_t y)
 
     last_mouse_position.x = static_cast<float>(x);
     last_mouse_position.y = static_cast<float>(y);
+}
+
+float get_screen_radius(const StaticMesh &mesh, const Camera &camera, uint32_t viewport_height)
+{
+    // Distance at which a unit sphere covers one pixel of the viewport height
+    float projection_scale = 0.5f * static_cast<float>(viewport_height) / std::abs(std::tan(0.5f * camera.get_fov()));
+    const glm::mat4 &view  = camera.get_model_matrix();
+
+    auto &sphere = mesh.get_bounding_sphere();
+    const glm::mat4 &model = mesh.get_model_matrix();
+
+    float scale = std::max
+    (
+        glm::length(glm::vec3(model[0])),
+        std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])))
+    );
+
+    glm::vec3 center = glm::vec3(view * model * glm::vec4(sphere.center, 1.f));
+    float distance = std::max(glm::length(center), camera.get_znear());
+
+    return sphere.radius * scale * projection_scale / distance;
+}
+
+bool is_instance_extension_supported(std::string_view extension)
+{
+    uint32_t extension_count = 0;
+    if(vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, nullptr) != VK_SUCCESS)
+        return false;
+
+    std::vector<VkExtensionProperties> extensions(extension_count);
+    if(vkEnumerateInstanceExtensionProperties(nullptr, &extension_count, extensions.data()) != VK_SUCCESS)
+        return false;
+
+    return std::any_of
+    (
+        extensions.begin(),
+        extensions.end(),
+        [&extension](const VkExtensionProperties &properties)
+        {
+            return extension == properties.extensionName;
+        }
+    );
 }
\ No newline at end of file
@@ -3,6 +3,10 @@
 
 #include <memory>
 #include <array>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <vulkan/vulkan.h>
 
@@ -13,12 +17,19 @@
 #include "device.h"
 #include "devicebuffer.h"
 #include "swapchain.h"
+#include "frustum.h"
+#include "meshletculler.h"
+#include "frustumculler.h"
+#include "dynamicaabbtree.h"
+#include "occlusionculler.h"
+#include "assetloader.h"
+#include "geometryheap.h"
+#include "staticbatcher.h"
+#include "virtualtexturefeedback.h"
 
 #include "scenegraph.h"
 #include "actorcontroller.h"
-#include "detail/actorscontainer.h"
-#include "detail/staticmeshescontainer.h"
-#include "detail/cameraselector.h"
+#include "detail/scenecomponents.h"
 #include "detail/meshselector.h"
 
 enum class VulkanValidationMode
@@ -27,14 +38,52 @@ enum class VulkanValidationMode
     ENABLED
 };
 
+enum class GeometryResidency
+{
+    KEEP_CPU_COPY,
+    RELEASE_AFTER_UPLOAD // CPU copies are imported again when geometry has to be uploaded again
+};
+
+enum class MaterialBinding
+{
+    DESCRIPTOR_SETS, // One set with the diffuse texture per material, bound for every draw
+    BINDLESS         // All textures in one array and materials in a storage buffer, falls back to DESCRIPTOR_SETS without VK_EXT_descriptor_indexing
+};
+
+enum class ResidencyEvent
+{
+    UPLOADED,
+    EVICTED,
+    CPU_COPY_RELEASED,
+    CPU_COPY_RESTORED
+};
+
 class Renderer : public AbstractRenderer
 {
 public:
+    using ResidencyCallback = std::function<void(const StaticMesh::Resources &, ResidencyEvent)>;
+
+    struct PickHit
+    {
+        std::shared_ptr<StaticMesh> mesh;
+        uint32_t  part;
+        uint32_t  triangle;    // In the full resolution range of the part
+        float     distance;    // From the camera
+        glm::vec3 position;
+        glm::vec2 barycentric; // Of the second and the third vertex
+    };
+
+    using PickCallback = std::function<void(const PickHit &)>;
+
+    // SPLIT_POSITIONS also enables the depth prepass, which then fetches 12 bytes per vertex
     Renderer
     (
         std::string_view application_name,
         Window &,
-        VulkanValidationMode
+        VulkanValidationMode,
+        VertexStreamLayout = VertexStreamLayout::INTERLEAVED,
+        GeometryResidency = GeometryResidency::KEEP_CPU_COPY,
+        MaterialBinding = MaterialBinding::BINDLESS
     );
 
     ~Renderer();
@@ -56,6 +105,7 @@ public:
     void initialize_swapchain();
     void create_pipeline_cache();
     void prepare(SceneGraph &);
+    void rebuild_scene();
     void prepare_frame();
     void submit_frame();
 
@@ -65,6 +115,9 @@ public:
     void create_static_mesh_vertex_descriptions();
     void create_pipelines();
     void fill_command_buffers();
+    void record_static_meshes(VkCommandBuffer, VkPipeline, bool is_depth_only);
+    bool is_depth_prepass_enabled() const;
+    bool is_bindless_enabled() const;
 
     void setup_descriptor_pool();
     void setup_scene_descriptor_set_layout();
@@ -73,13 +126,34 @@ public:
 
     void setup_scene_descriptors();
     void setup_materials_descriptors();
+    void setup_bindless_materials();
+    void setup_virtual_texture_feedback();
 
+    void batch_static_meshes();
     void setup_static_mesh_buffer();
+    void update_static_mesh_ranges();
+    void compact_geometry();
+    void release_compaction_command_buffer();
+    void setup_meshlet_indirect_buffer();
+
+    // Rewrites offsets of the meshlet commands of meshes using the resources, culling results are kept
+    void patch_meshlet_commands(const std::unordered_set<const StaticMesh::Resources*> &);
+    void setup_spatial_index();
+    void setup_occluders();
 
     void setup_uniform_buffers();
 
     void view_changed();
 
+    void update_pending_meshes();
+    void update_lods();
+    void update_visibility();
+    void update_spatial_index();
+    void update_meshlet_visibility();
+    void update_texture_streaming();
+    void update_streamed_descriptors(const std::vector<const Texture2D*> &changed);
+    void update_virtual_textures();
+
     void update_static_uniform();
     void update_dynamic_uniform();
 
@@ -88,6 +162,30 @@ public:
     std::shared_ptr<Device> get_device() const;
     VkCommandPool get_command_pool() const;
     VkQueue get_queue() const;
+    AssetLoader &get_asset_loader();
+    const FrustumCuller::Statistics &get_culling_statistics() const;
+    const OcclusionCuller::Statistics &get_occlusion_statistics() const;
+
+    // Nearest static mesh triangle under the framebuffer pixel, through the current camera.
+    // Pixels are counted from the top left corner, the same as mouse positions.
+    // Meshes of static batches are hit as their batch
+    std::optional<PickHit> pick(int32_t x, int32_t y) const;
+
+    // Called with the hit under the mouse on right click, misses aren't reported
+    void set_pick_callback(PickCallback);
+
+    // Called on the rendering thread for static mesh geometry moving between host and device
+    void set_residency_callback(ResidencyCallback);
+
+    // Adds a placeholder to the scene graph right away and swaps it for the mesh when it's loaded.
+    // Placeholders are movable, the mesh gets the mobility
+    void add_static_mesh
+    (
+        SceneGraph &,
+        AssetLoader::StaticMeshFuture,
+        const glm::mat4 &model = glm::mat4(1.f),
+        Mobility = Mobility::MOVABLE
+    );
 
     virtual void on_mouse_move(int32_t x, int32_t y) override;
 
@@ -100,12 +198,18 @@ public:
 private:
     void draw();
 
+    // The first camera of the scene
+    Camera &get_current_camera() const;
+
     ////////////////////////////////////////////
     //           Vulkan must have             //
     ////////////////////////////////////////////
 
     std::string          application_name;
     VulkanValidationMode validation_mode;
+    VertexStreamLayout   vertex_layout;
+    GeometryResidency    geometry_residency;
+    MaterialBinding      material_binding; // DESCRIPTOR_SETS when the device can't do bindless
 
     VkDebugReportCallbackEXT debug_report;
 
@@ -169,8 +273,57 @@ private:
 
     VkDescriptorSet scene_descriptor_set;
 
-    std::shared_ptr<DeviceBuffer> vertex_buffer;
-    std::shared_ptr<DeviceBuffer> index_buffer;
+    // Push constants of a material when it has its own descriptor set, the set is shared by materials with one texture.
+    // virtual_texture is the header of the material's virtual texture in the page table, or -1
+    struct MaterialConstants
+    {
+        StaticMesh::MaterialProperties properties;
+        StaticMesh::TextureRegion      diffuse_region;
+        int32_t                        virtual_texture;
+    };
+
+    // Bindless materials: set 1 holds every texture and a storage buffer of materials,
+    // each draw only pushes the index of its material
+    static constexpr uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+    struct alignas(16) BindlessMaterial
+    {
+        StaticMesh::MaterialProperties properties;
+        StaticMesh::TextureRegion      diffuse_region;
+        uint32_t                       texture_index;
+        int32_t                        virtual_texture;
+    };
+
+    uint32_t bindless_texture_capacity;
+    VkDescriptorSet bindless_descriptor_set;
+    std::shared_ptr<DeviceBuffer> bindless_materials;
+    std::unordered_map<const StaticMesh::Material*, uint32_t> bindless_material_indices;
+    std::unordered_map<const Texture*, uint32_t> bindless_texture_indices;
+
+    std::unique_ptr<GeometryHeap> geometry_heap;
+
+    static constexpr size_t GEOMETRY_HEAP_VERTEX_CAPACITY = 1 << 18;
+    static constexpr size_t GEOMETRY_HEAP_INDEX_CAPACITY  = 1 << 20;
+    static constexpr size_t GEOMETRY_COMPACTION_MOVES_PER_FRAME = 1;
+
+    // Keyed by resources, instances of one asset share its geometry
+    struct StaticMeshGeometry
+    {
+        std::weak_ptr<const StaticMesh::Resources> resources; // Detects new resources allocated at the address of freed ones
+        GeometryHeap::Handle handle;
+    };
+
+    std::unordered_map<const StaticMesh::Resources*, StaticMeshGeometry> static_mesh_geometry;
+    ResidencyCallback residency_callback;
+    PickCallback      pick_callback;
+    bool is_geometry_compaction_pending;
+
+    // Submitted ahead of the frame without a wait, freed once the frame has been executed
+    VkCommandBuffer compaction_command_buffer;
+
+    // Streamed texture levels are committed on a later frame, once the fence has signaled
+    VkCommandBuffer texture_streaming_command_buffer;
+    VkFence         texture_streaming_fence;
 
     struct 
     {
@@ -192,16 +345,60 @@ private:
         glm::mat4 *models = nullptr;
     } dynamic_uniform_data;
 
-    static constexpr uint32_t STATIC_MESH_BUFFER_ID = 0;
+    // Both faces are drawn, so meshlets are never rejected by their normal cones
+    static constexpr VkCullModeFlags STATIC_MESH_CULL_MODE = VK_CULL_MODE_NONE;
+
+    static constexpr uint32_t STATIC_MESH_BUFFER_ID            = 0;
+    static constexpr uint32_t STATIC_MESH_ATTRIBUTES_BUFFER_ID = 1; // Only with VertexStreamLayout::SPLIT_POSITIONS
+
+    struct StaticMeshRange
+    {
+        int32_t  vertex_offset;
+        uint32_t first_index;
+    };
+
+    std::unordered_map<const StaticMesh::Resources*, StaticMeshRange> static_mesh_ranges;
+
+    // Projected bounding sphere radius (in pixels) at which LOD 0 is selected,
+    // every halving of the radius selects the next LOD
+    static constexpr float LOD_FULL_DETAIL_SCREEN_RADIUS = 256.f;
+
+    std::vector<uint32_t> actor_lods;
+
+    // One indexed indirect command per meshlet of every actor, instanceCount is 0 for culled ones.
+    // Meshlets are only used for LOD 0, coarser LODs are drawn whole
+    std::shared_ptr<DeviceBuffer> meshlet_indirect_buffer;
+    std::vector<size_t>           actor_meshlet_offsets;
+
+    std::unordered_map<const StaticMesh::Resources*, MeshletCuller> meshlet_cullers;
+    Frustum frustum;
+
+    // Fat world boxes of static meshes with entities as user data, one proxy per static mesh component.
+    // Refitted when actors change, its frustum query picks the meshes the frustum culler tests
+    DynamicAabbTree spatial_index;
+    std::vector<DynamicAabbTree::Proxy> static_mesh_proxies;
+    std::vector<uint32_t> visible_entities;
+    std::vector<SceneComponents::Component<StaticMesh>> visible_meshes;
+
+    // Parts that passed the frustum and occlusion tests, recorded into the command buffers.
+    // Rerecorded when the visible set or the LODs change
+    FrustumCuller frustum_culler;
+    OcclusionCuller occlusion_culler;
+    std::vector<FrustumCuller::Draw> draw_list;
+    std::vector<FrustumCuller::Draw> culled_draws;
+    bool is_draw_list_outdated;
+
+    struct VertexInputInfo
+    {
+        VkPipelineVertexInputStateCreateInfo           input_state;
+        std::vector<VkVertexInputBindingDescription>   binding_descriptions;
+        std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
+    };
 
     struct 
     {
-        struct 
-        {
-            VkPipelineVertexInputStateCreateInfo           input_state;
-            std::vector<VkVertexInputBindingDescription>   binding_descriptions;
-            std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
-        } static_mesh;
+        VertexInputInfo static_mesh;
+        VertexInputInfo depth_only;
     } vertex_info;
 
     std::array<VkPipelineShaderStageCreateInfo, 2> shader_stages;
@@ -214,11 +411,34 @@ private:
     struct 
     {
         VkPipeline static_mesh;
+        VkPipeline depth_prepass;
+        VkPipeline virtual_feedback;
     } pipelines;
 
-    ActorsContainer actors_container;
-    StaticMeshesContainer static_meshes;
-    CameraSelector camera_selector;
+    // Recorded before the main pass while any virtual texture is loaded, read in the next update
+    std::unique_ptr<VirtualTextureFeedback> virtual_texture_feedback;
+
+    std::unique_ptr<AssetLoader> asset_loader;
+
+    struct PendingStaticMesh
+    {
+        SceneGraph                      *scenegraph;
+        AssetLoader::StaticMeshFuture    future;
+        std::shared_ptr<StaticMesh>      placeholder;
+        Mobility                         mobility;
+    };
+
+    std::vector<PendingStaticMesh> pending_static_meshes;
+
+    // Static meshes are drawn through batches in place of themselves.
+    // Batches are rebuilt only when the set of static meshes in the scene changes
+    StaticBatcher static_batcher;
+    std::vector<std::shared_ptr<StaticMesh>> static_batch_sources;
+    std::vector<std::shared_ptr<StaticMesh>> static_batches;
+
+    SceneGraph *scenegraph;
+
+    SceneComponents scene_components;
 
     ActorController controller;
     glm::vec2 last_mouse_position;
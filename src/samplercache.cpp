@@ -0,0 +1,67 @@
+#include <stdexcept>
+
+#include "samplercache.h"
+#include "vkassert.h"
+
+bool is_same_sampler(const VkSamplerCreateInfo &, const VkSamplerCreateInfo &);
+
+VkSampler SamplerCache::get(VkDevice device, const VkSamplerCreateInfo &create_info)
+{
+    if(create_info.pNext != nullptr)
+        throw std::runtime_error("Can't cache sampler with extension structures");
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for(auto &&entry : entries)
+        if(is_same_sampler(entry.create_info, create_info))
+            return entry.sampler;
+
+    Entry entry;
+    entry.create_info = create_info;
+    vk_assert
+    (
+        vkCreateSampler(device, &create_info, nullptr, &entry.sampler),
+        "Can't create texture sampler"
+    );
+
+    entries.push_back(entry);
+    return entry.sampler;
+}
+
+size_t SamplerCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return entries.size();
+}
+
+void SamplerCache::clear(VkDevice device)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for(auto &&entry : entries)
+        vkDestroySampler(device, entry.sampler, nullptr);
+
+    entries.clear();
+}
+
+// Field by field, padding bytes of the structures are unspecified
+bool is_same_sampler(const VkSamplerCreateInfo &lhs, const VkSamplerCreateInfo &rhs)
+{
+    return lhs.flags                   == rhs.flags
+        && lhs.magFilter               == rhs.magFilter
+        && lhs.minFilter               == rhs.minFilter
+        && lhs.mipmapMode              == rhs.mipmapMode
+        && lhs.addressModeU            == rhs.addressModeU
+        && lhs.addressModeV            == rhs.addressModeV
+        && lhs.addressModeW            == rhs.addressModeW
+        && lhs.mipLodBias              == rhs.mipLodBias
+        && lhs.anisotropyEnable        == rhs.anisotropyEnable
+        && lhs.maxAnisotropy           == rhs.maxAnisotropy
+        && lhs.compareEnable           == rhs.compareEnable
+        && lhs.compareOp               == rhs.compareOp
+        && lhs.minLod                  == rhs.minLod
+        && lhs.maxLod                  == rhs.maxLod
+        && lhs.borderColor             == rhs.borderColor
+        && lhs.unnormalizedCoordinates == rhs.unnormalizedCoordinates;
+}
\ No newline at end of file
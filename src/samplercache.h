@@ -0,0 +1,31 @@
+#ifndef CG_SEM5_SAMPLERCACHE_H
+#define CG_SEM5_SAMPLERCACHE_H
+
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Samplers are created once per distinct VkSamplerCreateInfo and shared by every texture.
+// They live until clear, which the owning device calls before it is destroyed
+class SamplerCache
+{
+public:
+    // pNext chains are not supported
+    VkSampler get(VkDevice, const VkSamplerCreateInfo &);
+
+    size_t size() const;
+
+    void clear(VkDevice);
+
+private:
+    struct Entry
+    {
+        VkSamplerCreateInfo create_info;
+        VkSampler           sampler;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries; // Few distinct samplers exist, a linear search is enough
+};
+
+#endif // CG_SEM5_SAMPLERCACHE_H
\ No newline at end of file
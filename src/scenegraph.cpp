@@ -1,22 +1,24 @@
+#include <algorithm>
+
 #include "scenegraph.h"
 
 SceneGraph::SceneGraph(std::string_view id)
 : SceneNode(id)
-{}
-
-void SceneGraph::accept_up(SceneGraphVisitor &)
-{}
-
-void SceneGraph::accept_down(SceneGraphVisitor &visitor)
 {
-    for(auto &&node : nodes)
-    {
-        node->accept_down(visitor);
-        node->accept_up(visitor);
-    }
+    kind = SceneNodeKind::GRAPH;
 }
 
 void SceneGraph::add_node(std::shared_ptr<SceneNode> node)
 {
     nodes.push_back(node);
+}
+
+bool SceneGraph::replace_node(std::shared_ptr<SceneNode> old_node, std::shared_ptr<SceneNode> new_node)
+{
+    auto it = std::find(nodes.begin(), nodes.end(), old_node);
+    if(it == nodes.end())
+        return false;
+
+    *it = new_node;
+    return true;
 }
\ No newline at end of file
@@ -5,19 +5,41 @@
 #include <memory>
 
 #include "scenenode.h"
+#include "scenegraphvisitor.h"
 
 class SceneGraph : public SceneNode
 {
 public:
     SceneGraph(std::string_view id);
 
-    virtual void accept_up(SceneGraphVisitor &) override;
-    virtual void accept_down(SceneGraphVisitor &) override;
+    // One traversal for all visitors: each node is visited down and then up by every visitor in turn.
+    // Nested graphs are entered, but not visited themselves
+    template <typename... Visitors>
+    void accept_down(Visitors &...);
 
     void add_node(std::shared_ptr<SceneNode>);
 
+    // Returns false if old_node isn't in the graph
+    bool replace_node(std::shared_ptr<SceneNode> old_node, std::shared_ptr<SceneNode> new_node);
+
 private:
     std::vector<std::shared_ptr<SceneNode>> nodes;
 };
 
-#endif // CG_SEM5_SCENEGRAPH_H
\ No newline at end of file
+template <typename... Visitors>
+void SceneGraph::accept_down(Visitors &...visitors)
+{
+    for(auto &&node : nodes)
+    {
+        if(node->get_kind() == SceneNodeKind::GRAPH)
+        {
+            static_cast<SceneGraph&>(*node).accept_down(visitors...);
+            continue;
+        }
+
+        (visit_down(visitors, *node), ...);
+        (visit_up(visitors, *node), ...);
+    }
+}
+
+#endif // CG_SEM5_SCENEGRAPH_H
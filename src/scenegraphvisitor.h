@@ -1,16 +1,67 @@
 #ifndef CG_SEM5_SCENEGRAPHVISITOR_H
 #define CG_SEM5_SCENEGRAPHVISITOR_H
 
-#include <memory>
+#include <type_traits>
+#include <utility>
 
-class SceneNode;
+#include "scenenode.h"
+#include "camera.h"
+#include "staticmesh.h"
 
-class SceneGraphVisitor 
+// Visitors are plain classes with visit_down and visit_up overloads taking node references, e.g.
+// void visit_down(Actor &). A node is passed as its most derived kind, so it reaches the overload of its
+// closest base, nodes without a matching overload are skipped. Dispatch switches on the kind tag of the node:
+// no virtual calls, no casts checked at run time and no reference counting per node
+template <typename Visitor, typename Node, typename = void>
+struct HasVisitDown : std::false_type {};
+
+template <typename Visitor, typename Node>
+struct HasVisitDown<Visitor, Node, std::void_t<decltype(std::declval<Visitor&>().visit_down(std::declval<Node&>()))>> : std::true_type {};
+
+template <typename Visitor, typename Node, typename = void>
+struct HasVisitUp : std::false_type {};
+
+template <typename Visitor, typename Node>
+struct HasVisitUp<Visitor, Node, std::void_t<decltype(std::declval<Visitor&>().visit_up(std::declval<Node&>()))>> : std::true_type {};
+
+template <typename Node, typename Visitor>
+void visit_down_as(Visitor &visitor, SceneNode &node)
+{
+    if constexpr(HasVisitDown<Visitor, Node>::value)
+        visitor.visit_down(static_cast<Node&>(node));
+}
+
+template <typename Node, typename Visitor>
+void visit_up_as(Visitor &visitor, SceneNode &node)
+{
+    if constexpr(HasVisitUp<Visitor, Node>::value)
+        visitor.visit_up(static_cast<Node&>(node));
+}
+
+template <typename Visitor>
+void visit_down(Visitor &visitor, SceneNode &node)
+{
+    switch(node.get_kind())
+    {
+    case SceneNodeKind::ACTOR:       visit_down_as<Actor>(visitor, node);        break;
+    case SceneNodeKind::CAMERA:      visit_down_as<Camera>(visitor, node);       break;
+    case SceneNodeKind::MESH:        visit_down_as<AbstractMesh>(visitor, node); break;
+    case SceneNodeKind::STATIC_MESH: visit_down_as<StaticMesh>(visitor, node);   break;
+    default:                         visit_down_as<SceneNode>(visitor, node);    break;
+    }
+}
+
+template <typename Visitor>
+void visit_up(Visitor &visitor, SceneNode &node)
 {
-public:
-    virtual ~SceneGraphVisitor() {}
-    virtual void visit_up(std::shared_ptr<SceneNode>)   = 0;
-    virtual void visit_down(std::shared_ptr<SceneNode>) = 0;
-};
+    switch(node.get_kind())
+    {
+    case SceneNodeKind::ACTOR:       visit_up_as<Actor>(visitor, node);        break;
+    case SceneNodeKind::CAMERA:      visit_up_as<Camera>(visitor, node);       break;
+    case SceneNodeKind::MESH:        visit_up_as<AbstractMesh>(visitor, node); break;
+    case SceneNodeKind::STATIC_MESH: visit_up_as<StaticMesh>(visitor, node);   break;
+    default:                         visit_up_as<SceneNode>(visitor, node);    break;
+    }
+}
 
-#endif // CG_SEM5_SCENEGRAPHVISITOR_H
\ No newline at end of file
+#endif // CG_SEM5_SCENEGRAPHVISITOR_H
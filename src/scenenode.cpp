@@ -1,27 +1,21 @@
 #include "scenenode.h"
-#include "scenegraphvisitor.h"
 
 static size_t default_id = 0;
 
 SceneNode::SceneNode()
-: id("node" + std::to_string(default_id++)), changed(true)
+: id("node" + std::to_string(default_id++)), kind(SceneNodeKind::NODE), changed(true)
 {}
 
 SceneNode::SceneNode(std::string_view id)
-: id(id.data()), changed(true)
+: id(id.data()), kind(SceneNodeKind::NODE), changed(true)
 {}
 
 SceneNode::~SceneNode()
 {}
 
-void SceneNode::accept_up(SceneGraphVisitor &visitor)
+SceneNodeKind SceneNode::get_kind() const
 {
-    visitor.visit_up(shared_from_this());
-}
-
-void SceneNode::accept_down(SceneGraphVisitor &visitor)
-{
-    visitor.visit_down(shared_from_this());
+    return kind;
 }
 
 const std::string &SceneNode::get_id() const
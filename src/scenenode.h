@@ -5,7 +5,17 @@
 #include <string>
 #include <string_view>
 
-class SceneGraphVisitor;
+// Most derived node class known to scene graph visitors, set by its constructor.
+// Classes derived outside keep the kind of their base
+enum class SceneNodeKind
+{
+    NODE,
+    GRAPH,
+    ACTOR,
+    CAMERA,
+    MESH,
+    STATIC_MESH
+};
 
 class SceneNode : public std::enable_shared_from_this<SceneNode>
 {
@@ -14,8 +24,7 @@ public:
     SceneNode(std::string_view id);
     virtual ~SceneNode();
 
-    virtual void accept_up(SceneGraphVisitor &);
-    virtual void accept_down(SceneGraphVisitor &);
+    SceneNodeKind get_kind() const;
 
     const std::string &get_id() const;
     void set_id(std::string_view id);
@@ -27,6 +36,7 @@ public:
     
 protected:
     std::string id;
+    SceneNodeKind kind;
 
     bool changed;
 };
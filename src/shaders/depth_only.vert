@@ -0,0 +1,31 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (location = 0) in vec3 in_position;
+
+layout (set = 0, binding = 0) uniform StaticUniformBuffer 
+{
+	mat4 projection;
+	mat4 view;
+	vec4 light_position;
+} static_uniform;
+
+layout (set = 0, binding = 1) uniform DynamicUniformBuffer
+{
+    mat4 model;
+} dynamic_uniform;
+
+out gl_PerVertex
+{
+	invariant vec4 gl_Position;
+};
+
+void main() 
+{
+	// Must match static_mesh.vert exactly, the color pass tests against this depth
+	mat4 modelView = static_uniform.view * dynamic_uniform.model;
+
+	gl_Position = static_uniform.projection * modelView * vec4(in_position.xyz, 1.0);
+}
@@ -3,7 +3,12 @@
 #extension GL_ARB_separate_shader_objects : enable
 #extension GL_ARB_shading_language_420pack : enable
 
-layout (set = 1, binding = 0) uniform sampler2D sampler_color_map;
+layout (set = 1, binding = 0) uniform sampler2DArray sampler_color_map;
+
+layout (std430, set = 0, binding = 2) readonly buffer PageTable
+{
+	uint page_table[];
+};
 
 layout (location = 0) in vec3 in_normal;
 layout (location = 1) in vec3 in_color;
@@ -17,13 +22,72 @@ layout(push_constant) uniform Material
 	vec4 diffuse;
 	vec4 specular;
 	float opacity;
+	float texture_layer;
+	vec2 uv_scale;
+	int virtual_texture; // Page table header, -1 without a virtual texture
 } material;
 
 layout (location = 0) out vec4 out_frag_color;
 
+// Packed textures fill a corner of their layer. Repeat is done inside the corner, and the filter footprint
+// is kept half a texel away from its edges so that neighbouring layer texels never bleed in
+vec4 sample_region(sampler2DArray map, vec2 uv, float layer, vec2 uv_scale)
+{
+	if(uv_scale == vec2(1.0))
+		return texture(map, vec3(uv, layer));
+
+	vec2 scaled_uv = uv * uv_scale;
+	float lod = textureQueryLod(map, scaled_uv).x;
+	vec2 half_texel = 0.5 / vec2(textureSize(map, int(ceil(lod))).xy);
+	vec2 region_uv = clamp(fract(uv) * uv_scale, half_texel, uv_scale - half_texel);
+
+	return textureGrad(map, vec3(region_uv, layer), dFdx(scaled_uv), dFdy(scaled_uv));
+}
+
+const uint PAGE_SIZE        = 128;
+const uint PAGE_BORDER      = 4;
+const uint STORED_PAGE_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+const uint VALID_BIT        = 0x80000000;
+
+// Pages of virtual textures live in slots of the cache layer, the page table maps them. Lookups start at the level
+// the derivatives ask for and fall back to coarser levels until a resident page is found, the coarsest one always is.
+// Pages are stored with borders, so the bilinear footprint never leaves its slot
+vec4 sample_virtual(sampler2DArray cache, uint base, vec2 uv)
+{
+	uvec2 size = uvec2(page_table[base], page_table[base + 1]);
+	uint level_count = page_table[base + 2];
+
+	vec2 texel = uv * vec2(size);
+	float lod = 0.5 * log2(max(dot(dFdx(texel), dFdx(texel)), dot(dFdy(texel), dFdy(texel))));
+	uint level = uint(clamp(lod, 0.0, float(level_count - 1)));
+
+	vec2 level_texel;
+	uvec2 page;
+	uint entry;
+	for(;; ++level)
+	{
+		uvec2 extent = max(size >> level, uvec2(1));
+		uvec2 grid = (extent + PAGE_SIZE - 1) / PAGE_SIZE;
+		level_texel = fract(uv) * vec2(extent);
+		page = min(uvec2(level_texel) / PAGE_SIZE, grid - 1);
+		entry = page_table[page_table[base + 3 + level] + page.y * grid.x + page.x];
+
+		if((entry & VALID_BIT) != 0 || level + 1 >= level_count)
+			break;
+	}
+
+	uvec2 slot = uvec2(entry & 0xff, (entry >> 8) & 0xff);
+	vec2 cache_texel = vec2(slot * STORED_PAGE_SIZE + PAGE_BORDER) + level_texel - vec2(page * PAGE_SIZE);
+
+	return textureLod(cache, vec3(cache_texel / vec2(textureSize(cache, 0).xy), 0.0), 0.0);
+}
+
 void main() 
 {
-	vec4 color = texture(sampler_color_map, in_uv) * vec4(in_color, 1.0);
+	vec4 color = material.virtual_texture >= 0
+		? sample_virtual(sampler_color_map, uint(material.virtual_texture), in_uv)
+		: sample_region(sampler_color_map, in_uv, material.texture_layer, material.uv_scale);
+	color *= vec4(in_color, 1.0);
 	vec3 N = normalize(in_normal);
 	vec3 L = normalize(in_light_vec);
 	vec3 V = normalize(in_view_vec);
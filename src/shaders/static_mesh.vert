@@ -28,7 +28,7 @@ layout (location = 4) out vec3 out_light_vec;
 
 out gl_PerVertex
 {
-	vec4 gl_Position;
+	invariant vec4 gl_Position;
 };
 
 void main() 
@@ -0,0 +1,52 @@
+#version 450
+
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_ARB_shading_language_420pack : enable
+
+layout (std430, set = 0, binding = 2) readonly buffer PageTable
+{
+	uint page_table[];
+};
+
+layout (location = 2) in vec2 in_uv;
+
+layout(push_constant) uniform Material 
+{
+	vec4 ambient;
+	vec4 diffuse;
+	vec4 specular;
+	float opacity;
+	float texture_layer;
+	vec2 uv_scale;
+	int virtual_texture;
+} material;
+
+layout (location = 0) out uint out_page;
+
+const uint PAGE_SIZE    = 128;
+const uint INVALID_PAGE = 0xffffffff;
+
+// The pass is VirtualTextureFeedback::SCALE times smaller than the framebuffer, derivatives are as much larger
+const float LOD_BIAS = -3.0;
+
+// Page table entry of the page the main pass wants at uv
+uint find_page(uint base, vec2 uv)
+{
+	uvec2 size = uvec2(page_table[base], page_table[base + 1]);
+	uint level_count = page_table[base + 2];
+
+	vec2 texel = uv * vec2(size);
+	float lod = 0.5 * log2(max(dot(dFdx(texel), dFdx(texel)), dot(dFdy(texel), dFdy(texel)))) + LOD_BIAS;
+	uint level = uint(clamp(lod, 0.0, float(level_count - 1)));
+
+	uvec2 extent = max(size >> level, uvec2(1));
+	uvec2 grid = (extent + PAGE_SIZE - 1) / PAGE_SIZE;
+	uvec2 page = min(uvec2(fract(uv) * vec2(extent)) / PAGE_SIZE, grid - 1);
+
+	return page_table[base + 3 + level] + page.y * grid.x + page.x;
+}
+
+void main() 
+{
+	out_page = material.virtual_texture >= 0 ? find_page(uint(material.virtual_texture), in_uv) : INVALID_PAGE;
+}
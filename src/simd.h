@@ -0,0 +1,11 @@
+#ifndef CG_SEM5_SIMD_H
+#define CG_SEM5_SIMD_H
+
+// CG_SEM5_SSE is defined where SSE2 is available: always on x86-64, on 32-bit x86 when enabled.
+// Code under it keeps a scalar path for other targets
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CG_SEM5_SSE
+#include <emmintrin.h>
+#endif
+
+#endif // CG_SEM5_SIMD_H
\ No newline at end of file
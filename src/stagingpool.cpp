@@ -0,0 +1,93 @@
+#include <algorithm>
+
+#include "stagingpool.h"
+#include "device.h"
+#include "vkassert.h"
+
+std::shared_ptr<DeviceBuffer> create_mapped_buffer(Device &, VkDeviceSize size);
+
+StagingPool::Allocation StagingPool::allocate(Device &device, VkDeviceSize size)
+{
+    // Copy offsets must be multiples of the texel block size and of 4, 16 covers every format used
+    VkDeviceSize alignment = std::max<VkDeviceSize>(16, device.properties.limits.optimalBufferCopyOffsetAlignment);
+
+    if(size > CHUNK_SIZE)
+    {
+        auto buffer = create_mapped_buffer(device, size);
+        return { buffer, 0, buffer->mapped_memory };
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Only the pool holds idle chunks
+    size_t idle_chunks = 0;
+    for(auto chunk = chunks.begin(); chunk != chunks.end();)
+    {
+        if(chunk->buffer.use_count() > 1)
+        {
+            ++chunk;
+            continue;
+        }
+
+        if(++idle_chunks > MAX_IDLE_CHUNKS)
+        {
+            chunk = chunks.erase(chunk);
+            continue;
+        }
+
+        chunk->head = 0;
+        ++chunk;
+    }
+
+    for(auto &&chunk : chunks)
+    {
+        VkDeviceSize offset = (chunk.head + alignment - 1) / alignment * alignment;
+        if(offset + size > CHUNK_SIZE)
+            continue;
+
+        chunk.head = offset + size;
+        return { chunk.buffer, offset, static_cast<std::byte*>(chunk.buffer->mapped_memory) + offset };
+    }
+
+    chunks.push_back({ create_mapped_buffer(device, CHUNK_SIZE), size });
+    return { chunks.back().buffer, 0, chunks.back().buffer->mapped_memory };
+}
+
+size_t StagingPool::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return chunks.size();
+}
+
+void StagingPool::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    chunks.clear();
+}
+
+std::shared_ptr<DeviceBuffer> create_mapped_buffer(Device &device, VkDeviceSize size)
+{
+    auto buffer = std::make_shared<DeviceBuffer>();
+
+    vk_assert
+    (
+        device.create_buffer
+        (
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            buffer,
+            size
+        ),
+        "Can't create staging buffer"
+    );
+
+    vk_assert
+    (
+        buffer->map(),
+        "Can't map staging buffer"
+    );
+
+    return buffer;
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef CG_SEM5_STAGINGPOOL_H
+#define CG_SEM5_STAGINGPOOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+#include "devicebuffer.h"
+
+struct Device;
+
+// Persistently mapped, host visible staging memory suballocated from large chunks.
+// Every allocation holds its chunk, a chunk is reused once no allocation holds it any more,
+// so allocations are kept until the command buffer reading them has executed, like any staging buffer.
+// Requests larger than a chunk get a buffer of their own
+class StagingPool
+{
+public:
+    static constexpr VkDeviceSize CHUNK_SIZE = 32ull << 20;
+    static constexpr size_t       MAX_IDLE_CHUNKS = 2; // Unused chunks beyond these are released
+
+    struct Allocation
+    {
+        std::shared_ptr<DeviceBuffer> buffer;
+        VkDeviceSize offset;
+        void        *data; // Mapped at offset
+    };
+
+    Allocation allocate(Device &, VkDeviceSize size);
+
+    size_t size() const;
+
+    void clear();
+
+private:
+    struct Chunk
+    {
+        std::shared_ptr<DeviceBuffer> buffer;
+        VkDeviceSize                  head;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Chunk> chunks;
+};
+
+#endif // CG_SEM5_STAGINGPOOL_H
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "staticbatcher.h"
+#include "meshletbuilder.h"
+
+static size_t static_batch_id = 0;
+
+bool is_same_material(const StaticMesh::Material &lhs, const StaticMesh::Material &rhs)
+{
+    return lhs.diffuse == rhs.diffuse
+        && lhs.virtual_diffuse == rhs.virtual_diffuse
+        && lhs.diffuse_region.layer    == rhs.diffuse_region.layer
+        && lhs.diffuse_region.uv_scale == rhs.diffuse_region.uv_scale
+        && lhs.properties.ambient  == rhs.properties.ambient
+        && lhs.properties.diffuse  == rhs.properties.diffuse
+        && lhs.properties.specular == rhs.properties.specular
+        && lhs.properties.opacity  == rhs.properties.opacity;
+}
+
+StaticBatcher::StaticBatcher(float cell_size)
+: cell_size(cell_size)
+{}
+
+std::vector<std::shared_ptr<StaticMesh>> StaticBatcher::build(const std::vector<std::shared_ptr<StaticMesh>> &meshes) const
+{
+    using Cell = std::tuple<int32_t, int32_t, int32_t>;
+
+    // Ordered, so the same scene always gives the same batches
+    std::map<Cell, std::vector<const StaticMesh*>> cells;
+
+    for(auto &&mesh : meshes)
+    {
+        if(!mesh->has_cpu_geometry())
+            throw std::runtime_error("Can't batch static mesh \"" + mesh->get_id() + "\" without its CPU geometry");
+
+        // A mesh goes whole into the cell of its bounding sphere center
+        auto &sphere = mesh->get_bounding_sphere();
+        glm::vec3 center = glm::vec3(mesh->get_model_matrix() * glm::vec4(sphere.center, 1.f));
+        glm::ivec3 cell  = glm::ivec3(glm::floor(center / cell_size));
+
+        cells[{ cell.x, cell.y, cell.z }].push_back(mesh.get());
+    }
+
+    std::vector<std::shared_ptr<StaticMesh>> batches;
+    for(auto &&[cell, cell_meshes] : cells)
+        batches.push_back(build_batch(cell_meshes));
+
+    return batches;
+}
+
+std::shared_ptr<StaticMesh> StaticBatcher::build_batch(const std::vector<const StaticMesh*> &meshes) const
+{
+    static constexpr MeshElementIndex NOT_REMAPPED = std::numeric_limits<MeshElementIndex>::max();
+
+    struct MaterialGroup
+    {
+        const StaticMesh::Material *material;
+        std::vector<std::pair<const StaticMesh*, const StaticMesh::Part*>> parts;
+    };
+
+    std::vector<MaterialGroup> groups;
+    for(auto &&mesh : meshes)
+        for(auto &&part : mesh->get_parts())
+        {
+            auto group = std::find_if
+            (
+                groups.begin(), groups.end(),
+                [&part](auto &&group) { return is_same_material(*group.material, *part.material); }
+            );
+
+            if(group == groups.end())
+                group = groups.insert(groups.end(), { part.material, {} });
+
+            group->parts.emplace_back(mesh, &part);
+        }
+
+    StaticMesh::Geometry geometry;
+    std::vector<StaticMesh::Part>     parts(groups.size());
+    std::vector<StaticMesh::Material> materials(groups.size());
+    std::vector<MeshElementIndex>     remap;
+
+    for(size_t i = 0; i < groups.size(); ++i)
+    {
+        materials[i] = *groups[i].material;
+        materials[i].descriptor_set = VK_NULL_HANDLE;
+
+        parts[i].index_base = static_cast<MeshElementIndex>(geometry.indices.size());
+
+        for(auto &&[mesh, source_part] : groups[i].parts)
+        {
+            auto &vertices = mesh->get_vertices();
+            auto &indices  = mesh->get_indices();
+
+            // Same transform as the static mesh vertex shader applies
+            const glm::mat4 &model = mesh->get_model_matrix();
+            glm::mat3 normal_model = glm::mat3(model);
+            bool is_mirrored = glm::determinant(normal_model) < 0.f;
+
+            // Only the vertices of this part are copied
+            remap.assign(vertices.size(), NOT_REMAPPED);
+            MeshElementIndex first = static_cast<MeshElementIndex>(geometry.indices.size());
+
+            for(MeshElementIndex j = source_part->index_base, end = j + source_part->index_count; j < end; ++j)
+            {
+                auto &index = remap[indices[j]];
+                if(index == NOT_REMAPPED)
+                {
+                    StaticMesh::Vertex vertex = vertices[indices[j]];
+                    vertex.position = glm::vec3(model * glm::vec4(vertex.position, 1.f));
+                    vertex.normal   = normal_model * vertex.normal;
+
+                    index = static_cast<MeshElementIndex>(geometry.vertices.size());
+                    geometry.vertices.push_back(vertex);
+                }
+
+                geometry.indices.push_back(index);
+            }
+
+            // Mirroring flips the winding, which has to survive back face culling
+            if(is_mirrored)
+                for(size_t j = first; j + 2 < geometry.indices.size(); j += 3)
+                    std::swap(geometry.indices[j + 1], geometry.indices[j + 2]);
+        }
+
+        parts[i].index_count = static_cast<MeshElementIndex>(geometry.indices.size()) - parts[i].index_base;
+        parts[i].lods.push_back({ parts[i].index_base, parts[i].index_count });
+    }
+
+    MeshletBuilder meshlet_builder(geometry.vertices);
+    for(size_t i = 0; i < parts.size(); ++i)
+    {
+        parts[i].meshlets = meshlet_builder.build(geometry.indices, parts[i].index_base, parts[i].index_count);
+        parts[i].material = &materials[i];
+    }
+
+    return StaticMesh::create
+    (
+        "static_batch" + std::to_string(static_batch_id++),
+        std::move(geometry),
+        std::move(parts),
+        std::move(materials),
+        StaticMesh::ImportSource()
+    );
+}
\ No newline at end of file
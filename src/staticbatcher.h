@@ -0,0 +1,28 @@
+#ifndef CG_SEM5_STATICBATCHER_H
+#define CG_SEM5_STATICBATCHER_H
+
+#include <memory>
+#include <vector>
+
+#include "staticmesh.h"
+
+// Bakes immovable static meshes into world space batches, one per cell of a uniform grid.
+// A batch has one part per distinct material (texture and properties), so it is drawn with one call per material,
+// and keeps the meshlets of its parts for culling
+class StaticBatcher
+{
+public:
+    static constexpr float DEFAULT_CELL_SIZE = 16.f;
+
+    StaticBatcher(float cell_size = DEFAULT_CELL_SIZE);
+
+    // Meshes must have their CPU geometry, batches are drawn with the identity model matrix
+    std::vector<std::shared_ptr<StaticMesh>> build(const std::vector<std::shared_ptr<StaticMesh>> &) const;
+
+private:
+    std::shared_ptr<StaticMesh> build_batch(const std::vector<const StaticMesh*> &) const;
+
+    float cell_size;
+};
+
+#endif // CG_SEM5_STATICBATCHER_H
\ No newline at end of file
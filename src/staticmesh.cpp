@@ -1,17 +1,72 @@
+#include <cstring>
+#include <filesystem>
+
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtc/type_ptr.hpp>
 
 #include "staticmesh.h"
+#include "assetregistry.h"
+#include "cookedmesh.h"
+#include "texturepacker.h"
+#include "texturestreamer.h"
+#include "texturecooker.h"
+#include "tgaimage.h"
+#include "virtualtexturecache.h"
+#include "meshsimplifier.h"
+#include "meshletbuilder.h"
+#include "objloader.h"
+#include "gltfloader.h"
+
+void set_material_properties
+(
+    StaticMesh::Material &,
+    const glm::vec4 &ambient,
+    const glm::vec4 &diffuse,
+    const glm::vec4 &specular,
+    float opacity
+);
+
+void load_diffuse_texture
+(
+    std::string_view mesh_path,
+    std::string_view texture_file,
+    const StaticMesh::TextureFormat &,
+    const AssetRegistry *,
+    StaticMesh::Material &,
+    Texture2D::Source &
+);
+
+void load_obj
+(
+    std::string_view path,
+    const StaticMesh::TextureFormat &,
+    const AssetRegistry *,
+    StaticMesh::ImportData &
+);
+
+void load_glb
+(
+    std::string_view path,
+    const StaticMesh::TextureFormat &,
+    const AssetRegistry *,
+    StaticMesh::ImportData &
+);
 
 void load_materials
 (
     const aiScene *,
     std::string_view path,
-    std::shared_ptr<Device> device,
-    VkCommandPool command_pool,
-    VkQueue copy_queue,
-    std::vector<StaticMesh::Material> &materials,
-    std::vector<decltype(materials.begin())> &to_erase
+    const StaticMesh::TextureFormat &,
+    const AssetRegistry *,
+    std::vector<StaticMesh::Material> &,
+    std::vector<Texture2D::Source> &
+);
+
+void remove_untextured_materials
+(
+    std::vector<StaticMesh::Material> &,
+    std::vector<Texture2D::Source> &,
+    std::vector<StaticMesh::Part> &
 );
 
 void load_parts
@@ -23,185 +78,688 @@ void load_parts
     std::vector<MeshElementIndex> &
 );
 
-std::shared_ptr<StaticMesh> StaticMesh::load_from_file
+void generate_lods
 (
-    std::string_view id, 
-    std::string_view path, 
+    uint32_t lod_count,
+    const std::vector<StaticMesh::Vertex> &,
+    std::vector<StaticMesh::Part> &,
+    std::vector<MeshElementIndex> &
+);
+
+void generate_meshlets
+(
+    const std::vector<StaticMesh::Vertex> &,
+    std::vector<StaticMesh::Part> &,
+    std::vector<MeshElementIndex> &
+);
+
+TriangleBvh build_bvh
+(
+    const std::vector<StaticMesh::Vertex> &,
+    const std::vector<StaticMesh::Part> &,
+    const std::vector<MeshElementIndex> &
+);
+
+BoundingBox compute_bounding_box(const StridedView<glm::vec3> &positions);
+BoundingSphere compute_bounding_sphere(const StridedView<glm::vec3> &positions, const BoundingBox &);
+
+// From the vertices of the full resolution range
+void compute_part_bounds(const StaticMesh::Geometry &, StaticMesh::Part &);
+
+void update_vertex_streams(const StaticMesh::Resources &);
+uint64_t hash_geometry(const StaticMesh::Geometry &);
+
+const StaticMesh::TextureFormat StaticMesh::UNCOMPRESSED_TEXTURE_FORMAT = { VK_FORMAT_R8G8B8A8_UNORM, "_rgba8_unorm" };
+
+StaticMesh::TextureFormat StaticMesh::select_texture_format(const Device &device)
+{
+    if(device.features.textureCompressionBC)
+        return { VK_FORMAT_BC3_UNORM_BLOCK, "_bc3_unorm" };
+
+    if(device.features.textureCompressionASTC_LDR)
+        return { VK_FORMAT_ASTC_8x8_UNORM_BLOCK, "_astc_8x8_unorm" };
+
+    // if(device.features.textureCompressionETC2)
+    //     return { VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, "_etc2_unorm" };
+
+    return UNCOMPRESSED_TEXTURE_FORMAT;
+}
+
+StaticMesh::ImportData StaticMesh::import_from_file
+(
+    std::string_view path,
+    const TextureFormat &texture_format,
+    int import_flags,
+    uint32_t lod_count,
+    const AssetRegistry *registry
+)
+{
+    using namespace std::string_literals;
+
+    ImportData data;
+
+    if(CookedMesh::read(path, texture_format, import_flags, lod_count, registry, data))
+        return data;
+
+    if(ObjLoader::can_load(path, import_flags))
+        load_obj(path, texture_format, registry, data);
+    else if(GltfLoader::can_load(path, import_flags))
+        load_glb(path, texture_format, registry, data);
+    else
+    {
+        Assimp::Importer importer;
+        const aiScene *scene = importer.ReadFile(path.data(), import_flags);
+
+        if(scene == nullptr)
+            throw std::runtime_error("Can't load mesh from file \""s + path.data() + "\"");
+
+        load_materials(scene, path, texture_format, registry, data.materials, data.diffuse_sources);
+        load_parts(scene, data.materials, data.parts, data.vertices, data.indices);
+    }
+
+    remove_untextured_materials(data.materials, data.diffuse_sources, data.parts);
+    generate_lods(lod_count, data.vertices, data.parts, data.indices);
+    generate_meshlets(data.vertices, data.parts, data.indices);
+    data.bvh = build_bvh(data.vertices, data.parts, data.indices);
+
+    data.source.path         = path.data();
+    data.source.import_flags = import_flags;
+    data.source.lod_count    = lod_count;
+
+    CookedMesh::write(texture_format, data);
+
+    return data;
+}
+
+std::shared_ptr<StaticMesh> StaticMesh::create
+(
+    std::string_view id,
+    ImportData &&data,
     std::shared_ptr<Device> device,
-    VkCommandPool command_pool,
-    VkQueue copy_queue,
-    int import_flags
+    VkCommandBuffer command_buffer,
+    std::vector<std::shared_ptr<DeviceBuffer>> &staging,
+    AssetRegistry *registry,
+    TextureStreamer *texture_streamer,
+    TexturePacker *texture_packer,
+    VirtualTextureCache *virtual_texture_cache
 )
 {
     using namespace std::string_literals;
 
-    std::vector<Part>             parts;
-    std::vector<Material>         materials;
-    std::vector<Vertex>           vertices;
-    std::vector<MeshElementIndex> indices;
+    for(size_t i = 0; i < data.materials.size(); ++i)
+    {
+        auto &material = data.materials[i];
+        auto &source   = data.diffuse_sources[i];
 
+        if(material.diffuse)
+            continue;
 
-    Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(path.data(), import_flags);
+        if(material.virtual_diffuse)
+        {
+            if(virtual_texture_cache == nullptr)
+                throw std::runtime_error("Can't upload virtual texture \""s + source.path + "\" without a cache");
 
-    if(scene == nullptr)
-        throw std::runtime_error("Can't load mesh from file \""s + path.data() + "\"");
+            staging.emplace_back();
+            material.virtual_diffuse = virtual_texture_cache->add(material.virtual_diffuse, command_buffer, staging.back());
+            material.diffuse         = virtual_texture_cache->get_texture();
+            continue;
+        }
 
-    std::vector<decltype(materials.begin())> to_erase;
+        // Packed textures are never streamed, their whole mip chain fits into the tail
+        if(texture_packer != nullptr && TexturePacker::can_pack(*device, source))
+        {
+            staging.emplace_back();
+            auto placement = texture_packer->pack(source, device, command_buffer, staging.back());
 
-    load_materials(scene, path, device, command_pool, copy_queue, materials, to_erase);
-    load_parts(scene, materials, parts, vertices, indices);
+            material.diffuse        = placement.texture;
+            material.diffuse_region = placement.region;
+            continue;
+        }
 
-    for(auto &&it : to_erase)
-        materials.erase(it);
+        std::string key;
+        if(registry != nullptr && !source.path.empty())
+        {
+            // Uploaded earlier into the same command buffer counts too, it is executed before any use
+            key = AssetRegistry::make_texture_key(source.path, source.format);
+            material.diffuse = registry->find_texture(key);
+            if(material.diffuse)
+                continue;
+        }
 
-    return std::shared_ptr<StaticMesh>
-    (
-        new StaticMesh
+        uint32_t first_resident_level = texture_streamer != nullptr? Texture2D::get_streaming_tail_level(source) : 0;
+
+        staging.emplace_back();
+        material.diffuse = Texture2D::create
         (
-            std::move(parts),
-            std::move(materials),
-            std::move(vertices),
-            std::move(indices)
-        )
+            source,
+            device,
+            command_buffer,
+            staging.back(),
+            VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            first_resident_level
+        );
+
+        if(first_resident_level > 0)
+            texture_streamer->add(material.diffuse, std::move(source));
+
+        if(!key.empty())
+            registry->add_texture(key, material.diffuse);
+    }
+
+    return create
+    (
+        id,
+        { std::move(data.vertices), std::move(data.indices) },
+        std::move(data.parts),
+        std::move(data.materials),
+        std::move(data.source),
+        std::move(data.bvh)
     );
 }
 
-StaticMesh::StaticMesh
+std::shared_ptr<StaticMesh> StaticMesh::create
 (
-    std::vector<Part> &&parts, 
+    std::string_view id,
+    Geometry &&geometry,
+    std::vector<Part> &&parts,
     std::vector<Material> &&materials,
-    std::vector<Vertex> &&vertices,
-    std::vector<MeshElementIndex> &&indices
-) : parts(std::forward<std::vector<Part>>(parts)),
-materials(std::forward<std::vector<Material>>(materials)),
-vertices(std::forward<std::vector<Vertex>>(vertices)),
-indices(std::forward<std::vector<MeshElementIndex>>(indices))
-{}
+    ImportSource &&source,
+    TriangleBvh &&bvh
+)
+{
+    // Parts point into materials, moving the vector keeps its storage
+    auto resources = std::make_shared<Resources>();
+    resources->parts           = std::move(parts);
+    resources->materials       = std::move(materials);
+    resources->vertex_count    = geometry.vertices.size();
+    resources->index_count     = geometry.indices.size();
+    resources->lod_count       = 1;
+    resources->bounding_box    = compute_bounding_box(make_strided_view(geometry.vertices, &Vertex::position));
+    resources->bounding_sphere = compute_bounding_sphere(make_strided_view(geometry.vertices, &Vertex::position), resources->bounding_box);
+    resources->source          = std::move(source);
+    resources->geometry        = std::move(geometry);
+
+    resources->bvh = bvh.empty()
+                   ? build_bvh(resources->geometry.vertices, resources->parts, resources->geometry.indices)
+                   : std::move(bvh);
 
-size_t StaticMesh::get_vertex_count() const
+    for(auto &&part : resources->parts)
+    {
+        resources->lod_count = std::max(resources->lod_count, static_cast<uint32_t>(part.lods.size()));
+        compute_part_bounds(resources->geometry, part);
+    }
+
+    update_vertex_streams(*resources);
+
+    return instantiate(id, resources);
+}
+
+std::shared_ptr<StaticMesh> StaticMesh::instantiate(std::string_view id, std::shared_ptr<const Resources> resources)
 {
-    return vertices.size();
+    return std::shared_ptr<StaticMesh>(new StaticMesh(id, resources));
 }
 
-const glm::vec3 &StaticMesh::get_vertex_position(VertexIndex index) const
+std::shared_ptr<StaticMesh> StaticMesh::instantiate(std::string_view id) const
 {
-    return vertices.at(index).position;
+    return instantiate(id, resources);
 }
 
-const glm::vec2 &StaticMesh::get_vertex_texture(VertexIndex index) const
+std::shared_ptr<StaticMesh> StaticMesh::create_placeholder
+(
+    std::string_view id,
+    std::shared_ptr<Device> device,
+    VkCommandBuffer command_buffer,
+    std::vector<std::shared_ptr<DeviceBuffer>> &staging
+)
 {
-    return vertices.at(index).uv;
+    static constexpr uint32_t WHITE_TEXEL = 0xffffffff;
+    static constexpr size_t   CUBE_SIDES  = 6;
+    static const glm::vec3 NORMALS[CUBE_SIDES] = 
+    {
+        {  1.f,  0.f,  0.f }, { -1.f,  0.f,  0.f },
+        {  0.f,  1.f,  0.f }, {  0.f, -1.f,  0.f },
+        {  0.f,  0.f,  1.f }, {  0.f,  0.f, -1.f }
+    };
+
+    ImportData data;
+
+    for(auto &&normal : NORMALS)
+    {
+        // Side corners are normal +- tangent +- bitangent, counter-clockwise around the normal
+        glm::vec3 tangent   = glm::vec3(normal.z, normal.x, normal.y);
+        glm::vec3 bitangent = glm::cross(normal, tangent);
+        MeshElementIndex base = static_cast<MeshElementIndex>(data.vertices.size());
+
+        for(auto &&corner : { glm::vec2(-1.f, -1.f), glm::vec2(1.f, -1.f), glm::vec2(1.f, 1.f), glm::vec2(-1.f, 1.f) })
+        {
+            Vertex vertex;
+            vertex.position = 0.5f * (normal + corner.x * tangent + corner.y * bitangent);
+            vertex.normal   = normal;
+            vertex.normal.y *= -1;
+            vertex.uv       = 0.5f * (corner + glm::vec2(1.f));
+            vertex.color    = glm::vec3(1.f);
+            data.vertices.push_back(vertex);
+        }
+
+        for(MeshElementIndex index : { 0, 1, 2, 0, 2, 3 })
+            data.indices.push_back(base + index);
+    }
+
+    Material material;
+    material.name                  = "placeholder";
+    material.properties.ambient    = glm::vec4(0.1f);
+    material.properties.diffuse    = glm::vec4(1.f);
+    material.properties.specular   = glm::vec4(0.f);
+    material.properties.opacity    = 1.f;
+    material.descriptor_set        = VK_NULL_HANDLE;
+    material.pipeline              = nullptr;
+    data.materials.push_back(material);
+
+    Texture2D::Source white;
+    white.format = VK_FORMAT_R8G8B8A8_UNORM;
+    white.width  = 1;
+    white.height = 1;
+    white.data   = &WHITE_TEXEL;
+    white.size   = sizeof(WHITE_TEXEL);
+
+    VkBufferImageCopy region               = {};
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount     = 1;
+    region.imageExtent                     = { 1, 1, 1 };
+    white.regions.push_back(region);
+    data.diffuse_sources.push_back(white);
+
+    Part part;
+    part.index_base  = 0;
+    part.index_count = static_cast<MeshElementIndex>(data.indices.size());
+    part.lods.push_back({ part.index_base, part.index_count });
+    part.material    = &data.materials.front();
+    data.parts.push_back(part);
+
+    generate_meshlets(data.vertices, data.parts, data.indices);
+
+    return create(id, std::move(data), device, command_buffer, staging);
 }
 
-const glm::vec3 &StaticMesh::get_vertex_normal(VertexIndex index) const
+std::shared_ptr<StaticMesh> StaticMesh::load_from_file
+(
+    std::string_view id, 
+    std::string_view path, 
+    std::shared_ptr<Device> device,
+    VkCommandPool command_pool,
+    VkQueue copy_queue,
+    int import_flags,
+    uint32_t lod_count
+)
 {
-    return vertices.at(index).normal;
+    ImportData data = import_from_file(path, select_texture_format(*device), import_flags, lod_count);
+    std::vector<std::shared_ptr<DeviceBuffer>> staging;
+
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
+
+    auto mesh = create(id, std::move(data), device, copy_cmd, staging);
+
+    device->end_command_buffer(copy_cmd);
+    device->flush_command_buffer(copy_cmd, copy_queue);
+    vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+
+    return mesh;
 }
 
-const glm::vec3 &StaticMesh::get_vertex_color(VertexIndex index) const
+StaticMesh::StaticMesh(std::string_view id, std::shared_ptr<const Resources> resources)
+: AbstractMesh(id),
+resources(resources),
+occluder(false)
 {
-    return vertices.at(index).color;
+    kind = SceneNodeKind::STATIC_MESH;
+    set_vertex_streams(&resources->vertex_streams);
 }
 
 const void *StaticMesh::get_raw_vertices_data() const
 {
-    return static_cast<const void*>(vertices.data());
+    return static_cast<const void*>(resources->geometry.vertices.data());
 }
 
 const void *StaticMesh::get_raw_indices_data() const
 {
-    return static_cast<const void*>(indices.data());
+    return static_cast<const void*>(resources->geometry.indices.data());
 }
 
 const std::vector<StaticMesh::Vertex> &StaticMesh::get_vertices() const
 {
-    return vertices;
+    return resources->geometry.vertices;
 }
 
 const std::vector<MeshElementIndex> &StaticMesh::get_indices() const
 {
-    return indices;
+    return resources->geometry.indices;
 }
 
 const std::vector<StaticMesh::Part> &StaticMesh::get_parts() const
 {
-    return parts;
+    return resources->parts;
 }
 
 const std::vector<StaticMesh::Material> &StaticMesh::get_materials() const
 {
-    return materials;
+    return resources->materials;
 }
 
-void load_materials
+uint32_t StaticMesh::get_lod_count() const
+{
+    return resources->lod_count;
+}
+
+const BoundingBox &StaticMesh::get_bounding_box() const
+{
+    return resources->bounding_box;
+}
+
+const BoundingSphere &StaticMesh::get_bounding_sphere() const
+{
+    return resources->bounding_sphere;
+}
+
+size_t StaticMesh::get_meshlet_count() const
+{
+    size_t meshlet_count = 0;
+    for(auto &&part : resources->parts)
+        meshlet_count += part.meshlets.size();
+
+    return meshlet_count;
+}
+
+const TriangleBvh &StaticMesh::get_bvh() const
+{
+    return resources->bvh;
+}
+
+const std::shared_ptr<const StaticMesh::Resources> &StaticMesh::get_resources() const
+{
+    return resources;
+}
+
+size_t StaticMesh::get_index_count() const
+{
+    return resources->index_count;
+}
+
+bool StaticMesh::is_occluder() const
+{
+    return occluder;
+}
+
+void StaticMesh::set_occluder(bool occluder)
+{
+    this->occluder = occluder;
+}
+
+bool StaticMesh::has_cpu_geometry() const
+{
+    return resources->geometry.indices.size() == resources->index_count;
+}
+
+bool StaticMesh::release_cpu_geometry()
+{
+    if(resources->source.path.empty())
+        return false;
+
+    if(!has_cpu_geometry())
+        return true;
+
+    resources->geometry_hash = hash_geometry(resources->geometry);
+
+    // Assigning empty vectors gives the memory back, clear() would keep the capacity
+    resources->geometry = Geometry();
+    update_vertex_streams(*resources);
+
+    return true;
+}
+
+void StaticMesh::restore_cpu_geometry(Geometry &&geometry)
+{
+    using namespace std::string_literals;
+
+    bool is_matching = geometry.vertices.size() == resources->vertex_count
+                    && geometry.indices.size() == resources->index_count
+                    && hash_geometry(geometry) == resources->geometry_hash;
+
+    if(!is_matching)
+        throw std::runtime_error("Restored geometry of \""s + resources->source.path + "\" doesn't match the released one");
+
+    resources->geometry = std::move(geometry);
+    update_vertex_streams(*resources);
+}
+
+void set_material_properties
+(
+    StaticMesh::Material &material,
+    const glm::vec4 &ambient,
+    const glm::vec4 &diffuse,
+    const glm::vec4 &specular,
+    float opacity
+)
+{
+    material.properties.ambient  = ambient + glm::vec4(0.1f);
+    material.properties.diffuse  = diffuse;
+    material.properties.specular = specular;
+    material.properties.opacity  = opacity;
+
+    if(material.properties.opacity > 0.f)
+        material.properties.specular = glm::vec4(0.f);
+}
+
+void load_diffuse_texture
+(
+    std::string_view mesh_path,
+    std::string_view texture_file,
+    const StaticMesh::TextureFormat &texture_format,
+    const AssetRegistry *registry,
+    StaticMesh::Material &material,
+    Texture2D::Source &source
+)
+{
+    std::string directory = mesh_path.data();
+    directory = directory.substr(0, mesh_path.find_last_of('/'));
+
+    // Prebaked "<name><suffix>.ktx" next to the texture, otherwise cooked from "<name>.tga"
+    auto stem = std::filesystem::path(directory + '/' + std::string(texture_file)).replace_extension().string();
+    std::string compressed_texture_file = stem + texture_format.file_suffix + ".ktx";
+    std::string source_image = stem + ".tga";
+    VkFormat format = texture_format.format;
+
+    std::error_code error;
+    if(!std::filesystem::exists(compressed_texture_file, error) && std::filesystem::exists(source_image, error))
+    {
+        auto image = TgaImage::load_header(source_image);
+        if(std::max(image.width, image.height) > VirtualTexture::MIN_SIZE)
+        {
+            std::string virtual_texture_file = stem + ".vtex";
+            if(!TextureCooker::is_up_to_date(source_image, virtual_texture_file))
+                TextureCooker::cook_virtual(source_image, virtual_texture_file);
+
+            // Pages are read when they are needed on screen
+            material.virtual_diffuse = VirtualTexture::open(virtual_texture_file);
+            source.format = VirtualTexture::FORMAT;
+            source.path   = virtual_texture_file;
+            return;
+        }
+
+        auto &cook_format = TextureCooker::can_cook(format)? texture_format : StaticMesh::UNCOMPRESSED_TEXTURE_FORMAT;
+
+        compressed_texture_file = stem + cook_format.file_suffix + ".cooked.ktx";
+        format = cook_format.format;
+
+        if(!TextureCooker::is_up_to_date(source_image, compressed_texture_file))
+            TextureCooker::cook(source_image, compressed_texture_file, format);
+    }
+
+    if(registry != nullptr)
+    {
+        material.diffuse = registry->find_texture(AssetRegistry::make_texture_key(compressed_texture_file, format));
+        if(material.diffuse)
+        {
+            // Kept for cooking
+            source.format = format;
+            source.path   = compressed_texture_file;
+            return;
+        }
+    }
+
+    source = Texture2D::read_source(compressed_texture_file, format);
+}
+
+void load_obj
 (
-    const aiScene *scene,
     std::string_view path,
-    std::shared_ptr<Device> device,
-    VkCommandPool command_pool,
-    VkQueue copy_queue,
-    std::vector<StaticMesh::Material> &materials,
-    std::vector<decltype(materials.begin())> &to_erase
+    const StaticMesh::TextureFormat &texture_format,
+    const AssetRegistry *registry,
+    StaticMesh::ImportData &data
 )
 {
-    materials.resize(scene->mNumMaterials);
-    for(size_t i = 0; i < materials.size(); ++i)
+    auto mesh = ObjLoader::load(path);
+
+    data.materials.resize(mesh.materials.size());
+    data.diffuse_sources.resize(mesh.materials.size());
+    for(size_t i = 0; i < mesh.materials.size(); ++i)
     {
-        aiString material_name;
-        scene->mMaterials[i]->Get(AI_MATKEY_NAME, material_name);
-        materials[i].name = material_name.C_Str();
+        auto &material = mesh.materials[i];
+        data.materials[i].name = material.name;
+        set_material_properties(data.materials[i], material.ambient, material.diffuse, material.specular, material.opacity);
+
+        if(!material.diffuse_texture.empty())
+            load_diffuse_texture(path, material.diffuse_texture, texture_format, registry, data.materials[i], data.diffuse_sources[i]);
+    }
+
+    for(auto &&group : mesh.groups)
+    {
+        StaticMesh::Part part;
+        part.index_base  = group.index_base;
+        part.index_count = group.index_count;
+        part.lods.push_back({ part.index_base, part.index_count });
+        part.material    = &data.materials[group.material];
+        data.parts.push_back(part);
+    }
 
-        aiColor4D color;
-        scene->mMaterials[i]->Get(AI_MATKEY_COLOR_AMBIENT, color);
-        materials[i].properties.ambient = glm::make_vec4(&color.r) + glm::vec4(0.1f);
+    data.vertices = std::move(mesh.vertices);
+    data.indices  = std::move(mesh.indices);
+}
 
-        scene->mMaterials[i]->Get(AI_MATKEY_COLOR_DIFFUSE, color);
-        materials[i].properties.diffuse = glm::make_vec4(&color.r);
+void load_glb
+(
+    std::string_view path,
+    const StaticMesh::TextureFormat &texture_format,
+    const AssetRegistry *registry,
+    StaticMesh::ImportData &data
+)
+{
+    using namespace std::string_literals;
 
-        scene->mMaterials[i]->Get(AI_MATKEY_COLOR_SPECULAR, color);
-        materials[i].properties.specular = glm::make_vec4(&color.r);
+    auto mesh = GltfLoader::load(path);
 
-        scene->mMaterials[i]->Get(AI_MATKEY_OPACITY, materials[i].properties.opacity);
+    data.materials.resize(mesh.materials.size());
+    data.diffuse_sources.resize(mesh.materials.size());
+    for(size_t i = 0; i < mesh.materials.size(); ++i)
+    {
+        auto &material = mesh.materials[i];
+        data.materials[i].name = material.name;
+        set_material_properties(data.materials[i], glm::vec4(0.f), material.base_color, glm::vec4(0.f), material.base_color.a);
 
-        if(materials[i].properties.opacity > 0.f)
-            materials[i].properties.specular = glm::vec4(0.f);
+        if(material.image == GltfLoader::NO_IMAGE)
+            continue;
 
-        VkFormat texture_format;
-        std::string texture_format_suffix;
-        if(device->features.textureCompressionBC)
+        auto &image = mesh.images[material.image];
+        if(image.data == nullptr)
         {
-            texture_format = VK_FORMAT_BC3_UNORM_BLOCK;
-            texture_format_suffix = "_bc3_unorm";
+            // External images go through the same compressed texture lookup as other formats
+            if(image.uri.size() > 4 && image.uri.compare(image.uri.size() - 4, 4, ".ktx") == 0)
+                load_diffuse_texture(path, image.uri, texture_format, registry, data.materials[i], data.diffuse_sources[i]);
+
+            continue;
         }
-        else if(device->features.textureCompressionASTC_LDR)
+
+        if(image.mime_type != "image/ktx2")
+            continue;
+
+        // Embedded KTX2 levels stay in the mapped file until they are staged
+        auto source = Texture2D::read_ktx2_source
+        (
+            image.data,
+            image.size,
+            mesh.file,
+            std::string(path) + "#image" + std::to_string(material.image)
+        );
+
+        if(source.format != texture_format.format && source.format != VK_FORMAT_R8G8B8A8_UNORM && source.format != VK_FORMAT_R8G8B8A8_SRGB)
+            throw std::runtime_error("Unsupported texture format in \""s + source.path + "\"");
+
+        if(registry != nullptr)
         {
-            texture_format = VK_FORMAT_ASTC_8x8_UNORM_BLOCK;
-            texture_format_suffix = "_astc_8x8_unorm";
+            data.materials[i].diffuse = registry->find_texture(AssetRegistry::make_texture_key(source.path, source.format));
+            if(data.materials[i].diffuse)
+                continue;
         }
-        // else if(device->features.textureCompressionETC2)
-        // {
-        //     texture_format = VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK;
-        //     texture_format_suffix = "_etc2_unorm";
-        // }
-        else
-            throw std::runtime_error("Device does not support any compressed texture format");
+
+        data.diffuse_sources[i] = std::move(source);
+    }
+
+    for(auto &&group : mesh.groups)
+    {
+        StaticMesh::Part part;
+        part.index_base  = group.index_base;
+        part.index_count = group.index_count;
+        part.lods.push_back({ part.index_base, part.index_count });
+        part.material    = &data.materials[group.material];
+        data.parts.push_back(part);
+    }
+
+    data.vertices = std::move(mesh.vertices);
+    data.indices  = std::move(mesh.indices);
+}
+
+void load_materials
+(
+    const aiScene *scene,
+    std::string_view path,
+    const StaticMesh::TextureFormat &texture_format,
+    const AssetRegistry *registry,
+    std::vector<StaticMesh::Material> &materials,
+    std::vector<Texture2D::Source> &diffuse_sources
+)
+{
+    materials.resize(scene->mNumMaterials);
+    diffuse_sources.resize(scene->mNumMaterials);
+    for(size_t i = 0; i < materials.size(); ++i)
+    {
+        aiString material_name;
+        scene->mMaterials[i]->Get(AI_MATKEY_NAME, material_name);
+        materials[i].name = material_name.C_Str();
+
+        aiColor4D ambient, diffuse, specular;
+        float opacity = 1.f;
+        scene->mMaterials[i]->Get(AI_MATKEY_COLOR_AMBIENT, ambient);
+        scene->mMaterials[i]->Get(AI_MATKEY_COLOR_DIFFUSE, diffuse);
+        scene->mMaterials[i]->Get(AI_MATKEY_COLOR_SPECULAR, specular);
+        scene->mMaterials[i]->Get(AI_MATKEY_OPACITY, opacity);
+
+        set_material_properties
+        (
+            materials[i],
+            glm::make_vec4(&ambient.r),
+            glm::make_vec4(&diffuse.r),
+            glm::make_vec4(&specular.r),
+            opacity
+        );
 
         if(scene->mMaterials[i]->GetTextureCount(aiTextureType_DIFFUSE) < 1)
-        {
-            to_erase.push_back(materials.begin() + i);
             continue;
-        }
             // throw std::runtime_error("Textures not found");
 
         aiString texture_file;
         scene->mMaterials[i]->GetTexture(aiTextureType_DIFFUSE, 0, &texture_file);
-        
-        std::string directory = path.data();
-        directory = directory.substr(0, path.find_last_of('/'));
-        std::string compressed_texture_file = directory + '/' + texture_file.C_Str();
-        compressed_texture_file.insert(compressed_texture_file.find(".ktx"), texture_format_suffix); // !!!
-        materials[i].diffuse = Texture2D::load_from_file(compressed_texture_file, texture_format, device, command_pool, copy_queue);
+        load_diffuse_texture(path, texture_file.C_Str(), texture_format, registry, materials[i], diffuse_sources[i]);
     }
 }
 
@@ -215,7 +773,8 @@ void load_parts
 )
 {
     static constexpr MeshElementIndex FACE_ELEMENT_COUNT = 3;
-    MeshElementIndex index_base = 0;
+    MeshElementIndex index_base  = 0;
+    MeshElementIndex vertex_base = 0;
 
     parts.resize(scene->mNumMeshes);
 
@@ -252,8 +811,222 @@ void load_parts
         }
 
         for(f = 0; f < mesh->mNumFaces; ++f)
-            for(j = 0; j < FACE_ELEMENT_COUNT; ++j) indices.push_back(mesh->mFaces[f].mIndices[j]);
+            for(j = 0; j < FACE_ELEMENT_COUNT; ++j) indices.push_back(vertex_base + mesh->mFaces[f].mIndices[j]);
+
+        parts[i].lods.push_back({ parts[i].index_base, parts[i].index_count });
+
+        index_base  += mesh->mNumFaces * FACE_ELEMENT_COUNT;
+        vertex_base += mesh->mNumVertices;
+    }
+}
 
-        index_base += mesh->mNumFaces * FACE_ELEMENT_COUNT;
+void remove_untextured_materials
+(
+    std::vector<StaticMesh::Material> &materials,
+    std::vector<Texture2D::Source> &diffuse_sources,
+    std::vector<StaticMesh::Part> &parts
+)
+{
+    // Parts keep pointers into materials, so they are remapped instead of erasing in place
+    std::vector<StaticMesh::Material> textured_materials;
+    std::vector<Texture2D::Source> textured_sources;
+    std::vector<const StaticMesh::Material*> remap(materials.size(), nullptr);
+    textured_materials.reserve(materials.size());
+
+    for(size_t i = 0; i < materials.size(); ++i)
+    {
+        if(diffuse_sources[i].data == nullptr && !materials[i].diffuse && !materials[i].virtual_diffuse)
+            continue;
+
+        textured_sources.push_back(std::move(diffuse_sources[i]));
+        textured_materials.push_back(std::move(materials[i]));
+        remap[i] = &textured_materials.back();
+    }
+
+    std::vector<StaticMesh::Part> textured_parts;
+    for(auto &&part : parts)
+    {
+        auto material = remap[part.material - materials.data()];
+        if(material == nullptr)
+            continue;
+
+        part.material = material;
+        textured_parts.push_back(std::move(part));
+    }
+
+    materials       = std::move(textured_materials);
+    diffuse_sources = std::move(textured_sources);
+    parts           = std::move(textured_parts);
+}
+
+void generate_lods
+(
+    uint32_t lod_count,
+    const std::vector<StaticMesh::Vertex> &vertices,
+    std::vector<StaticMesh::Part> &parts,
+    std::vector<MeshElementIndex> &indices
+)
+{
+    static constexpr MeshElementIndex FACE_ELEMENT_COUNT = 3;
+    static constexpr float MAX_LOD_ERROR = 0.05f; // Relative to the mesh extent
+
+    if(lod_count < 2)
+        return;
+
+    MeshSimplifier simplifier(vertices);
+
+    for(auto &&part : parts)
+    {
+        std::vector<MeshElementIndex> lod_indices(indices.begin() + part.index_base, indices.begin() + part.index_base + part.index_count);
+
+        for(uint32_t i = 1; i < lod_count; ++i)
+        {
+            size_t target_index_count = lod_indices.size() / (2 * FACE_ELEMENT_COUNT) * FACE_ELEMENT_COUNT;
+            float target_error = MAX_LOD_ERROR * static_cast<float>(i) / static_cast<float>(lod_count - 1);
+
+            lod_indices = simplifier.simplify(lod_indices.data(), lod_indices.size(), target_index_count, target_error);
+
+            // Stop when the simplifier can't remove at least a quarter of the triangles
+            if(lod_indices.empty() || lod_indices.size() * 4 > part.lods.back().index_count * 3)
+                break;
+
+            part.lods.push_back
+            ({
+                static_cast<MeshElementIndex>(indices.size()),
+                static_cast<MeshElementIndex>(lod_indices.size())
+            });
+
+            indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+        }
+    }
+}
+
+void generate_meshlets
+(
+    const std::vector<StaticMesh::Vertex> &vertices,
+    std::vector<StaticMesh::Part> &parts,
+    std::vector<MeshElementIndex> &indices
+)
+{
+    MeshletBuilder builder(vertices);
+
+    for(auto &&part : parts)
+        part.meshlets = builder.build(indices, part.index_base, part.index_count);
+}
+
+TriangleBvh build_bvh
+(
+    const std::vector<StaticMesh::Vertex> &vertices,
+    const std::vector<StaticMesh::Part> &parts,
+    const std::vector<MeshElementIndex> &indices
+)
+{
+    std::vector<MeshElementIndex> triangles;
+    for(auto &&part : parts)
+        for(MeshElementIndex i = part.index_base, end = part.index_base + part.index_count; i + 2 < end; i += 3)
+            triangles.push_back(i);
+
+    return TriangleBvh::build(make_strided_view(vertices, &StaticMesh::Vertex::position), indices, triangles);
+}
+
+void update_vertex_streams(const StaticMesh::Resources &resources)
+{
+    auto &vertices = resources.geometry.vertices;
+    auto &streams  = resources.vertex_streams;
+
+    streams.count     = resources.vertex_count;
+    streams.positions = make_strided_view(vertices, &StaticMesh::Vertex::position);
+    streams.normals   = make_strided_view(vertices, &StaticMesh::Vertex::normal);
+    streams.uvs       = make_strided_view(vertices, &StaticMesh::Vertex::uv);
+    streams.colors    = make_strided_view(vertices, &StaticMesh::Vertex::color);
+}
+
+BoundingBox compute_bounding_box(const StridedView<glm::vec3> &positions)
+{
+    BoundingBox box;
+    if(positions.empty())
+        return box;
+
+    box.min = positions[0];
+    box.max = positions[0];
+    for(size_t i = 1, count = positions.size(); i < count; ++i)
+    {
+        box.min = glm::min(box.min, positions[i]);
+        box.max = glm::max(box.max, positions[i]);
     }
+
+    return box;
+}
+
+BoundingSphere compute_bounding_sphere(const StridedView<glm::vec3> &positions, const BoundingBox &box)
+{
+    BoundingSphere sphere;
+    if(positions.empty())
+        return sphere;
+
+    // Squared distances keep the loop free of sqrt
+    float radius_squared = 0.f;
+    sphere.center = 0.5f * (box.min + box.max);
+    for(size_t i = 0, count = positions.size(); i < count; ++i)
+    {
+        glm::vec3 offset = positions[i] - sphere.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+
+    sphere.radius = std::sqrt(radius_squared);
+
+    return sphere;
+}
+
+void compute_part_bounds(const StaticMesh::Geometry &geometry, StaticMesh::Part &part)
+{
+    if(part.index_count == 0)
+        return;
+
+    auto &vertices = geometry.vertices;
+    auto &indices  = geometry.indices;
+
+    glm::vec3 first = vertices[indices[part.index_base]].position;
+    part.bounding_box.min = first;
+    part.bounding_box.max = first;
+    for(MeshElementIndex i = part.index_base + 1, end = part.index_base + part.index_count; i < end; ++i)
+    {
+        part.bounding_box.min = glm::min(part.bounding_box.min, vertices[indices[i]].position);
+        part.bounding_box.max = glm::max(part.bounding_box.max, vertices[indices[i]].position);
+    }
+
+    float radius_squared = 0.f;
+    part.bounding_sphere.center = 0.5f * (part.bounding_box.min + part.bounding_box.max);
+    for(MeshElementIndex i = part.index_base, end = part.index_base + part.index_count; i < end; ++i)
+    {
+        glm::vec3 offset = vertices[indices[i]].position - part.bounding_sphere.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+
+    part.bounding_sphere.radius = std::sqrt(radius_squared);
+}
+
+uint64_t hash_geometry(const StaticMesh::Geometry &geometry)
+{
+    // FNV-1a over eight bytes at a time, the tails byte by byte
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](const void *data, size_t size)
+    {
+        auto bytes = static_cast<const uint8_t*>(data);
+        size_t i = 0;
+        for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+
+        for(; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+    };
+
+    add(geometry.vertices.data(), geometry.vertices.size() * sizeof(StaticMesh::Vertex));
+    add(geometry.indices.data(), geometry.indices.size() * sizeof(MeshElementIndex));
+
+    return hash;
 }
\ No newline at end of file
@@ -15,8 +15,16 @@
 #include <glm/vec4.hpp>
 
 #include "abstractmesh.h"
+#include "boundingvolume.h"
 #include "device.h"
 #include "texture2d.h"
+#include "trianglebvh.h"
+
+class AssetRegistry;
+class TexturePacker;
+class TextureStreamer;
+class VirtualTexture;
+class VirtualTextureCache;
 
 class StaticMesh : public AbstractMesh 
 {
@@ -29,11 +37,23 @@ public:
         float opacity;
     };
 
+    // Part of the texture image a material samples. Packed textures share an array image,
+    // each fills a corner of its own layer. Members are in the order shaders read them
+    struct TextureRegion
+    {
+        float     layer    = 0.f;
+        glm::vec2 uv_scale = glm::vec2(1.f);
+    };
+
     struct Material
     {
         std::string                name;
         MaterialProperties         properties;
         std::shared_ptr<Texture2D> diffuse;
+        TextureRegion              diffuse_region;
+
+        // Images too large to load whole, diffuse is then the page cache shared by every virtual texture
+        std::shared_ptr<VirtualTexture> virtual_diffuse;
 
         VkDescriptorSet descriptor_set;
         VkPipeline     *pipeline;
@@ -47,18 +67,156 @@ public:
         glm::vec3 color;
     };
 
+    struct Lod
+    {
+        MeshElementIndex index_base;
+        MeshElementIndex index_count;
+    };
+
+    // Cluster of the full resolution part, its triangles are contiguous in the index buffer
+    struct Meshlet
+    {
+        MeshElementIndex index_base;
+        MeshElementIndex index_count;
+
+        BoundingSphere bounds;
+
+        // Every triangle faces away from the viewer when
+        // dot(center - viewer, cone_axis) >= cone_cutoff * |center - viewer| + radius
+        glm::vec3 cone_axis;
+        float     cone_cutoff;
+    };
+
     struct Part
     {
         MeshElementIndex index_base;
         MeshElementIndex index_count;
 
+        // lods[0] is the full resolution range above, every next one has about half of the triangles
+        std::vector<Lod> lods;
+
+        std::vector<Meshlet> meshlets;
+
+        // Of the full resolution range, computed when the mesh is created
+        BoundingBox    bounding_box;
+        BoundingSphere bounding_sphere;
+
         const Material *material;
     };
 
 
     static constexpr int DEFAULT_IMPORT_FLAGS = aiProcess_Triangulate 
                                               | aiProcess_PreTransformVertices
-                                              | aiProcess_GenNormals;
+                                              | aiProcess_GenNormals
+                                              | aiProcess_JoinIdenticalVertices;
+
+    static constexpr uint32_t DEFAULT_LOD_COUNT = 4;
+
+    struct Geometry
+    {
+        std::vector<Vertex>           vertices;
+        std::vector<MeshElementIndex> indices;
+    };
+
+    // Importing the same source with the same parameters reproduces the geometry
+    struct ImportSource
+    {
+        std::string path; // Empty for generated meshes
+        int         import_flags = DEFAULT_IMPORT_FLAGS;
+        uint32_t    lod_count    = DEFAULT_LOD_COUNT;
+    };
+
+    // Geometry and materials shared by every instance of one imported asset
+    struct Resources
+    {
+        std::vector<Part>     parts;
+        std::vector<Material> materials;
+
+        size_t         vertex_count;
+        size_t         index_count;
+        uint32_t       lod_count;
+        BoundingBox    bounding_box;
+        BoundingSphere bounding_sphere;
+        TriangleBvh    bvh;
+        ImportSource   source;
+
+        // CPU copy of the geometry, empty while released.
+        // Released and restored only by the thread that renders
+        mutable Geometry      geometry;
+        mutable VertexStreams vertex_streams;
+        mutable uint64_t      geometry_hash = 0; // Of the released geometry, restored one must match it
+    };
+
+    struct TextureFormat
+    {
+        VkFormat    format;
+        std::string file_suffix;
+    };
+
+    // Everything load_from_file produces on the CPU, importing doesn't touch the device
+    struct ImportData
+    {
+        std::vector<Part>               parts;
+        std::vector<Material>           materials;
+        std::vector<Texture2D::Source>  diffuse_sources; // One per material, virtual textures have only the path and format
+        std::vector<Vertex>             vertices;
+        std::vector<MeshElementIndex>   indices;
+        TriangleBvh                     bvh; // Over the full resolution triangles of the parts
+        ImportSource                    source;
+    };
+
+    // Used when the device has no supported compressed format, or the format can't be cooked on the CPU
+    static const TextureFormat UNCOMPRESSED_TEXTURE_FORMAT;
+
+    static TextureFormat select_texture_format(const Device &);
+
+    static ImportData import_from_file
+    (
+        std::string_view path,
+        const TextureFormat &,
+        int import_flags = DEFAULT_IMPORT_FLAGS,
+        uint32_t lod_count = DEFAULT_LOD_COUNT,
+        const AssetRegistry * = nullptr // Textures resident in it are not read again
+    );
+
+    // Records texture uploads into command_buffer, staging buffers must live until it is executed
+    static std::shared_ptr<StaticMesh> create
+    (
+        std::string_view id,
+        ImportData &&,
+        std::shared_ptr<Device>,
+        VkCommandBuffer command_buffer,
+        std::vector<std::shared_ptr<DeviceBuffer>> &staging,
+        AssetRegistry * = nullptr, // Textures are shared through it
+        TextureStreamer * = nullptr, // Textures get only their mip tail, finer levels are handed to it
+        TexturePacker * = nullptr, // Small textures are packed into shared arrays
+        VirtualTextureCache * = nullptr // Required for materials with virtual textures
+    );
+
+    // Materials must already have their textures, nothing is uploaded.
+    // An empty BVH is built from the geometry
+    static std::shared_ptr<StaticMesh> create
+    (
+        std::string_view id,
+        Geometry &&,
+        std::vector<Part> &&,
+        std::vector<Material> &&,
+        ImportSource &&,
+        TriangleBvh && = TriangleBvh()
+    );
+
+    // New actor sharing the resources, nothing is loaded or uploaded
+    static std::shared_ptr<StaticMesh> instantiate(std::string_view id, std::shared_ptr<const Resources>);
+    std::shared_ptr<StaticMesh> instantiate(std::string_view id) const;
+
+    // White unit cube, drawn while the real mesh is loading
+    static std::shared_ptr<StaticMesh> create_placeholder
+    (
+        std::string_view id,
+        std::shared_ptr<Device>,
+        VkCommandBuffer command_buffer,
+        std::vector<std::shared_ptr<DeviceBuffer>> &staging
+    );
 
     static std::shared_ptr<StaticMesh> load_from_file
     (
@@ -67,16 +225,10 @@ public:
         std::shared_ptr<Device>,
         VkCommandPool command_pool,
         VkQueue copy_queue,
-        int import_flags = DEFAULT_IMPORT_FLAGS
+        int import_flags = DEFAULT_IMPORT_FLAGS,
+        uint32_t lod_count = DEFAULT_LOD_COUNT
     );
 
-    virtual size_t get_vertex_count() const override;
-
-    virtual const glm::vec3 &get_vertex_position(VertexIndex) const override;
-    virtual const glm::vec2 &get_vertex_texture(VertexIndex) const override;
-    virtual const glm::vec3 &get_vertex_normal(VertexIndex) const override;
-    virtual const glm::vec3 &get_vertex_color(VertexIndex) const override;
-
     virtual const void *get_raw_vertices_data() const override;
     virtual const void *get_raw_indices_data() const override;
 
@@ -86,20 +238,31 @@ public:
     const std::vector<Part> &get_parts() const;
     const std::vector<Material> &get_materials() const;
 
-private:
-    StaticMesh
-    (
-        std::vector<Part> &&parts, 
-        std::vector<Material> &&materials,
-        std::vector<Vertex> &&vertices,
-        std::vector<MeshElementIndex> &&indices
-    );
+    uint32_t get_lod_count() const;
+    const BoundingBox &get_bounding_box() const;
+    const BoundingSphere &get_bounding_sphere() const;
+    size_t get_meshlet_count() const;
+    const TriangleBvh &get_bvh() const;
 
-    std::vector<Part>     parts;
-    std::vector<Material> materials;
+    const std::shared_ptr<const Resources> &get_resources() const;
+    size_t get_index_count() const;
+
+    // Occluders are rasterized by the renderer to reject draws behind them, large closed meshes like walls suit best.
+    // Set before the scene is prepared
+    bool is_occluder() const;
+    void set_occluder(bool);
+
+    // Residency of the CPU copy, the device copy is owned by the renderer.
+    // Releasing is shared by every instance and refused for meshes that can't be imported again
+    bool has_cpu_geometry() const;
+    bool release_cpu_geometry();
+    void restore_cpu_geometry(Geometry &&); // Throws if it doesn't match the released geometry
+
+private:
+    StaticMesh(std::string_view id, std::shared_ptr<const Resources>);
 
-    std::vector<Vertex>   vertices;
-    std::vector<MeshElementIndex> indices;
+    std::shared_ptr<const Resources> resources;
+    bool occluder;
 };
 
 #endif // CG_SEM5_OBJMESH_H
\ No newline at end of file
@@ -0,0 +1,129 @@
+#ifndef CG_SEM5_STRIDEDVIEW_H
+#define CG_SEM5_STRIDEDVIEW_H
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Read-only view of one attribute in an array of structures.
+// Element access is an inline multiply-add, so loops over a view can be unrolled and vectorized
+template <typename T>
+class StridedView
+{
+public:
+    class Iterator
+    {
+    public:
+        Iterator(const std::byte *element, size_t stride)
+        : element(element),
+        stride(stride)
+        {}
+
+        const T &operator*() const
+        {
+            return *reinterpret_cast<const T*>(element);
+        }
+
+        Iterator &operator++()
+        {
+            element += stride;
+            return *this;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return element != other.element;
+        }
+
+    private:
+        const std::byte *element;
+        size_t stride;
+    };
+
+    StridedView()
+    : data(nullptr),
+    count(0),
+    stride(sizeof(T))
+    {}
+
+    StridedView(const void *data, size_t count, size_t stride = sizeof(T))
+    : data(static_cast<const std::byte*>(data)),
+    count(count),
+    stride(stride)
+    {}
+
+    const T &operator[](size_t index) const
+    {
+        return *reinterpret_cast<const T*>(data + index * stride);
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    bool empty() const
+    {
+        return count == 0;
+    }
+
+    size_t get_stride() const
+    {
+        return stride;
+    }
+
+    bool is_contiguous() const
+    {
+        return stride == sizeof(T);
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(data, stride);
+    }
+
+    Iterator end() const
+    {
+        return Iterator(data + count * stride, stride);
+    }
+
+    // Tightly packed copy (structure of arrays), one memcpy when the view is already contiguous
+    void copy_to(T *destination) const
+    {
+        if(is_contiguous())
+        {
+            if(count > 0)
+                std::memcpy(destination, data, count * sizeof(T));
+
+            return;
+        }
+
+        for(size_t i = 0; i < count; ++i)
+            destination[i] = (*this)[i];
+    }
+
+    std::vector<T> to_vector() const
+    {
+        std::vector<T> elements(count);
+        copy_to(elements.data());
+
+        return elements;
+    }
+
+private:
+    const std::byte *data;
+    size_t count;
+    size_t stride;
+};
+
+// View of one member of every element
+template <typename T, typename Element>
+StridedView<T> make_strided_view(const std::vector<Element> &elements, T Element::*member)
+{
+    if(elements.empty())
+        return StridedView<T>();
+
+    return StridedView<T>(&(elements.front().*member), elements.size(), sizeof(Element));
+}
+
+#endif // CG_SEM5_STRIDEDVIEW_H
\ No newline at end of file
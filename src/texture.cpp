@@ -16,11 +16,10 @@ void Texture::destroy()
 {
     vkDestroyImageView(*device, view, nullptr);
     vkDestroyImage(*device, image, nullptr);
-    if(sampler != nullptr)
-    {
+    if(sampler != nullptr && owns_sampler)
         vkDestroySampler(*device, sampler, nullptr);
-        sampler = nullptr;
-    }
+
+    sampler = nullptr;
     
     vkFreeMemory(*device, device_memory, nullptr);
 }
\ No newline at end of file
@@ -12,6 +12,7 @@ struct Texture
     VkImage                 image;
     VkImageLayout           image_layout;
     VkDeviceMemory          device_memory;
+    VkDeviceSize            memory_size;
     VkImageView             view;
     uint32_t                width, height;
     uint32_t                mip_levels;
@@ -19,6 +20,7 @@ struct Texture
     VkDescriptorImageInfo   descriptor;
 
     VkSampler sampler;
+    bool      owns_sampler = true; // False for samplers shared through the device sampler cache
 
     virtual ~Texture();
 
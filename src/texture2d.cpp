@@ -1,8 +1,34 @@
+#include <cstring>
+
 #include <gli/gli.hpp>
 
 #include "texture2d.h"
+#include "mappedfile.h"
 #include "vkassert.h"
 
+VkImageView create_view(const Texture2D &);
+
+// Image and its device memory for the extent, format, levels and layers of the texture
+void allocate_image(Texture2D &, VkImageUsageFlags);
+
+VkSampler get_default_sampler(Device &);
+
+// Levels are referenced in the mapping, the staging copy is the only one
+Texture2D::Source read_ktx_source(std::shared_ptr<const MappedFile>, std::string_view path, VkFormat);
+
+bool has_extension(std::string_view path, std::string_view extension);
+
+// Copies the levels from first_level on into one staging allocation, each at an offset aligned for any
+// texel block. Levels may be apart in the source (KTX stores each size in front of it).
+// Returns the copy regions of the levels pointing into staging
+std::vector<VkBufferImageCopy> stage_levels
+(
+    Device &,
+    const Texture2D::Source &,
+    uint32_t first_level,
+    std::shared_ptr<DeviceBuffer> &staging
+);
+
 void set_image_layout
 (
     VkCommandBuffer command_buffer,
@@ -131,6 +157,159 @@ void set_image_layout
     );
 }
 
+Texture2D::Source Texture2D::read_source(std::string_view path, VkFormat format)
+{
+    using namespace std::string_literals;
+
+    if(has_extension(path, ".ktx"))
+        return read_ktx_source(std::make_shared<MappedFile>(path), path, format);
+
+    if(has_extension(path, ".ktx2"))
+    {
+        auto file = std::make_shared<MappedFile>(path);
+        return read_ktx2_source(file->get_data(), file->get_size(), file, path);
+    }
+
+    auto texture2d = std::make_shared<gli::texture2d>(gli::load(path.data()));
+
+    if(texture2d->empty())
+        throw std::runtime_error("Can't load texture from file \""s + path.data() + "\"");
+
+    Source source;
+    source.format  = format;
+    source.width   = static_cast<uint32_t>((*texture2d)[0].extent().x);
+    source.height  = static_cast<uint32_t>((*texture2d)[0].extent().y);
+    source.data    = texture2d->data();
+    source.size    = texture2d->size();
+    source.storage = texture2d;
+    source.path    = path.data();
+
+    uint32_t offset = 0;
+
+    for(uint32_t i = 0, mip_levels = static_cast<uint32_t>(texture2d->levels()); i < mip_levels; ++i)
+    {
+        VkBufferImageCopy buffer_copy_region               = {};
+        buffer_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        buffer_copy_region.imageSubresource.mipLevel       = i;
+        buffer_copy_region.imageSubresource.baseArrayLayer = 0;
+        buffer_copy_region.imageSubresource.layerCount     = 1;
+        buffer_copy_region.imageExtent.width               = static_cast<uint32_t>((*texture2d)[i].extent().x);
+        buffer_copy_region.imageExtent.height              = static_cast<uint32_t>((*texture2d)[i].extent().y);
+        buffer_copy_region.imageExtent.depth               = 1;
+        buffer_copy_region.bufferOffset                    = offset;
+
+        source.regions.push_back(buffer_copy_region);
+
+        offset += static_cast<uint32_t>((*texture2d)[i].size());
+    }
+
+    return source;
+}
+
+Texture2D::Source Texture2D::read_ktx2_source
+(
+    const void *data,
+    size_t size,
+    std::shared_ptr<const void> storage,
+    std::string_view path
+)
+{
+    using namespace std::string_literals;
+
+    static constexpr uint8_t KTX2_IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n' };
+
+    struct Ktx2Header
+    {
+        uint8_t  identifier[12];
+        uint32_t vk_format;
+        uint32_t type_size;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t layer_count;
+        uint32_t face_count;
+        uint32_t level_count;
+        uint32_t supercompression_scheme;
+        uint32_t dfd_byte_offset;
+        uint32_t dfd_byte_length;
+        uint32_t kvd_byte_offset;
+        uint32_t kvd_byte_length;
+        uint64_t sgd_byte_offset;
+        uint64_t sgd_byte_length;
+    };
+
+    struct Ktx2Level
+    {
+        uint64_t byte_offset;
+        uint64_t byte_length;
+        uint64_t uncompressed_byte_length;
+    };
+
+    Ktx2Header header;
+    if(size < sizeof(header))
+        throw std::runtime_error("Can't load KTX2 texture \""s + path.data() + "\"");
+
+    std::memcpy(&header, data, sizeof(header));
+
+    uint32_t level_count = std::max(header.level_count, 1u);
+    if
+    (
+        std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0 ||
+        size < sizeof(header) + level_count * sizeof(Ktx2Level)
+    )
+        throw std::runtime_error("Can't load KTX2 texture \""s + path.data() + "\"");
+
+    if
+    (
+        header.vk_format == VK_FORMAT_UNDEFINED ||
+        header.supercompression_scheme != 0 ||
+        header.pixel_depth > 1 ||
+        header.layer_count > 1 ||
+        header.face_count != 1
+    )
+        throw std::runtime_error("Unsupported KTX2 texture \""s + path.data() + "\"");
+
+    std::vector<Ktx2Level> levels(level_count);
+    std::memcpy(levels.data(), static_cast<const std::byte*>(data) + sizeof(header), level_count * sizeof(Ktx2Level));
+
+    uint64_t first = size, last = 0;
+    for(auto &&level : levels)
+    {
+        if(level.byte_offset + level.byte_length > size)
+            throw std::runtime_error("Can't load KTX2 texture \""s + path.data() + "\"");
+
+        first = std::min(first, level.byte_offset);
+        last  = std::max(last, level.byte_offset + level.byte_length);
+    }
+
+    // Levels are referenced in place, the staging copy is the only one
+    Source source;
+    source.format  = static_cast<VkFormat>(header.vk_format);
+    source.width   = header.pixel_width;
+    source.height  = std::max(header.pixel_height, 1u);
+    source.data    = static_cast<const std::byte*>(data) + first;
+    source.size    = static_cast<size_t>(last - first);
+    source.storage = std::move(storage);
+    source.path    = path.data();
+
+    for(uint32_t i = 0; i < level_count; ++i)
+    {
+        VkBufferImageCopy buffer_copy_region               = {};
+        buffer_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        buffer_copy_region.imageSubresource.mipLevel       = i;
+        buffer_copy_region.imageSubresource.baseArrayLayer = 0;
+        buffer_copy_region.imageSubresource.layerCount     = 1;
+        buffer_copy_region.imageExtent.width               = std::max(source.width >> i, 1u);
+        buffer_copy_region.imageExtent.height              = std::max(source.height >> i, 1u);
+        buffer_copy_region.imageExtent.depth               = 1;
+        buffer_copy_region.bufferOffset                    = levels[i].byte_offset - first;
+
+        source.regions.push_back(buffer_copy_region);
+    }
+
+    return source;
+}
+
 std::shared_ptr<Texture2D> Texture2D::load_from_file
 (
     std::string_view path,
@@ -142,142 +321,365 @@ std::shared_ptr<Texture2D> Texture2D::load_from_file
     VkImageLayout image_layout
 )
 {
-    auto texture = std::make_shared<Texture2D>();
+    Source source = read_source(path, format);
+    std::shared_ptr<DeviceBuffer> staging;
+
+    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    device->begin_command_buffer(copy_cmd);
 
-    gli::texture2d texture2d(gli::load(path.data()));
+    auto texture = create(source, device, copy_cmd, staging, image_usage_flags, image_layout);
 
-    assert(!texture2d.empty() && "Empty texture");
+    device->end_command_buffer(copy_cmd);
+    device->flush_command_buffer(copy_cmd, copy_queue);
+    vkFreeCommandBuffers(*device, command_pool, 1, &copy_cmd);
+
+    return texture;
+}
+
+std::shared_ptr<Texture2D> Texture2D::create
+(
+    const Source &source,
+    std::shared_ptr<Device> device,
+    VkCommandBuffer copy_cmd,
+    std::shared_ptr<DeviceBuffer> &staging,
+    VkImageUsageFlags image_usage_flags,
+    VkImageLayout image_layout,
+    uint32_t first_resident_level
+)
+{
+    auto texture = std::make_shared<Texture2D>();
+    VkFormat format = source.format;
 
     texture->device     = device;
-    texture->width      = static_cast<uint32_t>(texture2d[0].extent().x);
-    texture->height     = static_cast<uint32_t>(texture2d[0].extent().y);
-    texture->mip_levels = static_cast<uint32_t>(texture2d.levels());
+    texture->format     = format;
+    texture->width      = source.width;
+    texture->height     = source.height;
+    texture->mip_levels = static_cast<uint32_t>(source.regions.size());
+    texture->layer_count = 1;
+    texture->first_resident_level = std::min(first_resident_level, texture->mip_levels - 1);
 
-    VkFormatProperties format_properties;
-    vkGetPhysicalDeviceFormatProperties(*device, format, &format_properties);
+    auto regions = stage_levels(*device, source, texture->first_resident_level, staging);
 
-    VkBuffer       staging_buffer;
-    VkDeviceMemory staging_memory;
+    allocate_image(*texture, image_usage_flags);
 
-    device->create_buffer
+    VkImageSubresourceRange subresource_range = {};
+    subresource_range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.baseMipLevel            = 0;
+    subresource_range.levelCount              = texture->mip_levels;
+    subresource_range.layerCount              = 1;
+
+    set_image_layout
     (
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &staging_buffer,
-        texture2d.size(),
-        &staging_memory,
-        texture2d.data()
+        copy_cmd,
+        texture->image,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        subresource_range
     );
 
-    std::vector<VkBufferImageCopy> buffer_copy_regions;
-    uint32_t offset = 0;
+    vkCmdCopyBufferToImage
+    (
+        copy_cmd,
+        *staging,
+        texture->image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data()
+    );
 
-    for(uint32_t i = 0; i < texture->mip_levels; ++i)
-    {
-        VkBufferImageCopy buffer_copy_region               = {};
-        buffer_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        buffer_copy_region.imageSubresource.mipLevel       = i;
-        buffer_copy_region.imageSubresource.baseArrayLayer = 0;
-        buffer_copy_region.imageSubresource.layerCount     = 1;
-        buffer_copy_region.imageExtent.width               = static_cast<uint32_t>(texture2d[i].extent().x);
-        buffer_copy_region.imageExtent.height              = static_cast<uint32_t>(texture2d[i].extent().y);
-        buffer_copy_region.imageExtent.depth               = 1;
-        buffer_copy_region.bufferOffset                    = offset;
+    texture->image_layout = image_layout;
+    set_image_layout
+    (
+        copy_cmd,
+        texture->image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        image_layout,
+        subresource_range
+    );
 
-        buffer_copy_regions.push_back(buffer_copy_region);
+    texture->sampler      = get_default_sampler(*device);
+    texture->owns_sampler = false;
 
-        offset += static_cast<uint32_t>(texture2d[i].size());
-    }
+    texture->view = create_view(*texture);
+    texture->update_descriptor();
 
+    return texture;
+}
 
-    // Create optimal tiled target image
-    VkImageCreateInfo image_create_info = {};
-    image_create_info.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    image_create_info.imageType         = VK_IMAGE_TYPE_2D;
-    image_create_info.format            = format;
-    image_create_info.mipLevels         = texture->mip_levels;
-    image_create_info.arrayLayers       = 1;
-    image_create_info.samples           = VK_SAMPLE_COUNT_1_BIT;
-    image_create_info.tiling            = VK_IMAGE_TILING_OPTIMAL;
-    image_create_info.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
-    image_create_info.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
-    image_create_info.extent            = { texture->width, texture->height, 1 };
-    image_create_info.usage             = image_usage_flags;
+uint32_t Texture2D::get_streaming_tail_level(const Source &source)
+{
+    uint32_t level = 0;
+    while
+    (
+        level + 1 < source.regions.size() &&
+        std::max(source.regions[level].imageExtent.width, source.regions[level].imageExtent.height) > STREAMING_TAIL_SIZE
+    )
+        ++level;
 
-    // Ensure that the TRANSFER_DST_BIT is set for staging
-    if((image_create_info.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0)
-        image_create_info.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    return level;
+}
 
-    vk_assert
+VkDeviceSize Texture2D::get_level_size(const Source &source, uint32_t level)
+{
+    // A level ends where the next stored one begins, whatever the level order is
+    VkDeviceSize offset = source.regions[level].bufferOffset;
+    VkDeviceSize end    = source.size;
+
+    for(auto &&region : source.regions)
+        if(region.bufferOffset > offset)
+            end = std::min(end, region.bufferOffset);
+
+    return end - offset;
+}
+
+void Texture2D::upload_level
+(
+    const Source &source,
+    uint32_t level,
+    const void *data,
+    VkCommandBuffer copy_cmd,
+    std::shared_ptr<DeviceBuffer> &staging
+)
+{
+    VkDeviceSize level_size = get_level_size(source, level);
+    auto allocation = device->staging_pool.allocate(*device, level_size);
+    std::memcpy(allocation.data, data, level_size);
+    staging = allocation.buffer;
+
+    VkBufferImageCopy region = source.regions[level];
+    region.bufferOffset = allocation.offset;
+
+    VkImageSubresourceRange subresource_range = {};
+    subresource_range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.baseMipLevel            = level;
+    subresource_range.levelCount              = 1;
+    subresource_range.layerCount              = 1;
+
+    // The level has never been sampled, its contents are discarded
+    set_image_layout
     (
-        vkCreateImage(*device, &image_create_info, nullptr, &texture->image),
-        "Can't create image"
+        copy_cmd,
+        image,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        subresource_range
     );
 
-    VkMemoryRequirements memory_reqs;
-    vkGetImageMemoryRequirements(*device, texture->image, &memory_reqs);
+    vkCmdCopyBufferToImage(copy_cmd, *staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
 
-    VkMemoryAllocateInfo allocate_info = {};
-    allocate_info.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocate_info.allocationSize       = memory_reqs.size;
-    allocate_info.memoryTypeIndex      = device->find_memory_type(memory_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT).value();
-    vk_assert
+    set_image_layout
     (
-        vkAllocateMemory(*device, &allocate_info, nullptr, &texture->device_memory),
-        "Can't allocate texture memory"
+        copy_cmd,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        image_layout,
+        subresource_range
     );
+}
 
-    vk_assert
+std::shared_ptr<Texture2D> Texture2D::create_array
+(
+    VkFormat format,
+    uint32_t width,
+    uint32_t height,
+    uint32_t mip_levels,
+    uint32_t layer_count,
+    std::shared_ptr<Device> device,
+    VkCommandBuffer copy_cmd
+)
+{
+    auto texture = std::make_shared<Texture2D>();
+
+    texture->device      = device;
+    texture->format      = format;
+    texture->width       = width;
+    texture->height      = height;
+    texture->mip_levels  = mip_levels;
+    texture->layer_count = layer_count;
+
+    allocate_image(*texture, VK_IMAGE_USAGE_SAMPLED_BIT);
+
+    VkImageSubresourceRange subresource_range = {};
+    subresource_range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.baseMipLevel            = 0;
+    subresource_range.levelCount              = mip_levels;
+    subresource_range.layerCount              = layer_count;
+
+    // Unused layers are never sampled, but the whole image must be in the layout the descriptor names
+    texture->image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    set_image_layout
     (
-        vkBindImageMemory(*device, texture->image, texture->device_memory, 0),
-        "Can't bind texture memory"
+        copy_cmd,
+        texture->image,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        texture->image_layout,
+        subresource_range
     );
 
+    texture->sampler      = get_default_sampler(*device);
+    texture->owns_sampler = false;
+
+    texture->view = create_view(*texture);
+    texture->update_descriptor();
+
+    return texture;
+}
+
+void Texture2D::upload_layer(const Source &source, uint32_t layer, VkCommandBuffer copy_cmd, std::shared_ptr<DeviceBuffer> &staging)
+{
+    auto regions = stage_levels(*device, source, 0, staging);
+    for(auto &&region : regions)
+    {
+        region.imageSubresource.baseArrayLayer = layer;
+        region.imageSubresource.layerCount     = 1;
+    }
+
     VkImageSubresourceRange subresource_range = {};
     subresource_range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
     subresource_range.baseMipLevel            = 0;
-    subresource_range.levelCount              = texture->mip_levels;
+    subresource_range.levelCount              = mip_levels;
+    subresource_range.baseArrayLayer          = layer;
     subresource_range.layerCount              = 1;
 
-    VkCommandBuffer copy_cmd = device->create_command_buffer(command_pool, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
-    device->begin_command_buffer(copy_cmd);
-
+    // The layer has never been sampled, its contents are discarded
     set_image_layout
     (
         copy_cmd,
-        texture->image,
+        image,
         VK_IMAGE_LAYOUT_UNDEFINED,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         subresource_range
     );
 
-    vkCmdCopyBufferToImage
+    vkCmdCopyBufferToImage(copy_cmd, *staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    set_image_layout
     (
         copy_cmd,
-        staging_buffer,
-        texture->image,
+        image,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-        static_cast<uint32_t>(buffer_copy_regions.size()),
-        buffer_copy_regions.data()
+        image_layout,
+        subresource_range
     );
+}
+
+void Texture2D::copy_regions(VkBuffer staging, const std::vector<VkBufferImageCopy> &regions, VkCommandBuffer copy_cmd)
+{
+    VkImageSubresourceRange subresource_range = {};
+    subresource_range.aspectMask              = VK_IMAGE_ASPECT_COLOR_BIT;
+    subresource_range.baseMipLevel            = 0;
+    subresource_range.levelCount              = mip_levels;
+    subresource_range.layerCount              = layer_count;
 
-    texture->image_layout = image_layout;
     set_image_layout
     (
         copy_cmd,
-        texture->image,
+        image,
+        image_layout,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        subresource_range
+    );
+
+    vkCmdCopyBufferToImage(copy_cmd, staging, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    set_image_layout
+    (
+        copy_cmd,
+        image,
         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
         image_layout,
         subresource_range
     );
+}
 
-    device->end_command_buffer(copy_cmd);
-    device->flush_command_buffer(copy_cmd, copy_queue);
+void Texture2D::set_first_resident_level(uint32_t level)
+{
+    vkDestroyImageView(*device, view, nullptr);
+
+    first_resident_level = std::min(level, mip_levels - 1);
+    view = create_view(*this);
+    update_descriptor();
+}
+
+VkImageView create_view(const Texture2D &texture)
+{
+    VkImageViewCreateInfo view_create_info = {};
+    view_create_info.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_create_info.viewType              = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    view_create_info.format                = texture.format;
+    view_create_info.components            = 
+    { 
+        VK_COMPONENT_SWIZZLE_R, 
+        VK_COMPONENT_SWIZZLE_G, 
+        VK_COMPONENT_SWIZZLE_B, 
+        VK_COMPONENT_SWIZZLE_A 
+    };
+    view_create_info.subresourceRange              = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    view_create_info.subresourceRange.baseMipLevel = texture.first_resident_level;
+    view_create_info.subresourceRange.levelCount   = texture.mip_levels - texture.first_resident_level;
+    view_create_info.subresourceRange.layerCount   = texture.layer_count;
+    view_create_info.image                         = texture.image;
+
+    VkImageView view;
+    vk_assert
+    (
+        vkCreateImageView(*texture.device, &view_create_info, nullptr, &view),
+        "Can't create image view for texture"
+    );
+
+    return view;
+}
+
+void allocate_image(Texture2D &texture, VkImageUsageFlags usage)
+{
+    // Optimal tiled, filled through staging buffers
+    VkImageCreateInfo image_create_info = {};
+    image_create_info.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_create_info.imageType         = VK_IMAGE_TYPE_2D;
+    image_create_info.format            = texture.format;
+    image_create_info.mipLevels         = texture.mip_levels;
+    image_create_info.arrayLayers       = texture.layer_count;
+    image_create_info.samples           = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling            = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+    image_create_info.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_create_info.extent            = { texture.width, texture.height, 1 };
+    image_create_info.usage             = usage;
+
+    // Ensure that the TRANSFER_DST_BIT is set for staging
+    if((image_create_info.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT) == 0)
+        image_create_info.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    vk_assert
+    (
+        vkCreateImage(*texture.device, &image_create_info, nullptr, &texture.image),
+        "Can't create image"
+    );
 
-    vkFreeMemory(*device, staging_memory, nullptr);
-    vkDestroyBuffer(*device, staging_buffer, nullptr);
+    VkMemoryRequirements memory_reqs;
+    vkGetImageMemoryRequirements(*texture.device, texture.image, &memory_reqs);
 
-    // Create default sampler
+    VkMemoryAllocateInfo allocate_info = {};
+    allocate_info.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize       = memory_reqs.size;
+    texture.memory_size                = memory_reqs.size;
+    allocate_info.memoryTypeIndex      = texture.device->find_memory_type(memory_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT).value();
+    vk_assert
+    (
+        vkAllocateMemory(*texture.device, &allocate_info, nullptr, &texture.device_memory),
+        "Can't allocate texture memory"
+    );
+
+    vk_assert
+    (
+        vkBindImageMemory(*texture.device, texture.image, texture.device_memory, 0),
+        "Can't bind texture memory"
+    );
+}
+
+// Shared by every texture. Its LOD range isn't clamped, the image view limits the mip levels
+VkSampler get_default_sampler(Device &device)
+{
     VkSamplerCreateInfo sampler_create_info = {};
     sampler_create_info.sType               = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     sampler_create_info.magFilter           = VK_FILTER_LINEAR;
@@ -289,38 +691,145 @@ std::shared_ptr<Texture2D> Texture2D::load_from_file
     sampler_create_info.mipLodBias          = 0.f;
     sampler_create_info.compareOp           = VK_COMPARE_OP_NEVER;
     sampler_create_info.minLod              = 0.f;
-    sampler_create_info.maxLod              = static_cast<float>(texture->mip_levels); // Max level of detail must match mip level count
-    sampler_create_info.maxAnisotropy       = device->enabled_features.samplerAnisotropy? 
-                                              device->properties.limits.maxSamplerAnisotropy : 1.f;
-    sampler_create_info.anisotropyEnable    = device->enabled_features.samplerAnisotropy;
+    sampler_create_info.maxLod              = VK_LOD_CLAMP_NONE;
+    sampler_create_info.maxAnisotropy       = device.enabled_features.samplerAnisotropy? 
+                                              device.properties.limits.maxSamplerAnisotropy : 1.f;
+    sampler_create_info.anisotropyEnable    = device.enabled_features.samplerAnisotropy;
     sampler_create_info.borderColor         = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
-    vk_assert
-    (
-        vkCreateSampler(*device, &sampler_create_info, nullptr, &texture->sampler),
-        "Can't craete texture sampler"
-    );
 
-    VkImageViewCreateInfo view_create_info = {};
-    view_create_info.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    view_create_info.viewType              = VK_IMAGE_VIEW_TYPE_2D;
-    view_create_info.format                = format;
-    view_create_info.components            = 
-    { 
-        VK_COMPONENT_SWIZZLE_R, 
-        VK_COMPONENT_SWIZZLE_G, 
-        VK_COMPONENT_SWIZZLE_B, 
-        VK_COMPONENT_SWIZZLE_A 
+    return device.sampler_cache.get(device, sampler_create_info);
+}
+
+Texture2D::Source read_ktx_source(std::shared_ptr<const MappedFile> file, std::string_view path, VkFormat format)
+{
+    using namespace std::string_literals;
+
+    static constexpr uint8_t  KTX_IDENTIFIER[12] = { 0xab, 'K', 'T', 'X', ' ', '1', '1', 0xbb, '\r', '\n', 0x1a, '\n' };
+    static constexpr uint32_t KTX_ENDIANNESS     = 0x04030201;
+
+    struct KtxHeader
+    {
+        uint8_t  identifier[12];
+        uint32_t endianness;
+        uint32_t gl_type;
+        uint32_t gl_type_size;
+        uint32_t gl_format;
+        uint32_t gl_internal_format;
+        uint32_t gl_base_internal_format;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t array_element_count;
+        uint32_t face_count;
+        uint32_t level_count;
+        uint32_t key_value_data_size;
     };
-    view_create_info.subresourceRange            = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-    view_create_info.subresourceRange.levelCount = texture->mip_levels;
-    view_create_info.image                       = texture->image;
-    vk_assert
+
+    auto data = reinterpret_cast<const std::byte*>(file->get_data());
+    size_t size = file->get_size();
+
+    KtxHeader header;
+    if(size < sizeof(header))
+        throw std::runtime_error("Can't load KTX texture \""s + path.data() + "\"");
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if(std::memcmp(header.identifier, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0)
+        throw std::runtime_error("Can't load KTX texture \""s + path.data() + "\"");
+
+    if
     (
-        vkCreateImageView(*device, &view_create_info, nullptr, &texture->view),
-        "Can't create image view for texture"
-    );
+        header.endianness != KTX_ENDIANNESS ||
+        header.pixel_depth > 1 ||
+        header.array_element_count > 0 ||
+        header.face_count != 1
+    )
+        throw std::runtime_error("Unsupported KTX texture \""s + path.data() + "\"");
+
+    Texture2D::Source source;
+    source.format  = format;
+    source.width   = header.pixel_width;
+    source.height  = std::max(header.pixel_height, 1u);
+    source.path    = path.data();
+
+    // Every level is its size followed by its data padded to 4 bytes
+    size_t offset = sizeof(header) + header.key_value_data_size;
+    size_t first  = offset + sizeof(uint32_t);
+
+    for(uint32_t i = 0, level_count = std::max(header.level_count, 1u); i < level_count; ++i)
+    {
+        uint32_t level_size;
+        if(offset > size || size - offset < sizeof(level_size))
+            throw std::runtime_error("Can't load KTX texture \""s + path.data() + "\"");
 
-    texture->update_descriptor();
+        std::memcpy(&level_size, data + offset, sizeof(level_size));
+        offset += sizeof(level_size);
 
-    return texture;
+        if(size - offset < level_size)
+            throw std::runtime_error("Can't load KTX texture \""s + path.data() + "\"");
+
+        VkBufferImageCopy buffer_copy_region               = {};
+        buffer_copy_region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        buffer_copy_region.imageSubresource.mipLevel       = i;
+        buffer_copy_region.imageSubresource.baseArrayLayer = 0;
+        buffer_copy_region.imageSubresource.layerCount     = 1;
+        buffer_copy_region.imageExtent.width               = std::max(source.width >> i, 1u);
+        buffer_copy_region.imageExtent.height              = std::max(source.height >> i, 1u);
+        buffer_copy_region.imageExtent.depth               = 1;
+        buffer_copy_region.bufferOffset                    = offset - first;
+
+        source.regions.push_back(buffer_copy_region);
+
+        offset += (level_size + 3) & ~3u;
+    }
+
+    source.data    = data + first;
+    source.size    = std::min(offset, size) - first;
+    source.storage = std::move(file);
+
+    return source;
+}
+
+bool has_extension(std::string_view path, std::string_view extension)
+{
+    return path.size() >= extension.size() && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+std::vector<VkBufferImageCopy> stage_levels
+(
+    Device &device,
+    const Texture2D::Source &source,
+    uint32_t first_level,
+    std::shared_ptr<DeviceBuffer> &staging
+)
+{
+    // Largest block of the compressed formats, also the multiple of 4 every copy offset needs
+    static constexpr VkDeviceSize LEVEL_ALIGNMENT = 16;
+
+    auto align = [](VkDeviceSize offset) { return (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT; };
+
+    VkDeviceSize size = 0;
+    for(uint32_t i = first_level; i < source.regions.size(); ++i)
+        size = align(size) + Texture2D::get_level_size(source, i);
+
+    // Allocations start at least 16 byte aligned
+    auto allocation = device.staging_pool.allocate(device, size);
+    staging = allocation.buffer;
+
+    std::vector<VkBufferImageCopy> regions;
+
+    VkDeviceSize offset = 0;
+    for(uint32_t i = first_level; i < source.regions.size(); ++i)
+    {
+        offset = align(offset);
+
+        VkDeviceSize level_size = Texture2D::get_level_size(source, i);
+        std::memcpy(static_cast<std::byte*>(allocation.data) + offset, static_cast<const std::byte*>(source.data) + source.regions[i].bufferOffset, level_size);
+
+        regions.push_back(source.regions[i]);
+        regions.back().bufferOffset = allocation.offset + offset;
+        offset += level_size;
+    }
+
+    return regions;
 }
\ No newline at end of file
@@ -1,12 +1,92 @@
 #ifndef CG_SEM5_TEXTURE2D_H
 #define CG_SEM5_TEXTURE2D_H
 
+#include <string>
 #include <string_view>
+#include <vector>
 
 #include "texture.h"
+#include "devicebuffer.h"
 
 struct Texture2D : public Texture
 {
+    // Levels whose larger side is at most this many texels are uploaded when a streamed texture is created
+    static constexpr uint32_t STREAMING_TAIL_SIZE = 128;
+
+    // Decoded texture file, reading it doesn't touch the device so it may happen on any thread
+    struct Source
+    {
+        VkFormat format;
+        uint32_t width, height;
+        std::vector<VkBufferImageCopy> regions;
+
+        const void *data = nullptr;
+        size_t      size = 0;
+        std::shared_ptr<const void> storage; // Owns data
+
+        std::string path; // Empty for generated textures
+    };
+
+    VkFormat format;
+    uint32_t first_resident_level = 0; // The view starts here, finer levels are not uploaded yet
+
+    static Source read_source(std::string_view path, VkFormat format);
+
+    // KTX2 image already in memory, data must stay alive while storage does.
+    // Only uncompressed (no supercompression) single layer 2D images are supported
+    static Source read_ktx2_source
+    (
+        const void *data,
+        size_t size,
+        std::shared_ptr<const void> storage,
+        std::string_view path
+    );
+
+    // First level of the mip tail uploaded up front when the texture is streamed
+    static uint32_t get_streaming_tail_level(const Source &);
+    static VkDeviceSize get_level_size(const Source &, uint32_t level);
+
+    // Records the upload into command_buffer, staging must live until the command buffer is executed.
+    // The image always has the full mip chain, only levels from first_resident_level on are uploaded
+    static std::shared_ptr<Texture2D> create
+    (
+        const Source &,
+        std::shared_ptr<Device> device,
+        VkCommandBuffer command_buffer,
+        std::shared_ptr<DeviceBuffer> &staging,
+        VkImageUsageFlags image_usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT,
+        VkImageLayout image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        uint32_t first_resident_level = 0
+    );
+
+    // Array of empty layers, all of them may be sampled right away.
+    // Views of every texture are arrays, a texture created from a source has one layer
+    static std::shared_ptr<Texture2D> create_array
+    (
+        VkFormat format,
+        uint32_t width,
+        uint32_t height,
+        uint32_t mip_levels,
+        uint32_t layer_count,
+        std::shared_ptr<Device> device,
+        VkCommandBuffer command_buffer
+    );
+
+    // Records the upload of every level of the source into the corner of one layer,
+    // staging must live until the command buffer is executed. The source must fit into every level
+    void upload_layer(const Source &, uint32_t layer, VkCommandBuffer, std::shared_ptr<DeviceBuffer> &staging);
+
+    // Records copies from staging into an image that may already be sampled, texels outside the regions are kept.
+    // Staging must live until the command buffer is executed
+    void copy_regions(VkBuffer staging, const std::vector<VkBufferImageCopy> &, VkCommandBuffer);
+
+    // Records the upload of one level of the source the texture was created from, data is the level
+    // copied out of the source (get_level_size bytes). The view doesn't include the level until set_first_resident_level
+    void upload_level(const Source &, uint32_t level, const void *data, VkCommandBuffer, std::shared_ptr<DeviceBuffer> &staging);
+
+    // Recreates the view and the descriptor, no pending work may use the old view
+    void set_first_resident_level(uint32_t level);
+
     static std::shared_ptr<Texture2D> load_from_file
     (
         std::string_view path,
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <gli/gli.hpp>
+
+#include "texturecooker.h"
+#include "blockencoder.h"
+#include "tgaimage.h"
+#include "virtualtexture.h"
+
+gli::format get_gli_format(VkFormat);
+
+// Average of each 2x2 square, odd edges repeat the last row or column
+std::vector<uint8_t> downsample(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height);
+
+// Concurrent imports may cook the same image, readers never see a partially written file
+std::string make_temporary_path(std::string_view cooked_path);
+void replace_cooked_file(const std::string &temporary_path, std::string_view cooked_path);
+
+bool TextureCooker::can_cook(VkFormat format)
+{
+    return get_gli_format(format) != gli::FORMAT_UNDEFINED;
+}
+
+bool TextureCooker::is_up_to_date(std::string_view source_path, std::string_view cooked_path)
+{
+    std::error_code error;
+
+    auto cooked_time = std::filesystem::last_write_time(cooked_path, error);
+    if(error)
+        return false;
+
+    auto source_time = std::filesystem::last_write_time(source_path, error);
+    return !error && cooked_time >= source_time;
+}
+
+void TextureCooker::cook(std::string_view source_path, std::string_view cooked_path, VkFormat format)
+{
+    using namespace std::string_literals;
+
+    auto gli_format = get_gli_format(format);
+    if(gli_format == gli::FORMAT_UNDEFINED)
+        throw std::runtime_error("Can't cook textures in format " + std::to_string(format));
+
+    auto image = TgaImage::load(source_path);
+
+    uint32_t width  = image.width;
+    uint32_t height = image.height;
+    auto levels = static_cast<size_t>(std::log2(std::max(width, height))) + 1;
+
+    gli::texture2d texture(gli_format, gli::extent2d(width, height), levels);
+    std::vector<uint8_t> pixels = std::move(image.pixels);
+
+    for(size_t level = 0; level < levels; ++level)
+    {
+        if(BlockEncoder::can_encode(format))
+        {
+            auto blocks = BlockEncoder::encode(pixels.data(), width, height, format);
+            std::memcpy(texture.data(0, 0, level), blocks.data(), std::min(blocks.size(), texture.size(level)));
+        }
+        else
+        {
+            std::memcpy(texture.data(0, 0, level), pixels.data(), std::min(pixels.size(), texture.size(level)));
+        }
+
+        if(level + 1 < levels)
+        {
+            pixels = downsample(pixels, width, height);
+            width  = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+    }
+
+    auto temporary_path = make_temporary_path(cooked_path);
+    if(!gli::save_ktx(texture, temporary_path))
+        throw std::runtime_error("Can't write texture to file \""s + temporary_path + "\"");
+
+    replace_cooked_file(temporary_path, cooked_path);
+}
+
+void TextureCooker::cook_virtual(std::string_view source_path, std::string_view cooked_path)
+{
+    using namespace std::string_literals;
+
+    static constexpr uint32_t PAGE_SIZE   = VirtualTexture::PAGE_SIZE;
+    static constexpr uint32_t BORDER      = VirtualTexture::PAGE_BORDER;
+    static constexpr uint32_t STORED_SIZE = VirtualTexture::STORED_PAGE_SIZE;
+
+    auto image = TgaImage::load(source_path);
+
+    VirtualTexture::FileHeader header = {};
+    std::memcpy(header.magic, VirtualTexture::MAGIC, sizeof(header.magic));
+    header.version     = VirtualTexture::VERSION;
+    header.width       = image.width;
+    header.height      = image.height;
+    header.level_count = VirtualTexture::get_level_count(image.width, image.height);
+    header.page_size   = PAGE_SIZE;
+    header.page_border = BORDER;
+
+    auto temporary_path = make_temporary_path(cooked_path);
+
+    {
+        std::ofstream file(temporary_path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        uint32_t width  = image.width;
+        uint32_t height = image.height;
+        std::vector<uint8_t> pixels = std::move(image.pixels);
+        std::vector<uint8_t> page(VirtualTexture::PAGE_BYTES);
+
+        for(uint32_t level = 0; level < header.level_count; ++level)
+        {
+            auto grid = VirtualTexture::get_page_grid(header.width, header.height, level);
+
+            // Borders and the part of the last pages past the image wrap around, like repeat addressing
+            for(uint32_t page_y = 0; page_y < grid.y; ++page_y)
+                for(uint32_t page_x = 0; page_x < grid.x; ++page_x)
+                {
+                    for(uint32_t y = 0; y < STORED_SIZE; ++y)
+                    {
+                        uint32_t row = (page_y * PAGE_SIZE + y + height * BORDER - BORDER) % height;
+
+                        for(uint32_t x = 0; x < STORED_SIZE; ++x)
+                        {
+                            uint32_t column = (page_x * PAGE_SIZE + x + width * BORDER - BORDER) % width;
+                            std::memcpy(&page[(y * STORED_SIZE + x) * 4], &pixels[(static_cast<size_t>(row) * width + column) * 4], 4);
+                        }
+                    }
+
+                    file.write(reinterpret_cast<const char*>(page.data()), page.size());
+                }
+
+            if(level + 1 < header.level_count)
+            {
+                pixels = downsample(pixels, width, height);
+                width  = std::max(width / 2, 1u);
+                height = std::max(height / 2, 1u);
+            }
+        }
+
+        if(!file)
+            throw std::runtime_error("Can't write virtual texture to file \""s + temporary_path + "\"");
+    }
+
+    replace_cooked_file(temporary_path, cooked_path);
+}
+
+gli::format get_gli_format(VkFormat format)
+{
+    switch(format)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:      return gli::FORMAT_RGBA8_UNORM_PACK8;
+    case VK_FORMAT_R8G8B8A8_SRGB:       return gli::FORMAT_RGBA8_SRGB_PACK8;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: return gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:  return gli::FORMAT_RGB_DXT1_SRGB_BLOCK8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:     return gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+    case VK_FORMAT_BC3_SRGB_BLOCK:      return gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16;
+    case VK_FORMAT_BC7_UNORM_BLOCK:     return gli::FORMAT_RGBA_BP_UNORM_BLOCK16;
+    case VK_FORMAT_BC7_SRGB_BLOCK:      return gli::FORMAT_RGBA_BP_SRGB_BLOCK16;
+    default:                            return gli::FORMAT_UNDEFINED;
+    }
+}
+
+std::vector<uint8_t> downsample(const std::vector<uint8_t> &rgba, uint32_t width, uint32_t height)
+{
+    uint32_t next_width  = std::max(width / 2, 1u);
+    uint32_t next_height = std::max(height / 2, 1u);
+
+    std::vector<uint8_t> next(static_cast<size_t>(next_width) * next_height * 4);
+
+    for(uint32_t y = 0; y < next_height; ++y)
+    {
+        size_t rows[2] = { std::min(y * 2, height - 1), std::min(y * 2 + 1, height - 1) };
+
+        for(uint32_t x = 0; x < next_width; ++x)
+        {
+            size_t columns[2] = { std::min(x * 2, width - 1), std::min(x * 2 + 1, width - 1) };
+
+            for(size_t c = 0; c < 4; ++c)
+            {
+                uint32_t sum = 2;
+                for(auto row : rows)
+                    for(auto column : columns)
+                        sum += rgba[(row * width + column) * 4 + c];
+
+                next[(static_cast<size_t>(y) * next_width + x) * 4 + c] = static_cast<uint8_t>(sum / 4);
+            }
+        }
+    }
+
+    return next;
+}
+
+std::string make_temporary_path(std::string_view cooked_path)
+{
+    return std::string(cooked_path) + '.' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+}
+
+void replace_cooked_file(const std::string &temporary_path, std::string_view cooked_path)
+{
+    using namespace std::string_literals;
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, cooked_path, error);
+    if(error)
+    {
+        std::filesystem::remove(temporary_path, error);
+        throw std::runtime_error("Can't write texture to file \""s + cooked_path.data() + "\"");
+    }
+}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef CG_SEM5_TEXTURECOOKER_H
+#define CG_SEM5_TEXTURECOOKER_H
+
+#include <string_view>
+#include <vulkan/vulkan.h>
+
+// Converts uncompressed TGA images into KTX files with a box filtered mip chain,
+// block compressed when BlockEncoder supports the format and stored as RGBA8 otherwise,
+// or into tiled virtual textures.
+// Cooking doesn't touch the device so it may happen on any thread
+class TextureCooker
+{
+public:
+    static bool can_cook(VkFormat);
+
+    // The cooked file exists and isn't older than the source image
+    static bool is_up_to_date(std::string_view source_path, std::string_view cooked_path);
+
+    static void cook(std::string_view source_path, std::string_view cooked_path, VkFormat format);
+
+    // Pages of a VirtualTexture with the same box filtered levels
+    static void cook_virtual(std::string_view source_path, std::string_view cooked_path);
+};
+
+#endif // CG_SEM5_TEXTURECOOKER_H
\ No newline at end of file
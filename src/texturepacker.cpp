@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "texturepacker.h"
+#include "assetregistry.h"
+
+bool is_power_of_two(uint32_t value);
+bool is_block_compressed(VkFormat);
+
+bool TexturePacker::can_pack(const Device &device, const Texture2D::Source &source)
+{
+    if(source.regions.empty() || source.data == nullptr)
+        return false;
+
+    if
+    (
+        !is_power_of_two(source.width) || source.width > MAX_PACKED_SIZE ||
+        !is_power_of_two(source.height) || source.height > MAX_PACKED_SIZE
+    )
+        return false;
+
+    if(is_block_compressed(source.format) && source.width != source.height)
+        return false;
+
+    return device.properties.limits.maxImageArrayLayers > 1;
+}
+
+TexturePacker::Placement TexturePacker::pack
+(
+    const Texture2D::Source &source,
+    std::shared_ptr<Device> device,
+    VkCommandBuffer command_buffer,
+    std::shared_ptr<DeviceBuffer> &staging
+)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::string key;
+    if(!source.path.empty())
+    {
+        key = AssetRegistry::make_texture_key(source.path, source.format);
+
+        auto packed = packed_textures.find(key);
+        if(packed != packed_textures.end())
+        {
+            if(auto texture = packed->second.texture.lock())
+                return { texture, packed->second.region };
+
+            packed_textures.erase(packed);
+        }
+    }
+
+    arrays.erase
+    (
+        std::remove_if(arrays.begin(), arrays.end(), [](auto &&array) { return array.texture.expired(); }),
+        arrays.end()
+    );
+
+    uint32_t extent     = std::max(source.width, source.height);
+    uint32_t mip_levels = static_cast<uint32_t>(source.regions.size());
+
+    std::shared_ptr<Texture2D> texture;
+    auto array = std::find_if
+    (
+        arrays.begin(), arrays.end(),
+        [&](auto &&array)
+        {
+            if(array.format != source.format || array.extent != extent || array.mip_levels != mip_levels)
+                return false;
+
+            texture = array.texture.lock();
+            return texture && array.used_layers < texture->layer_count;
+        }
+    );
+
+    if(array == arrays.end())
+    {
+        uint32_t layer_count = std::min(LAYERS_PER_ARRAY, device->properties.limits.maxImageArrayLayers);
+        texture = Texture2D::create_array(source.format, extent, extent, mip_levels, layer_count, device, command_buffer);
+
+        array = arrays.insert(arrays.end(), { texture, source.format, extent, mip_levels, 0 });
+    }
+
+    uint32_t layer = array->used_layers++;
+    texture->upload_layer(source, layer, command_buffer, staging);
+
+    StaticMesh::TextureRegion region;
+    region.layer    = static_cast<float>(layer);
+    region.uv_scale = glm::vec2(source.width, source.height) / static_cast<float>(extent);
+
+    if(!key.empty())
+        packed_textures[key] = { texture, region };
+
+    return { texture, region };
+}
+
+size_t TexturePacker::get_array_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return std::count_if(arrays.begin(), arrays.end(), [](auto &&array) { return !array.texture.expired(); });
+}
+
+bool is_power_of_two(uint32_t value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+bool is_block_compressed(VkFormat format)
+{
+    return format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK;
+}
\ No newline at end of file
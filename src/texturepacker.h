@@ -0,0 +1,70 @@
+#ifndef CG_SEM5_TEXTUREPACKER_H
+#define CG_SEM5_TEXTUREPACKER_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "staticmesh.h"
+#include "texture2d.h"
+
+// Packs small material textures into shared 2D array images, one texture per layer.
+// Arrays are grouped by format, layer extent and mip level count. A texture smaller than its layer
+// fills the corner at every level, so mip levels of the layer never mix texels of different textures.
+// Materials of any mesh that use the same file share one layer. Layers are never reused, an array is released with its last material
+class TexturePacker
+{
+public:
+    static constexpr uint32_t MAX_PACKED_SIZE  = Texture2D::STREAMING_TAIL_SIZE; // Streamed textures keep their own images
+    static constexpr uint32_t LAYERS_PER_ARRAY = 64;
+
+    struct Placement
+    {
+        std::shared_ptr<Texture2D> texture;
+        StaticMesh::TextureRegion  region;
+    };
+
+    // Power of two sides up to MAX_PACKED_SIZE. Block compressed textures must be square,
+    // copies of partial blocks have to cover their whole level
+    static bool can_pack(const Device &, const Texture2D::Source &);
+
+    // Records the upload into command_buffer, staging must live until it is executed.
+    // Sources packed before are not uploaded again
+    Placement pack
+    (
+        const Texture2D::Source &,
+        std::shared_ptr<Device>,
+        VkCommandBuffer command_buffer,
+        std::shared_ptr<DeviceBuffer> &staging
+    );
+
+    // Live arrays
+    size_t get_array_count() const;
+
+private:
+    struct Array
+    {
+        std::weak_ptr<Texture2D> texture;
+        VkFormat format;
+        uint32_t extent;
+        uint32_t mip_levels;
+        uint32_t used_layers;
+    };
+
+    struct PackedTexture
+    {
+        std::weak_ptr<Texture2D>  texture;
+        StaticMesh::TextureRegion region;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Array> arrays;
+    std::unordered_map<std::string, PackedTexture> packed_textures; // Keyed like the asset registry
+};
+
+#endif // CG_SEM5_TEXTUREPACKER_H
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <limits>
+
+#include "texturestreamer.h"
+
+TextureStreamer::TextureStreamer(VkDeviceSize bytes_per_update)
+: textures(),
+staging(),
+bytes_per_update(bytes_per_update),
+loading_bytes(0),
+workers(),
+mutex(),
+loaded_levels()
+{}
+
+TextureStreamer::~TextureStreamer()
+{
+    workers.wait();
+}
+
+void TextureStreamer::add(std::shared_ptr<Texture2D> texture, Texture2D::Source &&source)
+{
+    if(texture->first_resident_level == 0)
+        return;
+
+    auto &streaming = textures[texture.get()];
+    streaming.texture        = texture;
+    streaming.source         = std::move(source);
+    streaming.wanted_level   = std::numeric_limits<uint32_t>::max();
+    streaming.priority       = 0.f;
+    streaming.loading_level  = texture->first_resident_level;
+    streaming.recorded_level = texture->first_resident_level;
+}
+
+void TextureStreamer::request(const Texture2D *texture, uint32_t level, float priority)
+{
+    auto streaming = textures.find(texture);
+    if(streaming == textures.end())
+        return;
+
+    streaming->second.wanted_level = std::min(streaming->second.wanted_level, level);
+    streaming->second.priority     = std::max(streaming->second.priority, priority);
+}
+
+void TextureStreamer::load()
+{
+    std::vector<std::pair<StreamingTexture*, std::shared_ptr<Texture2D>>> candidates;
+
+    for(auto it = textures.begin(); it != textures.end();)
+    {
+        auto texture = it->second.texture.lock();
+        if(!texture)
+        {
+            it = textures.erase(it);
+            continue;
+        }
+
+        // One level of a texture is in flight at a time
+        auto &streaming = it->second;
+        if(streaming.wanted_level < texture->first_resident_level && streaming.loading_level == texture->first_resident_level)
+            candidates.emplace_back(&streaming, std::move(texture));
+
+        ++it;
+    }
+
+    std::sort
+    (
+        candidates.begin(), candidates.end(),
+        [](auto &&lhs, auto &&rhs) { return lhs.first->priority > rhs.first->priority; }
+    );
+
+    // The first read starts even if a single level is over the budget
+    for(auto &&[streaming, texture] : candidates)
+    {
+        uint32_t level = texture->first_resident_level - 1;
+        VkDeviceSize size = Texture2D::get_level_size(streaming->source, level);
+
+        if(loading_bytes > 0 && loading_bytes + size > bytes_per_update)
+            break;
+
+        streaming->loading_level = level;
+        loading_bytes += size;
+
+        // The storage keeps the data alive even if the texture is released meanwhile
+        auto data = static_cast<const uint8_t*>(streaming->source.data) + streaming->source.regions[level].bufferOffset;
+        workers.run([this, texture = std::weak_ptr<Texture2D>(texture), level, data, size, storage = streaming->source.storage]
+        {
+            LoadedLevel loaded = { texture, level, std::vector<uint8_t>(data, data + size) };
+
+            std::lock_guard<std::mutex> lock(mutex);
+            loaded_levels.push_back(std::move(loaded));
+        });
+    }
+
+    for(auto &&[texture, streaming] : textures)
+    {
+        streaming.wanted_level = std::numeric_limits<uint32_t>::max();
+        streaming.priority     = 0.f;
+    }
+}
+
+bool TextureStreamer::has_loaded() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !loaded_levels.empty();
+}
+
+bool TextureStreamer::record(VkCommandBuffer command_buffer)
+{
+    std::vector<LoadedLevel> levels;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        levels.swap(loaded_levels);
+    }
+
+    bool is_recorded = false;
+    for(auto &&loaded : levels)
+    {
+        loading_bytes -= loaded.data.size();
+
+        // Levels of released textures are dropped
+        auto texture = loaded.texture.lock();
+        auto streaming = texture? textures.find(texture.get()) : textures.end();
+        if(streaming == textures.end())
+            continue;
+
+        staging.emplace_back();
+        texture->upload_level(streaming->second.source, loaded.level, loaded.data.data(), command_buffer, staging.back());
+
+        streaming->second.recorded_level = loaded.level;
+        is_recorded = true;
+    }
+
+    return is_recorded;
+}
+
+std::vector<const Texture2D*> TextureStreamer::commit()
+{
+    std::vector<const Texture2D*> changed;
+
+    for(auto it = textures.begin(); it != textures.end();)
+    {
+        auto texture = it->second.texture.lock();
+        if(texture && it->second.recorded_level < texture->first_resident_level)
+        {
+            texture->set_first_resident_level(it->second.recorded_level);
+            changed.push_back(texture.get());
+        }
+
+        // Fully resident textures don't need their source anymore
+        if(!texture || texture->first_resident_level == 0)
+            it = textures.erase(it);
+        else
+            ++it;
+    }
+
+    staging.clear();
+
+    return changed;
+}
+
+bool TextureStreamer::empty() const
+{
+    return textures.empty() && loading_bytes == 0;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#ifndef CG_SEM5_TEXTURESTREAMER_H
+#define CG_SEM5_TEXTURESTREAMER_H
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include <tbb/task_group.h>
+
+#include "devicebuffer.h"
+#include "texture2d.h"
+
+// Uploads the finer mip levels of textures created with only their mip tail resident.
+// Every update the renderer requests the level each texture needs on screen. Requests are served
+// one level per texture, coarse to fine, highest priority first, within a byte budget of levels in flight.
+// Levels are copied out of the sources on TBB workers, mapped files are only paged in there
+class TextureStreamer
+{
+public:
+    static constexpr VkDeviceSize DEFAULT_BYTES_PER_UPDATE = 8ull << 20;
+
+    TextureStreamer(VkDeviceSize bytes_per_update = DEFAULT_BYTES_PER_UPDATE);
+    ~TextureStreamer();
+
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // The source and its storage are kept until every level is resident or the texture is released
+    void add(std::shared_ptr<Texture2D>, Texture2D::Source &&);
+
+    // The finest level requested in an update wins, priority is the projected size in pixels
+    void request(const Texture2D *, uint32_t level, float priority);
+
+    // Starts reading the requested levels on workers and clears the requests
+    void load();
+
+    // Some read level waits to be recorded
+    bool has_loaded() const;
+
+    // Records the uploads of read levels into command_buffer, returns true if anything was recorded
+    bool record(VkCommandBuffer);
+
+    // Call after the recorded command buffer is executed: recorded levels join the texture views.
+    // Returns the textures whose descriptors changed
+    std::vector<const Texture2D*> commit();
+
+    // Nothing is streamed and no level is in flight
+    bool empty() const;
+
+private:
+    struct StreamingTexture
+    {
+        std::weak_ptr<Texture2D> texture;
+        Texture2D::Source        source;
+
+        uint32_t wanted_level;
+        float    priority;
+        uint32_t loading_level;  // Read on a worker or waiting for upload
+        uint32_t recorded_level; // Uploaded but not yet in the view
+    };
+
+    struct LoadedLevel
+    {
+        std::weak_ptr<Texture2D> texture;
+        uint32_t                 level;
+        std::vector<uint8_t>     data;
+    };
+
+    std::unordered_map<const Texture2D*, StreamingTexture> textures;
+    std::vector<std::shared_ptr<DeviceBuffer>> staging;
+
+    VkDeviceSize bytes_per_update;
+    VkDeviceSize loading_bytes;
+
+    tbb::task_group workers;
+
+    mutable std::mutex mutex;
+    std::vector<LoadedLevel> loaded_levels;
+};
+
+#endif // CG_SEM5_TEXTURESTREAMER_H
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "tgaimage.h"
+#include "mappedfile.h"
+
+static constexpr size_t TGA_HEADER_SIZE = 18;
+
+static constexpr uint8_t TGA_TRUE_COLOR     = 2;
+static constexpr uint8_t TGA_GRAYSCALE      = 3;
+static constexpr uint8_t TGA_RLE_TRUE_COLOR = 10;
+static constexpr uint8_t TGA_RLE_GRAYSCALE  = 11;
+
+static constexpr uint8_t TGA_TOP_ORIGIN_BIT = 0x20;
+
+TgaImage TgaImage::load(std::string_view path)
+{
+    using namespace std::string_literals;
+
+    MappedFile file(path);
+    auto data = reinterpret_cast<const uint8_t*>(file.get_data());
+    auto end  = data + file.get_size();
+
+    if(file.get_size() < TGA_HEADER_SIZE)
+        throw std::runtime_error("Can't load image from file \""s + path.data() + "\"");
+
+    uint8_t id_length     = data[0];
+    uint8_t colormap_type = data[1];
+    uint8_t image_type    = data[2];
+    uint8_t pixel_depth   = data[16];
+    uint8_t descriptor    = data[17];
+
+    TgaImage image;
+    image.width  = data[12] | (data[13] << 8);
+    image.height = data[14] | (data[15] << 8);
+
+    bool is_gray = image_type == TGA_GRAYSCALE || image_type == TGA_RLE_GRAYSCALE;
+    bool is_rle  = image_type == TGA_RLE_TRUE_COLOR || image_type == TGA_RLE_GRAYSCALE;
+    size_t pixel_size = pixel_depth / 8;
+
+    if
+    (
+        colormap_type != 0 ||
+        (image_type != TGA_TRUE_COLOR && image_type != TGA_RLE_TRUE_COLOR && !is_gray) ||
+        (is_gray && pixel_depth != 8) ||
+        (!is_gray && pixel_depth != 24 && pixel_depth != 32) ||
+        image.width == 0 || image.height == 0
+    )
+        throw std::runtime_error("Unsupported image format in \""s + path.data() + "\"");
+
+    const uint8_t *cursor = data + TGA_HEADER_SIZE + id_length;
+    size_t pixel_count = static_cast<size_t>(image.width) * image.height;
+
+    // Stored pixels in file order: BGR(A) or gray
+    std::vector<uint8_t> stored(pixel_count * pixel_size);
+    if(!is_rle)
+    {
+        if(static_cast<size_t>(end - cursor) < stored.size())
+            throw std::runtime_error("Can't load image from file \""s + path.data() + "\"");
+
+        std::memcpy(stored.data(), cursor, stored.size());
+    }
+    else
+    {
+        for(size_t i = 0; i < pixel_count;)
+        {
+            if(cursor == end)
+                throw std::runtime_error("Can't load image from file \""s + path.data() + "\"");
+
+            uint8_t packet = *cursor++;
+            size_t  count  = std::min<size_t>((packet & 0x7f) + 1, pixel_count - i);
+            bool    is_run = (packet & 0x80) != 0;
+            size_t  size   = is_run? pixel_size : count * pixel_size;
+
+            if(static_cast<size_t>(end - cursor) < size)
+                throw std::runtime_error("Can't load image from file \""s + path.data() + "\"");
+
+            for(size_t j = 0; j < count; ++j, ++i)
+                std::memcpy(&stored[i * pixel_size], is_run? cursor : cursor + j * pixel_size, pixel_size);
+
+            cursor += size;
+        }
+    }
+
+    image.pixels.resize(pixel_count * 4);
+    bool is_top_origin = (descriptor & TGA_TOP_ORIGIN_BIT) != 0;
+
+    for(uint32_t y = 0; y < image.height; ++y)
+    {
+        uint32_t row = is_top_origin? y : image.height - 1 - y;
+        const uint8_t *source = &stored[static_cast<size_t>(row) * image.width * pixel_size];
+        uint8_t *pixel = &image.pixels[static_cast<size_t>(y) * image.width * 4];
+
+        for(uint32_t x = 0; x < image.width; ++x, source += pixel_size, pixel += 4)
+        {
+            if(is_gray)
+            {
+                pixel[0] = pixel[1] = pixel[2] = source[0];
+                pixel[3] = 255;
+            }
+            else
+            {
+                pixel[0] = source[2];
+                pixel[1] = source[1];
+                pixel[2] = source[0];
+                pixel[3] = pixel_size == 4? source[3] : 255;
+            }
+
+            image.has_alpha = image.has_alpha || pixel[3] != 255;
+        }
+    }
+
+    return image;
+}
+
+TgaImage TgaImage::load_header(std::string_view path)
+{
+    using namespace std::string_literals;
+
+    MappedFile file(path);
+    auto data = reinterpret_cast<const uint8_t*>(file.get_data());
+
+    if(file.get_size() < TGA_HEADER_SIZE)
+        throw std::runtime_error("Can't load image from file \""s + path.data() + "\"");
+
+    TgaImage image;
+    image.width  = data[12] | (data[13] << 8);
+    image.height = data[14] | (data[15] << 8);
+
+    return image;
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#ifndef CG_SEM5_TGAIMAGE_H
+#define CG_SEM5_TGAIMAGE_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Uncompressed or run length encoded true color and grayscale TGA, converted to RGBA8 rows from the top
+struct TgaImage
+{
+    uint32_t width  = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+
+    bool has_alpha = false; // Some pixel isn't opaque
+
+    static TgaImage load(std::string_view path);
+
+    // Width and height only, pixels stay empty
+    static TgaImage load_header(std::string_view path);
+};
+
+#endif // CG_SEM5_TGAIMAGE_H
\ No newline at end of file
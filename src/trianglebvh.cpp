@@ -0,0 +1,491 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_invoke.h>
+
+#include "trianglebvh.h"
+#include "simd.h"
+
+// Splits ranges of triangle order in place, nodes are preallocated so subtrees are built concurrently
+class TriangleBvhBuilder
+{
+public:
+    static constexpr uint32_t BIN_COUNT          = 12;
+    static constexpr uint32_t PARALLEL_THRESHOLD = 4096; // Smaller subtrees are built by the task of their parent
+    static constexpr float    TRAVERSAL_COST     = 1.f;  // Relative to a triangle test
+
+    TriangleBvhBuilder
+    (
+        const StridedView<glm::vec3> &positions,
+        const std::vector<MeshElementIndex> &indices,
+        const std::vector<MeshElementIndex> &triangles
+    )
+    : triangles(triangles),
+    boxes(triangles.size()),
+    centroids(triangles.size()),
+    order(triangles.size()),
+    nodes(2 * triangles.size() - 1),
+    node_count(1)
+    {
+        tbb::parallel_for
+        (
+            tbb::blocked_range<size_t>(0, triangles.size()),
+            [&](const tbb::blocked_range<size_t> &range)
+            {
+                for(size_t i = range.begin(); i != range.end(); ++i)
+                {
+                    auto first = triangles[i];
+                    glm::vec3 a = positions[indices[first]];
+                    glm::vec3 b = positions[indices[first + 1]];
+                    glm::vec3 c = positions[indices[first + 2]];
+
+                    boxes[i]     = { glm::min(a, glm::min(b, c)), glm::max(a, glm::max(b, c)) };
+                    centroids[i] = 0.5f * (boxes[i].min + boxes[i].max);
+                }
+            }
+        );
+
+        std::iota(order.begin(), order.end(), 0);
+    }
+
+    void build(uint32_t node, uint32_t begin, uint32_t end)
+    {
+        BoundingBox box          = boxes[order[begin]];
+        BoundingBox centroid_box = { centroids[order[begin]], centroids[order[begin]] };
+        for(uint32_t i = begin + 1; i < end; ++i)
+        {
+            box = combine(box, boxes[order[i]]);
+            centroid_box.min = glm::min(centroid_box.min, centroids[order[i]]);
+            centroid_box.max = glm::max(centroid_box.max, centroids[order[i]]);
+        }
+
+        nodes[node].box = box;
+
+        uint32_t count = end - begin;
+        uint32_t mid   = begin + count / 2;
+
+        int axis = 0;
+        uint32_t split_bin = 0;
+        float split_cost = find_split(begin, end, box, centroid_box, axis, split_bin);
+
+        if(count <= 2 || (split_cost >= static_cast<float>(count) && count <= TriangleBvh::MAX_LEAF_TRIANGLES))
+        {
+            nodes[node].first = begin;
+            nodes[node].count = count;
+            return;
+        }
+
+        // Without a split, as when every centroid is the same, the range is halved
+        if(split_cost < std::numeric_limits<float>::max())
+        {
+            auto split = std::partition
+            (
+                order.begin() + begin,
+                order.begin() + end,
+                [&](uint32_t triangle) { return get_bin(centroids[triangle][axis], centroid_box, axis) < split_bin; }
+            );
+
+            mid = static_cast<uint32_t>(split - order.begin());
+            if(mid == begin || mid == end)
+                mid = begin + count / 2;
+        }
+
+        uint32_t left = node_count.fetch_add(2);
+        nodes[node].first = left;
+        nodes[node].count = 0;
+
+        if(count > PARALLEL_THRESHOLD)
+        {
+            tbb::parallel_invoke
+            (
+                [&] { build(left, begin, mid); },
+                [&] { build(left + 1, mid, end); }
+            );
+        }
+        else
+        {
+            build(left, begin, mid);
+            build(left + 1, mid, end);
+        }
+    }
+
+    std::vector<TriangleBvh::Node> take_nodes()
+    {
+        nodes.resize(node_count);
+        return std::move(nodes);
+    }
+
+    std::vector<MeshElementIndex> take_triangles() const
+    {
+        std::vector<MeshElementIndex> ordered(order.size());
+        for(size_t i = 0, triangles_count = order.size(); i < triangles_count; ++i)
+            ordered[i] = triangles[order[i]];
+
+        return ordered;
+    }
+
+private:
+    uint32_t get_bin(float centroid, const BoundingBox &centroid_box, int axis) const
+    {
+        float extent = centroid_box.max[axis] - centroid_box.min[axis];
+        auto bin = static_cast<uint32_t>(static_cast<float>(BIN_COUNT) * (centroid - centroid_box.min[axis]) / extent);
+        return std::min(bin, BIN_COUNT - 1);
+    }
+
+    // Cost of the cheapest split in triangle tests, max float if no axis can be split
+    float find_split(uint32_t begin, uint32_t end, const BoundingBox &box, const BoundingBox &centroid_box, int &best_axis, uint32_t &best_bin) const
+    {
+        float best_cost = std::numeric_limits<float>::max();
+        float inverse_area = 1.f / std::max(surface_area(box), std::numeric_limits<float>::min());
+
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            if(centroid_box.max[axis] <= centroid_box.min[axis])
+                continue;
+
+            BoundingBox bin_boxes[BIN_COUNT];
+            uint32_t bin_counts[BIN_COUNT] = {};
+            for(uint32_t i = begin; i < end; ++i)
+            {
+                auto bin = get_bin(centroids[order[i]][axis], centroid_box, axis);
+                bin_boxes[bin] = bin_counts[bin] == 0? boxes[order[i]] : combine(bin_boxes[bin], boxes[order[i]]);
+                ++bin_counts[bin];
+            }
+
+            // Right sides swept from the last bin, split i puts bins below i on the left
+            float right_areas[BIN_COUNT];
+            uint32_t right_counts[BIN_COUNT];
+            BoundingBox right_box;
+            uint32_t right_count = 0;
+            for(uint32_t i = BIN_COUNT - 1; i > 0; --i)
+            {
+                if(bin_counts[i] > 0)
+                {
+                    right_box = right_count == 0? bin_boxes[i] : combine(right_box, bin_boxes[i]);
+                    right_count += bin_counts[i];
+                }
+
+                right_areas[i]  = right_count > 0? surface_area(right_box) : 0.f;
+                right_counts[i] = right_count;
+            }
+
+            BoundingBox left_box;
+            uint32_t left_count = 0;
+            for(uint32_t i = 1; i < BIN_COUNT; ++i)
+            {
+                if(bin_counts[i - 1] > 0)
+                {
+                    left_box = left_count == 0? bin_boxes[i - 1] : combine(left_box, bin_boxes[i - 1]);
+                    left_count += bin_counts[i - 1];
+                }
+
+                if(left_count == 0 || right_counts[i] == 0)
+                    continue;
+
+                float cost = TRAVERSAL_COST + inverse_area * (surface_area(left_box) * left_count + right_areas[i] * right_counts[i]);
+                if(cost < best_cost)
+                {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin  = i;
+                }
+            }
+        }
+
+        return best_cost;
+    }
+
+    const std::vector<MeshElementIndex> &triangles;
+    std::vector<BoundingBox> boxes;
+    std::vector<glm::vec3> centroids;
+    std::vector<uint32_t> order;
+    std::vector<TriangleBvh::Node> nodes;
+    std::atomic<uint32_t> node_count;
+};
+
+bool TriangleBvh::Hit::is_hit() const
+{
+    return triangle != NO_TRIANGLE;
+}
+
+TriangleBvh TriangleBvh::build
+(
+    const StridedView<glm::vec3> &positions,
+    const std::vector<MeshElementIndex> &indices,
+    const std::vector<MeshElementIndex> &triangles
+)
+{
+    TriangleBvh bvh;
+    if(triangles.empty())
+        return bvh;
+
+    TriangleBvhBuilder builder(positions, indices, triangles);
+    builder.build(0, 0, static_cast<uint32_t>(triangles.size()));
+
+    bvh.nodes     = builder.take_nodes();
+    bvh.triangles = builder.take_triangles();
+    bvh.setup_triangles(positions, indices);
+
+    return bvh;
+}
+
+TriangleBvh::TriangleBvh
+(
+    std::vector<Node> &&nodes,
+    std::vector<MeshElementIndex> &&triangles,
+    const StridedView<glm::vec3> &positions,
+    const std::vector<MeshElementIndex> &indices
+)
+: nodes(std::move(nodes)),
+triangles(std::move(triangles))
+{
+    for(auto first : this->triangles)
+    {
+        if(static_cast<size_t>(first) + 2 >= indices.size())
+            throw std::runtime_error("Triangle BVH references indices out of range");
+
+        for(MeshElementIndex i = first; i < first + 3; ++i)
+            if(indices[i] >= positions.size())
+                throw std::runtime_error("Triangle BVH references vertices out of range");
+    }
+
+    for(auto &&node : this->nodes)
+    {
+        bool is_valid = node.count > 0
+                      ? static_cast<size_t>(node.first) + node.count <= this->triangles.size()
+                      : static_cast<size_t>(node.first) + 1 < this->nodes.size();
+
+        if(!is_valid)
+            throw std::runtime_error("Triangle BVH references nodes or triangles out of range");
+    }
+
+    setup_triangles(positions, indices);
+}
+
+bool TriangleBvh::empty() const
+{
+    return nodes.empty();
+}
+
+const std::vector<TriangleBvh::Node> &TriangleBvh::get_nodes() const
+{
+    return nodes;
+}
+
+const std::vector<MeshElementIndex> &TriangleBvh::get_triangles() const
+{
+    return triangles;
+}
+
+void TriangleBvh::intersect(const RayPacket &packet, Hit (&hits)[PACKET_SIZE]) const
+{
+    Rays rays;
+    for(uint32_t i = 0; i < PACKET_SIZE; ++i)
+    {
+        // Infinities of axis parallel rays compare correctly in the slab test
+        glm::vec3 inverse_direction = 1.f / packet.directions[i];
+
+        rays.origin_x[i]     = packet.origins[i].x;
+        rays.origin_y[i]     = packet.origins[i].y;
+        rays.origin_z[i]     = packet.origins[i].z;
+        rays.direction_x[i]  = packet.directions[i].x;
+        rays.direction_y[i]  = packet.directions[i].y;
+        rays.direction_z[i]  = packet.directions[i].z;
+        rays.inverse_x[i]    = inverse_direction.x;
+        rays.inverse_y[i]    = inverse_direction.y;
+        rays.inverse_z[i]    = inverse_direction.z;
+        rays.max_distance[i] = packet.max_distances[i];
+
+        hits[i] = {};
+        hits[i].distance = packet.max_distances[i];
+    }
+
+    if(nodes.empty())
+        return;
+
+    std::vector<uint32_t> stack = { 0 };
+    while(!stack.empty())
+    {
+        auto &node = nodes[stack.back()];
+        stack.pop_back();
+
+        if(intersect_box(node.box, rays) == 0)
+            continue;
+
+        if(node.count > 0)
+        {
+            for(uint32_t i = node.first, end = node.first + node.count; i < end; ++i)
+                intersect_triangle(i, rays, hits);
+
+            continue;
+        }
+
+        // The child nearer along the first ray is visited first, so hits shorten the rays early
+        glm::vec3 direction(rays.direction_x[0], rays.direction_y[0], rays.direction_z[0]);
+        auto &left  = nodes[node.first].box;
+        auto &right = nodes[node.first + 1].box;
+        bool is_left_nearer = glm::dot(left.min + left.max - right.min - right.max, direction) < 0.f;
+
+        stack.push_back(is_left_nearer? node.first + 1 : node.first);
+        stack.push_back(is_left_nearer? node.first : node.first + 1);
+    }
+}
+
+TriangleBvh::Hit TriangleBvh::intersect(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance) const
+{
+    RayPacket packet;
+    for(uint32_t i = 0; i < PACKET_SIZE; ++i)
+    {
+        packet.origins[i]       = origin;
+        packet.directions[i]    = direction;
+        packet.max_distances[i] = max_distance;
+    }
+
+    Hit hits[PACKET_SIZE];
+    intersect(packet, hits);
+
+    return hits[0];
+}
+
+void TriangleBvh::setup_triangles(const StridedView<glm::vec3> &positions, const std::vector<MeshElementIndex> &indices)
+{
+    triangle_positions.resize(triangles.size());
+    for(size_t i = 0, triangles_count = triangles.size(); i < triangles_count; ++i)
+    {
+        auto first = triangles[i];
+        glm::vec3 a = positions[indices[first]];
+
+        triangle_positions[i] = { a, positions[indices[first + 1]] - a, positions[indices[first + 2]] - a };
+    }
+}
+
+uint32_t TriangleBvh::intersect_box(const BoundingBox &box, const Rays &rays) const
+{
+#ifdef CG_SEM5_SSE
+    __m128 enter = _mm_setzero_ps();
+    __m128 leave = _mm_load_ps(rays.max_distance);
+
+    const float *origins[]  = { rays.origin_x, rays.origin_y, rays.origin_z };
+    const float *inverses[] = { rays.inverse_x, rays.inverse_y, rays.inverse_z };
+    for(int axis = 0; axis < 3; ++axis)
+    {
+        __m128 origin  = _mm_load_ps(origins[axis]);
+        __m128 inverse = _mm_load_ps(inverses[axis]);
+        __m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.min[axis]), origin), inverse);
+        __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(box.max[axis]), origin), inverse);
+
+        enter = _mm_max_ps(enter, _mm_min_ps(t0, t1));
+        leave = _mm_min_ps(leave, _mm_max_ps(t0, t1));
+    }
+
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(enter, leave)));
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < PACKET_SIZE; ++i)
+    {
+        glm::vec3 origin(rays.origin_x[i], rays.origin_y[i], rays.origin_z[i]);
+        glm::vec3 inverse(rays.inverse_x[i], rays.inverse_y[i], rays.inverse_z[i]);
+        glm::vec3 t0 = (box.min - origin) * inverse;
+        glm::vec3 t1 = (box.max - origin) * inverse;
+        glm::vec3 near = glm::min(t0, t1);
+        glm::vec3 far  = glm::max(t0, t1);
+
+        float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.f));
+        float leave = std::min(std::min(far.x, far.y), std::min(far.z, rays.max_distance[i]));
+        if(enter <= leave)
+            mask |= 1u << i;
+    }
+
+    return mask;
+#endif // CG_SEM5_SSE
+}
+
+void TriangleBvh::intersect_triangle(uint32_t triangle, Rays &rays, Hit (&hits)[PACKET_SIZE]) const
+{
+    // Moller-Trumbore, both windings are hit
+    auto &[vertex, edge1, edge2] = triangle_positions[triangle];
+
+#ifdef CG_SEM5_SSE
+    __m128 dx = _mm_load_ps(rays.direction_x);
+    __m128 dy = _mm_load_ps(rays.direction_y);
+    __m128 dz = _mm_load_ps(rays.direction_z);
+
+    __m128 e1x = _mm_set1_ps(edge1.x), e1y = _mm_set1_ps(edge1.y), e1z = _mm_set1_ps(edge1.z);
+    __m128 e2x = _mm_set1_ps(edge2.x), e2y = _mm_set1_ps(edge2.y), e2z = _mm_set1_ps(edge2.z);
+
+    // p = direction x edge2
+    __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+    __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+    __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+    __m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+    __m128 inverse_determinant = _mm_div_ps(_mm_set1_ps(1.f), determinant);
+
+    // s = origin - vertex
+    __m128 sx = _mm_sub_ps(_mm_load_ps(rays.origin_x), _mm_set1_ps(vertex.x));
+    __m128 sy = _mm_sub_ps(_mm_load_ps(rays.origin_y), _mm_set1_ps(vertex.y));
+    __m128 sz = _mm_sub_ps(_mm_load_ps(rays.origin_z), _mm_set1_ps(vertex.z));
+
+    __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverse_determinant);
+
+    // q = s x edge1
+    __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+    __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+    __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+    __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverse_determinant);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverse_determinant);
+
+    // Degenerate triangles and parallel rays get infinite or NaN coordinates, which fail the comparisons
+    __m128 zero = _mm_setzero_ps();
+    __m128 is_hit = _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero));
+    is_hit = _mm_and_ps(is_hit, _mm_cmple_ps(_mm_add_ps(u, v), _mm_set1_ps(1.f)));
+    is_hit = _mm_and_ps(is_hit, _mm_cmpge_ps(t, zero));
+    is_hit = _mm_and_ps(is_hit, _mm_cmplt_ps(t, _mm_load_ps(rays.max_distance)));
+
+    int mask = _mm_movemask_ps(is_hit);
+    if(mask == 0)
+        return;
+
+    alignas(16) float distances[PACKET_SIZE], us[PACKET_SIZE], vs[PACKET_SIZE];
+    _mm_store_ps(distances, t);
+    _mm_store_ps(us, u);
+    _mm_store_ps(vs, v);
+
+    for(uint32_t i = 0; i < PACKET_SIZE; ++i)
+    {
+        if(((mask >> i) & 1) == 0)
+            continue;
+
+        hits[i] = { distances[i], triangles[triangle], glm::vec2(us[i], vs[i]) };
+        rays.max_distance[i] = distances[i];
+    }
+#else
+    for(uint32_t i = 0; i < PACKET_SIZE; ++i)
+    {
+        glm::vec3 origin(rays.origin_x[i], rays.origin_y[i], rays.origin_z[i]);
+        glm::vec3 direction(rays.direction_x[i], rays.direction_y[i], rays.direction_z[i]);
+
+        glm::vec3 p = glm::cross(direction, edge2);
+        float inverse_determinant = 1.f / glm::dot(edge1, p);
+
+        glm::vec3 s = origin - vertex;
+        float u = glm::dot(s, p) * inverse_determinant;
+
+        glm::vec3 q = glm::cross(s, edge1);
+        float v = glm::dot(direction, q) * inverse_determinant;
+        float t = glm::dot(edge2, q) * inverse_determinant;
+
+        if(u >= 0.f && v >= 0.f && u + v <= 1.f && t >= 0.f && t < rays.max_distance[i])
+        {
+            hits[i] = { t, triangles[triangle], glm::vec2(u, v) };
+            rays.max_distance[i] = t;
+        }
+    }
+#endif // CG_SEM5_SSE
+}
\ No newline at end of file
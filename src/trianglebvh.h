@@ -0,0 +1,108 @@
+#ifndef CG_SEM5_TRIANGLEBVH_H
+#define CG_SEM5_TRIANGLEBVH_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/glm.hpp>
+
+#include "abstractmesh.h"
+#include "boundingvolume.h"
+#include "stridedview.h"
+
+// Binary bounding volume hierarchy over the triangles of a mesh, split by the surface area heuristic.
+// Rays are traced as packets of PACKET_SIZE, every node and triangle is tested against the whole packet.
+// Keeps its own copy of the triangle positions, so it works while the CPU geometry is released
+class TriangleBvh
+{
+public:
+    static constexpr uint32_t PACKET_SIZE        = 4;
+    static constexpr uint32_t MAX_LEAF_TRIANGLES = 8;
+    static constexpr uint32_t NO_TRIANGLE        = std::numeric_limits<uint32_t>::max();
+
+    // Children of an inner node are next to each other
+    struct Node
+    {
+        BoundingBox box;
+        uint32_t    first; // Left child of inner nodes, first triangle of leaves
+        uint32_t    count; // Triangles, 0 for inner nodes
+    };
+
+    struct Hit
+    {
+        float     distance = std::numeric_limits<float>::max(); // In direction lengths
+        uint32_t  triangle = NO_TRIANGLE;                       // First index of the triangle in the index buffer
+        glm::vec2 barycentric = glm::vec2(0.f);                 // Of the second and the third vertex
+
+        bool is_hit() const;
+    };
+
+    // Directions don't have to be normalized
+    struct RayPacket
+    {
+        glm::vec3 origins[PACKET_SIZE];
+        glm::vec3 directions[PACKET_SIZE];
+        float     max_distances[PACKET_SIZE];
+    };
+
+    TriangleBvh() = default;
+
+    // Over the triangles starting at the given indices, subtrees are built in parallel
+    static TriangleBvh build
+    (
+        const StridedView<glm::vec3> &positions,
+        const std::vector<MeshElementIndex> &indices,
+        const std::vector<MeshElementIndex> &triangles
+    );
+
+    // Restores a hierarchy from its nodes and triangles, throws if they don't match the geometry
+    TriangleBvh
+    (
+        std::vector<Node> &&nodes,
+        std::vector<MeshElementIndex> &&triangles,
+        const StridedView<glm::vec3> &positions,
+        const std::vector<MeshElementIndex> &indices
+    );
+
+    bool empty() const;
+    const std::vector<Node> &get_nodes() const;
+    const std::vector<MeshElementIndex> &get_triangles() const; // In leaf order
+
+    // Nearest hits no farther than the max distances
+    void intersect(const RayPacket &, Hit (&hits)[PACKET_SIZE]) const;
+
+    // The ray fills every lane of a packet
+    Hit intersect(const glm::vec3 &origin, const glm::vec3 &direction, float max_distance) const;
+
+private:
+    // Origin and two edges, in leaf order
+    struct Triangle
+    {
+        glm::vec3 vertex;
+        glm::vec3 edge1;
+        glm::vec3 edge2;
+    };
+
+    // Packet transposed for SIMD loads
+    struct alignas(16) Rays
+    {
+        float origin_x[PACKET_SIZE], origin_y[PACKET_SIZE], origin_z[PACKET_SIZE];
+        float direction_x[PACKET_SIZE], direction_y[PACKET_SIZE], direction_z[PACKET_SIZE];
+        float inverse_x[PACKET_SIZE], inverse_y[PACKET_SIZE], inverse_z[PACKET_SIZE];
+        float max_distance[PACKET_SIZE];
+    };
+
+    void setup_triangles(const StridedView<glm::vec3> &positions, const std::vector<MeshElementIndex> &indices);
+
+    // Bit per ray entering the box
+    uint32_t intersect_box(const BoundingBox &, const Rays &) const;
+    void intersect_triangle(uint32_t triangle, Rays &, Hit (&hits)[PACKET_SIZE]) const;
+
+    std::vector<Node> nodes;
+    std::vector<MeshElementIndex> triangles;
+    std::vector<Triangle> triangle_positions;
+};
+
+#endif // CG_SEM5_TRIANGLEBVH_H
\ No newline at end of file
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "virtualtexture.h"
+
+uint32_t VirtualTexture::get_level_count(uint32_t width, uint32_t height)
+{
+    uint32_t level_count = 1;
+    while(std::max(width, height) > PAGE_SIZE)
+    {
+        width  = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        ++level_count;
+    }
+
+    return level_count;
+}
+
+glm::uvec2 VirtualTexture::get_level_extent(uint32_t width, uint32_t height, uint32_t level)
+{
+    return glm::uvec2(std::max(width >> level, 1u), std::max(height >> level, 1u));
+}
+
+glm::uvec2 VirtualTexture::get_page_grid(uint32_t width, uint32_t height, uint32_t level)
+{
+    return (get_level_extent(width, height, level) + glm::uvec2(PAGE_SIZE - 1)) / PAGE_SIZE;
+}
+
+std::shared_ptr<VirtualTexture> VirtualTexture::open(std::string_view path)
+{
+    return std::shared_ptr<VirtualTexture>(new VirtualTexture(path));
+}
+
+VirtualTexture::VirtualTexture(std::string_view path)
+: path(path.data()),
+file(path),
+header(),
+level_offsets()
+{
+    using namespace std::string_literals;
+
+    if(file.get_size() < sizeof(header))
+        throw std::runtime_error("Can't load virtual texture \""s + path.data() + "\"");
+
+    std::memcpy(&header, file.get_data(), sizeof(header));
+
+    if
+    (
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.page_size != PAGE_SIZE ||
+        header.page_border != PAGE_BORDER ||
+        header.width == 0 || header.height == 0 ||
+        header.level_count != get_level_count(header.width, header.height)
+    )
+        throw std::runtime_error("Unsupported virtual texture \""s + path.data() + "\"");
+
+    level_offsets.push_back(0);
+    for(uint32_t level = 0; level < header.level_count; ++level)
+    {
+        auto grid = get_page_grid(level);
+        level_offsets.push_back(level_offsets.back() + grid.x * grid.y);
+    }
+
+    if((file.get_size() - sizeof(header)) / PAGE_BYTES < get_page_count())
+        throw std::runtime_error("Can't load virtual texture \""s + path.data() + "\"");
+}
+
+const std::string &VirtualTexture::get_path() const
+{
+    return path;
+}
+
+uint32_t VirtualTexture::get_width() const
+{
+    return header.width;
+}
+
+uint32_t VirtualTexture::get_height() const
+{
+    return header.height;
+}
+
+uint32_t VirtualTexture::get_level_count() const
+{
+    return header.level_count;
+}
+
+glm::uvec2 VirtualTexture::get_page_grid(uint32_t level) const
+{
+    return get_page_grid(header.width, header.height, level);
+}
+
+uint32_t VirtualTexture::get_page_count() const
+{
+    return level_offsets.back();
+}
+
+uint32_t VirtualTexture::get_level_offset(uint32_t level) const
+{
+    return level_offsets[level];
+}
+
+uint32_t VirtualTexture::get_page_index(const Page &page) const
+{
+    return level_offsets[page.level] + page.y * get_page_grid(page.level).x + page.x;
+}
+
+VirtualTexture::Page VirtualTexture::get_page(uint32_t index) const
+{
+    uint32_t level = static_cast<uint32_t>(std::upper_bound(level_offsets.begin(), level_offsets.end(), index) - level_offsets.begin()) - 1;
+    uint32_t grid_width = get_page_grid(level).x;
+    uint32_t offset = index - level_offsets[level];
+
+    return { level, offset % grid_width, offset / grid_width };
+}
+
+const void *VirtualTexture::get_page_data(uint32_t index) const
+{
+    return file.get_data() + sizeof(header) + index * PAGE_BYTES;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef CG_SEM5_VIRTUALTEXTURE_H
+#define CG_SEM5_VIRTUALTEXTURE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/vec2.hpp>
+
+#include "mappedfile.h"
+
+// Cooked RGBA8 image split into square pages, sampled through VirtualTextureCache so only the pages on screen are resident.
+// Every page is stored with a border of the neighbouring texels (wrapping around the image) for filtering.
+// Pages follow the header level after level, row after row, so a page is found without an index.
+// Levels halve the image until it fits into one page
+class VirtualTexture
+{
+public:
+    static constexpr uint32_t     PAGE_SIZE        = 128;
+    static constexpr uint32_t     PAGE_BORDER      = 4;
+    static constexpr uint32_t     STORED_PAGE_SIZE = PAGE_SIZE + 2 * PAGE_BORDER;
+    static constexpr VkDeviceSize PAGE_BYTES       = STORED_PAGE_SIZE * STORED_PAGE_SIZE * 4;
+    static constexpr VkFormat     FORMAT           = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // Images with a larger side are virtual, smaller ones are loaded whole
+    static constexpr uint32_t MIN_SIZE = 4096;
+
+    struct FileHeader
+    {
+        char     magic[4];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t level_count;
+        uint32_t page_size;
+        uint32_t page_border;
+        uint32_t reserved;
+    };
+
+    static constexpr char     MAGIC[4] = { 'V', 'T', 'E', 'X' };
+    static constexpr uint32_t VERSION  = 1;
+
+    struct Page
+    {
+        uint32_t level;
+        uint32_t x, y;
+    };
+
+    static uint32_t get_level_count(uint32_t width, uint32_t height);
+    static glm::uvec2 get_level_extent(uint32_t width, uint32_t height, uint32_t level);
+    static glm::uvec2 get_page_grid(uint32_t width, uint32_t height, uint32_t level);
+
+    static std::shared_ptr<VirtualTexture> open(std::string_view path);
+
+    VirtualTexture(const VirtualTexture &) = delete;
+    VirtualTexture &operator=(const VirtualTexture &) = delete;
+
+    const std::string &get_path() const;
+    uint32_t get_width() const;
+    uint32_t get_height() const;
+    uint32_t get_level_count() const;
+    glm::uvec2 get_page_grid(uint32_t level) const;
+
+    // Pages of every level are numbered together, coarser levels after finer ones
+    uint32_t get_page_count() const;
+    uint32_t get_level_offset(uint32_t level) const;
+    uint32_t get_page_index(const Page &) const;
+    Page get_page(uint32_t index) const;
+
+    // STORED_PAGE_SIZE rows from the top, in the mapping. Reading it may fault the file in
+    const void *get_page_data(uint32_t index) const;
+
+private:
+    VirtualTexture(std::string_view path);
+
+    std::string path;
+    MappedFile  file;
+    FileHeader  header;
+
+    std::vector<uint32_t> level_offsets; // One more than levels, the last one is the page count
+};
+
+#endif // CG_SEM5_VIRTUALTEXTURE_H
\ No newline at end of file
@@ -0,0 +1,452 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <glm/common.hpp>
+
+#include "virtualtexturecache.h"
+#include "vkassert.h"
+
+// Page at the next coarser level covering the center of the page
+VirtualTexture::Page get_parent_page(const VirtualTexture &, const VirtualTexture::Page &);
+
+VirtualTextureCache::VirtualTextureCache(std::shared_ptr<Device> device)
+: device(device),
+texture(),
+page_table(std::make_shared<DeviceBuffer>()),
+page_table_entries(nullptr),
+page_table_size(0),
+registrations(),
+slots(SLOTS_PER_SIDE * SLOTS_PER_SIDE),
+resident_pages(),
+reading_pages(),
+faulted_pages(),
+recorded_pages(),
+staging(),
+frame(0),
+requested_count(0),
+hit_count(0),
+fault_count(0),
+fault_latency_sum(0.0),
+workers(),
+mutex(),
+loaded_pages()
+{
+    // Written between frames only, while the queue is idle
+    vk_assert
+    (
+        device->create_buffer
+        (
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            page_table,
+            PAGE_TABLE_CAPACITY * sizeof(uint32_t)
+        ),
+        "Can't create buffer for virtual texture page table"
+    );
+
+    vk_assert
+    (
+        page_table->map(),
+        "Can't map virtual texture page table"
+    );
+
+    page_table_entries = static_cast<uint32_t*>(page_table->mapped_memory);
+    std::memset(page_table_entries, 0, PAGE_TABLE_CAPACITY * sizeof(uint32_t));
+}
+
+VirtualTextureCache::~VirtualTextureCache()
+{
+    workers.wait();
+}
+
+std::shared_ptr<VirtualTexture> VirtualTextureCache::add
+(
+    std::shared_ptr<VirtualTexture> virtual_texture,
+    VkCommandBuffer command_buffer,
+    std::shared_ptr<DeviceBuffer> &staging
+)
+{
+    using namespace std::string_literals;
+
+    release_expired();
+
+    for(auto &&registration : registrations)
+        if(registration.path == virtual_texture->get_path())
+            if(auto added = registration.texture.lock())
+                return added;
+
+    uint32_t level_count = virtual_texture->get_level_count();
+    uint32_t page_count  = virtual_texture->get_page_count();
+
+    if(PAGE_TABLE_CAPACITY - page_table_size < 3 + level_count + page_count)
+        throw std::runtime_error("Can't fit virtual texture \""s + virtual_texture->get_path() + "\" into the page table");
+
+    // Any page but the pinned ones may go, shaders fall back to coarser levels
+    size_t slot = find_free_slot(std::numeric_limits<uint64_t>::max());
+    if(slot == slots.size())
+        throw std::runtime_error("Can't fit virtual texture \""s + virtual_texture->get_path() + "\" into the page cache");
+
+    if(!texture)
+        create_texture(command_buffer);
+
+    Registration registration;
+    registration.texture     = virtual_texture;
+    registration.path        = virtual_texture->get_path();
+    registration.header      = page_table_size;
+    registration.first_entry = page_table_size + 3 + level_count;
+    registration.page_count  = page_count;
+
+    uint32_t *header = page_table_entries + registration.header;
+    header[0] = virtual_texture->get_width();
+    header[1] = virtual_texture->get_height();
+    header[2] = level_count;
+    for(uint32_t level = 0; level < level_count; ++level)
+        header[3 + level] = registration.first_entry + virtual_texture->get_level_offset(level);
+
+    page_table_size = registration.first_entry + page_count;
+    registrations.push_back(registration);
+
+    // Nothing is drawn until the command buffer is executed, the evicted page can go right away
+    uint32_t coarsest_entry = registration.first_entry + page_count - 1;
+    if(slots[slot].entry != INVALID_PAGE)
+    {
+        page_table_entries[slots[slot].entry] = 0;
+        resident_pages.erase(slots[slot].entry);
+    }
+
+    slots[slot] = { coarsest_entry, frame, true };
+    resident_pages[coarsest_entry] = static_cast<uint32_t>(slot);
+    page_table_entries[coarsest_entry] = make_entry(slot);
+
+    auto allocation = device->staging_pool.allocate(*device, VirtualTexture::PAGE_BYTES);
+    std::memcpy(allocation.data, virtual_texture->get_page_data(page_count - 1), VirtualTexture::PAGE_BYTES);
+    staging = allocation.buffer;
+
+    texture->copy_regions(*staging, { make_page_copy(slot, allocation.offset) }, command_buffer);
+
+    return virtual_texture;
+}
+
+int32_t VirtualTextureCache::get_page_table_offset(const VirtualTexture *virtual_texture) const
+{
+    if(!virtual_texture)
+        return -1;
+
+    for(auto &&registration : registrations)
+        if(registration.texture.lock().get() == virtual_texture)
+            return static_cast<int32_t>(registration.header);
+
+    return -1;
+}
+
+const std::shared_ptr<Texture2D> &VirtualTextureCache::get_texture() const
+{
+    return texture;
+}
+
+const std::shared_ptr<DeviceBuffer> &VirtualTextureCache::get_page_table() const
+{
+    return page_table;
+}
+
+void VirtualTextureCache::request(const uint32_t *entries, size_t count)
+{
+    ++frame;
+    release_expired();
+
+    std::vector<uint32_t> requested(entries, entries + count);
+    std::sort(requested.begin(), requested.end());
+    requested.erase(std::unique(requested.begin(), requested.end()), requested.end());
+
+    struct MissingPage
+    {
+        std::shared_ptr<VirtualTexture> texture;
+        uint32_t entry;
+        uint32_t index;
+        uint32_t level;
+    };
+
+    std::vector<MissingPage> missing_pages;
+    auto now = Clock::now();
+
+    for(uint32_t entry : requested)
+    {
+        size_t registration = find_registration(entry);
+        if(registration == registrations.size())
+            continue;
+
+        auto virtual_texture = registrations[registration].texture.lock();
+        if(!virtual_texture)
+            continue;
+
+        ++requested_count;
+
+        auto resident = resident_pages.find(entry);
+        if(resident != resident_pages.end())
+        {
+            ++hit_count;
+            slots[resident->second].last_used = frame;
+            continue;
+        }
+
+        // Keeps the page shaders fall back to
+        uint32_t first_entry = registrations[registration].first_entry;
+        auto page = virtual_texture->get_page(entry - first_entry);
+        for(auto parent = page; parent.level + 1 < virtual_texture->get_level_count();)
+        {
+            parent = get_parent_page(*virtual_texture, parent);
+            auto fallback = resident_pages.find(first_entry + virtual_texture->get_page_index(parent));
+            if(fallback != resident_pages.end())
+            {
+                slots[fallback->second].last_used = frame;
+                break;
+            }
+        }
+
+        faulted_pages.emplace(entry, now);
+        if(reading_pages.count(entry) == 0)
+            missing_pages.push_back({ virtual_texture, entry, entry - first_entry, page.level });
+    }
+
+    // Pages no longer on screen don't count as faults
+    for(auto it = faulted_pages.begin(); it != faulted_pages.end();)
+    {
+        if(reading_pages.count(it->first) == 0 && !std::binary_search(requested.begin(), requested.end(), it->first))
+            it = faulted_pages.erase(it);
+        else
+            ++it;
+    }
+
+    // Coarser pages cover more of the screen and are the fallback of finer ones
+    std::sort
+    (
+        missing_pages.begin(), missing_pages.end(),
+        [](auto &&lhs, auto &&rhs) { return lhs.level > rhs.level; }
+    );
+
+    // Pages not read now are requested again by the next feedback
+    for(auto &&page : missing_pages)
+    {
+        if(reading_pages.size() >= MAX_PENDING_READS)
+            break;
+
+        reading_pages.insert(page.entry);
+
+        // Reading the mapping may fault the file in, so it happens on a worker
+        workers.run([this, texture = std::move(page.texture), entry = page.entry, index = page.index]
+        {
+            auto data = static_cast<const uint8_t*>(texture->get_page_data(index));
+            LoadedPage loaded = { entry, std::vector<uint8_t>(data, data + VirtualTexture::PAGE_BYTES) };
+
+            std::lock_guard<std::mutex> lock(mutex);
+            loaded_pages.push_back(std::move(loaded));
+        });
+    }
+}
+
+bool VirtualTextureCache::record(VkCommandBuffer command_buffer)
+{
+    std::vector<LoadedPage> pages;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pages.swap(loaded_pages);
+    }
+
+    std::vector<VkBufferImageCopy> regions;
+    StagingPool::Allocation allocation = {};
+
+    size_t i = 0;
+    for(; i < pages.size() && regions.size() < MAX_UPLOADS_PER_UPDATE; ++i)
+    {
+        auto &page = pages[i];
+        size_t registration = find_registration(page.entry);
+        if(registration == registrations.size() || registrations[registration].texture.expired())
+        {
+            reading_pages.erase(page.entry);
+            continue;
+        }
+
+        // Every slot is used by the current frame, the page waits for the next update
+        size_t slot = find_free_slot(frame);
+        if(slot == slots.size())
+            break;
+
+        if(!allocation.buffer)
+        {
+            VkDeviceSize size = std::min<VkDeviceSize>(pages.size(), MAX_UPLOADS_PER_UPDATE) * VirtualTexture::PAGE_BYTES;
+            allocation = device->staging_pool.allocate(*device, size);
+        }
+
+        VkDeviceSize offset = regions.size() * VirtualTexture::PAGE_BYTES;
+        std::memcpy(static_cast<uint8_t*>(allocation.data) + offset, page.data.data(), VirtualTexture::PAGE_BYTES);
+        regions.push_back(make_page_copy(slot, allocation.offset + offset));
+
+        recorded_pages.push_back({ page.entry, static_cast<uint32_t>(slot), slots[slot].entry });
+        if(slots[slot].entry != INVALID_PAGE)
+            resident_pages.erase(slots[slot].entry);
+
+        slots[slot] = { page.entry, frame, false };
+        resident_pages[page.entry] = static_cast<uint32_t>(slot);
+    }
+
+    // Over the budget
+    if(i < pages.size())
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded_pages.insert(loaded_pages.end(), std::make_move_iterator(pages.begin() + i), std::make_move_iterator(pages.end()));
+    }
+
+    if(regions.empty())
+        return false;
+
+    staging.push_back(allocation.buffer);
+    texture->copy_regions(*allocation.buffer, regions, command_buffer);
+
+    return true;
+}
+
+void VirtualTextureCache::commit()
+{
+    auto now = Clock::now();
+
+    for(auto &&page : recorded_pages)
+    {
+        if(page.evicted_entry != INVALID_PAGE)
+            page_table_entries[page.evicted_entry] = 0;
+
+        page_table_entries[page.entry] = make_entry(page.slot);
+
+        reading_pages.erase(page.entry);
+
+        auto faulted = faulted_pages.find(page.entry);
+        if(faulted != faulted_pages.end())
+        {
+            fault_latency_sum += std::chrono::duration<double, std::milli>(now - faulted->second).count();
+            ++fault_count;
+            faulted_pages.erase(faulted);
+        }
+    }
+
+    recorded_pages.clear();
+    staging.clear();
+}
+
+VirtualTextureCache::Statistics VirtualTextureCache::take_statistics()
+{
+    Statistics taken;
+    taken.hit_rate           = requested_count > 0? static_cast<float>(hit_count) / static_cast<float>(requested_count) : 1.f;
+    taken.page_fault_latency = fault_count > 0? fault_latency_sum / static_cast<double>(fault_count) : 0.0;
+    taken.page_faults        = fault_count;
+
+    requested_count   = 0;
+    hit_count         = 0;
+    fault_count       = 0;
+    fault_latency_sum = 0.0;
+
+    return taken;
+}
+
+bool VirtualTextureCache::empty() const
+{
+    return registrations.empty();
+}
+
+void VirtualTextureCache::create_texture(VkCommandBuffer command_buffer)
+{
+    uint32_t size = SLOTS_PER_SIDE * VirtualTexture::STORED_PAGE_SIZE;
+    texture = Texture2D::create_array(VirtualTexture::FORMAT, size, size, 1, 1, device, command_buffer);
+}
+
+void VirtualTextureCache::release_expired()
+{
+    for(auto it = registrations.begin(); it != registrations.end();)
+    {
+        if(!it->texture.expired())
+        {
+            ++it;
+            continue;
+        }
+
+        for(auto &&slot : slots)
+            if(slot.entry != INVALID_PAGE && slot.entry >= it->first_entry && slot.entry < it->first_entry + it->page_count)
+            {
+                resident_pages.erase(slot.entry);
+                slot = Slot();
+            }
+
+        it = registrations.erase(it);
+    }
+}
+
+size_t VirtualTextureCache::find_registration(uint32_t entry) const
+{
+    auto registration = std::upper_bound
+    (
+        registrations.begin(), registrations.end(), entry,
+        [](uint32_t entry, auto &&registration) { return entry < registration.first_entry; }
+    );
+
+    if(registration == registrations.begin())
+        return registrations.size();
+
+    --registration;
+    if(entry >= registration->first_entry + registration->page_count)
+        return registrations.size();
+
+    return static_cast<size_t>(registration - registrations.begin());
+}
+
+size_t VirtualTextureCache::find_free_slot(uint64_t used_before) const
+{
+    size_t found = slots.size();
+    for(size_t i = 0; i < slots.size(); ++i)
+    {
+        if(slots[i].is_pinned || (slots[i].entry != INVALID_PAGE && slots[i].last_used >= used_before))
+            continue;
+
+        if(found == slots.size() || slots[i].entry == INVALID_PAGE || slots[i].last_used < slots[found].last_used)
+            found = i;
+
+        if(slots[found].entry == INVALID_PAGE)
+            break;
+    }
+
+    return found;
+}
+
+uint32_t VirtualTextureCache::make_entry(size_t slot) const
+{
+    return VALID_BIT | static_cast<uint32_t>(slot / SLOTS_PER_SIDE) << 8 | static_cast<uint32_t>(slot % SLOTS_PER_SIDE);
+}
+
+VkBufferImageCopy VirtualTextureCache::make_page_copy(size_t slot, VkDeviceSize buffer_offset) const
+{
+    VkBufferImageCopy region               = {};
+    region.bufferOffset                    = buffer_offset;
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel       = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount     = 1;
+    region.imageOffset.x                   = static_cast<int32_t>(slot % SLOTS_PER_SIDE * VirtualTexture::STORED_PAGE_SIZE);
+    region.imageOffset.y                   = static_cast<int32_t>(slot / SLOTS_PER_SIDE * VirtualTexture::STORED_PAGE_SIZE);
+    region.imageExtent                     = { VirtualTexture::STORED_PAGE_SIZE, VirtualTexture::STORED_PAGE_SIZE, 1 };
+
+    return region;
+}
+
+VirtualTexture::Page get_parent_page(const VirtualTexture &texture, const VirtualTexture::Page &page)
+{
+    auto extent = glm::vec2(VirtualTexture::get_level_extent(texture.get_width(), texture.get_height(), page.level));
+    auto center = (glm::vec2(page.x, page.y) + 0.5f) * static_cast<float>(VirtualTexture::PAGE_SIZE);
+    auto uv = glm::min(center / extent, glm::vec2(1.f));
+
+    uint32_t level = page.level + 1;
+    auto parent_extent = glm::vec2(VirtualTexture::get_level_extent(texture.get_width(), texture.get_height(), level));
+    auto grid = texture.get_page_grid(level);
+    auto parent = glm::min(glm::uvec2(uv * parent_extent) / VirtualTexture::PAGE_SIZE, grid - 1u);
+
+    return { level, parent.x, parent.y };
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+#ifndef CG_SEM5_VIRTUALTEXTURECACHE_H
+#define CG_SEM5_VIRTUALTEXTURECACHE_H
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include <tbb/task_group.h>
+
+#include "device.h"
+#include "devicebuffer.h"
+#include "texture2d.h"
+#include "virtualtexture.h"
+
+// Pages of every virtual texture share one physical cache image, a square grid of slots.
+// The page table is a host visible storage buffer read by shaders. Every added texture gets a header
+// [width, height, level count, first entry of every level] followed by one entry per page:
+// VALID_BIT | slot y << 8 | slot x for resident pages, 0 otherwise. Shaders fall back to coarser levels
+// until they find a resident page, the single page of the coarsest level is resident while the texture lives.
+// The feedback pass writes the entry index of the page each pixel wants, missing pages are read from
+// the mapped files on TBB workers and uploaded a few per update, least recently used pages are evicted.
+// Page table space of released textures isn't reused
+class VirtualTextureCache
+{
+public:
+    static constexpr uint32_t SLOTS_PER_SIDE         = 16;
+    static constexpr uint32_t PAGE_TABLE_CAPACITY    = 1 << 20; // Entries, 4 MiB
+    static constexpr uint32_t MAX_UPLOADS_PER_UPDATE = 16;
+    static constexpr uint32_t MAX_PENDING_READS      = 2 * MAX_UPLOADS_PER_UPDATE;
+
+    static constexpr uint32_t VALID_BIT    = 0x80000000;
+    static constexpr uint32_t INVALID_PAGE = 0xffffffff; // Feedback of pixels without a virtual texture
+
+    struct Statistics
+    {
+        float  hit_rate           = 1.f; // Requested pages that were resident
+        double page_fault_latency = 0.0; // Milliseconds from the first request of a page to its upload
+        size_t page_faults        = 0;
+    };
+
+    VirtualTextureCache(std::shared_ptr<Device>);
+    ~VirtualTextureCache();
+
+    VirtualTextureCache(const VirtualTextureCache &) = delete;
+    VirtualTextureCache &operator=(const VirtualTextureCache &) = delete;
+
+    // Records the upload of the coarsest page into command_buffer, staging must live until it is executed.
+    // Returns the texture already added for the same file, if any
+    std::shared_ptr<VirtualTexture> add
+    (
+        std::shared_ptr<VirtualTexture>,
+        VkCommandBuffer command_buffer,
+        std::shared_ptr<DeviceBuffer> &staging
+    );
+
+    // Header of the texture in the page table, -1 for textures never added
+    int32_t get_page_table_offset(const VirtualTexture *) const;
+
+    // Created with the first added texture
+    const std::shared_ptr<Texture2D> &get_texture() const;
+
+    const std::shared_ptr<DeviceBuffer> &get_page_table() const;
+
+    // Entries the feedback pass wrote in one frame. Missing pages start loading, coarser levels first
+    void request(const uint32_t *entries, size_t count);
+
+    // Records the uploads of loaded pages into command_buffer, returns true if anything was recorded
+    bool record(VkCommandBuffer);
+
+    // Call after the recorded command buffer is executed and before the next frame: entries point to the new pages
+    void commit();
+
+    // Since the previous call
+    Statistics take_statistics();
+
+    bool empty() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Registration
+    {
+        std::weak_ptr<VirtualTexture> texture;
+        std::string path;
+        uint32_t    header;
+        uint32_t    first_entry;
+        uint32_t    page_count;
+    };
+
+    struct Slot
+    {
+        uint32_t entry     = INVALID_PAGE;
+        uint64_t last_used = 0;
+        bool     is_pinned = false;
+    };
+
+    struct LoadedPage
+    {
+        uint32_t             entry;
+        std::vector<uint8_t> data;
+    };
+
+    struct RecordedPage
+    {
+        uint32_t entry;
+        uint32_t slot;
+        uint32_t evicted_entry;
+    };
+
+    void create_texture(VkCommandBuffer);
+    void release_expired();
+
+    // Index of the registration owning the entry, or registrations.size()
+    size_t find_registration(uint32_t entry) const;
+
+    // Free or least recently used slot that isn't pinned or used since used_before, or slots.size()
+    size_t find_free_slot(uint64_t used_before) const;
+
+    uint32_t make_entry(size_t slot) const;
+    VkBufferImageCopy make_page_copy(size_t slot, VkDeviceSize buffer_offset) const;
+
+    std::shared_ptr<Device> device;
+
+    std::shared_ptr<Texture2D>    texture;
+    std::shared_ptr<DeviceBuffer> page_table;
+    uint32_t                     *page_table_entries;
+    uint32_t                      page_table_size;
+
+    std::vector<Registration> registrations; // In page table order
+    std::vector<Slot>         slots;
+    std::unordered_map<uint32_t, uint32_t>          resident_pages; // Entry to slot
+    std::unordered_set<uint32_t>                    reading_pages;  // Read on workers or waiting for upload
+    std::unordered_map<uint32_t, Clock::time_point> faulted_pages;  // Entry to the time of its first request
+    std::vector<RecordedPage> recorded_pages;
+    std::vector<std::shared_ptr<DeviceBuffer>> staging;
+    uint64_t frame;
+
+    size_t requested_count;
+    size_t hit_count;
+    size_t fault_count;
+    double fault_latency_sum;
+
+    tbb::task_group workers;
+
+    std::mutex mutex;
+    std::vector<LoadedPage> loaded_pages;
+};
+
+#endif // CG_SEM5_VIRTUALTEXTURECACHE_H
\ No newline at end of file
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "virtualtexturefeedback.h"
+#include "vkassert.h"
+
+VirtualTextureFeedback::VirtualTextureFeedback
+(
+    std::shared_ptr<Device> device,
+    uint32_t framebuffer_width,
+    uint32_t framebuffer_height,
+    VkFormat depth_format
+)
+: device(device),
+width(std::max(framebuffer_width / SCALE, 1u)),
+height(std::max(framebuffer_height / SCALE, 1u)),
+color(),
+depth(),
+render_pass(VK_NULL_HANDLE),
+framebuffer(VK_NULL_HANDLE),
+readback(std::make_shared<DeviceBuffer>())
+{
+    create_attachment(FORMAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, color);
+
+    bool has_stencil = depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT
+                    || depth_format == VK_FORMAT_D24_UNORM_S8_UINT
+                    || depth_format == VK_FORMAT_D16_UNORM_S8_UINT;
+    VkImageAspectFlags depth_aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (has_stencil? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+    create_attachment(depth_format, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depth_aspect, depth);
+
+    std::array<VkAttachmentDescription, 2> attachments = {};
+    attachments[0].format         = FORMAT;
+    attachments[0].samples        = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp        = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout    = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    attachments[1].format         = depth_format;
+    attachments[1].samples        = VK_SAMPLE_COUNT_1_BIT;
+    attachments[1].loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[1].finalLayout    = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference color_reference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkAttachmentReference depth_reference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+    VkSubpassDescription subpass_description    = {};
+    subpass_description.pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass_description.colorAttachmentCount    = 1;
+    subpass_description.pColorAttachments       = &color_reference;
+    subpass_description.pDepthStencilAttachment = &depth_reference;
+
+    // The previous copy has read the image before it's cleared, and the pass is written before the copy
+    std::array<VkSubpassDependency, 2> dependencies;
+    dependencies[0].srcSubpass      = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass      = 0;
+    dependencies[0].srcStageMask    = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[0].dstStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependencies[0].srcAccessMask   = VK_ACCESS_TRANSFER_READ_BIT;
+    dependencies[0].dstAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[0].dependencyFlags = 0;
+
+    dependencies[1].srcSubpass      = 0;
+    dependencies[1].dstSubpass      = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].dstStageMask    = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].srcAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstAccessMask   = VK_ACCESS_TRANSFER_READ_BIT;
+    dependencies[1].dependencyFlags = 0;
+
+    VkRenderPassCreateInfo renderpass_create_info = {};
+    renderpass_create_info.sType                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderpass_create_info.attachmentCount        = static_cast<uint32_t>(attachments.size());
+    renderpass_create_info.pAttachments           = attachments.data();
+    renderpass_create_info.subpassCount           = 1;
+    renderpass_create_info.pSubpasses             = &subpass_description;
+    renderpass_create_info.dependencyCount        = static_cast<uint32_t>(dependencies.size());
+    renderpass_create_info.pDependencies          = dependencies.data();
+
+    vk_assert
+    (
+        vkCreateRenderPass(*device, &renderpass_create_info, nullptr, &render_pass),
+        "Can't create render pass for virtual texture feedback"
+    );
+
+    std::array<VkImageView, 2> views = { color.view, depth.view };
+
+    VkFramebufferCreateInfo framebuffer_create_info = {};
+    framebuffer_create_info.sType                   = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebuffer_create_info.renderPass              = render_pass;
+    framebuffer_create_info.attachmentCount         = static_cast<uint32_t>(views.size());
+    framebuffer_create_info.pAttachments            = views.data();
+    framebuffer_create_info.width                   = width;
+    framebuffer_create_info.height                  = height;
+    framebuffer_create_info.layers                  = 1;
+
+    vk_assert
+    (
+        vkCreateFramebuffer(*device, &framebuffer_create_info, nullptr, &framebuffer),
+        "Can't create framebuffer for virtual texture feedback"
+    );
+
+    vk_assert
+    (
+        device->create_buffer
+        (
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            readback,
+            get_size() * sizeof(uint32_t)
+        ),
+        "Can't create buffer for virtual texture feedback"
+    );
+
+    vk_assert
+    (
+        readback->map(),
+        "Can't map virtual texture feedback"
+    );
+
+    // Nothing is requested before the first pass
+    std::memset(readback->mapped_memory, 0xff, get_size() * sizeof(uint32_t));
+}
+
+VirtualTextureFeedback::~VirtualTextureFeedback()
+{
+    readback.reset();
+
+    vkDestroyFramebuffer(*device, framebuffer, nullptr);
+    vkDestroyRenderPass(*device, render_pass, nullptr);
+
+    destroy_attachment(depth);
+    destroy_attachment(color);
+}
+
+VkRenderPass VirtualTextureFeedback::get_render_pass() const
+{
+    return render_pass;
+}
+
+void VirtualTextureFeedback::begin(VkCommandBuffer command_buffer)
+{
+    VkClearValue clear_values[2];
+    clear_values[0].color.uint32[0] = 0xffffffff;
+    clear_values[1].depthStencil    = { 1.f, 0 };
+
+    VkRenderPassBeginInfo renderpass_begin_info    = {};
+    renderpass_begin_info.sType                    = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderpass_begin_info.renderPass               = render_pass;
+    renderpass_begin_info.framebuffer              = framebuffer;
+    renderpass_begin_info.renderArea.extent.width  = width;
+    renderpass_begin_info.renderArea.extent.height = height;
+    renderpass_begin_info.clearValueCount          = 2;
+    renderpass_begin_info.pClearValues             = clear_values;
+
+    vkCmdBeginRenderPass(command_buffer, &renderpass_begin_info, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport = {};
+    viewport.width      = static_cast<float>(width);
+    viewport.height     = static_cast<float>(height);
+    viewport.minDepth   = 0.f;
+    viewport.maxDepth   = 1.f;
+    vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+
+    VkRect2D scissor = {};
+    scissor.extent   = { width, height };
+    vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+}
+
+void VirtualTextureFeedback::end(VkCommandBuffer command_buffer)
+{
+    vkCmdEndRenderPass(command_buffer);
+
+    VkBufferImageCopy region               = {};
+    region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount     = 1;
+    region.imageExtent                     = { width, height, 1 };
+
+    vkCmdCopyImageToBuffer(command_buffer, color.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, *readback, 1, &region);
+
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask         = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask         = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer                = *readback;
+    barrier.offset                = 0;
+    barrier.size                  = VK_WHOLE_SIZE;
+
+    vkCmdPipelineBarrier
+    (
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, nullptr,
+        1, &barrier,
+        0, nullptr
+    );
+}
+
+const uint32_t *VirtualTextureFeedback::get_data() const
+{
+    return static_cast<const uint32_t*>(readback->mapped_memory);
+}
+
+size_t VirtualTextureFeedback::get_size() const
+{
+    return static_cast<size_t>(width) * height;
+}
+
+void VirtualTextureFeedback::create_attachment(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, Attachment &attachment)
+{
+    VkImageCreateInfo image_create_info = {};
+    image_create_info.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_create_info.imageType         = VK_IMAGE_TYPE_2D;
+    image_create_info.format            = format;
+    image_create_info.extent            = { width, height, 1 };
+    image_create_info.mipLevels         = 1;
+    image_create_info.arrayLayers       = 1;
+    image_create_info.samples           = VK_SAMPLE_COUNT_1_BIT;
+    image_create_info.tiling            = VK_IMAGE_TILING_OPTIMAL;
+    image_create_info.usage             = usage;
+
+    vk_assert
+    (
+        vkCreateImage(*device, &image_create_info, nullptr, &attachment.image),
+        "Can't create virtual texture feedback image"
+    );
+
+    VkMemoryRequirements memory_reqs;
+    vkGetImageMemoryRequirements(*device, attachment.image, &memory_reqs);
+
+    VkMemoryAllocateInfo allocate_info = {};
+    allocate_info.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.allocationSize       = memory_reqs.size;
+    allocate_info.memoryTypeIndex      = device->find_memory_type(memory_reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT).value();
+    vk_assert
+    (
+        vkAllocateMemory(*device, &allocate_info, nullptr, &attachment.memory),
+        "Can't allocate virtual texture feedback memory"
+    );
+
+    vk_assert
+    (
+        vkBindImageMemory(*device, attachment.image, attachment.memory, 0),
+        "Can't bind virtual texture feedback memory"
+    );
+
+    VkImageViewCreateInfo view_create_info = {};
+    view_create_info.sType                 = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    view_create_info.viewType              = VK_IMAGE_VIEW_TYPE_2D;
+    view_create_info.format                = format;
+    view_create_info.subresourceRange      = { aspect, 0, 1, 0, 1 };
+    view_create_info.image                 = attachment.image;
+
+    vk_assert
+    (
+        vkCreateImageView(*device, &view_create_info, nullptr, &attachment.view),
+        "Can't create virtual texture feedback image view"
+    );
+}
+
+void VirtualTextureFeedback::destroy_attachment(Attachment &attachment)
+{
+    vkDestroyImageView(*device, attachment.view, nullptr);
+    vkDestroyImage(*device, attachment.image, nullptr);
+    vkFreeMemory(*device, attachment.memory, nullptr);
+}
\ No newline at end of file
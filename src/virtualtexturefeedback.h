@@ -0,0 +1,66 @@
+#ifndef CG_SEM5_VIRTUALTEXTUREFEEDBACK_H
+#define CG_SEM5_VIRTUALTEXTUREFEEDBACK_H
+
+#include <memory>
+#include <vulkan/vulkan.h>
+
+#include "device.h"
+#include "devicebuffer.h"
+
+// Low resolution pass writing the page table entry every pixel wants, VirtualTextureCache::INVALID_PAGE where
+// no virtual texture is drawn. It is copied into host visible memory and read after the frame is executed.
+// Plain color attachment writes, so it needs neither storage images nor atomics
+class VirtualTextureFeedback
+{
+public:
+    static constexpr uint32_t SCALE  = 8; // Framebuffer side over feedback side, shaders bias the LOD by log2(SCALE)
+    static constexpr VkFormat FORMAT = VK_FORMAT_R32_UINT;
+
+    VirtualTextureFeedback
+    (
+        std::shared_ptr<Device>,
+        uint32_t framebuffer_width,
+        uint32_t framebuffer_height,
+        VkFormat depth_format
+    );
+
+    ~VirtualTextureFeedback();
+
+    VirtualTextureFeedback(const VirtualTextureFeedback &) = delete;
+    VirtualTextureFeedback &operator=(const VirtualTextureFeedback &) = delete;
+
+    VkRenderPass get_render_pass() const;
+
+    // Begins the render pass and sets the viewport and the scissor
+    void begin(VkCommandBuffer);
+
+    // Ends the render pass and records the copy into host memory
+    void end(VkCommandBuffer);
+
+    // Entries of the last executed pass, row by row
+    const uint32_t *get_data() const;
+    size_t get_size() const;
+
+private:
+    struct Attachment
+    {
+        VkImage        image  = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkImageView    view   = VK_NULL_HANDLE;
+    };
+
+    void create_attachment(VkFormat, VkImageUsageFlags, VkImageAspectFlags, Attachment &);
+    void destroy_attachment(Attachment &);
+
+    std::shared_ptr<Device> device;
+    uint32_t width, height;
+
+    Attachment    color;
+    Attachment    depth;
+    VkRenderPass  render_pass;
+    VkFramebuffer framebuffer;
+
+    std::shared_ptr<DeviceBuffer> readback;
+};
+
+#endif // CG_SEM5_VIRTUALTEXTUREFEEDBACK_H
\ No newline at end of file
@@ -39,6 +39,7 @@ public:
 
     void set_resize_callback(std::function<void()>);
 
+    // Framebuffer pixels, the origin is at the top left corner of the view
     void set_mouse_move_callback(std::function<void(int32_t, int32_t)>);
 
     void set_mouse_down_callback(std::function<void(MouseButton)>);
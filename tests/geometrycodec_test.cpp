@@ -0,0 +1,233 @@
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "geometrycodec.h"
+
+struct TestVertex
+{
+    float position[3];
+    float normal[3];
+    float uv[2];
+    uint8_t color[4];
+};
+
+std::vector<MeshElementIndex> make_indices(size_t count);
+std::vector<TestVertex> make_vertices(size_t count);
+
+void expect_indices_round_trip(const std::vector<MeshElementIndex> &indices)
+{
+    auto data = GeometryCodec::encode_indices(indices.data(), indices.size());
+
+    std::vector<MeshElementIndex> decoded(indices.size());
+    GeometryCodec::decode_indices(data.data(), data.size(), decoded.data(), decoded.size());
+
+    EXPECT_EQ(decoded, indices);
+}
+
+void expect_vertices_round_trip(const std::vector<TestVertex> &vertices)
+{
+    auto data = GeometryCodec::encode_vertices(vertices.data(), vertices.size(), sizeof(TestVertex));
+
+    std::vector<TestVertex> decoded(vertices.size());
+    GeometryCodec::decode_vertices(data.data(), data.size(), decoded.data(), decoded.size(), sizeof(TestVertex));
+
+    EXPECT_EQ(std::memcmp(decoded.data(), vertices.data(), vertices.size() * sizeof(TestVertex)), 0);
+}
+
+TEST(GeometryCodec, EmptyIndices)
+{
+    auto data = GeometryCodec::encode_indices(nullptr, 0);
+    EXPECT_TRUE(data.empty());
+
+    EXPECT_NO_THROW(GeometryCodec::decode_indices(data.data(), data.size(), nullptr, 0));
+}
+
+TEST(GeometryCodec, SingleIndex)
+{
+    expect_indices_round_trip({ 7 });
+}
+
+TEST(GeometryCodec, IndicesRoundTrip)
+{
+    expect_indices_round_trip(make_indices(3 * 1000 + 1));
+}
+
+TEST(GeometryCodec, ExtremeIndices)
+{
+    expect_indices_round_trip({ 0, 0xffffffffu, 0, 0x80000000u, 0x7fffffffu, 0xffffffffu, 1 });
+}
+
+TEST(GeometryCodec, TruncatedIndices)
+{
+    auto indices = make_indices(100);
+    auto data = GeometryCodec::encode_indices(indices.data(), indices.size());
+
+    std::vector<MeshElementIndex> decoded(indices.size());
+    EXPECT_THROW(GeometryCodec::decode_indices(data.data(), data.size() - 1, decoded.data(), decoded.size()), std::runtime_error);
+}
+
+TEST(GeometryCodec, TrailingIndexBytes)
+{
+    auto indices = make_indices(100);
+    auto data = GeometryCodec::encode_indices(indices.data(), indices.size());
+    data.push_back(0);
+
+    std::vector<MeshElementIndex> decoded(indices.size());
+    EXPECT_THROW(GeometryCodec::decode_indices(data.data(), data.size(), decoded.data(), decoded.size()), std::runtime_error);
+}
+
+TEST(GeometryCodec, OverlongIndexVarint)
+{
+    std::vector<uint8_t> data(6, 0x80);
+    data.push_back(0);
+
+    MeshElementIndex index;
+    EXPECT_THROW(GeometryCodec::decode_indices(data.data(), data.size(), &index, 1), std::runtime_error);
+}
+
+TEST(GeometryCodec, EmptyVertices)
+{
+    auto data = GeometryCodec::encode_vertices(nullptr, 0, sizeof(TestVertex));
+    EXPECT_TRUE(data.empty());
+
+    EXPECT_NO_THROW(GeometryCodec::decode_vertices(data.data(), data.size(), nullptr, 0, sizeof(TestVertex)));
+}
+
+TEST(GeometryCodec, SingleVertex)
+{
+    expect_vertices_round_trip(make_vertices(1));
+}
+
+TEST(GeometryCodec, WholeBlocks)
+{
+    expect_vertices_round_trip(make_vertices(4 * GeometryCodec::BLOCK_SIZE));
+}
+
+TEST(GeometryCodec, PartialLastBlock)
+{
+    expect_vertices_round_trip(make_vertices(4 * GeometryCodec::BLOCK_SIZE + 5));
+    expect_vertices_round_trip(make_vertices(GeometryCodec::BLOCK_SIZE - 1));
+}
+
+TEST(GeometryCodec, EveryPlaneMode)
+{
+    // Constant, small, medium and random deltas select the 0, 2, 4 and 8 bit modes.
+    // Odd stride, the planes don't fill the last mode byte
+    constexpr size_t COUNT  = 37;
+    constexpr size_t STRIDE = 5;
+
+    std::mt19937 random(3);
+    std::vector<uint8_t> vertices(COUNT * STRIDE);
+    for(size_t i = 0; i < COUNT; ++i)
+    {
+        vertices[i * STRIDE + 0] = 42;
+        vertices[i * STRIDE + 1] = static_cast<uint8_t>(i % 2);
+        vertices[i * STRIDE + 2] = static_cast<uint8_t>(i * 7 % 16);
+        vertices[i * STRIDE + 3] = static_cast<uint8_t>(random());
+        vertices[i * STRIDE + 4] = static_cast<uint8_t>(i);
+    }
+
+    auto data = GeometryCodec::encode_vertices(vertices.data(), COUNT, STRIDE);
+
+    std::vector<uint8_t> decoded(vertices.size());
+    GeometryCodec::decode_vertices(data.data(), data.size(), decoded.data(), COUNT, STRIDE);
+
+    EXPECT_EQ(decoded, vertices);
+}
+
+TEST(GeometryCodec, TruncatedVertices)
+{
+    auto vertices = make_vertices(40);
+    auto data = GeometryCodec::encode_vertices(vertices.data(), vertices.size(), sizeof(TestVertex));
+
+    std::vector<TestVertex> decoded(vertices.size());
+    for(size_t size : { size_t(0), size_t(1), data.size() / 2, data.size() - 1 })
+        EXPECT_THROW
+        (
+            GeometryCodec::decode_vertices(data.data(), size, decoded.data(), decoded.size(), sizeof(TestVertex)),
+            std::runtime_error
+        );
+}
+
+TEST(GeometryCodec, TrailingVertexBytes)
+{
+    auto vertices = make_vertices(40);
+    auto data = GeometryCodec::encode_vertices(vertices.data(), vertices.size(), sizeof(TestVertex));
+    data.push_back(0);
+
+    std::vector<TestVertex> decoded(vertices.size());
+    EXPECT_THROW
+    (
+        GeometryCodec::decode_vertices(data.data(), data.size(), decoded.data(), decoded.size(), sizeof(TestVertex)),
+        std::runtime_error
+    );
+}
+
+TEST(GeometryCodec, VertexCountMismatch)
+{
+    auto vertices = make_vertices(40);
+    auto data = GeometryCodec::encode_vertices(vertices.data(), vertices.size(), sizeof(TestVertex));
+
+    // One block more than encoded runs past the end, one less leaves bytes behind
+    std::vector<TestVertex> decoded(vertices.size() + GeometryCodec::BLOCK_SIZE);
+    EXPECT_THROW
+    (
+        GeometryCodec::decode_vertices(data.data(), data.size(), decoded.data(), decoded.size(), sizeof(TestVertex)),
+        std::runtime_error
+    );
+    EXPECT_THROW
+    (
+        GeometryCodec::decode_vertices(data.data(), data.size(), decoded.data(), vertices.size() - GeometryCodec::BLOCK_SIZE, sizeof(TestVertex)),
+        std::runtime_error
+    );
+}
+
+std::vector<MeshElementIndex> make_indices(size_t count)
+{
+    // Mostly local triangles with occasional jumps, like a mesh after vertex cache optimization
+    std::mt19937 random(1);
+    std::uniform_int_distribution<MeshElementIndex> step(0, 8);
+    std::uniform_int_distribution<MeshElementIndex> jump(0, 1 << 20);
+
+    std::vector<MeshElementIndex> indices(count);
+    MeshElementIndex base = 0;
+    for(size_t i = 0; i < count; ++i)
+    {
+        if(i % 64 == 0)
+            base = jump(random);
+
+        indices[i] = base + step(random);
+    }
+
+    return indices;
+}
+
+std::vector<TestVertex> make_vertices(size_t count)
+{
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> noise(-0.01f, 0.01f);
+
+    std::vector<TestVertex> vertices(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        auto &vertex = vertices[i];
+        vertex.position[0] = static_cast<float>(i) * 0.1f + noise(random);
+        vertex.position[1] = 1.f + noise(random);
+        vertex.position[2] = -2.f;
+        vertex.normal[0]   = 0.f;
+        vertex.normal[1]   = 1.f;
+        vertex.normal[2]   = noise(random);
+        vertex.uv[0]       = static_cast<float>(i % 16) / 16.f;
+        vertex.uv[1]       = 0.5f;
+        vertex.color[0]    = 255;
+        vertex.color[1]    = static_cast<uint8_t>(i);
+        vertex.color[2]    = static_cast<uint8_t>(random());
+        vertex.color[3]    = 0;
+    }
+
+    return vertices;
+}
\ No newline at end of file
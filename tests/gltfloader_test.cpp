@@ -0,0 +1,119 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gltfloader.h"
+
+// One triangle in the xz plane facing +y, attributes interleaved like StaticMesh::Vertex
+struct GlbOptions
+{
+    bool        has_normals = true;
+    std::string node_extra; // Appended to the JSON of the only node
+};
+
+std::string write_glb(const std::string &name, const GlbOptions &);
+
+void expect_normals(const GltfLoader::Mesh &mesh, const glm::vec3 &expected)
+{
+    ASSERT_FALSE(mesh.vertices.empty());
+    for(auto &&vertex : mesh.vertices)
+    {
+        EXPECT_NEAR(vertex.normal.x, expected.x, 1e-6f);
+        EXPECT_NEAR(vertex.normal.y, expected.y, 1e-6f);
+        EXPECT_NEAR(vertex.normal.z, expected.z, 1e-6f);
+    }
+}
+
+// Normals are flipped in y like in the generic importer path, whichever way the vertices are read
+
+TEST(GltfLoader, InterleavedNormalsAreFlipped)
+{
+    auto mesh = GltfLoader::load(write_glb("interleaved.glb", {}));
+
+    expect_normals(mesh, glm::vec3(0.f, -1.f, 0.f));
+    EXPECT_EQ(mesh.indices, std::vector<MeshElementIndex>({ 0, 1, 2 }));
+}
+
+TEST(GltfLoader, TransformedNormalsAreFlipped)
+{
+    auto mesh = GltfLoader::load(write_glb("transformed.glb", { true, ", \"translation\": [1, 2, 3]" }));
+
+    expect_normals(mesh, glm::vec3(0.f, -1.f, 0.f));
+    EXPECT_FLOAT_EQ(mesh.vertices[0].position.y, 2.f);
+}
+
+TEST(GltfLoader, FlatNormalsAreFlipped)
+{
+    auto mesh = GltfLoader::load(write_glb("flat.glb", { false, "" }));
+
+    EXPECT_EQ(mesh.vertices.size(), 3u);
+    expect_normals(mesh, glm::vec3(0.f, -1.f, 0.f));
+}
+
+std::string write_glb(const std::string &name, const GlbOptions &options)
+{
+    const float vertices[3][11] =
+    {
+        { 0.f, 0.f, 0.f,   0.f, 1.f, 0.f,   0.f, 0.f,   1.f, 1.f, 1.f },
+        { 0.f, 0.f, 1.f,   0.f, 1.f, 0.f,   0.f, 1.f,   1.f, 1.f, 1.f },
+        { 1.f, 0.f, 0.f,   0.f, 1.f, 0.f,   1.f, 0.f,   1.f, 1.f, 1.f }
+    };
+    const uint32_t indices[3] = { 0, 1, 2 };
+
+    static_assert(sizeof(vertices[0]) == sizeof(StaticMesh::Vertex));
+
+    std::vector<uint8_t> bin(sizeof(vertices) + sizeof(indices));
+    std::memcpy(bin.data(), vertices, sizeof(vertices));
+    std::memcpy(bin.data() + sizeof(vertices), indices, sizeof(indices));
+
+    std::string normal_attribute = options.has_normals? "\"NORMAL\": 1, " : "";
+    std::string json =
+        "{"
+        "\"asset\": {\"version\": \"2.0\"},"
+        "\"buffers\": [{\"byteLength\": " + std::to_string(bin.size()) + "}],"
+        "\"bufferViews\": ["
+            "{\"buffer\": 0, \"byteOffset\": 0, \"byteLength\": " + std::to_string(sizeof(vertices)) + ", \"byteStride\": 44},"
+            "{\"buffer\": 0, \"byteOffset\": " + std::to_string(sizeof(vertices)) + ", \"byteLength\": " + std::to_string(sizeof(indices)) + "}"
+        "],"
+        "\"accessors\": ["
+            "{\"bufferView\": 0, \"byteOffset\": 0, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\"},"
+            "{\"bufferView\": 0, \"byteOffset\": 12, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\"},"
+            "{\"bufferView\": 0, \"byteOffset\": 24, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC2\"},"
+            "{\"bufferView\": 0, \"byteOffset\": 32, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\"},"
+            "{\"bufferView\": 1, \"componentType\": 5125, \"count\": 3, \"type\": \"SCALAR\"}"
+        "],"
+        "\"meshes\": [{\"primitives\": [{\"attributes\": {\"POSITION\": 0, " + normal_attribute + "\"TEXCOORD_0\": 2, \"COLOR_0\": 3}, \"indices\": 4}]}],"
+        "\"nodes\": [{\"mesh\": 0" + options.node_extra + "}],"
+        "\"scenes\": [{\"nodes\": [0]}],"
+        "\"scene\": 0"
+        "}";
+
+    // Chunks are 4-byte aligned, JSON is padded with spaces
+    json.resize((json.size() + 3) / 4 * 4, ' ');
+
+    auto write = [](std::ofstream &file, uint32_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+
+    auto path = (std::filesystem::temp_directory_path() / name).string();
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    write(file, 0x46546c67); // glTF
+    write(file, 2);
+    write(file, static_cast<uint32_t>(12 + 8 + json.size() + 8 + bin.size()));
+
+    write(file, static_cast<uint32_t>(json.size()));
+    write(file, 0x4e4f534a); // JSON
+    file.write(json.data(), static_cast<std::streamsize>(json.size()));
+
+    write(file, static_cast<uint32_t>(bin.size()));
+    write(file, 0x004e4942); // BIN
+    file.write(reinterpret_cast<const char*>(bin.data()), static_cast<std::streamsize>(bin.size()));
+
+    return path;
+}
\ No newline at end of file